@@ -11,10 +11,18 @@
         'conditions': [
             ['couchbase_root==""', {
                 'defines': [
-                    'LIBCOUCHBASE_STATIC'
+                    'LIBCOUCHBASE_STATIC',
+                    'LCBX_HAVE_SNAPPY',
+                    'LCBX_HAVE_HDRHISTOGRAM'
+                ],
+                'include_dirs': [
+                    'deps/lcb/contrib/snappy',
+                    'deps/lcb/contrib/HdrHistogram_c/src'
                 ],
                 'dependencies': [
-                    'deps/lcb/libcouchbase.gyp:couchbase'
+                    'deps/lcb/libcouchbase.gyp:couchbase',
+                    'deps/lcb/libcouchbase.gyp:snappy',
+                    'deps/lcb/libcouchbase.gyp:HdrHistogram_c'
                 ]
             }, {
                 'conditions': [
@@ -79,6 +87,7 @@
             'src/error.cpp',
             'src/instance.cpp',
             'src/instance_callbacks.cpp',
+            'src/iothread.cpp',
             'src/lcbx.cpp',
             'src/logger.cpp',
             'src/metrics.cpp',
@@ -86,6 +95,7 @@
             'src/opbuilder.cpp',
             'src/respreader.cpp',
             'src/tracing.cpp',
+            'src/transcoder.cpp',
             'src/uv-plugin-all.cpp'
         ],
         'include_dirs': [
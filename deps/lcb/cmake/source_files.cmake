@@ -82,6 +82,7 @@ SET(LCB_CORE_CXXSRC
     src/newconfig.cc
     src/nodeinfo.cc
     src/operations/cbflush.cc
+    src/operations/clone.cc
     src/operations/counter.cc
     src/operations/durability-seqno.cc
     src/operations/durability.cc
@@ -1326,11 +1326,168 @@ typedef enum {
  */
 #define LCB_CNTL_ENABLE_OP_METRICS 0x67
 
+/**
+ * @brief Enable/disable loading of the collections manifest at bootstrap.
+ *
+ * When enabled, the collections manifest of the bucket is requested as soon as
+ * the first cluster configuration is received, and every collection it lists is
+ * added to the collection ID cache. Operations on those collections then do
+ * not need a separate collection ID lookup on first use.
+ *
+ * Use `prefetch_collections` in the connection string.
+ *
+ * @cntl_arg_both{int* (as boolean)}
+ * @uncommitted
+ */
+#define LCB_CNTL_PREFETCH_COLLECTIONS 0x68
+
+/**
+ * @brief Maximum number of prepared statements kept in the query plan cache.
+ *
+ * When the cache is full, the least recently used statement is evicted to make
+ * room for a new one. Lowering the value evicts any statements which no longer
+ * fit right away. The value must not be zero, and defaults to 5000.
+ *
+ * Use `query_cache_size` in the connection string.
+ *
+ * @cntl_arg_both{lcb_U32*}
+ * @uncommitted
+ */
+#define LCB_CNTL_QUERY_CACHE_SIZE 0x69
+
+/** @brief Counters of the query plan cache, see @ref LCB_CNTL_QUERY_CACHE_STATS */
+typedef struct {
+    lcb_U64 hits;      /**< Number of queries which found their plan in the cache */
+    lcb_U64 misses;    /**< Number of queries which had to prepare their statement */
+    lcb_U64 evictions; /**< Number of plans evicted to make room for others */
+    lcb_SIZE size;     /**< Number of plans currently in the cache */
+    lcb_SIZE capacity; /**< Maximum number of plans, see @ref LCB_CNTL_QUERY_CACHE_SIZE */
+} lcb_QUERY_CACHE_STATS;
+
+/**
+ * @brief Get the counters of the query plan cache.
+ *
+ * The counters cover the lifetime of the instance, and are not reset when the
+ * cache is cleared.
+ *
+ * @cntl_arg_getonly{lcb_QUERY_CACHE_STATS*}
+ * @uncommitted
+ */
+#define LCB_CNTL_QUERY_CACHE_STATS 0x6A
+
+/**
+ * @brief Enable/disable the structural scanner for streaming responses.
+ *
+ * When enabled, the rows of query, search, analytics and view responses are
+ * located by scanning only for quotes, brackets, braces and commas, several
+ * bytes at a time, and are handed out without being copied unless they span
+ * more than one network read. The rows themselves are not validated as JSON
+ * until they are decoded by the application.
+ *
+ * Use `enable_row_scanner` in the connection string.
+ *
+ * @cntl_arg_both{int* (as boolean)}
+ * @uncommitted
+ */
+#define LCB_CNTL_ENABLE_ROW_SCANNER 0x6B
+
+/**
+ * @brief Maximum number of bytes of key-value requests queued for one server.
+ *
+ * Once the requests which are queued for, or awaiting a response from, a
+ * server hold this many bytes of headers, keys and values, new key-value
+ * operations routed to it fail with @ref LCB_ERR_REQUEST_BUDGET_EXCEEDED
+ * rather than being queued. The check is made before each request is built,
+ * so the budget may be exceeded by at most one request. Values passed without
+ * being copied are counted too. 0 (the default) means no limit.
+ *
+ * Use `kv_pipeline_max_bytes` in the connection string.
+ *
+ * @cntl_arg_both{lcb_SIZE*}
+ * @uncommitted
+ */
+#define LCB_CNTL_KV_PIPELINE_MAX_BYTES 0x6C
+
+/**
+ * @brief Maximum number of key-value requests queued for one server.
+ *
+ * Like @ref LCB_CNTL_KV_PIPELINE_MAX_BYTES, but limits the number of requests.
+ *
+ * Use `kv_pipeline_max_requests` in the connection string.
+ *
+ * @cntl_arg_both{lcb_SIZE*}
+ * @uncommitted
+ */
+#define LCB_CNTL_KV_PIPELINE_MAX_REQUESTS 0x6D
+
+/**
+ * @brief Maximum number of bytes of key-value requests queued for all servers.
+ *
+ * Like @ref LCB_CNTL_KV_PIPELINE_MAX_BYTES, but applies to the instance as a
+ * whole.
+ *
+ * Use `kv_max_bytes` in the connection string.
+ *
+ * @cntl_arg_both{lcb_SIZE*}
+ * @uncommitted
+ */
+#define LCB_CNTL_KV_MAX_BYTES 0x6E
+
+/**
+ * @brief Maximum number of key-value requests queued for all servers.
+ *
+ * Like @ref LCB_CNTL_KV_PIPELINE_MAX_REQUESTS, but applies to the instance as
+ * a whole.
+ *
+ * Use `kv_max_requests` in the connection string.
+ *
+ * @cntl_arg_both{lcb_SIZE*}
+ * @uncommitted
+ */
+#define LCB_CNTL_KV_MAX_REQUESTS 0x6F
+
+/**
+ * Current usage of the key-value request budgets. The per-server number of
+ * rejected requests is also available as lcb_SERVERMETRICS::packets_rejected.
+ * @see LCB_CNTL_KV_BUDGET_STATS
+ * @uncommitted
+ */
+typedef struct {
+    lcb_SIZE nbytes;    /**< Bytes held by queued requests */
+    lcb_SIZE nrequests; /**< Number of queued requests */
+    lcb_SIZE nrejected; /**< Number of requests rejected over budget, over the lifetime of the instance */
+} lcb_KV_BUDGET_STATS;
+
+/**
+ * @brief Get the current usage of the key-value request budgets.
+ *
+ * @cntl_arg_getonly{lcb_KV_BUDGET_STATS*}
+ * @uncommitted
+ */
+#define LCB_CNTL_KV_BUDGET_STATS 0x70
+
+/**
+ * @brief Fraction of each retry interval which is randomized.
+ *
+ * Operations in the retry queue wait for an interval given by the error map
+ * retry strategy of the failure (or by @ref LCB_CNTL_RETRY_INTERVAL and
+ * @ref LCB_CNTL_RETRY_NMV_INTERVAL). To keep operations which failed together
+ * from being retried together, each interval is shortened by a random amount
+ * of up to this fraction of it. Must be between 0 (no jitter) and 1. The
+ * default is 0.5.
+ *
+ * Use `retry_jitter` in the connection string.
+ *
+ * @cntl_arg_both{float*}
+ * @uncommitted
+ */
+#define LCB_CNTL_RETRY_JITTER 0x71
+
 /**
  * This is not a command, but rather an indicator of the last item.
  * @internal
  */
-#define LCB_CNTL__MAX 0x68
+#define LCB_CNTL__MAX 0x72
 /**@}*/
 
 #ifdef __cplusplus
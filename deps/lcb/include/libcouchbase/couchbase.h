@@ -592,6 +592,38 @@ lcb_RESPCALLBACK lcb_install_callback(lcb_INSTANCE *instance, int cbtype, lcb_RE
 LIBCOUCHBASE_API
 lcb_RESPCALLBACK lcb_get_callback(lcb_INSTANCE *instance, int cbtype);
 
+/**
+ * @uncommitted
+ *
+ * Create a copy of a response which remains valid once the callback it was
+ * passed to has returned.  Any data referenced by the response (such as the
+ * value of a GET, or the row of a query) is copied along with it, so the copy
+ * does not reference any of the library's buffers and may be read from
+ * another thread.
+ *
+ * Only the responses of key-value operations, and the rows of N1QL, Analytics
+ * and Search queries may be copied.  The raw HTTP response and the request
+ * handle are not available from a copy.
+ *
+ * @param cbtype the type of the response, as passed to the callback
+ * @param src the response to copy
+ * @param[out] dst the copy, which must be freed using lcb_resp_destroy()
+ * @return LCB_ERR_UNSUPPORTED_OPERATION if the response type cannot be copied
+ */
+LIBCOUCHBASE_API
+lcb_STATUS lcb_resp_clone(int cbtype, const lcb_RESPBASE *src, lcb_RESPBASE **dst);
+
+/**
+ * @uncommitted
+ *
+ * Free a response created by lcb_resp_clone().
+ *
+ * @param cbtype the type of the response, as passed to lcb_resp_clone()
+ * @param resp the response to free
+ */
+LIBCOUCHBASE_API
+lcb_STATUS lcb_resp_destroy(int cbtype, lcb_RESPBASE *resp);
+
 /**
  * Returns the type of the callback as a string.
  * This function is helpful for debugging and demonstrative processes.
@@ -982,11 +1014,42 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_collection(lcb_CMDSTORE *cmd, const cha
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_key(lcb_CMDSTORE *cmd, const char *key, size_t key_len);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_value(lcb_CMDSTORE *cmd, const char *value, size_t value_len);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_value_iov(lcb_CMDSTORE *cmd, const lcb_IOV *value, size_t value_len);
+/**
+ * @uncommitted
+ *
+ * Set the value of the document without copying it. The library references the
+ * buffer directly when writing the request, so it must remain valid (and
+ * unmodified) until the lcb_pktflushed_callback is invoked with the cookie of
+ * the operation. The callback is invoked once for every operation which was
+ * accepted by lcb_store(), possibly before the operation callback. It is not
+ * invoked if lcb_store() returns an error, in which case the buffer may be
+ * reclaimed right away. Operations discarded with lcb_sched_fail() no longer
+ * reference the buffer once it returns.
+ *
+ * @param cmd the command
+ * @param value the buffer holding the value
+ * @param value_len the length of the value
+ * @return LCB_SUCCESS
+ * @see lcb_set_pktflushed_callback
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_value_nocopy(lcb_CMDSTORE *cmd, const char *value, size_t value_len);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_expiry(lcb_CMDSTORE *cmd, uint32_t expiration);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_preserve_expiry(lcb_CMDSTORE *cmd, int should_preserve);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_cas(lcb_CMDSTORE *cmd, uint64_t cas);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_flags(lcb_CMDSTORE *cmd, uint32_t flags);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_datatype(lcb_CMDSTORE *cmd, uint8_t datatype);
+/**
+ * @uncommitted
+ *
+ * Send the value as given, even when outgoing compression is enabled. This is
+ * for applications which have already tried to compress the value themselves
+ * and found it not worth sending compressed.
+ *
+ * @param cmd the command
+ * @param skip non-zero to skip compression of the value
+ * @return LCB_SUCCESS
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_skip_compression(lcb_CMDSTORE *cmd, int skip);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_durability(lcb_CMDSTORE *cmd, lcb_DURABILITY_LEVEL level);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_durability_observe(lcb_CMDSTORE *cmd, int persist_to, int replicate_to);
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_timeout(lcb_CMDSTORE *cmd, uint32_t timeout);
@@ -1687,6 +1750,31 @@ LIBCOUCHBASE_API lcb_STATUS lcb_http(lcb_INSTANCE *instance, void *cookie, const
  */
 LIBCOUCHBASE_API lcb_STATUS lcb_http_cancel(lcb_INSTANCE *instance, lcb_HTTP_HANDLE *handle);
 
+/**
+ * @uncommitted
+ *
+ * Stop reading the response of an HTTP request from the network. Any data
+ * which has already been read will still be delivered. This allows a slow
+ * consumer of a streaming response to exert backpressure on the server.
+ *
+ * @param instance the instance
+ * @param handle the handle to the request
+ * @return LCB_SUCCESS
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_http_pause(lcb_INSTANCE *instance, lcb_HTTP_HANDLE *handle);
+
+/**
+ * @uncommitted
+ *
+ * Resume reading the response of an HTTP request previously paused with
+ * lcb_http_pause().
+ *
+ * @param instance the instance
+ * @param handle the handle to the request
+ * @return LCB_SUCCESS
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_http_resume(lcb_INSTANCE *instance, lcb_HTTP_HANDLE *handle);
+
 /**@} (Group: HTTP) */
 
 /**
@@ -2631,6 +2719,22 @@ LIBCOUCHBASE_API lcb_STATUS lcb_analytics(lcb_INSTANCE *instance, void *cookie,
  */
 LIBCOUCHBASE_API lcb_STATUS lcb_analytics_cancel(lcb_INSTANCE *instance, lcb_ANALYTICS_HANDLE *handle);
 
+/**
+ * @uncommitted
+ *
+ * Stop reading rows of an analytics query from the network until
+ * lcb_analytics_resume() is called. Rows which have already been read are
+ * still delivered.
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_analytics_pause(lcb_INSTANCE *instance, lcb_ANALYTICS_HANDLE *handle);
+
+/**
+ * @uncommitted
+ *
+ * Resume reading rows of an analytics query paused with lcb_analytics_pause().
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_analytics_resume(lcb_INSTANCE *instance, lcb_ANALYTICS_HANDLE *handle);
+
 /** @} */
 
 /**
@@ -2735,6 +2839,22 @@ LIBCOUCHBASE_API lcb_STATUS lcb_search(lcb_INSTANCE *instance, void *cookie, con
  * @return LCB_SUCCESS if successful, otherwise an error.
  */
 LIBCOUCHBASE_API lcb_STATUS lcb_search_cancel(lcb_INSTANCE *instance, lcb_SEARCH_HANDLE *handle);
+
+/**
+ * @uncommitted
+ *
+ * Stop reading rows of a full-text query from the network until
+ * lcb_search_resume() is called. Rows which have already been read are still
+ * delivered.
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_search_pause(lcb_INSTANCE *instance, lcb_SEARCH_HANDLE *handle);
+
+/**
+ * @uncommitted
+ *
+ * Resume reading rows of a full-text query paused with lcb_search_pause().
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_search_resume(lcb_INSTANCE *instance, lcb_SEARCH_HANDLE *handle);
 /** @} */
 
 /**
@@ -3115,6 +3235,22 @@ LIBCOUCHBASE_API lcb_STATUS lcb_query(lcb_INSTANCE *instance, void *cookie, cons
  * @endcode
  */
 LIBCOUCHBASE_API lcb_STATUS lcb_query_cancel(lcb_INSTANCE *instance, lcb_QUERY_HANDLE *handle);
+
+/**
+ * @uncommitted
+ *
+ * Stop reading rows of a query from the network until lcb_query_resume() is
+ * called. Rows which have already been read are still delivered. The pause
+ * also applies to requests issued for retries of the query.
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_query_pause(lcb_INSTANCE *instance, lcb_QUERY_HANDLE *handle);
+
+/**
+ * @uncommitted
+ *
+ * Resume reading rows of a query paused with lcb_query_pause().
+ */
+LIBCOUCHBASE_API lcb_STATUS lcb_query_resume(lcb_INSTANCE *instance, lcb_QUERY_HANDLE *handle);
 /** @} */
 
 /**
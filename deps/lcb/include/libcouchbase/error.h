@@ -203,7 +203,8 @@ X(LCB_ERR_CONNECT_ERROR,                    1051, LCB_ERROR_TYPE_SDK, LCB_ERROR_
 X(LCB_ERR_EMPTY_KEY,                        1052, LCB_ERROR_TYPE_SDK, LCB_ERROR_FLAG_INPUT, "An empty key was passed to an operation") \
 X(LCB_ERR_HTTP,                             1053, LCB_ERROR_TYPE_SDK, 0, "HTTP Operation failed. Inspect status code for details") \
 X(LCB_ERR_QUERY,                            1054, LCB_ERROR_TYPE_SDK, 0, "Query execution failed. Inspect raw response object for information") \
-X(LCB_ERR_TOPOLOGY_CHANGE,                  1055, LCB_ERROR_TYPE_SDK, 0, "Topology Change (internal)")
+X(LCB_ERR_TOPOLOGY_CHANGE,                  1055, LCB_ERROR_TYPE_SDK, 0, "Topology Change (internal)") \
+X(LCB_ERR_REQUEST_BUDGET_EXCEEDED,          1056, LCB_ERROR_TYPE_SDK, LCB_ERROR_FLAG_TRANSIENT, "Too many requests, or too much request data, are already queued. See LCB_CNTL_KV_MAX_BYTES and related settings")
 /* clang-format on */
 
 /** Error codes returned by the library. */
@@ -62,6 +62,9 @@ typedef struct lcb_SERVERMETRICS_st {
 
     /** Number of NOT_MY_VBUCKET replies received */
     lcb_SIZE packets_nmv;
+
+    /** Number of packets rejected because the server's request budget was exceeded */
+    lcb_SIZE packets_rejected;
 } lcb_SERVERMETRICS;
 
 typedef struct lcb_METRICS_st {
@@ -70,6 +73,21 @@ typedef struct lcb_METRICS_st {
 
     /** Number of times a packet entered the retry queue */
     lcb_SIZE packets_retried;
+
+    /** Number of packets currently waiting in the retry queue */
+    lcb_SIZE retryq_depth;
+
+    /** Largest number of packets which waited in the retry queue at once */
+    lcb_SIZE retryq_max_depth;
+
+    /** Number of packets sent again from the retry queue */
+    lcb_SIZE packets_resent;
+
+    /** Total time, in microseconds, which resent packets waited in the retry queue */
+    lcb_U64 retry_wait_us;
+
+    /** Longest time, in microseconds, which a resent packet waited in the retry queue */
+    lcb_U64 retry_wait_max_us;
 } lcb_METRICS;
 
 #ifdef __cplusplus
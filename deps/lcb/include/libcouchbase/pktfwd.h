@@ -253,6 +253,55 @@ void lcb_backbuf_ref(lcb_BACKBUF buf);
  */
 LIBCOUCHBASE_API
 void lcb_backbuf_unref(lcb_BACKBUF buf);
+
+/**
+ * @uncommitted
+ *
+ * Retrieve the lcb_BACKBUF which provides storage for the value returned by
+ * lcb_respget_value(). The application may call lcb_backbuf_ref() on it to
+ * keep the value valid after the callback has returned, rather than copying it.
+ *
+ * @param resp the response
+ * @param[out] buf the buffer backing the value
+ * @return LCB_ERR_UNSUPPORTED_OPERATION if the value is not located inside
+ * the network buffer (for example because it was inflated into temporary
+ * storage). In this case the value must be copied.
+ */
+LIBCOUCHBASE_API
+lcb_STATUS lcb_respget_backbuf(const lcb_RESPGET *resp, lcb_BACKBUF *buf);
+
+/**
+ * @uncommitted
+ *
+ * Retrieve a value which spans several network buffers as an array of IOVs,
+ * without it first being copied into one contiguous buffer as is done by
+ * lcb_respget_value(). The IOVs are only valid within the callback.
+ *
+ * @param resp the response
+ * @param[out] iov the segments of the value
+ * @param[out] niov the number of segments
+ * @return LCB_ERR_UNSUPPORTED_OPERATION if the value is contiguous, in which
+ * case lcb_respget_value() should be used.
+ */
+LIBCOUCHBASE_API
+lcb_STATUS lcb_respget_value_iov(const lcb_RESPGET *resp, const lcb_IOV **iov, size_t *niov);
+
+/**
+ * @uncommitted
+ * @see lcb_respget_backbuf()
+ */
+LIBCOUCHBASE_API
+lcb_STATUS lcb_respgetreplica_backbuf(const lcb_RESPGETREPLICA *resp, lcb_BACKBUF *buf);
+
+/**
+ * @uncommitted
+ *
+ * Retrieve the lcb_BACKBUF which provides storage for the values returned by
+ * lcb_respsubdoc_result_value().
+ * @see lcb_respget_backbuf()
+ */
+LIBCOUCHBASE_API
+lcb_STATUS lcb_respsubdoc_backbuf(const lcb_RESPSUBDOC *resp, lcb_BACKBUF *buf);
 /**@}*/
 
 /**@}*/
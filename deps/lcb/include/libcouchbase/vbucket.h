@@ -234,6 +234,24 @@ int lcbvb_load_json(lcbvb_CONFIG *vbc, const char *data);
 LIBCOUCHBASE_API
 int lcbvb_load_json_ex(lcbvb_CONFIG *vbc, const char *data, const char *source, char **network);
 
+/**
+ * @uncommitted
+ * @brief Read the revision of a JSON config without fully parsing it
+ *
+ * Only the top-level `rev` and `revEpoch` fields are read. This is much
+ * cheaper than lcbvb_load_json(), and may be used to discard configurations
+ * which are not newer than the current one before parsing them.
+ *
+ * @param data the JSON config
+ * @param ndata the length of the JSON config
+ * @param[out] revepoch the revision epoch, or -1 if the config does not have one
+ * @param[out] revid the revision ID
+ * @return 0 on success, nonzero if the config does not have a revision or the
+ *  revision could not be read. In this case the config should be parsed.
+ */
+LIBCOUCHBASE_API
+int lcbvb_peek_revision(const char *data, lcb_SIZE ndata, int64_t *revepoch, int64_t *revid);
+
 /**@brief Serialize the current config as a JSON string.
  * @volatile
  * Serialize the current configuration as a JSON string. The string returned is
@@ -360,6 +378,20 @@ int lcbvb_map_key(lcbvb_CONFIG *cfg, const void *key, lcb_SIZE n, int *vbid, int
 LIBCOUCHBASE_API
 int lcbvb_k2vb(lcbvb_CONFIG *cfg, const void *key, lcb_SIZE n);
 
+/**
+ * @uncommitted
+ *
+ * Maps a key to a vBucket ID given only the number of vBuckets. This is the
+ * same mapping as lcbvb_k2vb(), for callers which do not hold on to the
+ * configuration itself.
+ * @param nvb The number of vBuckets, which must not be 0
+ * @param key The key to retrieve
+ * @param n The size of the key
+ * @return the vBucket for the key
+ */
+LIBCOUCHBASE_API
+int lcbvb_hash_key(unsigned nvb, const void *key, lcb_SIZE n);
+
 /**
  * @uncommitted
  * Determines if a given server index is either a master or a replica for a
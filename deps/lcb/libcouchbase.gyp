@@ -220,6 +220,7 @@
         'src/http/http.cc',
         'src/http/http_io.cc',
         'src/jsparse/parser.cc',
+        'src/jsparse/scanner.cc',
         'src/lcbht/lcbht.cc',
         'src/lcbio/connect.cc',
         'src/lcbio/ctx.cc',
@@ -244,6 +245,7 @@
         'src/n1ql/query_utils.cc',
         'src/netbuf/netbuf.c',
         'src/operations/cbflush.cc',
+        'src/operations/clone.cc',
         'src/operations/counter.cc',
         'src/operations/durability-seqno.cc',
         'src/operations/durability.cc',
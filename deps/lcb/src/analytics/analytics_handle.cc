@@ -153,8 +153,8 @@ static void chunk_callback(lcb_INSTANCE * /* instance */, int /* cbtype */, cons
 }
 
 lcb_ANALYTICS_HANDLE_::lcb_ANALYTICS_HANDLE_(lcb_INSTANCE *obj, void *user_cookie, const lcb_CMDANALYTICS *cmd)
-    : parser_(new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_ANALYTICS, this)), cookie_(user_cookie),
-      callback_(cmd->callback()), instance_(obj), ingest_options_(cmd->ingest_options())
+    : parser_(new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_ANALYTICS, this, LCBT_SETTING(obj, use_row_scanner))),
+      cookie_(user_cookie), callback_(cmd->callback()), instance_(obj), ingest_options_(cmd->ingest_options())
 {
 
     std::string encoded = Json::FastWriter().write(cmd->root());
@@ -243,8 +243,8 @@ lcb_ANALYTICS_HANDLE_::lcb_ANALYTICS_HANDLE_(lcb_INSTANCE *obj, void *user_cooki
 }
 
 lcb_ANALYTICS_HANDLE_::lcb_ANALYTICS_HANDLE_(lcb_INSTANCE *obj, void *user_cookie, lcb_DEFERRED_HANDLE *handle)
-    : parser_(new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_ANALYTICS, this)), cookie_(user_cookie),
-      callback_(handle->callback), instance_(obj), deferred_handle_(handle->handle)
+    : parser_(new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_ANALYTICS, this, LCBT_SETTING(obj, use_row_scanner))),
+      cookie_(user_cookie), callback_(handle->callback), instance_(obj), deferred_handle_(handle->handle)
 {
     timeout_ = LCBT_SETTING(obj, analytics_timeout);
 }
@@ -295,6 +295,9 @@ lcb_STATUS lcb_ANALYTICS_HANDLE_::issue_htreq(const std::string &body)
         if (priority_) {
             http_request_->add_header("Analytics-Priority", "-1");
         }
+        if (paused_) {
+            lcb_http_pause(instance_, http_request_);
+        }
     }
     return rc;
 }
@@ -209,6 +209,15 @@ lcb_STATUS CccpProvider::update(const char *host, const char *data)
     lcbvb_CONFIG *vbc;
     int rv;
     ConfigInfo *new_config;
+    int64_t revepoch, revid;
+
+    /* During a rebalance every NOT_MY_VBUCKET reply carries a config, most of
+     * which we have already applied. Avoid parsing those. */
+    if (lcbvb_peek_revision(data, strlen(data), &revepoch, &revid) == 0 && parent->is_stale(revepoch, revid)) {
+        parent->provider_got_stale_config(this, revepoch, revid);
+        return LCB_SUCCESS;
+    }
+
     vbc = lcbvb_create();
 
     if (!vbc) {
@@ -101,6 +101,7 @@ static lcb_STATUS process_chunk(HttpProvider *http, const void *buf, unsigned nb
     lcbvb_CONFIG *cfgh;
     unsigned state, oldstate, diff;
     lcb_host_t *host;
+    int64_t revepoch, revid;
     htp::Response &resp = http->htp->get_cur_response();
 
     oldstate = resp.state;
@@ -178,6 +179,13 @@ GT_CHECKDONE:
         return LCB_SUCCESS;
     }
     resp.body[termpos] = '\0';
+    if (lcbvb_peek_revision(resp.body.c_str(), termpos, &revepoch, &revid) == 0 &&
+        http->parent->is_stale(revepoch, revid)) {
+        http->io_timer.cancel();
+        http->parent->provider_got_stale_config(http, revepoch, revid);
+        resp.body.erase(0, termpos + sizeof(CONFIG_DELIMITER) - 1);
+        return LCB_SUCCESS;
+    }
     cfgh = lcbvb_create();
     if (!cfgh) {
         return LCB_ERR_NO_MEMORY;
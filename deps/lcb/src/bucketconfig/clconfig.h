@@ -320,6 +320,34 @@ struct Confmon {
      */
     void provider_got_config(Provider *which, ConfigInfo *config);
 
+    /**
+     * @brief Check whether a configuration revision would be ignored
+     *
+     * This mirrors ConfigInfo::compare() for configurations which carry a
+     * revision, and allows providers to discard stale configurations (for
+     * example those attached to every "not my vbucket" reply during a
+     * rebalance) without parsing them.
+     *
+     * @param revepoch the epoch of the received configuration, or -1
+     * @param revid the revision of the received configuration
+     * @return true if the configuration is not newer than the current one
+     */
+    bool is_stale(int64_t revepoch, int64_t revid) const;
+
+    /**
+     * @brief Indicate that a provider has received a configuration which
+     * is not newer than the current one.
+     *
+     * This has the same effect as provider_got_config() with a configuration
+     * which does not get applied, but does not require it to be parsed.
+     *
+     * @param which the provider which received the configuration
+     * @param revepoch the epoch of the received configuration
+     * @param revid the revision of the received configuration
+     * @see is_stale()
+     */
+    void provider_got_stale_config(Provider *which, int64_t revepoch, int64_t revid);
+
     /**
      * Dump information about the monitor
      * @param fp the file to which information should be written
@@ -276,6 +276,30 @@ void Confmon::provider_got_config(Provider *, ConfigInfo *config_)
     stop();
 }
 
+bool Confmon::is_stale(int64_t revepoch, int64_t revid) const
+{
+    if (config == nullptr || config->vbc->bname == nullptr) {
+        return false;
+    }
+    const lcbvb_CONFIG *cur = config->vbc;
+    if (revepoch > cur->revepoch) {
+        return false;
+    }
+    if (cur->revid < 0 || revid < 0) {
+        return false;
+    }
+    return revid <= cur->revid;
+}
+
+void Confmon::provider_got_stale_config(Provider *which, int64_t revepoch, int64_t revid)
+{
+    lcb_log(LOGARGS(this, TRACE),
+            "Not applying configuration received via %s. Revision is not newer. A.rev=%" PRId64 ":%" PRId64
+            ", B.rev=%" PRId64 ":%" PRId64,
+            provider_string(which->type), config->vbc->revepoch, config->vbc->revid, revepoch, revid);
+    stop();
+}
+
 void Confmon::do_next_provider()
 {
     state &= ~CONFMON_S_ITERGRACE;
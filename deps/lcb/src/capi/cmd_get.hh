@@ -221,6 +221,16 @@ struct lcb_RESPGET_ {
     void *bufh;
     std::uint8_t datatype;  /**< @internal */
     std::uint32_t itmflags; /**< User-defined flags for the item */
+
+    /**
+     * @internal
+     * Segments of a value which spans several network buffers, in which case
+     * `value` is only set once lcb_respget_value() has gathered it into
+     * `value_buf`.
+     */
+    const lcb_IOV *value_iov;
+    std::size_t nvalue_iov;
+    char *value_buf;
 };
 
 #endif // LIBCOUCHBASE_CAPI_GET_HH
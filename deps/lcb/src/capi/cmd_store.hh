@@ -175,6 +175,16 @@ struct lcb_CMDSTORE_ {
         return compressed_;
     }
 
+    void skip_compression(bool val)
+    {
+        skip_compression_ = val;
+    }
+
+    bool skip_compression() const
+    {
+        return skip_compression_;
+    }
+
     lcb_STATUS durability_level(lcb_DURABILITY_LEVEL level)
     {
         if (durability_mode_ != durability_mode::sync && durability_mode_ != durability_mode::none) {
@@ -240,9 +250,38 @@ struct lcb_CMDSTORE_ {
     lcb_STATUS value(std::string value)
     {
         value_ = std::move(value);
+        borrowed_value_ = nullptr;
+        borrowed_value_len_ = 0;
         return LCB_SUCCESS;
     }
 
+    lcb_STATUS value_nocopy(const char *value, std::size_t value_len)
+    {
+        value_.clear();
+        borrowed_value_ = value;
+        borrowed_value_len_ = value_len;
+        return LCB_SUCCESS;
+    }
+
+    /**
+     * The value is owned by the caller, which must keep it alive until the
+     * library reports it is no longer referenced (see lcb_cmdstore_value_nocopy).
+     */
+    bool has_borrowed_value() const
+    {
+        return borrowed_value_ != nullptr;
+    }
+
+    const char *value_data() const
+    {
+        return borrowed_value_ != nullptr ? borrowed_value_ : value_.data();
+    }
+
+    std::size_t value_size() const
+    {
+        return borrowed_value_ != nullptr ? borrowed_value_len_ : value_.size();
+    }
+
     lcb_STATUS value(const lcb_IOV *iov, std::size_t iov_len)
     {
         std::stringstream ss;
@@ -252,6 +291,8 @@ struct lcb_CMDSTORE_ {
             }
         }
         value_ = ss.str();
+        borrowed_value_ = nullptr;
+        borrowed_value_len_ = 0;
         return LCB_SUCCESS;
     }
 
@@ -396,6 +437,8 @@ struct lcb_CMDSTORE_ {
     std::uint32_t expiry_{0};
     std::string key_{};
     std::string value_{};
+    const char *borrowed_value_{nullptr};
+    std::size_t borrowed_value_len_{0};
     std::uint64_t cas_{0};
     std::uint32_t flags_{0};
     durability_mode durability_mode_{durability_mode::none};
@@ -404,6 +447,7 @@ struct lcb_CMDSTORE_ {
     int replicate_to_{0};
     bool json_{false};
     bool compressed_{false};
+    bool skip_compression_{false};
     bool cookie_is_callback_{false};
     bool preserve_expiry_{false};
     std::string impostor_{};
@@ -21,7 +21,6 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
-#include <sstream>
 #include <stdexcept>
 
 namespace lcb
@@ -48,11 +47,10 @@ struct collection_qualifier {
         if (collection_name != nullptr && collection_name_len > 0) {
             collection_.assign(collection_name, collection_name_len);
         }
-        std::stringstream ss;
-        ss << (scope_.empty() ? "_default" : scope_);
-        ss << '.';
-        ss << (collection_.empty() ? "_default" : collection_);
-        spec_ = ss.str();
+        const std::string &scope = scope_.empty() ? default_name() : scope_;
+        const std::string &collection = collection_.empty() ? default_name() : collection_;
+        spec_.reserve(scope.size() + 1 + collection.size());
+        spec_.append(scope).append(1, '.').append(collection);
     }
 
     const std::string &scope() const
@@ -97,6 +95,12 @@ struct collection_qualifier {
     }
 
   private:
+    static const std::string &default_name()
+    {
+        static const std::string name("_default");
+        return name;
+    }
+
     static bool is_valid_collection_char(char ch)
     {
         if (ch >= 'A' && ch <= 'Z') {
@@ -725,6 +725,90 @@ HANDLER(unordered_execution_handler)
     RETURN_GET_SET(int, LCBT_SETTING(instance, enable_unordered_execution))
 }
 
+HANDLER(prefetch_collections_handler)
+{
+    RETURN_GET_SET(int, LCBT_SETTING(instance, prefetch_collections))
+}
+
+HANDLER(query_cache_size_handler)
+{
+    if (mode == LCB_CNTL_SET) {
+        std::uint32_t val = *reinterpret_cast<std::uint32_t *>(arg);
+        if (val == 0) {
+            return LCB_ERR_CONTROL_INVALID_ARGUMENT;
+        }
+        lcb_n1qlcache_set_capacity(instance->n1ql_cache, val);
+    } else if (mode == LCB_CNTL_GET) {
+        *reinterpret_cast<std::uint32_t *>(arg) =
+            static_cast<std::uint32_t>(lcb_n1qlcache_capacity(instance->n1ql_cache));
+    } else {
+        return LCB_ERR_CONTROL_UNSUPPORTED_MODE;
+    }
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(query_cache_stats_handler)
+{
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ERR_CONTROL_UNSUPPORTED_MODE;
+    }
+    lcb_n1qlcache_stats(instance->n1ql_cache, reinterpret_cast<lcb_QUERY_CACHE_STATS *>(arg));
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+HANDLER(row_scanner_handler)
+{
+    RETURN_GET_SET(int, LCBT_SETTING(instance, use_row_scanner))
+}
+
+HANDLER(kv_budget_handler)
+{
+    lcb_SIZE *ptr;
+    switch (cmd) {
+        case LCB_CNTL_KV_PIPELINE_MAX_BYTES:
+            ptr = &LCBT_SETTING(instance, kv_pipeline_max_bytes);
+            break;
+        case LCB_CNTL_KV_PIPELINE_MAX_REQUESTS:
+            ptr = &LCBT_SETTING(instance, kv_pipeline_max_requests);
+            break;
+        case LCB_CNTL_KV_MAX_BYTES:
+            ptr = &LCBT_SETTING(instance, kv_max_bytes);
+            break;
+        case LCB_CNTL_KV_MAX_REQUESTS:
+            ptr = &LCBT_SETTING(instance, kv_max_requests);
+            break;
+        default:
+            return LCB_ERR_CONTROL_UNKNOWN_CODE;
+    }
+    RETURN_GET_SET(lcb_SIZE, *ptr)
+}
+
+HANDLER(retry_jitter_handler)
+{
+    if (mode == LCB_CNTL_SET) {
+        float val = *reinterpret_cast<float *>(arg);
+        if (val > 1 || val < 0) {
+            return LCB_ERR_CONTROL_INVALID_ARGUMENT;
+        }
+    }
+    RETURN_GET_SET(float, LCBT_SETTING(instance, retry_jitter))
+}
+
+HANDLER(kv_budget_stats_handler)
+{
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ERR_CONTROL_UNSUPPORTED_MODE;
+    }
+    auto *stats = reinterpret_cast<lcb_KV_BUDGET_STATS *>(arg);
+    stats->nbytes = instance->cmdq.budget_nbytes;
+    stats->nrequests = instance->cmdq.budget_npackets;
+    stats->nrejected = instance->cmdq.budget_nrejected;
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
 /* clang-format off */
 static ctl_handler handlers[] = {
     timeout_common,                       /* LCB_CNTL_OP_TIMEOUT */
@@ -831,6 +915,16 @@ static ctl_handler handlers[] = {
     enable_errmap_handler,                /* LCB_CNTL_ENABLE_ERRMAP */
     timeout_common,                       /* LCB_CNTL_OP_METRICS_FLUSH_INTERVAL */
     enable_op_metrics_handler,            /* LCB_CNTL_ENABLE_OP_METRICS */
+    prefetch_collections_handler,         /* LCB_CNTL_PREFETCH_COLLECTIONS */
+    query_cache_size_handler,             /* LCB_CNTL_QUERY_CACHE_SIZE */
+    query_cache_stats_handler,            /* LCB_CNTL_QUERY_CACHE_STATS */
+    row_scanner_handler,                  /* LCB_CNTL_ENABLE_ROW_SCANNER */
+    kv_budget_handler,                    /* LCB_CNTL_KV_PIPELINE_MAX_BYTES */
+    kv_budget_handler,                    /* LCB_CNTL_KV_PIPELINE_MAX_REQUESTS */
+    kv_budget_handler,                    /* LCB_CNTL_KV_MAX_BYTES */
+    kv_budget_handler,                    /* LCB_CNTL_KV_MAX_REQUESTS */
+    kv_budget_stats_handler,              /* LCB_CNTL_KV_BUDGET_STATS */
+    retry_jitter_handler,                 /* LCB_CNTL_RETRY_JITTER */
     nullptr
 };
 /* clang-format on */
@@ -1067,6 +1161,14 @@ static cntl_OPCODESTRS stropcode_map[] = {
     {"enable_errmap", LCB_CNTL_ENABLE_ERRMAP, convert_intbool},
     {"operation_metrics_flush_interval", LCB_CNTL_OP_METRICS_FLUSH_INTERVAL, convert_timevalue},
     {"enable_operation_metrics", LCB_CNTL_ENABLE_OP_METRICS, convert_intbool},
+    {"prefetch_collections", LCB_CNTL_PREFETCH_COLLECTIONS, convert_intbool},
+    {"query_cache_size", LCB_CNTL_QUERY_CACHE_SIZE, convert_u32},
+    {"enable_row_scanner", LCB_CNTL_ENABLE_ROW_SCANNER, convert_intbool},
+    {"kv_pipeline_max_bytes", LCB_CNTL_KV_PIPELINE_MAX_BYTES, convert_SIZE},
+    {"kv_pipeline_max_requests", LCB_CNTL_KV_PIPELINE_MAX_REQUESTS, convert_SIZE},
+    {"kv_max_bytes", LCB_CNTL_KV_MAX_BYTES, convert_SIZE},
+    {"kv_max_requests", LCB_CNTL_KV_MAX_REQUESTS, convert_SIZE},
+    {"retry_jitter", LCB_CNTL_RETRY_JITTER, convert_float},
     {nullptr, -1}};
 
 #define CNTL_NUM_HANDLERS (sizeof(handlers) / sizeof(handlers[0]))
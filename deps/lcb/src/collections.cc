@@ -19,8 +19,11 @@
 #include "collections.h"
 #include "mcserver/negotiate.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <string>
 
+#include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
 #include "capi/cmd_getcid.hh"
 #include "capi/cmd_getmanifest.hh"
 
@@ -28,43 +31,246 @@
 
 namespace lcb
 {
-CollectionCache::CollectionCache()
+static const char default_name[] = "_default";
+static const size_t default_name_len = sizeof(default_name) - 1;
+static const size_t initial_slots = 16;
+
+/* FNV-1a, hashing "scope" "." "collection" piecewise gives the same result as hashing the whole spec */
+static uint64_t spec_hash(uint64_t hash, const char *data, size_t ndata)
+{
+    for (size_t ii = 0; ii < ndata; ++ii) {
+        hash ^= static_cast<unsigned char>(data[ii]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t spec_hash(const char *scope, size_t nscope, const char *collection, size_t ncollection)
+{
+    uint64_t hash = spec_hash(0xcbf29ce484222325ULL, scope, nscope);
+    hash = spec_hash(hash, ".", 1);
+    return spec_hash(hash, collection, ncollection);
+}
+
+static void split_spec(const std::string &path, const char **scope, size_t *nscope, const char **collection,
+                       size_t *ncollection)
+{
+    size_t dot = path.find('.');
+    if (dot == std::string::npos) {
+        dot = path.size();
+    }
+    *scope = path.data();
+    *nscope = dot;
+    *collection = path.data() + std::min(dot + 1, path.size());
+    *ncollection = path.size() - std::min(dot + 1, path.size());
+}
+
+CollectionCache::CollectionCache() : slots_(initial_slots)
 {
     static const std::string default_collection("_default._default");
     put(default_collection, 0);
 }
 
-std::string CollectionCache::id_to_name(uint32_t cid)
+const std::string &CollectionCache::id_to_name(uint32_t cid) const
 {
-    std::map<uint32_t, std::string>::const_iterator pos = cache_i2n.find(cid);
+    static const std::string empty;
+    auto pos = cache_i2n.find(cid);
     if (pos != cache_i2n.end()) {
         return pos->second;
     }
-    return "";
+    return empty;
 }
 
-bool CollectionCache::get(const std::string &path, uint32_t *cid)
+size_t CollectionCache::find_slot(uint64_t hash, const char *scope, size_t nscope, const char *collection,
+                                  size_t ncollection) const
 {
-    std::map<std::string, uint32_t>::const_iterator pos = cache_n2i.find(path);
-    if (pos != cache_n2i.end()) {
-        *cid = pos->second;
+    const size_t mask = slots_.size() - 1;
+    const size_t npath = nscope + 1 + ncollection;
+    for (size_t idx = hash & mask;; idx = (idx + 1) & mask) {
+        const entry &slot = slots_[idx];
+        if (!slot.used) {
+            return idx;
+        }
+        if (slot.hash == hash && slot.path.size() == npath && slot.path.compare(0, nscope, scope, nscope) == 0 &&
+            slot.path[nscope] == '.' && slot.path.compare(nscope + 1, ncollection, collection, ncollection) == 0) {
+            return idx;
+        }
+    }
+}
+
+bool CollectionCache::get(const char *scope, size_t nscope, const char *collection, size_t ncollection,
+                          uint32_t *cid) const
+{
+    if (scope == nullptr || nscope == 0) {
+        scope = default_name;
+        nscope = default_name_len;
+    }
+    if (collection == nullptr || ncollection == 0) {
+        collection = default_name;
+        ncollection = default_name_len;
+    }
+    const entry &slot =
+        slots_[find_slot(spec_hash(scope, nscope, collection, ncollection), scope, nscope, collection, ncollection)];
+    if (slot.used) {
+        *cid = slot.cid;
         return true;
     }
     return false;
 }
 
+bool CollectionCache::get(const std::string &path, uint32_t *cid) const
+{
+    const char *scope, *collection;
+    size_t nscope, ncollection;
+    split_spec(path, &scope, &nscope, &collection, &ncollection);
+    return get(scope, nscope, collection, ncollection, cid);
+}
+
 void CollectionCache::put(const std::string &path, uint32_t cid)
 {
-    cache_n2i[path] = cid;
+    const char *scope, *collection;
+    size_t nscope, ncollection;
+    split_spec(path, &scope, &nscope, &collection, &ncollection);
+
+    /* the ID may have moved to a different spec, which must not resolve to it anymore */
+    auto prev = cache_i2n.find(cid);
+    if (prev != cache_i2n.end() && prev->second != path) {
+        erase(cid);
+    }
+
+    /* keep the load factor under 3/4, so that probe sequences stay short */
+    if ((nentries_ + 1) * 4 > slots_.size() * 3) {
+        grow();
+    }
+    uint64_t hash = spec_hash(scope, nscope, collection, ncollection);
+    entry &slot = slots_[find_slot(hash, scope, nscope, collection, ncollection)];
+    if (slot.used) {
+        if (slot.cid != cid) {
+            cache_i2n.erase(slot.cid);
+        }
+    } else {
+        slot.path = path;
+        slot.hash = hash;
+        slot.used = true;
+        ++nentries_;
+    }
+    slot.cid = cid;
     cache_i2n[cid] = path;
 }
 
+void CollectionCache::grow()
+{
+    std::vector<entry> old(slots_.size() * 2);
+    old.swap(slots_);
+    const size_t mask = slots_.size() - 1;
+    for (auto &slot : old) {
+        if (!slot.used) {
+            continue;
+        }
+        size_t idx = slot.hash & mask;
+        while (slots_[idx].used) {
+            idx = (idx + 1) & mask;
+        }
+        slots_[idx] = std::move(slot);
+    }
+}
+
+void CollectionCache::remove_slot(size_t idx)
+{
+    /* backward shift deletion, so that lookups never need tombstones */
+    const size_t mask = slots_.size() - 1;
+    size_t next = idx;
+    for (;;) {
+        next = (next + 1) & mask;
+        if (!slots_[next].used) {
+            break;
+        }
+        size_t home = slots_[next].hash & mask;
+        bool stays = (idx <= next) ? (idx < home && home <= next) : (idx < home || home <= next);
+        if (!stays) {
+            slots_[idx] = std::move(slots_[next]);
+            idx = next;
+        }
+    }
+    slots_[idx] = entry{};
+    --nentries_;
+}
+
 void CollectionCache::erase(uint32_t cid)
 {
     auto pos = cache_i2n.find(cid);
-    if (pos != cache_i2n.end()) {
-        cache_n2i.erase(pos->second);
-        cache_i2n.erase(pos);
+    if (pos == cache_i2n.end()) {
+        return;
+    }
+    const char *scope, *collection;
+    size_t nscope, ncollection;
+    split_spec(pos->second, &scope, &nscope, &collection, &ncollection);
+    size_t idx = find_slot(spec_hash(scope, nscope, collection, ncollection), scope, nscope, collection, ncollection);
+    if (slots_[idx].used) {
+        remove_slot(idx);
+    }
+    cache_i2n.erase(pos);
+}
+
+int CollectionCache::apply_manifest(const char *json, size_t njson)
+{
+    Json::Value manifest;
+    if (!Json::Reader().parse(json, json + njson, manifest) || !manifest.isObject()) {
+        return -1;
+    }
+    const Json::Value &scopes = manifest["scopes"];
+    if (!scopes.isArray()) {
+        return -1;
+    }
+    uint64_t uid = 0;
+    if (manifest["uid"].isString()) {
+        uid = std::strtoull(manifest["uid"].asCString(), nullptr, 16);
+    }
+    if (uid < manifest_uid_) {
+        return 0;
+    }
+    manifest_uid_ = uid;
+
+    int added = 0;
+    std::string path;
+    for (const auto &scope : scopes) {
+        const Json::Value &collections = scope["collections"];
+        if (!scope["name"].isString() || !collections.isArray()) {
+            continue;
+        }
+        for (const auto &collection : collections) {
+            if (!collection["name"].isString() || !collection["uid"].isString()) {
+                continue;
+            }
+            path.assign(scope["name"].asString()).append(1, '.').append(collection["name"].asString());
+            put(path, static_cast<uint32_t>(std::strtoul(collection["uid"].asCString(), nullptr, 16)));
+            ++added;
+        }
+    }
+    return added;
+}
+
+bool CollectionCache::begin_resolve(const std::string &path)
+{
+    return pending_.emplace(path, std::vector<resolve_waiter>()).second;
+}
+
+void CollectionCache::wait_resolve(const std::string &path, resolve_waiter waiter)
+{
+    pending_[path].emplace_back(std::move(waiter));
+}
+
+void CollectionCache::finish_resolve(const std::string &path, lcb_STATUS rc, const lcb_RESPGETCID *resp)
+{
+    auto pos = pending_.find(path);
+    if (pos == pending_.end()) {
+        return;
+    }
+    /* the waiters may schedule new resolutions, so detach them first */
+    std::vector<resolve_waiter> waiters(std::move(pos->second));
+    pending_.erase(pos);
+    for (auto &waiter : waiters) {
+        waiter(rc, resp);
     }
 }
 } // namespace lcb
@@ -96,8 +302,7 @@ lcb_STATUS collcache_get(lcb_INSTANCE *instance, const char *scope, size_t nscop
         return LCB_ERR_UNSUPPORTED_OPERATION;
     }
 
-    std::string spec = collcache_build_spec(scope, nscope, collection, ncollection);
-    if (instance->collcache->get(spec, cid)) {
+    if (instance->collcache->get(scope, nscope, collection, ncollection, cid)) {
         return LCB_SUCCESS;
     }
     return LCB_ERR_COLLECTION_NOT_FOUND;
@@ -105,16 +310,96 @@ lcb_STATUS collcache_get(lcb_INSTANCE *instance, const char *scope, size_t nscop
 
 lcb_STATUS collcache_get(lcb_INSTANCE *instance, lcb::collection_qualifier &collection)
 {
+    if (LCBT_SETTING(instance, conntype) != LCB_TYPE_BUCKET) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    if (!LCBT_SETTING(instance, use_collections)) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+
     uint32_t collection_id;
-    lcb_STATUS rc = collcache_get(instance, collection.scope().c_str(), collection.scope().size(),
-                                  collection.collection().c_str(), collection.collection().size(), &collection_id);
-    if (rc != LCB_SUCCESS) {
-        return rc;
+    if (!instance->collcache->get(collection.spec(), &collection_id)) {
+        return LCB_ERR_COLLECTION_NOT_FOUND;
     }
     collection.collection_id(collection_id);
     return LCB_SUCCESS;
 }
 
+struct ManifestLoadCtx : mc_REQDATAEX {
+    static mc_REQDATAPROCS proctable;
+
+    explicit ManifestLoadCtx(lcb_INSTANCE *instance) : mc_REQDATAEX(nullptr, proctable, gethrtime()), instance_(instance)
+    {
+    }
+
+    lcb_INSTANCE *instance_;
+};
+
+static void handle_manifest_load(mc_PIPELINE * /* pipeline */, mc_PACKET *pkt, lcb_CALLBACK_TYPE /* cbtype */,
+                                 lcb_STATUS /* err */, const void *rb)
+{
+    auto *ctx = static_cast<ManifestLoadCtx *>(pkt->u_rdata.exdata);
+    const auto *resp = reinterpret_cast<const lcb_RESPGETMANIFEST *>(rb);
+    lcb_INSTANCE *instance = ctx->instance_;
+    if (resp->ctx.rc != LCB_SUCCESS) {
+        lcb_log(LOGARGS(instance, DEBUG), "Unable to load collections manifest: %s", lcb_strerror_short(resp->ctx.rc));
+    } else if (resp->value == nullptr || resp->nvalue == 0) {
+        lcb_log(LOGARGS(instance, DEBUG), "Received empty collections manifest");
+    }
+    /* successful manifests are applied to the cache by the response handler already */
+    delete ctx;
+}
+
+static void handle_manifest_load_schedfail(mc_PACKET *pkt)
+{
+    delete static_cast<ManifestLoadCtx *>(pkt->u_rdata.exdata);
+}
+
+mc_REQDATAPROCS ManifestLoadCtx::proctable = {handle_manifest_load, handle_manifest_load_schedfail};
+
+/**
+ * Request the collections manifest of the bucket, so that the collection cache
+ * gets filled with every collection at once instead of one GET_CID per miss.
+ */
+lcb_STATUS collcache_load_manifest(lcb_INSTANCE *instance)
+{
+    if (LCBT_SETTING(instance, conntype) != LCB_TYPE_BUCKET) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    if (!LCBT_SETTING(instance, use_collections)) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    mc_CMDQUEUE *cq = &instance->cmdq;
+    if (cq->config == nullptr) {
+        return LCB_ERR_NO_CONFIGURATION;
+    }
+    if (cq->npipelines < 1) {
+        return LCB_ERR_NO_MATCHING_SERVER;
+    }
+    mc_PIPELINE *pl = cq->pipelines[0];
+
+    mc_PACKET *pkt = mcreq_allocate_packet(pl);
+    if (!pkt) {
+        return LCB_ERR_NO_MEMORY;
+    }
+    mcreq_reserve_header(pl, pkt, MCREQ_PKT_BASESIZE);
+    pkt->flags |= MCREQ_F_NOCID;
+
+    protocol_binary_request_header hdr{};
+    hdr.request.magic = PROTOCOL_BINARY_REQ;
+    hdr.request.opcode = PROTOCOL_BINARY_CMD_COLLECTIONS_GET_MANIFEST;
+    hdr.request.datatype = PROTOCOL_BINARY_RAW_BYTES;
+    hdr.request.opaque = pkt->opaque;
+    memcpy(SPAN_BUFFER(&pkt->kh_span), hdr.bytes, sizeof(hdr.bytes));
+
+    pkt->u_rdata.exdata = new ManifestLoadCtx(instance);
+    pkt->u_rdata.exdata->deadline = pkt->u_rdata.exdata->start + LCB_US2NS(LCBT_SETTING(instance, operation_timeout));
+    pkt->flags |= MCREQ_F_REQEXT;
+
+    LCB_SCHED_ADD(instance, pl, pkt)
+    return LCB_SUCCESS;
+}
+
 LIBCOUCHBASE_API lcb_STATUS lcb_respgetmanifest_status(const lcb_RESPGETMANIFEST *resp)
 {
     return resp->ctx.rc;
@@ -19,7 +19,11 @@
 #define LCB_COLLECTIONS_H
 
 #ifdef __cplusplus
+#include <functional>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "capi/cmd_getcid.hh"
 #include "capi/collection_qualifier.hh"
@@ -27,23 +31,85 @@
 
 namespace lcb
 {
+/**
+ * Maps "scope.collection" specs to collection IDs.
+ *
+ * The specs are kept in a flat open-addressing table, which can be probed
+ * with the scope and collection names directly, so that looking up an ID does
+ * not need to build the spec string first.
+ *
+ * The cache also tracks in-flight GET_CID requests, so that concurrent misses
+ * for the same spec wait for a single resolution instead of each sending one.
+ */
 class CollectionCache
 {
-    std::map<std::string, uint32_t> cache_n2i{};
-    std::map<uint32_t, std::string> cache_i2n{};
-
   public:
+    using resolve_waiter = std::function<void(lcb_STATUS, const lcb_RESPGETCID *)>;
+
     CollectionCache();
 
     ~CollectionCache() = default;
 
-    bool get(const std::string &path, uint32_t *cid);
+    bool get(const std::string &path, uint32_t *cid) const;
+
+    bool get(const char *scope, size_t nscope, const char *collection, size_t ncollection, uint32_t *cid) const;
 
     void put(const std::string &path, uint32_t cid);
 
-    std::string id_to_name(uint32_t cid);
+    const std::string &id_to_name(uint32_t cid) const;
 
     void erase(uint32_t cid);
+
+    /**
+     * Fill the cache with every collection listed in a JSON manifest, as
+     * returned by GET_COLLECTIONS_MANIFEST. Manifests older than the last one
+     * applied are ignored.
+     *
+     * @return the number of collections added, or -1 if the manifest could not be parsed
+     */
+    int apply_manifest(const char *json, size_t njson);
+
+    /**
+     * Mark the given spec as being resolved.
+     *
+     * Returns false if a resolution for it is already in flight, in which
+     * case the caller should queue behind it with wait_resolve(). Otherwise
+     * the caller is expected to send the GET_CID request and to call
+     * finish_resolve() once it completes.
+     */
+    bool begin_resolve(const std::string &path);
+
+    void wait_resolve(const std::string &path, resolve_waiter waiter);
+
+    /**
+     * Complete the in-flight resolution of the given spec, invoking every
+     * waiter queued behind it. The response is nullptr if the request could
+     * not be scheduled.
+     */
+    void finish_resolve(const std::string &path, lcb_STATUS rc, const lcb_RESPGETCID *resp);
+
+    size_t size() const
+    {
+        return nentries_;
+    }
+
+  private:
+    struct entry {
+        std::string path{};
+        uint64_t hash{0};
+        uint32_t cid{0};
+        bool used{false};
+    };
+
+    size_t find_slot(uint64_t hash, const char *scope, size_t nscope, const char *collection, size_t ncollection) const;
+    void grow();
+    void remove_slot(size_t idx);
+
+    std::vector<entry> slots_;
+    size_t nentries_{0};
+    uint64_t manifest_uid_{0};
+    std::unordered_map<uint32_t, std::string> cache_i2n{};
+    std::unordered_map<std::string, std::vector<resolve_waiter>> pending_{};
 };
 } // namespace lcb
 typedef lcb::CollectionCache lcb_COLLCACHE;
@@ -51,10 +117,12 @@ typedef lcb::CollectionCache lcb_COLLCACHE;
 lcb_STATUS collcache_get(lcb_INSTANCE *instance, const char *scope, size_t nscope, const char *collection,
                          size_t ncollection, uint32_t *cid);
 lcb_STATUS collcache_get(lcb_INSTANCE *instance, lcb::collection_qualifier &collection);
+lcb_STATUS collcache_load_manifest(lcb_INSTANCE *instance);
 std::string collcache_build_spec(const char *scope, size_t nscope, const char *collection, size_t ncollection);
 
 template <typename Command, typename Operation, typename Destructor>
 struct GetCidCtx : mc_REQDATAEX {
+    lcb_INSTANCE *instance_;
     std::string path_;
     Operation op_;
     Command cmd_;
@@ -62,8 +130,9 @@ struct GetCidCtx : mc_REQDATAEX {
 
     static mc_REQDATAPROCS proctable;
 
-    GetCidCtx(std::string path, Operation op, Command cmd, Destructor dtor)
-        : mc_REQDATAEX(nullptr, proctable, gethrtime()), path_(std::move(path)), op_(op), cmd_(cmd), dtor_(dtor)
+    GetCidCtx(lcb_INSTANCE *instance, std::string path, Operation op, Command cmd, Destructor dtor)
+        : mc_REQDATAEX(nullptr, proctable, gethrtime()), instance_(instance), path_(std::move(path)), op_(op), cmd_(cmd),
+          dtor_(dtor)
     {
     }
 
@@ -77,9 +146,10 @@ struct GetCidCtx : mc_REQDATAEX {
 };
 
 template <typename Command, typename Operation, typename Destructor>
-GetCidCtx<Command, Operation, Destructor> *make_cid_ctx(std::string path, Operation op, Command cmd, Destructor dtor)
+GetCidCtx<Command, Operation, Destructor> *make_cid_ctx(lcb_INSTANCE *instance, std::string path, Operation op,
+                                                        Command cmd, Destructor dtor)
 {
-    return new GetCidCtx<Command, Operation, Destructor>(path, op, cmd, dtor);
+    return new GetCidCtx<Command, Operation, Destructor>(instance, std::move(path), op, cmd, dtor);
 }
 
 template <typename Command, typename Operation, typename Destructor>
@@ -98,19 +168,49 @@ static void handle_collcache_proc(mc_PIPELINE *pipeline, mc_PACKET *pkt, lcb_CAL
                 "failed to resolve collection, rc: %s", lcb_strerror_short(resp->ctx.rc));
     }
     ctx->op_(resp, ctx->cmd_);
+    std::string path = std::move(ctx->path_);
     delete ctx;
+    instance->collcache->finish_resolve(path, resp->ctx.rc, resp);
 }
 
 template <typename Command, typename Operation, typename Destructor>
 static void handle_collcache_schedfail(mc_PACKET *pkt)
 {
-    delete static_cast<GetCidCtx<Command, Operation, Destructor> *>(pkt->u_rdata.exdata);
+    auto *ctx = static_cast<GetCidCtx<Command, Operation, Destructor> *>(pkt->u_rdata.exdata);
+    lcb_INSTANCE *instance = ctx->instance_;
+    lcb_RESPGETCID resp{};
+    resp.ctx.rc = LCB_ERR_SHEDULE_FAILURE;
+    ctx->op_(&resp, ctx->cmd_);
+    std::string path = std::move(ctx->path_);
+    delete ctx;
+    instance->collcache->finish_resolve(path, LCB_ERR_SHEDULE_FAILURE, nullptr);
 }
 
 template <typename Command, typename Operation, typename Destructor>
 mc_REQDATAPROCS GetCidCtx<Command, Operation, Destructor>::proctable = {
     handle_collcache_proc<Command, Operation, Destructor>, handle_collcache_schedfail<Command, Operation, Destructor>};
 
+/**
+ * Wrap a command queued behind an in-flight resolution, so that it is handed
+ * to the operation once the resolution completes. If the resolution failed
+ * without a response, the operation receives one carrying the failure status.
+ */
+template <typename Command, typename Operation>
+lcb::CollectionCache::resolve_waiter make_cid_waiter(Operation op, std::shared_ptr<Command> follower)
+{
+    return [op, follower](lcb_STATUS rc, const lcb_RESPGETCID *resp) {
+        lcb_RESPGETCID failed{};
+        if (resp == nullptr) {
+            failed.ctx.rc = rc;
+            resp = &failed;
+        }
+        if (resp->ctx.rc == LCB_SUCCESS) {
+            follower->cid = resp->collection_id;
+        }
+        op(resp, follower.get());
+    };
+}
+
 template <typename Command, typename Operation, typename Duplicator, typename Destructor>
 lcb_STATUS collcache_resolve(lcb_INSTANCE *instance, Command cmd, Operation op, Duplicator dup, Destructor dtor)
 {
@@ -135,9 +235,20 @@ lcb_STATUS collcache_resolve(lcb_INSTANCE *instance, Command cmd, Operation op,
     if (idx < 0) {
         return LCB_ERR_NO_MATCHING_SERVER;
     }
+
+    if (!instance->collcache->begin_resolve(spec)) {
+        /* another command is resolving the same collection already */
+        MutableCommand clone{};
+        dup(cmd, &clone);
+        std::shared_ptr<typename std::remove_pointer<MutableCommand>::type> follower(clone, dtor);
+        instance->collcache->wait_resolve(spec, make_cid_waiter(op, follower));
+        return LCB_SUCCESS;
+    }
+
     mc_PIPELINE *pl = cq->pipelines[idx];
     mc_PACKET *pkt = mcreq_allocate_packet(pl);
     if (!pkt) {
+        instance->collcache->finish_resolve(spec, LCB_ERR_NO_MEMORY, nullptr);
         return LCB_ERR_NO_MEMORY;
     }
     mcreq_reserve_header(pl, pkt, MCREQ_PKT_BASESIZE);
@@ -155,7 +266,7 @@ lcb_STATUS collcache_resolve(lcb_INSTANCE *instance, Command cmd, Operation op,
 
     MutableCommand clone{};
     dup(cmd, &clone);
-    pkt->u_rdata.exdata = make_cid_ctx(spec, op, clone, dtor);
+    pkt->u_rdata.exdata = make_cid_ctx(instance, spec, op, clone, dtor);
     pkt->u_rdata.exdata->start = gethrtime();
     pkt->u_rdata.exdata->deadline =
         pkt->u_rdata.exdata->start + LCB_US2NS(cmd->timeout ? cmd->timeout : LCBT_SETTING(instance, operation_timeout));
@@ -188,9 +299,22 @@ lcb_STATUS collcache_resolve(lcb_INSTANCE *instance, std::shared_ptr<Command> cm
     if (idx < 0) {
         return LCB_ERR_NO_MATCHING_SERVER;
     }
+
+    if (!instance->collcache->begin_resolve(spec)) {
+        /* another command is resolving the same collection already */
+        instance->collcache->wait_resolve(spec, [cmd, scheduler](lcb_STATUS rc, const lcb_RESPGETCID *resp) {
+            if (resp != nullptr && resp->ctx.rc == LCB_SUCCESS) {
+                cmd->collection().collection_id(resp->collection_id);
+            }
+            scheduler(rc, resp, cmd);
+        });
+        return LCB_SUCCESS;
+    }
+
     mc_PIPELINE *pl = cq->pipelines[idx];
     mc_PACKET *pkt = mcreq_allocate_packet(pl);
     if (!pkt) {
+        instance->collcache->finish_resolve(spec, LCB_ERR_NO_MEMORY, nullptr);
         return LCB_ERR_NO_MEMORY;
     }
     mcreq_reserve_header(pl, pkt, MCREQ_PKT_BASESIZE);
@@ -208,15 +332,17 @@ lcb_STATUS collcache_resolve(lcb_INSTANCE *instance, std::shared_ptr<Command> cm
 
     pkt->u_rdata.exdata = lcb::make_deferred_command_context<Command, lcb_RESPGETCID>(
         cmd, [instance, scheduler](lcb_STATUS rc, const lcb_RESPGETCID *resp, std::shared_ptr<Command> operation) {
-            if (resp->ctx.rc == LCB_SUCCESS) {
-                auto &collection = operation->collection();
+            auto &collection = operation->collection();
+            if (resp != nullptr && resp->ctx.rc == LCB_SUCCESS) {
                 instance->collcache->put(collection.spec(), resp->collection_id);
                 collection.collection_id(resp->collection_id);
             } else {
                 lcb_log((instance)->settings, "collcache", LCB_LOG_DEBUG, __FILE__, __LINE__,
-                        "failed to resolve collection, rc: %s", lcb_strerror_short(resp->ctx.rc));
+                        "failed to resolve collection, rc: %s",
+                        lcb_strerror_short(resp != nullptr ? resp->ctx.rc : rc));
             }
             scheduler(rc, resp, operation);
+            instance->collcache->finish_resolve(collection.spec(), rc, resp);
         });
     pkt->u_rdata.exdata->deadline =
         pkt->u_rdata.exdata->start +
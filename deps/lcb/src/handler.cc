@@ -336,7 +336,7 @@ template <typename T>
 void invoke_callback(const mc_PACKET *pkt, lcb_INSTANCE *instance, T *resp, lcb_CALLBACK_TYPE cbtype)
 {
     if (instance != nullptr) {
-        std::string collection_path = instance->collcache->id_to_name(mcreq_get_cid(instance, pkt));
+        const std::string &collection_path = instance->collcache->id_to_name(mcreq_get_cid(instance, pkt));
         if (!collection_path.empty()) {
             size_t dot = collection_path.find('.');
             if (dot != std::string::npos) {
@@ -389,7 +389,8 @@ static void maybe_decompress(lcb_INSTANCE *o, const MemcachedResponse *respkt, T
     if (respkt->datatype() & PROTOCOL_BINARY_DATATYPE_COMPRESSED) {
         if (LCBT_SETTING(o, compressopts) & LCB_COMPRESS_IN) {
             /* if we inflate, we don't set the flag */
-            mcreq_inflate_value(respkt->value(), respkt->vallen(), &rescmd->value, &rescmd->nvalue, freeptr);
+            mcreq_inflate_value2(mcreq_queue_scratch(&o->cmdq), respkt->value(), respkt->vallen(), &rescmd->value,
+                                 &rescmd->nvalue, freeptr);
 
         } else {
             /* user doesn't want inflation. signal it's compressed */
@@ -410,9 +411,14 @@ static void H_get(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedResponse *
 
     if (resp.ctx.rc == LCB_SUCCESS) {
         resp.datatype = response->datatype();
-        resp.value = response->value();
+        if (response->is_scattered()) {
+            resp.value_iov = reinterpret_cast<const lcb_IOV *>(response->value_iov().data());
+            resp.nvalue_iov = response->value_iov().size();
+        } else {
+            resp.value = response->value();
+            resp.bufh = response->bufseg();
+        }
         resp.nvalue = response->vallen();
-        resp.bufh = response->bufseg();
         if (response->extlen() == sizeof(uint32_t)) {
             memcpy(&resp.itmflags, response->ext(), sizeof(uint32_t));
             resp.itmflags = ntohl(resp.itmflags);
@@ -429,7 +435,8 @@ static void H_get(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedResponse *
     } else {
         invoke_callback(request, o, &resp, LCB_CALLBACK_GET);
     }
-    free(freeptr);
+    mcreq_scratch_release(o->cmdq.scratch, freeptr);
+    delete[] resp.value_buf;
 }
 
 static void H_exists(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedResponse *response, lcb_STATUS immerr)
@@ -484,7 +491,7 @@ static void H_getreplica(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedRes
 
     maybe_decompress(instance, response, &resp, &freeptr);
     rd->procs->handler(pipeline, request, LCB_CALLBACK_GETREPLICA, resp.ctx.rc, &resp);
-    free(freeptr);
+    mcreq_scratch_release(instance->cmdq.scratch, freeptr);
 }
 
 static int lcb_sdresult_next(const lcb_RESPSUBDOC *resp, lcb_SDENTRY *ent, size_t *iter);
@@ -519,6 +526,7 @@ static void H_subdoc(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedRespons
     init_resp(o, pipeline, response, request, immerr, &resp);
     resp.rflags |= LCB_RESP_F_FINAL;
     resp.res = nullptr;
+    resp.bufh = response->bufseg();
 
     /* For mutations, add the mutation token */
     switch (response->opcode()) {
@@ -896,7 +904,21 @@ static void H_collections_get_manifest(mc_PIPELINE *pipeline, mc_PACKET *request
     resp.rflags |= LCB_RESP_F_FINAL;
     resp.value = response->value();
     resp.nvalue = response->vallen();
-    invoke_callback(request, root, &resp, LCB_CALLBACK_COLLECTIONS_GET_MANIFEST);
+    if (resp.ctx.rc == LCB_SUCCESS && root != nullptr && resp.nvalue > 0) {
+        /* every manifest seen fills the collection cache, no matter who asked for it */
+        int added = root->collcache->apply_manifest(resp.value, resp.nvalue);
+        if (added < 0) {
+            lcb_log(LOGARGS(root, WARN), "Unable to parse collections manifest");
+        } else {
+            lcb_log(LOGARGS(root, DEBUG), "Loaded %d collection(s) from manifest", added);
+        }
+    }
+    if (request->flags & MCREQ_F_REQEXT) {
+        request->u_rdata.exdata->procs->handler(pipeline, request, LCB_CALLBACK_COLLECTIONS_GET_MANIFEST, resp.ctx.rc,
+                                                &resp);
+    } else {
+        invoke_callback(request, root, &resp, LCB_CALLBACK_COLLECTIONS_GET_MANIFEST);
+    }
 }
 
 static void H_collections_get_cid(mc_PIPELINE *pipeline, mc_PACKET *request, MemcachedResponse *response,
@@ -809,3 +809,15 @@ LIBCOUCHBASE_API lcb_STATUS lcb_http_cancel(lcb_INSTANCE *, lcb_HTTP_HANDLE *han
     handle->cancel();
     return LCB_SUCCESS;
 }
+
+LIBCOUCHBASE_API lcb_STATUS lcb_http_pause(lcb_INSTANCE *, lcb_HTTP_HANDLE *handle)
+{
+    handle->pause();
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_http_resume(lcb_INSTANCE *, lcb_HTTP_HANDLE *handle)
+{
+    handle->resume();
+    return LCB_SUCCESS;
+}
@@ -193,10 +193,11 @@ void Request::resume()
         return;
     }
 
+    paused = false;
     if (ioctx == nullptr) {
+        // Reading will begin once the connection has been established
         return;
     }
-    paused = false;
     lcbio_ctx_rwant(ioctx, 1);
     lcbio_ctx_schedule(ioctx);
 }
@@ -260,7 +261,7 @@ static void on_connected(lcbio_SOCKET *sock, void *arg, lcb_STATUS err, lcbio_OS
     if (!req->body.empty()) {
         lcbio_ctx_put(req->ioctx, &req->body[0], req->body.size());
     }
-    lcbio_ctx_rwant(req->ioctx, 1);
+    lcbio_ctx_rwant(req->ioctx, req->paused ? 0 : 1);
     lcbio_ctx_schedule(req->ioctx);
     (void)syserr;
 }
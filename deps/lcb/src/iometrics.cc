@@ -116,6 +116,7 @@ void lcb_metrics_dumpserver(const lcb_SERVERMETRICS *metrics, FILE *fp)
     fprintf(fp, "Packets received: %lu\n", (unsigned long int)metrics->packets_read);
     fprintf(fp, "Packets errored: %lu\n", (unsigned long int)metrics->packets_errored);
     fprintf(fp, "Packets NMV: %lu\n", (unsigned long int)metrics->packets_nmv);
+    fprintf(fp, "Packets rejected: %lu\n", (unsigned long int)metrics->packets_rejected);
     fprintf(fp, "Packets timeout: %lu\n", (unsigned long int)metrics->packets_timeout);
     fprintf(fp, "Packets orphaned: %lu", (unsigned long int)metrics->packets_ownerless);
 }
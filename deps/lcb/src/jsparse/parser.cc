@@ -240,6 +240,11 @@ static void initial_push_callback(jsonsl_t jsn, jsonsl_action_t, struct jsonsl_s
 
 void Parser::feed(const char *data_, size_t ndata)
 {
+    if (scanner) {
+        scanner->feed(data_, ndata);
+        return;
+    }
+
     size_t old_len = current_buf.size();
     current_buf.append(data_, ndata);
     jsonsl_feed(jsn, current_buf.c_str() + old_len, ndata);
@@ -267,18 +272,37 @@ const char *Parser::jprstr_for_mode(Mode mode)
     }
 }
 
-Parser::Parser(Mode mode_, Parser::Actions *actions_)
-    : jsn(jsonsl_new(512)), jsn_rdetails(jsonsl_new(32)), jpr(jsonsl_jpr_new(jprstr_for_mode(mode_), nullptr)),
-      mode(mode_), have_error(0), initialized(0), meta_complete(0), rowcount(0), min_pos(0), keep_pos(0), header_len(0),
-      last_row_endpos(0), cxx_data(), actions(actions_)
+const char *Parser::rowset_key_for_mode(Mode mode)
+{
+    switch (mode) {
+        case MODE_VIEWS:
+            return "rows";
+        case MODE_N1QL:
+        case MODE_ANALYTICS:
+            return "results";
+        case MODE_FTS:
+            return "hits";
+        default:
+            lcb_assert(0 && "Invalid mode passed!");
+            return nullptr;
+    }
+}
+
+Parser::Parser(Mode mode_, Parser::Actions *actions_, bool use_scanner)
+    : jsn(nullptr), jsn_rdetails(nullptr), jpr(nullptr), mode(mode_), have_error(0), initialized(0), meta_complete(0),
+      rowcount(0), min_pos(0), keep_pos(0), header_len(0), last_row_endpos(0), cxx_data(), actions(actions_),
+      scanner(nullptr)
 {
+    if (use_scanner) {
+        /* the scanner splits the rows itself, so the jsonsl parser is never needed */
+        scanner = new RowScanner(*this, rowset_key_for_mode(mode_));
+        return;
+    }
 
+    jsn = jsonsl_new(512);
+    jpr = jsonsl_jpr_new(jprstr_for_mode(mode_), nullptr);
     jsonsl_jpr_match_state_init(jsn, &jpr, 1);
     jsonsl_reset(jsn);
-    jsonsl_reset(jsn_rdetails);
-    current_buf.clear();
-    meta_buf.clear();
-    last_hk.clear();
 
     /* Initially all callbacks are enabled so that we can search for the
      * rows array. */
@@ -292,7 +316,7 @@ Parser::Parser(Mode mode_, Parser::Actions *actions_)
 
 void Parser::get_postmortem(lcb_IOV &out) const
 {
-    if (meta_complete) {
+    if (meta_complete || scanner) {
         out.iov_base = const_cast<char *>(meta_buf.c_str());
         out.iov_len = meta_buf.size();
     } else {
@@ -303,10 +327,13 @@ void Parser::get_postmortem(lcb_IOV &out) const
 
 Parser::~Parser()
 {
-    jsonsl_jpr_match_state_cleanup(jsn);
-    jsonsl_destroy(jsn);
+    delete scanner;
+    if (jsn != nullptr) {
+        jsonsl_jpr_match_state_cleanup(jsn);
+        jsonsl_destroy(jsn);
+        jsonsl_jpr_destroy(jpr);
+    }
     jsonsl_destroy(jsn_rdetails);
-    jsonsl_jpr_destroy(jpr);
 }
 
 typedef struct {
@@ -412,6 +439,9 @@ void Parser::parse_viewrow(Row &vr)
     ctx.root = static_cast<const char *>(vr.row.iov_base);
     ctx.parent = this;
 
+    if (jsn_rdetails == nullptr) {
+        jsn_rdetails = jsonsl_new(32);
+    }
     jsonsl_reset(jsn_rdetails);
 
     jsonsl_enable_all_callbacks(jsn_rdetails);
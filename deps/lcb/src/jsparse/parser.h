@@ -20,6 +20,7 @@
 #include <libcouchbase/couchbase.h>
 #include "contrib/jsonsl/jsonsl.h"
 #include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
+#include "scanner.h"
 #include <string>
 
 namespace lcb
@@ -71,8 +72,10 @@ struct Parser {
      * You must set callbacks on this object if you wish it to be useful.
      * You must feed it data (calling vrow_feed) as well. The data may be fed
      * in chunks and callbacks will be invoked as each row is read.
+     *
+     * @param use_scanner split rows with the RowScanner rather than jsonsl
      */
-    Parser(Mode mode, Actions *actions_);
+    Parser(Mode mode, Actions *actions_, bool use_scanner = false);
     ~Parser();
 
     /**
@@ -109,9 +112,10 @@ struct Parser {
     inline const char *get_buffer_region(size_t pos, size_t desired, size_t *actual) const;
     inline void combine_meta();
     inline static const char *jprstr_for_mode(Mode);
+    static const char *rowset_key_for_mode(Mode);
 
-    jsonsl_t jsn;            /**< Parser for the row itself */
-    jsonsl_t jsn_rdetails;   /**< Parser for the row details */
+    jsonsl_t jsn;            /**< Parser for the row itself, unless the scanner is used */
+    jsonsl_t jsn_rdetails;   /**< Parser for the row details, allocated on first use */
     jsonsl_jpr_t jpr;        /**< jsonpointer match object */
     std::string meta_buf;    /**< String containing the skeleton (outer layer) */
     std::string current_buf; /**< Scratch/read buffer */
@@ -150,6 +154,9 @@ struct Parser {
 
     /* callback to invoke */
     Actions *actions;
+
+    /* Used instead of jsn to split the rows, if set */
+    RowScanner *scanner;
 };
 
 } // namespace jsparse
@@ -0,0 +1,406 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "scanner.h"
+#include "parser.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LCB_JSPARSE_SSE2
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+using namespace lcb::jsparse;
+
+namespace
+{
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+#ifdef LCB_JSPARSE_SSE2
+inline unsigned first_bit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return idx;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+/** Finds the next character which is significant outside of a string */
+const char *find_structural(const char *p, const char *end)
+{
+#ifdef LCB_JSPARSE_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i lowercase = _mm_set1_epi8(0x20);
+    /* '[' and ']' only differ from '{' and '}' in the 0x20 bit */
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i folded = _mm_or_si128(chunk, lowercase);
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, comma)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask != 0) {
+            return p + first_bit(mask);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        switch (*p) {
+            case '"':
+            case ',':
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+                return p;
+            default:
+                break;
+        }
+    }
+    return end;
+}
+
+/** Finds the next character which is significant inside of a string */
+const char *find_string_special(const char *p, const char *end)
+{
+#ifdef LCB_JSPARSE_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask != 0) {
+            return p + first_bit(mask);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == '"' || *p == '\\') {
+            return p;
+        }
+    }
+    return end;
+}
+
+char opener_for(char c)
+{
+    return c == '}' ? '{' : '[';
+}
+} // namespace
+
+RowScanner::RowScanner(Parser &parser, const char *rowset_key) : parser_(parser), rowset_key_(rowset_key) {}
+
+void RowScanner::feed(const char *data, std::size_t ndata)
+{
+    const char *end = data + ndata;
+    switch (state_) {
+        case STATE_HEADER: {
+            std::size_t chunk_pos = parser_.meta_buf.size();
+            parser_.meta_buf.append(data, ndata);
+            std::size_t rows_pos = scan_meta(scan_pos_);
+            if (rows_pos == std::string::npos) {
+                return;
+            }
+            /* everything following the opening bracket is handed to the rows from the chunk itself */
+            parser_.meta_buf.resize(rows_pos);
+            parser_.header_len = rows_pos;
+            scan_rows(data, data + (rows_pos - chunk_pos), end);
+            break;
+        }
+        case STATE_ROWS:
+            scan_rows(data, data, end);
+            break;
+        case STATE_TRAILER: {
+            std::size_t pos = parser_.meta_buf.size();
+            parser_.meta_buf.append(data, ndata);
+            scan_meta(pos);
+            break;
+        }
+        case STATE_DONE:
+            break;
+    }
+}
+
+const char *RowScanner::skip_string(const char *p, const char *end)
+{
+    if (escaped_) {
+        if (p == end) {
+            return p;
+        }
+        escaped_ = false;
+        p++;
+    }
+    while (true) {
+        p = find_string_special(p, end);
+        if (p == end) {
+            return end;
+        }
+        if (*p == '\\') {
+            if (p + 1 == end) {
+                escaped_ = true;
+                return end;
+            }
+            p += 2;
+            continue;
+        }
+        in_string_ = false;
+        return p + 1;
+    }
+}
+
+std::size_t RowScanner::scan_meta(std::size_t pos)
+{
+    std::string &buf = parser_.meta_buf;
+    const char *begin = buf.data();
+    const char *p = begin + pos;
+    const char *end = begin + buf.size();
+
+    while (p < end) {
+        if (in_string_) {
+            p = skip_string(p, end);
+            if (!in_string_ && stack_.size() == 1) {
+                key_end_ = p - 1 - begin;
+            }
+            continue;
+        }
+
+        if (stack_.empty()) {
+            if (is_space(*p)) {
+                p++;
+                continue;
+            }
+            if (state_ == STATE_HEADER && *p == '{') {
+                stack_.push_back('{');
+                p++;
+                continue;
+            }
+            fail();
+            return std::string::npos;
+        }
+
+        p = find_structural(p, end);
+        if (p == end) {
+            break;
+        }
+        char c = *p;
+        switch (c) {
+            case '"':
+                in_string_ = true;
+                if (stack_.size() == 1) {
+                    key_begin_ = p + 1 - begin;
+                }
+                p++;
+                break;
+            case '[':
+                if (state_ == STATE_HEADER && stack_.size() == 1 &&
+                    buf.compare(key_begin_, key_end_ - key_begin_, rowset_key_) == 0) {
+                    stack_.push_back('[');
+                    state_ = STATE_ROWS;
+                    return p + 1 - begin;
+                }
+                stack_.push_back(c);
+                p++;
+                break;
+            case '{':
+                stack_.push_back(c);
+                p++;
+                break;
+            case '}':
+            case ']':
+                if (stack_.back() != opener_for(c)) {
+                    fail();
+                    return std::string::npos;
+                }
+                stack_.pop_back();
+                p++;
+                if (stack_.empty()) {
+                    if (state_ == STATE_TRAILER) {
+                        buf.resize(p - begin);
+                        state_ = STATE_DONE;
+                        parser_.meta_complete = 1;
+                        if (parser_.actions) {
+                            parser_.actions->JSPARSE_on_complete(buf);
+                            parser_.actions = nullptr;
+                        }
+                    } else {
+                        /* there was no rows array, the entire response is left in the buffer */
+                        state_ = STATE_DONE;
+                    }
+                    return std::string::npos;
+                }
+                break;
+            default:
+                p++;
+                break;
+        }
+    }
+    scan_pos_ = buf.size();
+    return std::string::npos;
+}
+
+void RowScanner::scan_rows(const char *data, const char *p, const char *end)
+{
+    while (p < end) {
+        if (in_string_) {
+            p = skip_string(p, end);
+            if (!in_string_ && row_kind_ == ROW_STRING) {
+                emit_row(data, p);
+            }
+            continue;
+        }
+
+        if (!in_row_) {
+            char c = *p;
+            if (is_space(c) || c == ',') {
+                p++;
+                continue;
+            }
+            if (c == ']') {
+                /* end of the rows, the rest of the chunk starts the trailer */
+                state_ = STATE_TRAILER;
+                std::size_t pos = parser_.meta_buf.size();
+                parser_.meta_buf.append(p, end - p);
+                scan_meta(pos);
+                return;
+            }
+            if (c == '}') {
+                fail();
+                return;
+            }
+            in_row_ = true;
+            row_begin_ = p;
+            if (c == '{' || c == '[') {
+                row_kind_ = ROW_CONTAINER;
+                stack_.push_back(c);
+            } else if (c == '"') {
+                row_kind_ = ROW_STRING;
+                in_string_ = true;
+            } else {
+                row_kind_ = ROW_SCALAR;
+            }
+            p++;
+            continue;
+        }
+
+        p = find_structural(p, end);
+        if (p == end) {
+            break;
+        }
+        char c = *p;
+        if (row_kind_ == ROW_SCALAR) {
+            if (c != ',' && c != ']') {
+                fail();
+                return;
+            }
+            /* the separator is left for the next row (or the trailer) */
+            const char *rowend = p;
+            if (row_buf_.empty()) {
+                while (rowend > row_begin_ && is_space(rowend[-1])) {
+                    rowend--;
+                }
+            }
+            emit_row(data, rowend);
+            continue;
+        }
+        p++;
+        switch (c) {
+            case '"':
+                in_string_ = true;
+                break;
+            case '{':
+            case '[':
+                stack_.push_back(c);
+                break;
+            case '}':
+            case ']':
+                if (stack_.back() != opener_for(c)) {
+                    fail();
+                    return;
+                }
+                stack_.pop_back();
+                if (stack_.size() == 2) {
+                    emit_row(data, p);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (in_row_) {
+        /* the row continues in the next chunk */
+        const char *piece = row_begin_ ? row_begin_ : data;
+        row_buf_.append(piece, end - piece);
+        row_begin_ = nullptr;
+    }
+}
+
+void RowScanner::emit_row(const char *data, const char *rowend)
+{
+    const char *rowbuf;
+    std::size_t nrowbuf;
+    if (row_buf_.empty()) {
+        rowbuf = row_begin_;
+        nrowbuf = rowend - row_begin_;
+    } else {
+        row_buf_.append(data, rowend - data);
+        if (row_kind_ == ROW_SCALAR) {
+            while (!row_buf_.empty() && is_space(row_buf_.back())) {
+                row_buf_.pop_back();
+            }
+        }
+        rowbuf = row_buf_.data();
+        nrowbuf = row_buf_.size();
+    }
+
+    in_row_ = false;
+    row_begin_ = nullptr;
+    parser_.rowcount++;
+    if (parser_.actions) {
+        Row dt{};
+        dt.row.iov_base = const_cast<char *>(rowbuf);
+        dt.row.iov_len = nrowbuf;
+        parser_.actions->JSPARSE_on_row(dt);
+    }
+    row_buf_.clear();
+}
+
+void RowScanner::fail()
+{
+    state_ = STATE_DONE;
+    parser_.have_error = 1;
+    if (parser_.actions) {
+        parser_.actions->JSPARSE_on_error(parser_.meta_buf);
+        parser_.actions = nullptr;
+    }
+}
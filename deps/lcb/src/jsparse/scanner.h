@@ -0,0 +1,93 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_JSPARSE_SCANNER_H
+#define LCB_JSPARSE_SCANNER_H
+
+#include <cstddef>
+#include <string>
+
+namespace lcb
+{
+namespace jsparse
+{
+
+struct Parser;
+
+/**
+ * Splits a streaming response into rows by looking only at its structural
+ * characters (quotes, backslashes, braces, brackets and commas), which are
+ * located several bytes at a time where the CPU allows it.
+ *
+ * Only the header preceding the rows array and the trailer following it are
+ * buffered (in Parser::meta_buf). A row is handed out as a slice of the data
+ * passed to feed() unless it spans more than one chunk, in which case its
+ * pieces are gathered into a buffer first.
+ *
+ * Unlike the jsonsl backend, the contents of rows and scalar values are not
+ * validated. Malformed nesting is still reported as an error, while anything
+ * else is left for the consumer of the rows or the metadata to reject.
+ */
+class RowScanner
+{
+  public:
+    RowScanner(Parser &parser, const char *rowset_key);
+
+    void feed(const char *data, std::size_t ndata);
+
+  private:
+    enum State { STATE_HEADER, STATE_ROWS, STATE_TRAILER, STATE_DONE };
+    enum RowKind { ROW_CONTAINER, ROW_STRING, ROW_SCALAR };
+
+    /**
+     * Scans the header or trailer, which is held in the parser's meta_buf,
+     * starting at the given offset.
+     * @return the offset following the opening bracket of the rows array
+     *  if it was found, or std::string::npos
+     */
+    std::size_t scan_meta(std::size_t pos);
+    void scan_rows(const char *data, const char *p, const char *end);
+    const char *skip_string(const char *p, const char *end);
+    void emit_row(const char *data, const char *rowend);
+    void fail();
+
+    Parser &parser_;
+    std::string rowset_key_;
+    State state_{STATE_HEADER};
+
+    /** The containers currently open, as their opening characters */
+    std::string stack_;
+    bool in_string_{false};
+    bool escaped_{false};
+
+    /** Offset of meta_buf to resume scanning the header from */
+    std::size_t scan_pos_{0};
+    /** Offsets of the last string seen directly within the root object */
+    std::size_t key_begin_{0};
+    std::size_t key_end_{0};
+
+    bool in_row_{false};
+    RowKind row_kind_{ROW_CONTAINER};
+    /** Start of the current row, if it began in the chunk being scanned */
+    const char *row_begin_{nullptr};
+    /** The pieces of a row which began in an earlier chunk */
+    std::string row_buf_;
+};
+
+} // namespace jsparse
+} // namespace lcb
+#endif /* LCB_JSPARSE_SCANNER_H */
@@ -18,6 +18,9 @@
 #include "mcreq.h"
 #include "compress.h"
 
+#include <cstdlib>
+#include <cstring>
+
 #include <snappy.h>
 #include <snappy-sinksource.h>
 
@@ -82,54 +85,132 @@ class FragBufSource : public snappy::Source
     unsigned int idx;
 };
 
+/* buffers are prefixed with the index of their size class, padded to keep the payload aligned */
+#define SCRATCH_HEADER_SIZE 16
+#define SCRATCH_MIN_SHIFT 12 /* 4KiB */
+#define SCRATCH_NCLASSES 9   /* ... up to 1MiB */
+#define SCRATCH_MAX_CACHED 2 /* per size class */
+#define SCRATCH_UNPOOLED 0xff
+
+struct mc_scratchpool_st {
+    char *cached[SCRATCH_NCLASSES][SCRATCH_MAX_CACHED];
+    unsigned ncached[SCRATCH_NCLASSES];
+};
+
+static unsigned scratch_class(size_t size)
+{
+    unsigned cls = 0;
+    while (cls < SCRATCH_NCLASSES && (size_t(1) << (SCRATCH_MIN_SHIFT + cls)) < size) {
+        cls++;
+    }
+    return cls < SCRATCH_NCLASSES ? cls : SCRATCH_UNPOOLED;
+}
+
+mc_SCRATCHPOOL *mcreq_scratch_new(void)
+{
+    return static_cast<mc_SCRATCHPOOL *>(calloc(1, sizeof(mc_SCRATCHPOOL)));
+}
+
+void mcreq_scratch_free(mc_SCRATCHPOOL *pool)
+{
+    if (pool == nullptr) {
+        return;
+    }
+    for (unsigned cls = 0; cls < SCRATCH_NCLASSES; cls++) {
+        for (unsigned ii = 0; ii < pool->ncached[cls]; ii++) {
+            free(pool->cached[cls][ii]);
+        }
+    }
+    free(pool);
+}
+
+mc_SCRATCHPOOL *mcreq_queue_scratch(mc_CMDQUEUE *queue)
+{
+    if (queue == nullptr) {
+        return nullptr;
+    }
+    if (queue->scratch == nullptr) {
+        queue->scratch = mcreq_scratch_new();
+    }
+    return queue->scratch;
+}
+
+void *mcreq_scratch_alloc(mc_SCRATCHPOOL *pool, size_t size)
+{
+    unsigned cls = pool ? scratch_class(size) : SCRATCH_UNPOOLED;
+    char *buf;
+    if (cls != SCRATCH_UNPOOLED && pool->ncached[cls] > 0) {
+        buf = pool->cached[cls][--pool->ncached[cls]];
+    } else {
+        size_t capacity = cls != SCRATCH_UNPOOLED ? size_t(1) << (SCRATCH_MIN_SHIFT + cls) : size;
+        buf = static_cast<char *>(malloc(SCRATCH_HEADER_SIZE + capacity));
+        if (buf == nullptr) {
+            return nullptr;
+        }
+        buf[0] = static_cast<char>(cls);
+    }
+    return buf + SCRATCH_HEADER_SIZE;
+}
+
+void mcreq_scratch_release(mc_SCRATCHPOOL *pool, void *ptr)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    char *buf = static_cast<char *>(ptr) - SCRATCH_HEADER_SIZE;
+    auto cls = static_cast<unsigned char>(buf[0]);
+    if (pool != nullptr && cls != SCRATCH_UNPOOLED && pool->ncached[cls] < SCRATCH_MAX_CACHED) {
+        pool->cached[cls][pool->ncached[cls]++] = buf;
+        return;
+    }
+    free(buf);
+}
+
 int mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_VALBUF *vbuf, lcb_settings *settings,
                          int *should_compress)
 {
     std::size_t origsize = 0;
-    snappy::Source *source;
     switch (vbuf->vtype) {
         case LCB_KV_COPY:
         case LCB_KV_CONTIG:
             origsize = vbuf->u_buf.contig.nbytes;
-            if (origsize < settings->compress_min_size) {
-                *should_compress = 0;
-                mcreq_reserve_value(pl, pkt, vbuf);
-                return 0;
-            }
-            source = new snappy::ByteArraySource(static_cast<const char *>(vbuf->u_buf.contig.bytes),
-                                                 vbuf->u_buf.contig.nbytes);
             break;
 
         case LCB_KV_IOV:
         case LCB_KV_IOVCOPY:
-            if (vbuf->u_buf.multi.total_length == 0) {
+            origsize = vbuf->u_buf.multi.total_length;
+            if (origsize == 0) {
                 for (unsigned int ii = 0; ii < vbuf->u_buf.multi.niov; ii++) {
                     origsize += vbuf->u_buf.multi.iov[ii].iov_len;
                 }
             }
-            if (origsize == 0 || origsize < settings->compress_min_size) {
-                *should_compress = 0;
-                mcreq_reserve_value(pl, pkt, vbuf);
-                return 0;
-            }
-            source = new FragBufSource(&vbuf->u_buf.multi);
             break;
 
         default:
             return -1;
     }
+    if (origsize == 0 || origsize < settings->compress_min_size) {
+        *should_compress = 0;
+        mcreq_reserve_value(pl, pkt, vbuf);
+        return 0;
+    }
 
-    std::size_t maxsize = snappy::MaxCompressedLength(source->Available());
+    /* compress straight into the pipeline buffers, trimming the reservation down to the compressed size */
+    std::size_t maxsize = snappy::MaxCompressedLength(origsize);
     if (mcreq_reserve_value2(pl, pkt, maxsize) != LCB_SUCCESS) {
-        delete source;
         return -1;
     }
     nb_SPAN *outspan = &pkt->u_value.single;
-    snappy::UncheckedByteArraySink sink(SPAN_BUFFER(outspan));
 
-    Compress(source, &sink);
-    std::size_t compsize = sink.CurrentDestination() - SPAN_BUFFER(outspan);
-    delete source;
+    std::size_t compsize = 0;
+    if (vbuf->vtype == LCB_KV_COPY || vbuf->vtype == LCB_KV_CONTIG) {
+        snappy::RawCompress(static_cast<const char *>(vbuf->u_buf.contig.bytes), origsize, SPAN_BUFFER(outspan),
+                            &compsize);
+    } else {
+        FragBufSource source(&vbuf->u_buf.multi);
+        snappy::UncheckedByteArraySink sink(SPAN_BUFFER(outspan));
+        compsize = snappy::Compress(&source, &sink);
+    }
 
     if (compsize == 0 || (((float)compsize / origsize) > settings->compress_min_ratio)) {
         netbuf_mblock_release(&pl->nbmgr, outspan);
@@ -139,7 +220,6 @@ int mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_VALBUF *vbuf
     }
 
     if (compsize < maxsize) {
-        /* chop off some bytes? */
         nb_SPAN trailspan = *outspan;
         trailspan.offset += compsize;
         trailspan.size = maxsize - compsize;
@@ -149,6 +229,29 @@ int mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_VALBUF *vbuf
     return 0;
 }
 
+int mcreq_inflate_value2(mc_SCRATCHPOOL *pool, const void *compressed, size_t ncompressed, const void **bytes,
+                         size_t *nbytes, void **freeptr)
+{
+    size_t compsize = 0;
+
+    if (!snappy::GetUncompressedLength(static_cast<const char *>(compressed), ncompressed, &compsize)) {
+        return -1;
+    }
+    *freeptr = mcreq_scratch_alloc(pool, compsize);
+    if (*freeptr == nullptr) {
+        return -1;
+    }
+    if (!snappy::RawUncompress(static_cast<const char *>(compressed), ncompressed, static_cast<char *>(*freeptr))) {
+        mcreq_scratch_release(pool, *freeptr);
+        *freeptr = nullptr;
+        return -1;
+    }
+
+    *bytes = *freeptr;
+    *nbytes = compsize;
+    return 0;
+}
+
 int mcreq_inflate_value(const void *compressed, size_t ncompressed, const void **bytes, size_t *nbytes, void **freeptr)
 {
     size_t compsize = 0;
@@ -24,6 +24,36 @@
 extern "C" {
 #endif
 
+/**
+ * Pool of reusable scratch buffers used to inflate values, so that each
+ * compressed response does not need a fresh allocation.
+ * Buffers are grouped in power-of-two size classes, and those larger than the
+ * biggest class are allocated and freed directly.
+ */
+typedef struct mc_scratchpool_st mc_SCRATCHPOOL;
+
+mc_SCRATCHPOOL *mcreq_scratch_new(void);
+void mcreq_scratch_free(mc_SCRATCHPOOL *pool);
+
+/**
+ * Get the scratch pool of the queue, creating it on first use
+ */
+mc_SCRATCHPOOL *mcreq_queue_scratch(mc_CMDQUEUE *queue);
+
+/**
+ * Allocate a scratch buffer of at least the given size
+ * @param pool The pool to allocate from. If NULL, the buffer is always allocated
+ * @param size The number of bytes required
+ * @return the buffer, or NULL if out of memory
+ */
+void *mcreq_scratch_alloc(mc_SCRATCHPOOL *pool, size_t size);
+
+/**
+ * Return a buffer obtained from mcreq_scratch_alloc() to the pool it was
+ * allocated from. NULL is ignored.
+ */
+void mcreq_scratch_release(mc_SCRATCHPOOL *pool, void *buf);
+
 /**
  * Stores a compressed payload into a packet
  * @param pl The pipeline which hosts the packet
@@ -49,6 +79,20 @@ int mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_VALBUF *vbuf
  */
 int mcreq_inflate_value(const void *compressed, size_t ncompressed, const void **bytes, size_t *nbytes, void **freeptr);
 
+/**
+ * Inflate a compressed value into a scratch buffer
+ * @param pool The pool to take the buffer from
+ * @param compressed The value to inflate
+ * @param ncompressed Size of value to inflate
+ * @param[out] bytes The inflated value
+ * @param[out] nbytes The size of the inflated value
+ * @param[in/out] freeptr Pointer initialized to NULL, which on output points to
+ * the buffer to be passed to mcreq_scratch_release() when no longer required.
+ * @return 0 if successful, nonzero on error.
+ */
+int mcreq_inflate_value2(mc_SCRATCHPOOL *pool, const void *compressed, size_t ncompressed, const void **bytes,
+                         size_t *nbytes, void **freeptr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -215,6 +215,246 @@ lcb_STATUS mcreq_reserve_value(mc_PIPELINE *pipeline, mc_PACKET *packet, const l
     return LCB_SUCCESS;
 }
 
+/** Initial capacity of a pipeline's packet map */
+#define PKTMAP_MINSIZE 64
+
+static unsigned pktmap_home(const mc_PKTMAP *map, uint32_t opaque)
+{
+    /* Opaques are handed out sequentially, so their low bits alone already
+     * spread the in-flight packets evenly over the table. */
+    return opaque & map->mask;
+}
+
+static void pktmap_insert(mc_PKTMAP *map, mc_PACKET *pkt);
+
+static void pktmap_grow(mc_PKTMAP *map)
+{
+    mc_PKTSLOT *old = map->slots;
+    unsigned oldcap = old ? map->mask + 1 : 0;
+    unsigned newcap = oldcap ? oldcap * 2 : PKTMAP_MINSIZE;
+
+    map->slots = calloc(newcap, sizeof(*map->slots));
+    map->mask = newcap - 1;
+    map->count = 0;
+
+    for (unsigned ii = 0; ii < oldcap; ii++) {
+        if (old[ii].pkt) {
+            pktmap_insert(map, old[ii].pkt);
+        }
+    }
+    free(old);
+}
+
+static void pktmap_insert(mc_PKTMAP *map, mc_PACKET *pkt)
+{
+    unsigned ix;
+
+    /* Keep the table at most half full so that probe runs stay short */
+    if (map->slots == NULL || (map->count + 1) * 2 > map->mask + 1) {
+        pktmap_grow(map);
+    }
+
+    ix = pktmap_home(map, pkt->opaque);
+    while (map->slots[ix].pkt) {
+        ix = (ix + 1) & map->mask;
+    }
+    map->slots[ix].opaque = pkt->opaque;
+    map->slots[ix].pkt = pkt;
+    map->count++;
+}
+
+static mc_PACKET *pktmap_find(const mc_PKTMAP *map, uint32_t opaque)
+{
+    unsigned ix;
+
+    if (map->count == 0) {
+        return NULL;
+    }
+
+    for (ix = pktmap_home(map, opaque); map->slots[ix].pkt; ix = (ix + 1) & map->mask) {
+        if (map->slots[ix].opaque == opaque) {
+            return map->slots[ix].pkt;
+        }
+    }
+    return NULL;
+}
+
+static void pktmap_remove(mc_PKTMAP *map, mc_PACKET *pkt)
+{
+    unsigned hole, ix;
+
+    hole = pktmap_home(map, pkt->opaque);
+    while (map->slots[hole].pkt != pkt) {
+        lcb_assert(map->slots[hole].pkt);
+        hole = (hole + 1) & map->mask;
+    }
+
+    /* Shift the following entries of the probe run back into the hole,
+     * rather than leaving a tombstone which lookups would need to skip. An
+     * entry may only move if its home slot is not between the hole and it. */
+    for (ix = (hole + 1) & map->mask; map->slots[ix].pkt; ix = (ix + 1) & map->mask) {
+        unsigned home = pktmap_home(map, map->slots[ix].opaque);
+        if (((ix - home) & map->mask) >= ((ix - hole) & map->mask)) {
+            map->slots[hole] = map->slots[ix];
+            hole = ix;
+        }
+    }
+    map->slots[hole].pkt = NULL;
+
+    /* Give back the memory used for a burst of requests once it has passed */
+    if (--map->count == 0 && map->mask + 1 > PKTMAP_MINSIZE) {
+        free(map->slots);
+        map->slots = NULL;
+        map->mask = 0;
+    }
+}
+
+static void pktheap_set(mc_PKTHEAP *heap, unsigned ix, mc_HEAPENTRY entry)
+{
+    heap->entries[ix] = entry;
+    entry.pkt->heapidx = ix;
+}
+
+static void pktheap_sift_up(mc_PKTHEAP *heap, unsigned ix)
+{
+    mc_HEAPENTRY entry = heap->entries[ix];
+    while (ix > 0) {
+        unsigned parent = (ix - 1) / 2;
+        if (heap->entries[parent].deadline <= entry.deadline) {
+            break;
+        }
+        pktheap_set(heap, ix, heap->entries[parent]);
+        ix = parent;
+    }
+    pktheap_set(heap, ix, entry);
+}
+
+static void pktheap_sift_down(mc_PKTHEAP *heap, unsigned ix)
+{
+    mc_HEAPENTRY entry = heap->entries[ix];
+    for (;;) {
+        unsigned child = ix * 2 + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count && heap->entries[child + 1].deadline < heap->entries[child].deadline) {
+            child++;
+        }
+        if (entry.deadline <= heap->entries[child].deadline) {
+            break;
+        }
+        pktheap_set(heap, ix, heap->entries[child]);
+        ix = child;
+    }
+    pktheap_set(heap, ix, entry);
+}
+
+static void pktheap_push(mc_PKTHEAP *heap, mc_PACKET *pkt)
+{
+    mc_HEAPENTRY entry;
+
+    if (heap->count == heap->capacity) {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : PKTMAP_MINSIZE;
+        heap->entries = realloc(heap->entries, heap->capacity * sizeof(*heap->entries));
+    }
+
+    entry.deadline = MCREQ_PKT_RDATA(pkt)->deadline;
+    entry.pkt = pkt;
+    heap->entries[heap->count] = entry;
+    pktheap_sift_up(heap, heap->count++);
+}
+
+static void pktheap_remove(mc_PKTHEAP *heap, mc_PACKET *pkt)
+{
+    unsigned ix = pkt->heapidx;
+    lcb_assert(ix < heap->count && heap->entries[ix].pkt == pkt);
+
+    if (ix != --heap->count) {
+        heap->entries[ix] = heap->entries[heap->count];
+        if (ix > 0 && heap->entries[ix].deadline < heap->entries[(ix - 1) / 2].deadline) {
+            pktheap_sift_up(heap, ix);
+        } else {
+            pktheap_sift_down(heap, ix);
+        }
+    }
+
+    if (heap->count == 0 && heap->capacity > PKTMAP_MINSIZE) {
+        free(heap->entries);
+        heap->entries = NULL;
+        heap->capacity = 0;
+    }
+}
+
+/** Rebuilds the heap after the deadlines of its packets have changed */
+static void pktheap_rebuild(mc_PKTHEAP *heap)
+{
+    for (unsigned ii = 0; ii < heap->count; ii++) {
+        heap->entries[ii].deadline = MCREQ_PKT_RDATA(heap->entries[ii].pkt)->deadline;
+    }
+    for (unsigned ii = heap->count / 2; ii-- > 0;) {
+        pktheap_sift_down(heap, ii);
+    }
+}
+
+/** Adds a packet in the request list to the pipeline's indexes */
+static void pipeline_index(mc_PIPELINE *pipeline, mc_PACKET *packet)
+{
+    pktmap_insert(&pipeline->inflight, packet);
+    pktheap_push(&pipeline->deadlines, packet);
+}
+
+static void pipeline_unindex(mc_PIPELINE *pipeline, mc_PACKET *packet)
+{
+    pktmap_remove(&pipeline->inflight, packet);
+    pktheap_remove(&pipeline->deadlines, packet);
+}
+
+/**
+ * Links a packet into the pipeline's request list after the given node, which
+ * may be the list head.
+ */
+static void pipeline_link(mc_PIPELINE *pipeline, sllist_node *prev, mc_PACKET *packet)
+{
+    sllist_node *next = prev->next;
+    sllist_insert(&pipeline->requests, prev, &packet->slnode);
+    packet->slprev = prev;
+    if (next) {
+        SLLIST_ITEM(next, mc_PACKET, slnode)->slprev = &packet->slnode;
+    }
+    pipeline_index(pipeline, packet);
+}
+
+/** Removes a packet from the pipeline's request list in constant time */
+static void pipeline_unlink(mc_PIPELINE *pipeline, mc_PACKET *packet)
+{
+    sllist_root *reqs = &pipeline->requests;
+    sllist_node *prev = packet->slprev;
+    sllist_node *next = packet->slnode.next;
+
+    prev->next = next;
+    if (next) {
+        SLLIST_ITEM(next, mc_PACKET, slnode)->slprev = prev;
+    } else if (prev == &reqs->first_prev) {
+        reqs->last = NULL;
+    } else {
+        reqs->last = prev;
+    }
+    pipeline_unindex(pipeline, packet);
+}
+
+/**
+ * Removes the current packet of an iteration over the request list. The
+ * packet must already have been removed from the indexes, as it may have
+ * been released by now.
+ */
+static void pipeline_iter_remove(mc_PIPELINE *pipeline, sllist_iterator *iter)
+{
+    sllist_iter_remove(&pipeline->requests, iter);
+    if (iter->next) {
+        SLLIST_ITEM(iter->next, mc_PACKET, slnode)->slprev = iter->prev;
+    }
+}
+
 static int pkt_tmo_compar(sllist_node *a, sllist_node *b)
 {
     mc_PACKET *pa, *pb;
@@ -238,15 +478,27 @@ static int pkt_tmo_compar(sllist_node *a, sllist_node *b)
 void mcreq_reenqueue_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
 {
     sllist_root *reqs = &pipeline->requests;
+    sllist_iterator iter;
+
     mcreq_enqueue_packet(pipeline, packet);
-    sllist_remove(reqs, &packet->slnode);
-    sllist_insert_sorted(reqs, &packet->slnode, pkt_tmo_compar);
+    pipeline_unlink(pipeline, packet);
+
+    SLLIST_ITERFOR(reqs, &iter)
+    {
+        /** if the item we have is before the current, insert it here */
+        if (pkt_tmo_compar(&packet->slnode, iter.cur) <= 0) {
+            pipeline_link(pipeline, iter.prev, packet);
+            return;
+        }
+    }
+    pipeline_link(pipeline, reqs->last ? reqs->last : &reqs->first_prev, packet);
 }
 
 void mcreq_enqueue_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
 {
+    sllist_root *reqs = &pipeline->requests;
     nb_SPAN *vspan = &packet->u_value.single;
-    sllist_append(&pipeline->requests, &packet->slnode);
+    pipeline_link(pipeline, reqs->last ? reqs->last : &reqs->first_prev, packet);
     netbuf_enqueue_span(&pipeline->nbmgr, &packet->kh_span, packet);
     MC_INCR_METRIC(pipeline, bytes_queued, packet->kh_span.size);
 
@@ -271,8 +523,74 @@ GT_ENQUEUE_PDU:
     MC_INCR_METRIC(pipeline, packets_queued, 1);
 }
 
+static void budget_charge(mc_PIPELINE *pipeline, mc_PACKET *packet)
+{
+    mc_CMDQUEUE *cq;
+    if (packet->budget_nbytes) {
+        return;
+    }
+    cq = pipeline->parent;
+    packet->budget_nbytes = mcreq_get_size(packet);
+    pipeline->budget_nbytes += packet->budget_nbytes;
+    pipeline->budget_npackets++;
+    cq->budget_nbytes += packet->budget_nbytes;
+    cq->budget_npackets++;
+}
+
+static void budget_release(mc_PIPELINE *pipeline, mc_PACKET *packet)
+{
+    mc_CMDQUEUE *cq;
+    if (!packet->budget_nbytes) {
+        return;
+    }
+    cq = pipeline->parent;
+    pipeline->budget_nbytes -= packet->budget_nbytes;
+    pipeline->budget_npackets--;
+    cq->budget_nbytes -= packet->budget_nbytes;
+    cq->budget_npackets--;
+    packet->budget_nbytes = 0;
+}
+
+static int budget_exceeded(const mc_CMDQUEUE *cq, const mc_PIPELINE *pipeline)
+{
+    lcb_INSTANCE *instance = (lcb_INSTANCE *)cq->cqdata;
+    lcb_SIZE max;
+    if (!instance) {
+        return 0;
+    }
+    max = LCBT_SETTING(instance, kv_pipeline_max_bytes);
+    if (max && pipeline->budget_nbytes >= max) {
+        return 1;
+    }
+    max = LCBT_SETTING(instance, kv_pipeline_max_requests);
+    if (max && pipeline->budget_npackets >= max) {
+        return 1;
+    }
+    max = LCBT_SETTING(instance, kv_max_bytes);
+    if (max && cq->budget_nbytes >= max) {
+        return 1;
+    }
+    max = LCBT_SETTING(instance, kv_max_requests);
+    if (max && cq->budget_npackets >= max) {
+        return 1;
+    }
+    return 0;
+}
+
+lcb_STATUS mcreq_check_budget(mc_CMDQUEUE *queue, mc_PIPELINE *pipeline)
+{
+    if (budget_exceeded(queue, pipeline)) {
+        queue->budget_nrejected++;
+        MC_INCR_METRIC(pipeline, packets_rejected, 1);
+        return LCB_ERR_REQUEST_BUDGET_EXCEEDED;
+    }
+    return LCB_SUCCESS;
+}
+
 void mcreq_wipe_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
 {
+    budget_release(pipeline, packet);
+
     if (!(packet->flags & MCREQ_F_KEY_NOCOPY)) {
         if (packet->flags & MCREQ_F_DETACHED) {
             free(SPAN_BUFFER(&packet->kh_span));
@@ -316,6 +634,7 @@ mc_PACKET *mcreq_allocate_packet(mc_PIPELINE *pipeline)
     ret->alloc_parent = span.parent;
     ret->flags = 0;
     ret->retries = 0;
+    ret->budget_nbytes = 0;
     ret->opaque = pipeline->parent->seq++;
     ret->u_rdata.reqdata.span = NULL;
     ret->u_rdata.reqdata.deadline = 0;
@@ -365,6 +684,7 @@ mc_PACKET *mcreq_renew_packet(const mc_PACKET *src)
     dst->flags &= ~(MCREQ_F_KEY_NOCOPY | MCREQ_F_VALUE_NOCOPY | MCREQ_F_VALUE_IOV);
     dst->flags |= MCREQ_F_DETACHED;
     dst->alloc_parent = NULL;
+    dst->budget_nbytes = 0;
     dst->sl_flushq.next = NULL;
     dst->slnode.next = NULL;
     dst->retries = src->retries;
@@ -505,6 +825,7 @@ lcb_STATUS mcreq_basic_packet(mc_CMDQUEUE *queue, const lcb_KEYBUF *key, uint32_
 {
     int vb, srvix;
     uint16_t nkey;
+    lcb_STATUS rc;
 
     if (!queue->config) {
         return LCB_ERR_NO_CONFIGURATION;
@@ -525,6 +846,11 @@ lcb_STATUS mcreq_basic_packet(mc_CMDQUEUE *queue, const lcb_KEYBUF *key, uint32_
         }
     }
 
+    rc = mcreq_check_budget(queue, *pipeline);
+    if (rc != LCB_SUCCESS) {
+        return rc;
+    }
+
     *packet = mcreq_allocate_packet(*pipeline);
     if (*packet == NULL) {
         return LCB_ERR_NO_MEMORY;
@@ -689,6 +1015,10 @@ void mcreq_pipeline_cleanup(mc_PIPELINE *pipeline)
 {
     netbuf_cleanup(&pipeline->nbmgr);
     netbuf_cleanup(&pipeline->reqpool);
+    free(pipeline->inflight.slots);
+    memset(&pipeline->inflight, 0, sizeof pipeline->inflight);
+    free(pipeline->deadlines.entries);
+    memset(&pipeline->deadlines, 0, sizeof pipeline->deadlines);
 }
 
 int mcreq_pipeline_init(mc_PIPELINE *pipeline)
@@ -697,11 +1027,15 @@ int mcreq_pipeline_init(mc_PIPELINE *pipeline)
 
     /* Initialize all members to 0 */
     memset(&pipeline->requests, 0, sizeof pipeline->requests);
+    memset(&pipeline->inflight, 0, sizeof pipeline->inflight);
+    memset(&pipeline->deadlines, 0, sizeof pipeline->deadlines);
     pipeline->parent = NULL;
     pipeline->flush_start = NULL;
     pipeline->index = 0;
     memset(&pipeline->ctxqueued, 0, sizeof pipeline->ctxqueued);
     pipeline->buf_done_callback = NULL;
+    pipeline->budget_nbytes = 0;
+    pipeline->budget_npackets = 0;
 
     netbuf_default_settings(&settings);
 
@@ -758,6 +1092,10 @@ int mcreq_queue_init(mc_CMDQUEUE *queue)
     queue->scheds = NULL;
     queue->fallback = NULL;
     queue->npipelines = 0;
+    queue->scratch = NULL;
+    queue->budget_nbytes = 0;
+    queue->budget_npackets = 0;
+    queue->budget_nrejected = 0;
     return 0;
 }
 
@@ -773,6 +1111,10 @@ void mcreq_queue_cleanup(mc_CMDQUEUE *queue)
     queue->pipelines = NULL;
     queue->npipelines = 0;
     queue->scheds = NULL;
+    if (queue->scratch) {
+        mcreq_scratch_free(queue->scratch);
+        queue->scratch = NULL;
+    }
 }
 
 void mcreq_sched_enter(mc_CMDQUEUE *queue)
@@ -850,23 +1192,17 @@ void mcreq_sched_add(mc_PIPELINE *pipeline, mc_PACKET *pkt)
         cq->scheds[pipeline->index] = 1;
     }
     sllist_append(&pipeline->ctxqueued, &pkt->slnode);
+    budget_charge(pipeline, pkt);
     mcreq_rearm_timeout(pipeline);
 }
 
 static mc_PACKET *pipeline_find(mc_PIPELINE *pipeline, lcb_uint32_t opaque, int do_remove)
 {
-    sllist_iterator iter;
-    SLLIST_ITERFOR(&pipeline->requests, &iter)
-    {
-        mc_PACKET *pkt = SLLIST_ITEM(iter.cur, mc_PACKET, slnode);
-        if (pkt->opaque == opaque) {
-            if (do_remove) {
-                sllist_iter_remove(&pipeline->requests, &iter);
-            }
-            return pkt;
-        }
+    mc_PACKET *pkt = pktmap_find(&pipeline->inflight, opaque);
+    if (pkt && do_remove) {
+        pipeline_unlink(pipeline, pkt);
     }
-    return NULL;
+    return pkt;
 }
 
 mc_PACKET *mcreq_pipeline_find(mc_PIPELINE *pipeline, lcb_uint32_t opaque)
@@ -919,6 +1255,7 @@ void mcreq_reset_timeouts(mc_PIPELINE *pl, lcb_U64 nstime)
         MCREQ_PKT_RDATA(pkt)->start = nstime;
         MCREQ_PKT_RDATA(pkt)->deadline = nstime + old_timeout;
     }
+    pktheap_rebuild(&pl->deadlines);
 }
 
 unsigned mcreq_pipeline_timeout(mc_PIPELINE *pl, lcb_STATUS err, mcreq_pktfail_fn failcb, void *cbarg, hrtime_t now)
@@ -926,16 +1263,26 @@ unsigned mcreq_pipeline_timeout(mc_PIPELINE *pl, lcb_STATUS err, mcreq_pktfail_f
     sllist_iterator iter;
     unsigned count = 0;
 
-    SLLIST_ITERFOR(&pl->requests, &iter)
-    {
-        mc_PACKET *pkt = SLLIST_ITEM(iter.cur, mc_PACKET, slnode);
-        mc_REQDATA *rd = MCREQ_PKT_RDATA(pkt);
-        if (now == 0 || rd->deadline <= now) {
-            sllist_iter_remove(&pl->requests, &iter);
+    if (now != 0) {
+        /* Only the packets which have expired are visited, earliest first */
+        mc_PACKET *pkt;
+        while ((pkt = mcreq_next_expiring(pl)) != NULL && MCREQ_PKT_RDATA(pkt)->deadline <= now) {
+            pipeline_unlink(pl, pkt);
             failcb(pl, pkt, err, cbarg);
             mcreq_packet_handled(pl, pkt);
             count++;
         }
+        return count;
+    }
+
+    SLLIST_ITERFOR(&pl->requests, &iter)
+    {
+        mc_PACKET *pkt = SLLIST_ITEM(iter.cur, mc_PACKET, slnode);
+        pipeline_unindex(pl, pkt);
+        pipeline_iter_remove(pl, &iter);
+        failcb(pl, pkt, err, cbarg);
+        mcreq_packet_handled(pl, pkt);
+        count++;
     }
     return count;
 }
@@ -953,9 +1300,15 @@ void mcreq_iterwipe(mc_CMDQUEUE *queue, mc_PIPELINE *src, mcreq_iterwipe_fn call
     {
         int rv;
         mc_PACKET *orig = SLLIST_ITEM(iter.cur, mc_PACKET, slnode);
+
+        /* The callback may release the packet, so it cannot be looked at once
+         * the callback returns */
+        pipeline_unindex(src, orig);
         rv = callback(queue, src, orig, arg);
         if (rv == MCREQ_REMOVE_PACKET) {
-            sllist_iter_remove(&src->requests, &iter);
+            pipeline_iter_remove(src, &iter);
+        } else {
+            pipeline_index(src, orig);
         }
     }
 }
@@ -981,8 +1334,9 @@ static void do_fallback_flush(mc_PIPELINE *pipeline)
     SLLIST_ITERFOR(&pipeline->requests, &iter)
     {
         mc_PACKET *pkt = SLLIST_ITEM(iter.cur, mc_PACKET, slnode);
+        pipeline_unindex(pipeline, pkt);
         fpl->handler(pipeline->parent, pkt);
-        sllist_iter_remove(&pipeline->requests, &iter);
+        pipeline_iter_remove(pipeline, &iter);
         mcreq_packet_handled(pipeline, pkt);
     }
 }
@@ -333,6 +333,19 @@ typedef struct mc_packet_st {
     /** Node in the linked list for logical command ordering */
     sllist_node slnode;
 
+    /**
+     * Node preceding this packet in the pipeline's request list, which allows
+     * it to be unlinked without walking the list. Only valid while the packet
+     * is in that list.
+     */
+    sllist_node *slprev;
+
+    /** Position of this packet within the pipeline's deadline heap */
+    uint32_t heapidx;
+
+    /** Bytes charged against the pipeline's budget, 0 if not yet scheduled */
+    uint32_t budget_nbytes;
+
     /**
      * Node in the linked list for actual output ordering.
      * @see netbuf_end_flush2(), netbuf_pdu_enqueue()
@@ -385,6 +398,41 @@ typedef struct mc_packet_st {
  */
 typedef void (*mcreq_flushstart_fn)(struct mc_pipeline_st *pipeline);
 
+/** Slot within an mc_PKTMAP */
+typedef struct {
+    uint32_t opaque;
+    struct mc_packet_st *pkt;
+} mc_PKTSLOT;
+
+/**
+ * Open-addressed hash table of the packets in a pipeline's request list,
+ * keyed by their opaque. This allows responses to be matched to their
+ * requests in constant time, regardless of how many are in flight.
+ */
+typedef struct {
+    mc_PKTSLOT *slots;
+    /** Capacity - 1, the capacity is always a power of two */
+    unsigned mask;
+    unsigned count;
+} mc_PKTMAP;
+
+/** Entry within an mc_PKTHEAP, the deadline is cached from the packet */
+typedef struct {
+    hrtime_t deadline;
+    struct mc_packet_st *pkt;
+} mc_HEAPENTRY;
+
+/**
+ * Binary min-heap of the packets in a pipeline's request list, ordered by
+ * their deadline. This allows the next timeout to be found in constant time,
+ * and expired packets to be removed without visiting any others.
+ */
+typedef struct {
+    mc_HEAPENTRY *entries;
+    unsigned count;
+    unsigned capacity;
+} mc_PKTHEAP;
+
 /**
  * @brief Structure representing a single input/output queue for memcached
  *
@@ -395,6 +443,12 @@ typedef struct mc_pipeline_st {
     /** List of requests. Newer requests are appended at the end */
     sllist_root requests;
 
+    /** Index of the packets in `requests` by their opaque */
+    mc_PKTMAP inflight;
+
+    /** Packets in `requests` ordered by their deadline */
+    mc_PKTHEAP deadlines;
+
     /** Parent command queue */
     struct mc_cmdqueue_st *parent;
 
@@ -427,6 +481,12 @@ typedef struct mc_pipeline_st {
 
     /** Optional metrics structure for server */
     struct lcb_SERVERMETRICS_st *metrics;
+
+    /** Bytes held by the packets scheduled on this pipeline and not yet done */
+    lcb_SIZE budget_nbytes;
+
+    /** Number of packets scheduled on this pipeline and not yet done */
+    lcb_SIZE budget_npackets;
 } mc_PIPELINE;
 
 typedef struct mc_cmdqueue_st {
@@ -462,6 +522,16 @@ typedef struct mc_cmdqueue_st {
     /**Special pipeline used to contain orphaned packets within a scheduling
      * context. This field is used by mcreq_set_fallback_handler() */
     mc_PIPELINE *fallback;
+
+    /** Scratch buffers for inflating values, see mcreq_queue_scratch() */
+    struct mc_scratchpool_st *scratch;
+
+    /** Totals of the pipelines' budget usage */
+    lcb_SIZE budget_nbytes;
+    lcb_SIZE budget_npackets;
+
+    /** Number of packets rejected by mcreq_basic_packet() for exceeding a budget */
+    lcb_SIZE budget_nrejected;
 } mc_CMDQUEUE;
 
 /**
@@ -648,6 +718,20 @@ void mcreq_map_key(mc_CMDQUEUE *queue, const lcb_KEYBUF *key, unsigned nhdr, int
  */
 #define MCREQ_BASICPACKET_F_RANDPIPELINE 0x02
 
+/**
+ * Check whether a new packet may be scheduled on a pipeline, counting the
+ * rejection if it may not. Commands which allocate their packets themselves
+ * must call this for every packet before allocating any of them, so that a
+ * rejection never leaves part of a command scheduled.
+ *
+ * @param queue the queue
+ * @param pipeline the pipeline the packet is for
+ * @return LCB_ERR_REQUEST_BUDGET_EXCEEDED if the pipeline, or the queue as a
+ * whole, already holds as many packets or bytes as the instance's settings
+ * allow (see @ref LCB_CNTL_KV_PIPELINE_MAX_BYTES), LCB_SUCCESS otherwise.
+ */
+lcb_STATUS mcreq_check_budget(mc_CMDQUEUE *queue, mc_PIPELINE *pipeline);
+
 /**
  * Handle the basic requirements of a packet common to all commands
  * @param queue the queue
@@ -663,6 +747,10 @@ void mcreq_map_key(mc_CMDQUEUE *queue, const lcb_KEYBUF *key, unsigned nhdr, int
  * @param options a set of options to control creation behavior. Currently the
  * only recognized options are `0` (i.e. default options), or @ref
  * MCREQ_BASICPACKET_F_FALLBACKOK
+ *
+ * @return LCB_ERR_REQUEST_BUDGET_EXCEEDED if the target pipeline, or the queue
+ * as a whole, already holds as many packets or bytes as the instance's
+ * settings allow (see mcreq_check_budget()).
  */
 
 lcb_STATUS mcreq_basic_packet(mc_CMDQUEUE *queue, const lcb_KEYBUF *key, uint32_t collection_id,
@@ -736,6 +824,10 @@ void mcreq_queue_cleanup(mc_CMDQUEUE *queue);
 
 /**
  * @brief Add a packet to the current scheduling context
+ *
+ * The packet's size is charged against the pipeline's budget until the packet
+ * is wiped.
+ *
  * @param pipeline
  * @param pkt
  * @see mcreq_sched_enter()
@@ -949,6 +1041,9 @@ void mcreq_dump_chain(const mc_PIPELINE *pipeline, FILE *fp, mcreq_payload_dump_
 #define mcreq_first_packet(pipeline)                                                                                   \
     SLLIST_IS_EMPTY(&(pipeline)->requests) ? NULL : SLLIST_ITEM(SLLIST_FIRST(&(pipeline)->requests), mc_PACKET, slnode)
 
+/** Returns the packet in the pipeline with the earliest deadline, if any */
+#define mcreq_next_expiring(pipeline) ((pipeline)->deadlines.count ? (pipeline)->deadlines.entries[0].pkt : NULL)
+
 /* Increment a metric */
 #define MC_INCR_METRIC(pipeline, metric, amount)                                                                       \
     do {                                                                                                               \
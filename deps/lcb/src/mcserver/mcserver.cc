@@ -441,6 +441,18 @@ int Server::handle_unknown_error(const mc_PACKET *request, const MemcachedRespon
 
 lcb_STATUS lcb_map_error(lcb_INSTANCE *instance, int in);
 
+bool Server::can_scatter_value(const mc_PACKET *request, const MemcachedResponse &resinfo)
+{
+    uint8_t opcode = resinfo.opcode();
+    if (opcode != PROTOCOL_BINARY_CMD_GET && opcode != PROTOCOL_BINARY_CMD_GAT &&
+        opcode != PROTOCOL_BINARY_CMD_GET_LOCKED) {
+        return false;
+    }
+    /* Internal callers (e.g. the documents fetched for include_docs) keep the response, along with a reference to
+     * its buffer, after the callback returns. The segments of a scattered value are released by then */
+    return (request->flags & (MCREQ_F_PRIVCALLBACK | MCREQ_F_REQEXT)) == 0;
+}
+
 static bool is_warmup_issue(uint16_t status)
 {
     return status == PROTOCOL_BINARY_RESPONSE_NO_BUCKET || status == PROTOCOL_BINARY_RESPONSE_NOT_INITIALIZED;
@@ -474,6 +486,15 @@ Server::ReadState Server::try_read(lcbio_CTX *ctx, rdb_IOROPE *ior)
     }                                                                                                                  \
     {
 
+/* Like DO_ASSIGN_PAYLOAD(), but a value which spans several segments is left
+ * where it is for the handlers which can consume it that way */
+#define DO_ASSIGN_VALUE_PAYLOAD()                                                                                      \
+    rdb_consumed(ior, mcresp.hdrsize());                                                                               \
+    if (mcresp.bodylen() && !(can_scatter_value(request, mcresp) && mcresp.assign_scattered(ior))) {                   \
+        mcresp.payload = rdb_get_consolidated(ior, mcresp.bodylen());                                                  \
+    }                                                                                                                  \
+    {
+
 #define DO_SWALLOW_PAYLOAD()                                                                                           \
     }                                                                                                                  \
     if (mcresp.bodylen()) {                                                                                            \
@@ -584,7 +605,7 @@ Server::ReadState Server::try_read(lcbio_CTX *ctx, rdb_IOROPE *ior)
 
     /* Figure out if the request is 'ufwd' or not */
     if (!(request->flags & MCREQ_F_UFWD)) {
-        DO_ASSIGN_PAYLOAD()
+        DO_ASSIGN_VALUE_PAYLOAD()
         mcresp.bufh = rdb_get_first_segment(ior);
         mcreq_dispatch_response(this, request, &mcresp, err_override);
         DO_SWALLOW_PAYLOAD()
@@ -860,19 +881,8 @@ static void flush_errdrain(mc_PIPELINE *pipeline)
 
 uint32_t Server::next_timeout() const
 {
-    hrtime_t now, expiry, diff, min = 0;
-    mc_PACKET *pkt = nullptr;
-
-    sllist_iterator iter;
-    SLLIST_ITERFOR(const_cast<sllist_root *>(&requests), &iter)
-    {
-        mc_PACKET *p = SLLIST_ITEM(iter.cur, mc_PACKET, slnode);
-        hrtime_t deadline = MCREQ_PKT_RDATA(p)->deadline;
-        if (pkt == nullptr || deadline < min) {
-            min = deadline;
-            pkt = p;
-        }
-    }
+    hrtime_t now, expiry, diff;
+    const mc_PACKET *pkt = mcreq_next_expiring(this);
 
     if (!pkt) {
         return default_timeout();
@@ -197,6 +197,14 @@ class Server : public mc_PIPELINE
     enum ReadState { PKT_READ_COMPLETE, PKT_READ_PARTIAL, PKT_READ_ABORT };
 
     ReadState try_read(lcbio_CTX *ctx, rdb_IOROPE *ior);
+
+    /**
+     * Whether the value of the response to this request may be left scattered
+     * over the read buffers (see MemcachedResponse::assign_scattered()) rather
+     * than being consolidated. This is only the case when the handler and
+     * callback consume the value before the response is released.
+     */
+    static bool can_scatter_value(const mc_PACKET *request, const MemcachedResponse &resinfo);
     int handle_unknown_error(const mc_PACKET *request, const MemcachedResponse &resinfo, lcb_STATUS &newerr);
     bool handle_nmv(MemcachedResponse &resinfo, mc_PACKET *oldpkt);
     bool handle_unknown_collection(MemcachedResponse &resinfo, mc_PACKET *oldpkt);
@@ -32,3 +32,22 @@ void lcb_n1qlcache_clear(lcb_QUERY_CACHE *cache)
 {
     cache->clear();
 }
+
+lcb_SIZE lcb_n1qlcache_capacity(const lcb_QUERY_CACHE *cache)
+{
+    return cache->capacity();
+}
+
+void lcb_n1qlcache_set_capacity(lcb_QUERY_CACHE *cache, lcb_SIZE capacity)
+{
+    cache->capacity(capacity);
+}
+
+void lcb_n1qlcache_stats(const lcb_QUERY_CACHE *cache, lcb_QUERY_CACHE_STATS *stats)
+{
+    stats->hits = cache->hits();
+    stats->misses = cache->misses();
+    stats->evictions = cache->evictions();
+    stats->size = cache->size();
+    stats->capacity = cache->capacity();
+}
@@ -22,6 +22,8 @@
 #ifndef LCB_N1QL_INTERNAL_H
 #define LCB_N1QL_INTERNAL_H
 
+#include <libcouchbase/couchbase.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -31,6 +33,9 @@ typedef struct lcb_QUERY_CACHE_ lcb_QUERY_CACHE;
 lcb_QUERY_CACHE *lcb_n1qlcache_create(void);
 void lcb_n1qlcache_destroy(lcb_QUERY_CACHE *);
 void lcb_n1qlcache_clear(lcb_QUERY_CACHE *);
+lcb_SIZE lcb_n1qlcache_capacity(const lcb_QUERY_CACHE *);
+void lcb_n1qlcache_set_capacity(lcb_QUERY_CACHE *, lcb_SIZE);
+void lcb_n1qlcache_stats(const lcb_QUERY_CACHE *, lcb_QUERY_CACHE_STATS *);
 
 #ifdef __cplusplus
 }
@@ -172,3 +172,19 @@ LIBCOUCHBASE_API lcb_STATUS lcb_query_cancel(lcb_INSTANCE * /* instance */, lcb_
     }
     return LCB_SUCCESS;
 }
+
+LIBCOUCHBASE_API lcb_STATUS lcb_query_pause(lcb_INSTANCE * /* instance */, lcb_QUERY_HANDLE *handle)
+{
+    if (handle) {
+        return handle->pause();
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_query_resume(lcb_INSTANCE * /* instance */, lcb_QUERY_HANDLE *handle)
+{
+    if (handle) {
+        return handle->resume();
+    }
+    return LCB_SUCCESS;
+}
@@ -22,7 +22,7 @@
 #include <cstdint>
 #include <chrono>
 #include <string>
-#include <map>
+#include <unordered_map>
 #include <list>
 
 #include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
@@ -33,6 +33,10 @@ class Plan
     friend struct lcb_QUERY_CACHE_;
     std::string key;
     std::string planstr;
+    /** The options of the last request issued with this plan, and their encoding */
+    mutable Json::Value options{Json::objectValue};
+    mutable std::string optionstr;
+    mutable size_t noptions_encoded{0};
     explicit Plan(std::string k) : key(std::move(k)) {}
 
   public:
@@ -40,26 +44,105 @@ class Plan
      * Applies the plan to the output 'bodystr'. We don't assign the
      * Json::Value directly, as this appears to be horribly slow. On my system
      * an assignment took about 200ms!
+     *
+     * The options of the request are encoded once and kept with the plan, so
+     * that executing the statement again with the same options only needs to
+     * encode the client context ID, which differs for every request.
      * @param body The request body (e.g. lcb_QUERY_HANDLE_::json)
      * @param[out] bodystr the actual request payload
      */
-    void apply_plan(Json::Value &body, std::string &bodystr) const
+    void apply_plan(const Json::Value &body, std::string &bodystr) const
     {
-        body.removeMember("statement");
-        bodystr = Json::FastWriter().write(body);
-
-        // Assume bodystr ends with '}'
-        size_t pos = bodystr.rfind('}');
-        bodystr.erase(pos);
+        if (!same_options(body)) {
+            encode_options(body);
+        }
+        const Json::Value &ccid = body.isObject() ? body["client_context_id"] : Json::Value::nullRef;
 
-        if (!body.empty()) {
+        bodystr.reserve(optionstr.size() + planstr.size() + 64);
+        bodystr.assign(optionstr);
+        if (!ccid.isNull()) {
+            if (bodystr.size() > 1) {
+                bodystr.append(",");
+            }
+            bodystr.append("\"client_context_id\":");
+            append_value(bodystr, ccid);
+        }
+        if (bodystr.size() > 1) {
             bodystr.append(",");
         }
         bodystr.append(planstr);
         bodystr.append("}");
     }
 
+    /** Number of times the options of a request had to be encoded for this plan */
+    size_t options_encoded() const
+    {
+        return noptions_encoded;
+    }
+
   private:
+    /** Appends the encoded value, without the line feed the writer ends it with */
+    static void append_value(std::string &out, const Json::Value &value)
+    {
+        std::string encoded = Json::FastWriter().write(value);
+        if (!encoded.empty() && encoded.back() == '\n') {
+            encoded.pop_back();
+        }
+        out.append(encoded);
+    }
+
+    /** Members of the request body which are not part of its cached options */
+    static bool is_per_request(const std::string &name)
+    {
+        return name == "statement" || name == "client_context_id";
+    }
+
+    /** Checks whether the body has the options which were last encoded */
+    bool same_options(const Json::Value &body) const
+    {
+        if (noptions_encoded == 0 || !body.isObject()) {
+            return false;
+        }
+        Json::ArrayIndex nmembers = 0;
+        for (auto it = body.begin(); it != body.end(); ++it) {
+            std::string name = it.name();
+            if (is_per_request(name)) {
+                continue;
+            }
+            if (!options.isMember(name) || options[name] != *it) {
+                return false;
+            }
+            nmembers++;
+        }
+        return nmembers == options.size();
+    }
+
+    /**
+     * Encodes the options of the body without the closing brace, so that the
+     * per-request members and the plan can be appended to it.
+     */
+    void encode_options(const Json::Value &body) const
+    {
+        options = Json::Value(Json::objectValue);
+        optionstr.assign("{");
+        if (body.isObject()) {
+            for (auto it = body.begin(); it != body.end(); ++it) {
+                std::string name = it.name();
+                if (is_per_request(name)) {
+                    continue;
+                }
+                options[name] = *it;
+                if (optionstr.size() > 1) {
+                    optionstr.append(",");
+                }
+                optionstr.append(Json::valueToQuotedString(name.c_str()));
+                optionstr.append(":");
+                append_value(optionstr, *it);
+            }
+        }
+        noptions_encoded++;
+    }
+
     /**
      * Assign plan data to this entry
      * @param plan The JSON returned from the PREPARE request
@@ -68,11 +151,11 @@ class Plan
     {
         // Set the plan as a string
         planstr = "\"prepared\":";
-        planstr += Json::FastWriter().write(plan["name"]);
+        append_value(planstr, plan["name"]);
         if (include_encoded_plan) {
             planstr += ",";
             planstr += "\"encoded_plan\":";
-            planstr += Json::FastWriter().write(plan["encoded_plan"]);
+            append_value(planstr, plan["encoded_plan"]);
         }
     }
 };
@@ -87,12 +170,52 @@ struct lcb_QUERY_CACHE_ {
         clear();
     }
 
-    /** Maximum number of entries in LRU cache. This is fixed at 5000 */
-    static size_t max_size()
+    /** Default maximum number of entries in the LRU cache */
+    static size_t default_capacity()
     {
         return 5000;
     }
 
+    /** Maximum number of entries in the LRU cache */
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    /**
+     * Changes the maximum number of entries, evicting the least recently used
+     * entries which no longer fit.
+     * @param capacity the new maximum, which must not be zero
+     */
+    void capacity(size_t capacity)
+    {
+        capacity_ = capacity;
+        while (lru.size() > capacity_) {
+            evict();
+        }
+        by_name.reserve(capacity_);
+    }
+
+    size_t size() const
+    {
+        return lru.size();
+    }
+
+    std::uint64_t hits() const
+    {
+        return hits_;
+    }
+
+    std::uint64_t misses() const
+    {
+        return misses_;
+    }
+
+    std::uint64_t evictions() const
+    {
+        return evictions_;
+    }
+
     /**
      * Adds an entry for a given key
      * @param key The key to add
@@ -101,14 +224,14 @@ struct lcb_QUERY_CACHE_ {
      */
     const Plan &add_entry(const std::string &key, const Json::Value &json, bool include_encoded_plan = true)
     {
-        if (lru.size() == max_size()) {
-            // Purge entry from end
-            remove_entry(lru.back()->key);
-        }
-
         // Remove old entry, if present
         remove_entry(key);
 
+        if (!lru.empty() && lru.size() >= capacity_) {
+            // Purge entry from end
+            evict();
+        }
+
         lru.push_front(new Plan(key));
         by_name[key] = lru.begin();
         lru.front()->set_plan(json, include_encoded_plan);
@@ -124,8 +247,10 @@ struct lcb_QUERY_CACHE_ {
     {
         auto m = by_name.find(key);
         if (m == by_name.end()) {
+            misses_++;
             return nullptr;
         }
+        hits_++;
 
         const Plan *cur = *m->second;
 
@@ -161,8 +286,19 @@ struct lcb_QUERY_CACHE_ {
     }
 
   private:
+    /** Removes the least recently used entry */
+    void evict()
+    {
+        remove_entry(lru.back()->key);
+        evictions_++;
+    }
+
     std::list<Plan *> lru;
-    std::map<std::string, decltype(lru)::iterator> by_name;
+    std::unordered_map<std::string, decltype(lru)::iterator> by_name;
+    size_t capacity_{default_capacity()};
+    std::uint64_t hits_{0};
+    std::uint64_t misses_{0};
+    std::uint64_t evictions_{0};
 };
 
 #endif // LIBCOUCHBASE_N1QL_QUERY_CACHE_HH
@@ -334,7 +334,8 @@ bool lcb_QUERY_HANDLE_::maybe_retry()
     if (last_error_ == LCB_SUCCESS) {
         // We'll be parsing more rows later on..
         delete parser_;
-        parser_ = new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_N1QL, this);
+        parser_ = new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_N1QL, this,
+                                           LCBT_SETTING(instance_, use_row_scanner));
         return true;
     }
 
@@ -422,6 +423,9 @@ lcb_STATUS lcb_QUERY_HANDLE_::issue_htreq(const std::string &body)
     lcb_cmdhttp_destroy(htcmd);
     if (rc == LCB_SUCCESS) {
         http_request_->set_callback(reinterpret_cast<lcb_RESPCALLBACK>(chunk_callback));
+        if (paused_) {
+            lcb_http_pause(instance_, http_request_);
+        }
     }
     lcb_log(LOGARGS(this, TRACE),
             LOGFMT "execute query: %.*s, idempotent=%s, timeout=%uus, grace_period=%uus, client_context_id=\"%s\"",
@@ -450,13 +454,13 @@ lcb_STATUS lcb_QUERY_HANDLE_::apply_plan(const Plan &plan)
 {
     lcb_log(LOGARGS(this, DEBUG), LOGFMT "Using prepared plan", LOGID(this));
     std::string bodystr;
-    plan.apply_plan(json, bodystr);
+    plan.apply_plan(json_const(), bodystr);
     return issue_htreq(bodystr);
 }
 
 lcb_QUERY_HANDLE_::lcb_QUERY_HANDLE_(lcb_INSTANCE *obj, void *user_cookie, const lcb_CMDQUERY *cmd)
-    : parser_(new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_N1QL, this)), cookie_(user_cookie),
-      callback_(cmd->callback()), instance_(obj), prepared_statement_(cmd->prepare_statement()),
+    : parser_(new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_N1QL, this, LCBT_SETTING(obj, use_row_scanner))),
+      cookie_(user_cookie), callback_(cmd->callback()), instance_(obj), prepared_statement_(cmd->prepare_statement()),
       use_multi_bucket_authentication_(cmd->use_multi_bucket_authentication()),
       timeout_timer_(instance_->iotable, this), backoff_timer_(instance_->iotable, this)
 {
@@ -609,7 +613,8 @@ void lcb_QUERY_HANDLE_::on_backoff()
     lcb_aspend_del(&instance_->pendops, LCB_PENDTYPE_COUNTER, nullptr);
     backoff_timer_.cancel();
     delete parser_;
-    parser_ = new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_N1QL, this);
+    parser_ = new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_N1QL, this,
+                                       LCBT_SETTING(instance_, use_row_scanner));
     if (use_prepcache()) {
         const Plan *cached = cache().get_entry(statement_);
         if (cached != nullptr) {
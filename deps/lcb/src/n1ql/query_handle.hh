@@ -246,11 +246,30 @@ struct lcb_QUERY_HANDLE_ : lcb::jsparse::Parser::Actions {
         return LCB_SUCCESS;
     }
 
+    lcb_STATUS pause()
+    {
+        paused_ = true;
+        if (http_request_ != nullptr) {
+            lcb_http_pause(instance_, http_request_);
+        }
+        return LCB_SUCCESS;
+    }
+
+    lcb_STATUS resume()
+    {
+        paused_ = false;
+        if (http_request_ != nullptr) {
+            lcb_http_resume(instance_, http_request_);
+        }
+        return LCB_SUCCESS;
+    }
+
   private:
     void on_backoff();
 
     const lcb_RESPHTTP *http_response_{nullptr};
     lcb_HTTP_HANDLE *http_request_{nullptr};
+    bool paused_{false};
     lcb::jsparse::Parser *parser_{nullptr};
     void *cookie_{nullptr};
     lcb_QUERY_CALLBACK callback_{nullptr};
@@ -267,6 +286,7 @@ struct lcb_QUERY_HANDLE_ : lcb::jsparse::Parser::Actions {
 
     /** Request body as received from the application */
     Json::Value json;
+
     /** String of the original statement. Cached here to avoid jsoncpp lookups */
     std::string statement_;
     std::string client_context_id;
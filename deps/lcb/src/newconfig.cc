@@ -17,6 +17,7 @@
 
 #include "internal.h"
 #include "packetutils.h"
+#include "collections.h"
 #include "bucketconfig/clconfig.h"
 #include "vbucket/aliases.h"
 #include "sllist-inl.h"
@@ -238,6 +239,30 @@ static int iterwipe_cb(mc_CMDQUEUE *cq, mc_PIPELINE *oldpl, mc_PACKET *oldpkt, v
     return MCREQ_REMOVE_PACKET;
 }
 
+/**
+ * Check whether each server in the new config has the same data endpoint (and
+ * index) as in the old one. This is the case when only the vBucket map has
+ * changed, e.g. for the majority of the configurations seen during a rebalance.
+ * replace_config() would then reuse every server at its current index.
+ */
+static bool same_data_servers(lcb_INSTANCE *instance, lcbvb_CONFIG *oldconfig, lcbvb_CONFIG *newconfig)
+{
+    lcbvb_SVCMODE mode = LCBT_SETTING_SVCMODE(instance);
+
+    if (LCBVB_NSERVERS(oldconfig) != LCBVB_NSERVERS(newconfig) ||
+        instance->cmdq.npipelines != LCBVB_NSERVERS(newconfig)) {
+        return false;
+    }
+    for (size_t ii = 0; ii < LCBVB_NSERVERS(newconfig); ii++) {
+        const char *old_datahost = lcbvb_get_hostport(oldconfig, ii, LCBVB_SVCTYPE_DATA, mode);
+        const char *new_datahost = lcbvb_get_hostport(newconfig, ii, LCBVB_SVCTYPE_DATA, mode);
+        if (!old_datahost || !new_datahost || strcmp(old_datahost, new_datahost) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static void replace_config(lcb_INSTANCE *instance, lcbvb_CONFIG *oldconfig, lcbvb_CONFIG *newconfig)
 {
     mc_CMDQUEUE *cq = &instance->cmdq;
@@ -329,7 +354,17 @@ void lcb_update_vbconfig(lcb_INSTANCE *instance, lcb_pCONFIGINFO config)
         /* Apply the vb guesses */
         lcb_vbguess_newconfig(instance, config->vbc, instance->vbguess);
 
-        replace_config(instance, old_config->vbc, config->vbc);
+        if (same_data_servers(instance, old_config->vbc, config->vbc)) {
+            /* The queue already points to the new map, so the servers may be kept as they are */
+            lcb_log(LOGARGS(instance, DEBUG), "Servers unchanged. Keeping existing pipelines");
+            for (size_t ii = 0; ii < q->npipelines; ii++) {
+                if (static_cast<lcb::Server *>(q->pipelines[ii])->has_pending()) {
+                    q->pipelines[ii]->flush_start(q->pipelines[ii]);
+                }
+            }
+        } else {
+            replace_config(instance, old_config->vbc, config->vbc);
+        }
         old_config->decref();
     } else {
         size_t nservers = VB_NSERVERS(config->vbc);
@@ -340,6 +375,14 @@ void lcb_update_vbconfig(lcb_INSTANCE *instance, lcb_pCONFIGINFO config)
         }
 
         mcreq_queue_add_pipelines(q, &servers[0], nservers, config->vbc);
+
+        if (LCBT_SETTING(instance, prefetch_collections) && LCBT_SETTING(instance, use_collections) &&
+            LCBT_SETTING(instance, conntype) == LCB_TYPE_BUCKET) {
+            lcb_STATUS rc = collcache_load_manifest(instance);
+            if (rc != LCB_SUCCESS) {
+                lcb_log(LOGARGS(instance, DEBUG), "Unable to request collections manifest: %s", lcb_strerror_short(rc));
+            }
+        }
     }
 
     /* Update the list of nodes here for server list */
@@ -0,0 +1,363 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "internal.h"
+
+#include "capi/cmd_analytics.hh"
+#include "capi/cmd_counter.hh"
+#include "capi/cmd_exists.hh"
+#include "capi/cmd_get.hh"
+#include "capi/cmd_get_replica.hh"
+#include "capi/cmd_query.hh"
+#include "capi/cmd_remove.hh"
+#include "capi/cmd_search.hh"
+#include "capi/cmd_store.hh"
+#include "capi/cmd_subdoc.hh"
+#include "capi/cmd_touch.hh"
+#include "capi/cmd_unlock.hh"
+
+#include <cstring>
+#include <new>
+
+namespace
+{
+/**
+ * A cloned response is allocated as a single block, with the response itself at the start of the block followed
+ * by the storage for any data it references.  This keeps the copy to one allocation regardless of how many
+ * fields need to be copied, and allows it to be freed knowing only the address of the response.
+ */
+class clone_storage
+{
+  public:
+    void reserve(const void *data, std::size_t ndata)
+    {
+        if (data != nullptr) {
+            size_ += ndata;
+        }
+    }
+
+    template <typename T>
+    T *create(const T *src, std::size_t nextra = 0)
+    {
+        block_ = new char[sizeof(T) + nextra + size_];
+        extra_ = block_ + sizeof(T);
+        next_ = extra_ + nextra;
+        return new (block_) T(*src);
+    }
+
+    /** Storage for fixed size data, reserved by passing @p nextra to create() */
+    char *extra() const
+    {
+        return extra_;
+    }
+
+    template <typename CharType>
+    void copy(CharType *&data, std::size_t ndata)
+    {
+        if (data == nullptr) {
+            return;
+        }
+        std::memcpy(next_, data, ndata);
+        data = static_cast<CharType *>(static_cast<void *>(next_));
+        next_ += ndata;
+    }
+
+  private:
+    std::size_t size_{0};
+    char *block_{nullptr};
+    char *extra_{nullptr};
+    char *next_{nullptr};
+};
+
+template <typename T>
+void destroy_clone(lcb_RESPBASE *resp)
+{
+    T *typed = reinterpret_cast<T *>(resp);
+    typed->~T();
+    delete[] reinterpret_cast<char *>(typed);
+}
+
+template <typename T>
+lcb_RESPBASE *clone_simple(const lcb_RESPBASE *src)
+{
+    clone_storage storage;
+    return storage.create(reinterpret_cast<const T *>(src));
+}
+
+template <typename T>
+lcb_RESPBASE *clone_value(const lcb_RESPBASE *src)
+{
+    const T *typed = reinterpret_cast<const T *>(src);
+
+    clone_storage storage;
+    storage.reserve(typed->value, typed->nvalue);
+    T *dst = storage.create(typed);
+    storage.copy(dst->value, dst->nvalue);
+    dst->bufh = nullptr;
+    return dst;
+}
+
+lcb_RESPBASE *clone_get(const lcb_RESPBASE *src)
+{
+    const auto *typed = reinterpret_cast<const lcb_RESPGET *>(src);
+    if (typed->value != nullptr || typed->nvalue_iov == 0) {
+        auto *dst = reinterpret_cast<lcb_RESPGET *>(clone_value<lcb_RESPGET>(src));
+        dst->value_iov = nullptr;
+        dst->nvalue_iov = 0;
+        dst->value_buf = nullptr;
+        return dst;
+    }
+
+    /* the value was left in the network buffers, so gather it straight into the clone */
+    clone_storage storage;
+    lcb_RESPGET *dst = storage.create(typed, typed->nvalue);
+    char *ptr = storage.extra();
+    for (std::size_t ii = 0; ii < typed->nvalue_iov; ++ii) {
+        std::memcpy(ptr, typed->value_iov[ii].iov_base, typed->value_iov[ii].iov_len);
+        ptr += typed->value_iov[ii].iov_len;
+    }
+    dst->value = storage.extra();
+    dst->value_iov = nullptr;
+    dst->nvalue_iov = 0;
+    dst->value_buf = nullptr;
+    dst->bufh = nullptr;
+    return dst;
+}
+
+lcb_RESPBASE *clone_store(const lcb_RESPBASE *src)
+{
+    clone_storage storage;
+    lcb_RESPSTORE *dst = storage.create(reinterpret_cast<const lcb_RESPSTORE *>(src));
+    /* durability responses belong to the durability request, which does not outlive the callback */
+    dst->dur_resp = nullptr;
+    return dst;
+}
+
+lcb_RESPBASE *clone_subdoc(const lcb_RESPBASE *src)
+{
+    const auto *typed = reinterpret_cast<const lcb_RESPSUBDOC *>(src);
+
+    clone_storage storage;
+    for (std::size_t ii = 0; ii < typed->nres; ii++) {
+        storage.reserve(typed->res[ii].value, typed->res[ii].nvalue);
+    }
+    lcb_RESPSUBDOC *dst = storage.create(typed, sizeof(lcb_SDENTRY) * typed->nres);
+    if (typed->nres > 0) {
+        dst->res = reinterpret_cast<lcb_SDENTRY *>(storage.extra());
+        for (std::size_t ii = 0; ii < typed->nres; ii++) {
+            dst->res[ii] = typed->res[ii];
+            storage.copy(dst->res[ii].value, dst->res[ii].nvalue);
+        }
+    } else {
+        dst->res = nullptr;
+    }
+    dst->responses = nullptr;
+    dst->bufh = nullptr;
+    return dst;
+}
+
+template <typename T>
+void reserve_row(clone_storage &storage, const T *typed)
+{
+    storage.reserve(typed->row, typed->nrow);
+}
+
+template <typename T>
+void copy_row(clone_storage &storage, T *dst)
+{
+    storage.copy(dst->row, dst->nrow);
+    dst->htresp = nullptr;
+    dst->handle = nullptr;
+}
+
+lcb_RESPBASE *clone_query(const lcb_RESPBASE *src)
+{
+    const auto *typed = reinterpret_cast<const lcb_RESPQUERY *>(src);
+    const lcb_QUERY_ERROR_CONTEXT &ctx = typed->ctx;
+
+    clone_storage storage;
+    reserve_row(storage, typed);
+    storage.reserve(ctx.first_error_message, ctx.first_error_message_len);
+    storage.reserve(ctx.statement, ctx.statement_len);
+    storage.reserve(ctx.client_context_id, ctx.client_context_id_len);
+    storage.reserve(ctx.query_params, ctx.query_params_len);
+    storage.reserve(ctx.http_response_message, ctx.http_response_message_len);
+    storage.reserve(ctx.endpoint, ctx.endpoint_len);
+
+    lcb_RESPQUERY *dst = storage.create(typed);
+    copy_row(storage, dst);
+    storage.copy(dst->ctx.first_error_message, dst->ctx.first_error_message_len);
+    storage.copy(dst->ctx.statement, dst->ctx.statement_len);
+    storage.copy(dst->ctx.client_context_id, dst->ctx.client_context_id_len);
+    storage.copy(dst->ctx.query_params, dst->ctx.query_params_len);
+    storage.copy(dst->ctx.http_response_message, dst->ctx.http_response_message_len);
+    storage.copy(dst->ctx.endpoint, dst->ctx.endpoint_len);
+    return dst;
+}
+
+lcb_RESPBASE *clone_analytics(const lcb_RESPBASE *src)
+{
+    const auto *typed = reinterpret_cast<const lcb_RESPANALYTICS *>(src);
+    const lcb_ANALYTICS_ERROR_CONTEXT &ctx = typed->ctx;
+
+    clone_storage storage;
+    reserve_row(storage, typed);
+    storage.reserve(ctx.first_error_message, ctx.first_error_message_len);
+    storage.reserve(ctx.statement, ctx.statement_len);
+    storage.reserve(ctx.client_context_id, ctx.client_context_id_len);
+    storage.reserve(ctx.query_params, ctx.query_params_len);
+    storage.reserve(ctx.http_response_body, ctx.http_response_body_len);
+    storage.reserve(ctx.endpoint, ctx.endpoint_len);
+
+    lcb_RESPANALYTICS *dst = storage.create(typed);
+    copy_row(storage, dst);
+    storage.copy(dst->ctx.first_error_message, dst->ctx.first_error_message_len);
+    storage.copy(dst->ctx.statement, dst->ctx.statement_len);
+    storage.copy(dst->ctx.client_context_id, dst->ctx.client_context_id_len);
+    storage.copy(dst->ctx.query_params, dst->ctx.query_params_len);
+    storage.copy(dst->ctx.http_response_body, dst->ctx.http_response_body_len);
+    storage.copy(dst->ctx.endpoint, dst->ctx.endpoint_len);
+    return dst;
+}
+
+lcb_RESPBASE *clone_search(const lcb_RESPBASE *src)
+{
+    const auto *typed = reinterpret_cast<const lcb_RESPSEARCH *>(src);
+    const lcb_SEARCH_ERROR_CONTEXT &ctx = typed->ctx;
+
+    clone_storage storage;
+    reserve_row(storage, typed);
+    storage.reserve(ctx.error_message, ctx.error_message_len);
+    storage.reserve(ctx.index, ctx.index_len);
+    storage.reserve(ctx.search_query, ctx.search_query_len);
+    storage.reserve(ctx.search_params, ctx.search_params_len);
+    storage.reserve(ctx.http_response_body, ctx.http_response_body_len);
+    storage.reserve(ctx.endpoint, ctx.endpoint_len);
+
+    lcb_RESPSEARCH *dst = storage.create(typed);
+    copy_row(storage, dst);
+    storage.copy(dst->ctx.error_message, dst->ctx.error_message_len);
+    storage.copy(dst->ctx.index, dst->ctx.index_len);
+    storage.copy(dst->ctx.search_query, dst->ctx.search_query_len);
+    storage.copy(dst->ctx.search_params, dst->ctx.search_params_len);
+    storage.copy(dst->ctx.http_response_body, dst->ctx.http_response_body_len);
+    storage.copy(dst->ctx.endpoint, dst->ctx.endpoint_len);
+    return dst;
+}
+} // namespace
+
+LIBCOUCHBASE_API
+lcb_STATUS lcb_resp_clone(int cbtype, const lcb_RESPBASE *src, lcb_RESPBASE **dst)
+{
+    if (src == nullptr || dst == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+
+    switch (cbtype) {
+        case LCB_CALLBACK_GET:
+            *dst = clone_get(src);
+            break;
+        case LCB_CALLBACK_GETREPLICA:
+            *dst = clone_value<lcb_RESPGETREPLICA>(src);
+            break;
+        case LCB_CALLBACK_EXISTS:
+            *dst = clone_simple<lcb_RESPEXISTS>(src);
+            break;
+        case LCB_CALLBACK_STORE:
+            *dst = clone_store(src);
+            break;
+        case LCB_CALLBACK_COUNTER:
+            *dst = clone_simple<lcb_RESPCOUNTER>(src);
+            break;
+        case LCB_CALLBACK_REMOVE:
+            *dst = clone_simple<lcb_RESPREMOVE>(src);
+            break;
+        case LCB_CALLBACK_TOUCH:
+            *dst = clone_simple<lcb_RESPTOUCH>(src);
+            break;
+        case LCB_CALLBACK_UNLOCK:
+            *dst = clone_simple<lcb_RESPUNLOCK>(src);
+            break;
+        case LCB_CALLBACK_SDLOOKUP:
+        case LCB_CALLBACK_SDMUTATE:
+            *dst = clone_subdoc(src);
+            break;
+        case LCB_CALLBACK_QUERY:
+            *dst = clone_query(src);
+            break;
+        case LCB_CALLBACK_ANALYTICS:
+            *dst = clone_analytics(src);
+            break;
+        case LCB_CALLBACK_SEARCH:
+            *dst = clone_search(src);
+            break;
+        default:
+            return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API
+lcb_STATUS lcb_resp_destroy(int cbtype, lcb_RESPBASE *resp)
+{
+    if (resp == nullptr) {
+        return LCB_ERR_INVALID_ARGUMENT;
+    }
+
+    switch (cbtype) {
+        case LCB_CALLBACK_GET:
+            destroy_clone<lcb_RESPGET>(resp);
+            break;
+        case LCB_CALLBACK_GETREPLICA:
+            destroy_clone<lcb_RESPGETREPLICA>(resp);
+            break;
+        case LCB_CALLBACK_EXISTS:
+            destroy_clone<lcb_RESPEXISTS>(resp);
+            break;
+        case LCB_CALLBACK_STORE:
+            destroy_clone<lcb_RESPSTORE>(resp);
+            break;
+        case LCB_CALLBACK_COUNTER:
+            destroy_clone<lcb_RESPCOUNTER>(resp);
+            break;
+        case LCB_CALLBACK_REMOVE:
+            destroy_clone<lcb_RESPREMOVE>(resp);
+            break;
+        case LCB_CALLBACK_TOUCH:
+            destroy_clone<lcb_RESPTOUCH>(resp);
+            break;
+        case LCB_CALLBACK_UNLOCK:
+            destroy_clone<lcb_RESPUNLOCK>(resp);
+            break;
+        case LCB_CALLBACK_SDLOOKUP:
+        case LCB_CALLBACK_SDMUTATE:
+            destroy_clone<lcb_RESPSUBDOC>(resp);
+            break;
+        case LCB_CALLBACK_QUERY:
+            destroy_clone<lcb_RESPQUERY>(resp);
+            break;
+        case LCB_CALLBACK_ANALYTICS:
+            destroy_clone<lcb_RESPANALYTICS>(resp);
+            break;
+        case LCB_CALLBACK_SEARCH:
+            destroy_clone<lcb_RESPSEARCH>(resp);
+            break;
+        default:
+            return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    return LCB_SUCCESS;
+}
@@ -15,6 +15,7 @@
  *   limitations under the License.
  */
 
+#include <cstring>
 #include <memory>
 
 #include "internal.h"
@@ -68,11 +69,42 @@ LIBCOUCHBASE_API lcb_STATUS lcb_respget_key(const lcb_RESPGET *resp, const char
 
 LIBCOUCHBASE_API lcb_STATUS lcb_respget_value(const lcb_RESPGET *resp, const char **value, size_t *value_len)
 {
+    if (resp->value == nullptr && resp->nvalue_iov > 0) {
+        /* the value was left in the network buffers, gather it on first use. The buffer is released by the
+         * handler once the callback returns */
+        auto *mutable_resp = const_cast<lcb_RESPGET *>(resp);
+        char *ptr = mutable_resp->value_buf = new char[resp->nvalue];
+        for (std::size_t ii = 0; ii < resp->nvalue_iov; ++ii) {
+            std::memcpy(ptr, resp->value_iov[ii].iov_base, resp->value_iov[ii].iov_len);
+            ptr += resp->value_iov[ii].iov_len;
+        }
+        mutable_resp->value = mutable_resp->value_buf;
+    }
     *value = (const char *)resp->value;
     *value_len = resp->nvalue;
     return LCB_SUCCESS;
 }
 
+LIBCOUCHBASE_API lcb_STATUS lcb_respget_backbuf(const lcb_RESPGET *resp, lcb_BACKBUF *buf)
+{
+    auto *seg = reinterpret_cast<rdb_ROPESEG *>(resp->bufh);
+    if (seg == nullptr || !RDB_SEG_CONTAINS(seg, resp->value, resp->nvalue)) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    *buf = seg;
+    return LCB_SUCCESS;
+}
+
+LIBCOUCHBASE_API lcb_STATUS lcb_respget_value_iov(const lcb_RESPGET *resp, const lcb_IOV **iov, size_t *niov)
+{
+    if (resp->value_iov == nullptr || resp->value != nullptr) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    *iov = resp->value_iov;
+    *niov = resp->nvalue_iov;
+    return LCB_SUCCESS;
+}
+
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdget_create(lcb_CMDGET **cmd)
 {
     *cmd = new lcb_CMDGET{};
@@ -80,6 +80,16 @@ LIBCOUCHBASE_API lcb_STATUS lcb_respgetreplica_value(const lcb_RESPGETREPLICA *r
     return LCB_SUCCESS;
 }
 
+LIBCOUCHBASE_API lcb_STATUS lcb_respgetreplica_backbuf(const lcb_RESPGETREPLICA *resp, lcb_BACKBUF *buf)
+{
+    auto *seg = reinterpret_cast<rdb_ROPESEG *>(resp->bufh);
+    if (seg == nullptr || !RDB_SEG_CONTAINS(seg, resp->value, resp->nvalue)) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    *buf = seg;
+    return LCB_SUCCESS;
+}
+
 LIBCOUCHBASE_API int lcb_respgetreplica_is_final(const lcb_RESPGETREPLICA *resp)
 {
     return resp->rflags & LCB_RESP_F_FINAL;
@@ -179,8 +189,9 @@ static void rget_callback(mc_PIPELINE *pipeline, mc_PACKET *pkt, lcb_CALLBACK_TY
         active_resp.cookie = get_resp->cookie;
         active_resp.ctx = get_resp->ctx;
         active_resp.datatype = get_resp->datatype;
-        active_resp.value = get_resp->value;
-        active_resp.nvalue = get_resp->nvalue;
+        const char *value = nullptr;
+        lcb_respget_value(get_resp, &value, &active_resp.nvalue);
+        active_resp.value = value;
         active_resp.itmflags = get_resp->itmflags;
     } else {
         resp = reinterpret_cast<lcb_RESPGETREPLICA *>(const_cast<void *>(arg));
@@ -349,12 +360,6 @@ static lcb_STATUS get_replica_schedule(lcb_INSTANCE *instance, std::shared_ptr<l
         return LCB_ERR_NO_MATCHING_SERVER;
     }
 
-    /* Initialize the cookie */
-    auto *rck = new RGetCookie(cmd->cookie(), instance, cmd->mode(), vbid);
-    rck->start = cmd->start_time_or_default_in_nanoseconds(gethrtime());
-    rck->deadline =
-        rck->start + cmd->timeout_or_default_in_nanoseconds(LCB_US2NS(LCBT_SETTING(instance, operation_timeout)));
-
     std::vector<std::uint8_t> framing_extras;
     if (cmd->want_impersonation()) {
         lcb_STATUS err = lcb::flexible_framing_extras::encode_impersonate_user(cmd->impostor(), framing_extras);
@@ -363,6 +368,45 @@ static lcb_STATUS get_replica_schedule(lcb_INSTANCE *instance, std::shared_ptr<l
         }
     }
 
+    /* Admit every packet of the command before allocating any of them, a
+     * rejection must not leave some of them scheduled with a deleted cookie.
+     * XXX: the replica index is always expected to be in range, for the FIRST
+     * mode it will seek to the first valid index (checked above), and for the
+     * ALL mode, it will fail if not all replicas are already online (also
+     * checked above) */
+    std::vector<mc_PIPELINE *> replica_pipelines;
+    unsigned rcur = r0;
+    do {
+        mc_PIPELINE *pl = cq->pipelines[lcbvb_vbreplica(cq->config, vbid, rcur)];
+        lcb_STATUS err = mcreq_check_budget(cq, pl);
+        if (err != LCB_SUCCESS) {
+            return err;
+        }
+        replica_pipelines.push_back(pl);
+    } while (++rcur < r1);
+
+    auto ffextlen = static_cast<std::uint8_t>(framing_extras.size());
+
+    /* The active GET goes through basic_packet(), which admits it as well */
+    protocol_binary_request_header active_req{};
+    mc_PIPELINE *active_pl = nullptr;
+    mc_PACKET *active_pkt = nullptr;
+    if (cmd->need_get_active()) {
+        active_req.request.opcode = PROTOCOL_BINARY_CMD_GET;
+        active_req.request.datatype = PROTOCOL_BINARY_RAW_BYTES;
+        lcb_STATUS err = mcreq_basic_packet(cq, &keybuf, cmd->collection().collection_id(), &active_req, 0, ffextlen,
+                                            &active_pkt, &active_pl, MCREQ_BASICPACKET_F_FALLBACKOK);
+        if (err != LCB_SUCCESS) {
+            return err;
+        }
+    }
+
+    /* Initialize the cookie */
+    auto *rck = new RGetCookie(cmd->cookie(), instance, cmd->mode(), vbid);
+    rck->start = cmd->start_time_or_default_in_nanoseconds(gethrtime());
+    rck->deadline =
+        rck->start + cmd->timeout_or_default_in_nanoseconds(LCB_US2NS(LCBT_SETTING(instance, operation_timeout)));
+
     /* Initialize the packet */
     req.request.magic = framing_extras.empty() ? PROTOCOL_BINARY_REQ : PROTOCOL_BINARY_AREQ;
     req.request.opcode = PROTOCOL_BINARY_CMD_GET_REPLICA;
@@ -371,22 +415,20 @@ static lcb_STATUS get_replica_schedule(lcb_INSTANCE *instance, std::shared_ptr<l
     req.request.cas = 0;
     req.request.extlen = 0;
 
-    auto ffextlen = static_cast<std::uint8_t>(framing_extras.size());
-
-    rck->r_cur = r0;
-    do {
-        int curix;
-        mc_PIPELINE *pl;
-        mc_PACKET *pkt;
-
-        curix = lcbvb_vbreplica(cq->config, vbid, r0);
-        /* XXX: this is always expected to be in range. For the FIRST mode
-         * it will seek to the first valid index (checked above), and for the
-         * ALL mode, it will fail if not all replicas are already online
-         * (also checked above) */
-        pl = cq->pipelines[curix];
-        pkt = mcreq_allocate_packet(pl);
+    /* Every packet is built before any is scheduled, so that they can all be
+     * released should one of them fail to allocate */
+    std::vector<mc_PACKET *> replica_pkts;
+    for (mc_PIPELINE *pl : replica_pipelines) {
+        mc_PACKET *pkt = mcreq_allocate_packet(pl);
         if (!pkt) {
+            for (std::size_t ii = 0; ii < replica_pkts.size(); ++ii) {
+                mcreq_wipe_packet(replica_pipelines[ii], replica_pkts[ii]);
+                mcreq_release_packet(replica_pipelines[ii], replica_pkts[ii]);
+            }
+            if (active_pkt) {
+                mcreq_wipe_packet(active_pl, active_pkt);
+                mcreq_release_packet(active_pl, active_pkt);
+            }
             delete rck;
             return LCB_ERR_NO_MEMORY;
         }
@@ -404,28 +446,26 @@ static lcb_STATUS get_replica_schedule(lcb_INSTANCE *instance, std::shared_ptr<l
         if (!framing_extras.empty()) {
             memcpy(SPAN_BUFFER(&pkt->kh_span) + sizeof(req.bytes), framing_extras.data(), framing_extras.size());
         }
-        mcreq_sched_add(pl, pkt);
-    } while (++r0 < r1);
+        replica_pkts.push_back(pkt);
+    }
 
-    if (cmd->need_get_active()) {
-        req.request.opcode = PROTOCOL_BINARY_CMD_GET;
-        mc_PIPELINE *pl;
-        mc_PACKET *pkt;
-        lcb_STATUS err = mcreq_basic_packet(cq, &keybuf, cmd->collection().collection_id(), &req, 0, ffextlen, &pkt,
-                                            &pl, MCREQ_BASICPACKET_F_FALLBACKOK);
-        if (err != LCB_SUCCESS) {
-            delete rck;
-            return err;
-        }
-        req.request.opaque = pkt->opaque;
-        pkt->u_rdata.exdata = rck;
-        pkt->flags |= MCREQ_F_REQEXT;
+    rck->r_cur = r0;
+    for (std::size_t ii = 0; ii < replica_pkts.size(); ++ii) {
+        mcreq_sched_add(replica_pipelines[ii], replica_pkts[ii]);
+    }
+
+    if (active_pkt) {
+        active_req.request.bodylen = req.request.bodylen;
+        active_req.request.opaque = active_pkt->opaque;
+        active_pkt->u_rdata.exdata = rck;
+        active_pkt->flags |= MCREQ_F_REQEXT;
         rck->remaining++;
-        mcreq_write_hdr(pkt, &req);
+        mcreq_write_hdr(active_pkt, &active_req);
         if (!framing_extras.empty()) {
-            memcpy(SPAN_BUFFER(&pkt->kh_span) + sizeof(req.bytes), framing_extras.data(), framing_extras.size());
+            memcpy(SPAN_BUFFER(&active_pkt->kh_span) + sizeof(active_req.bytes), framing_extras.data(),
+                   framing_extras.size());
         }
-        mcreq_sched_add(pl, pkt);
+        mcreq_sched_add(active_pl, active_pkt);
     }
 
     MAYBE_SCHEDLEAVE(instance)
@@ -183,6 +183,15 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_value(lcb_CMDSTORE *cmd, const char *va
     return cmd->value(std::string(value, value_len));
 }
 
+LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_value_nocopy(lcb_CMDSTORE *cmd, const char *value, size_t value_len)
+{
+    if (value == nullptr || value_len == 0) {
+        return LCB_SUCCESS; /* empty values allowed */
+    }
+
+    return cmd->value_nocopy(value, value_len);
+}
+
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_value_iov(lcb_CMDSTORE *cmd, const lcb_IOV *value, size_t value_len)
 {
     return cmd->value(value, value_len);
@@ -219,6 +228,12 @@ LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_datatype(lcb_CMDSTORE *cmd, uint8_t dat
     return LCB_SUCCESS;
 }
 
+LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_skip_compression(lcb_CMDSTORE *cmd, int skip)
+{
+    cmd->skip_compression(skip != 0);
+    return LCB_SUCCESS;
+}
+
 LIBCOUCHBASE_API lcb_STATUS lcb_cmdstore_durability(lcb_CMDSTORE *cmd, lcb_DURABILITY_LEVEL level)
 {
     return cmd->durability_level(level);
@@ -334,22 +349,21 @@ static lcb_size_t get_value_size(const mc_PACKET *packet)
     }
 }
 
-static bool can_compress(lcb_INSTANCE *instance, const mc_PIPELINE *pipeline, bool already_compressed)
+static bool accepts_compressed(lcb_INSTANCE *instance, const mc_PIPELINE *pipeline)
 {
-    if (already_compressed) {
-        return false;
-    }
-
     const auto *server = static_cast<const lcb::Server *>(pipeline);
-    uint8_t compressopts = LCBT_SETTING(instance, compressopts);
+    return server->supports_compression() || (LCBT_SETTING(instance, compressopts) & LCB_COMPRESS_FORCE);
+}
 
-    if ((compressopts & LCB_COMPRESS_OUT) == 0) {
+static bool can_compress(lcb_INSTANCE *instance, const mc_PIPELINE *pipeline, bool already_compressed)
+{
+    if (already_compressed) {
         return false;
     }
-    if (server->supports_compression() == false && (compressopts & LCB_COMPRESS_FORCE) == 0) {
+    if ((LCBT_SETTING(instance, compressopts) & LCB_COMPRESS_OUT) == 0) {
         return false;
     }
-    return true;
+    return accepts_compressed(instance, pipeline);
 }
 
 static lcb_STATUS store_validate(lcb_INSTANCE *instance, const lcb_CMDSTORE *cmd)
@@ -368,6 +382,19 @@ static lcb_STATUS store_validate(lcb_INSTANCE *instance, const lcb_CMDSTORE *cmd
     return LCB_SUCCESS;
 }
 
+/**
+ * Tells the application that the library no longer references the value it
+ * lent to the command. This is also used when the value was never attached to
+ * a packet (e.g. because it got compressed into a buffer of our own, or the
+ * operation failed before it could be scheduled).
+ */
+static void store_release_value(lcb_INSTANCE *instance, lcb_CMDSTORE &cmd)
+{
+    if (cmd.has_borrowed_value()) {
+        instance->callbacks.pktflushed(instance, cmd.cookie());
+    }
+}
+
 static lcb_STATUS store_schedule(lcb_INSTANCE *instance, std::shared_ptr<lcb_CMDSTORE> cmd)
 {
     lcb_STATUS err;
@@ -412,9 +439,25 @@ static lcb_STATUS store_schedule(lcb_INSTANCE *instance, std::shared_ptr<lcb_CMD
         return err;
     }
 
-    int should_compress = can_compress(instance, pipeline, cmd->value_is_compressed());
-    lcb_VALBUF valuebuf{LCB_KV_COPY, {{cmd->value().c_str(), cmd->value().size()}}};
-    if (should_compress) {
+    int should_compress = can_compress(instance, pipeline, cmd->value_is_compressed() || cmd->skip_compression());
+    bool send_compressed = cmd->value_is_compressed();
+    /* values lent by the application are referenced by the packet rather than copied into the pipeline buffers */
+    lcb_VALBUF valuebuf{cmd->has_borrowed_value() ? LCB_KV_CONTIG : LCB_KV_COPY,
+                        {{cmd->value_data(), cmd->value_size()}}};
+    if (send_compressed && !accepts_compressed(instance, pipeline)) {
+        /* the value was compressed by the application, but this server cannot take it that way */
+        mc_SCRATCHPOOL *pool = mcreq_queue_scratch(cq);
+        void *inflated = nullptr;
+        lcb_VALBUF inflatedbuf{LCB_KV_COPY, {{nullptr, 0}}};
+        if (mcreq_inflate_value2(pool, cmd->value_data(), cmd->value_size(), &inflatedbuf.u_buf.contig.bytes,
+                                 &inflatedbuf.u_buf.contig.nbytes, &inflated) != 0) {
+            mcreq_release_packet(pipeline, packet);
+            return LCB_ERR_INVALID_ARGUMENT;
+        }
+        mcreq_reserve_value(pipeline, packet, &inflatedbuf);
+        mcreq_scratch_release(pool, inflated);
+        send_compressed = false;
+    } else if (should_compress) {
         int rv = mcreq_compress_value(pipeline, packet, &valuebuf, instance->settings, &should_compress);
         if (rv != 0) {
             mcreq_release_packet(pipeline, packet);
@@ -450,7 +493,7 @@ static lcb_STATUS store_schedule(lcb_INSTANCE *instance, std::shared_ptr<lcb_CMD
 
     hdr.request.cas = lcb_htonll(cmd->cas());
     hdr.request.datatype = PROTOCOL_BINARY_RAW_BYTES;
-    if (should_compress || cmd->value_is_compressed()) {
+    if (should_compress || send_compressed) {
         hdr.request.datatype |= PROTOCOL_BINARY_DATATYPE_COMPRESSED;
     }
 
@@ -490,6 +533,11 @@ static lcb_STATUS store_schedule(lcb_INSTANCE *instance, std::shared_ptr<lcb_CMD
 
     TRACE_STORE_BEGIN(instance, &hdr, cmd);
 
+    if (!(packet->flags & MCREQ_F_VALUE_NOCOPY)) {
+        /* the compressor wrote its output into the pipeline, so the lent value is not needed anymore */
+        store_release_value(instance, *cmd);
+    }
+
     return LCB_SUCCESS;
 }
 
@@ -519,15 +567,18 @@ static lcb_STATUS store_execute(lcb_INSTANCE *instance, std::shared_ptr<lcb_CMDS
             response.cookie = operation->cookie();
             if (status == LCB_ERR_SHEDULE_FAILURE || resp == nullptr) {
                 response.ctx.rc = LCB_ERR_TIMEOUT;
+                store_release_value(instance, *operation);
                 operation_callback(instance, callback_type, &response);
                 return;
             }
             if (resp->ctx.rc != LCB_SUCCESS) {
+                store_release_value(instance, *operation);
                 operation_callback(instance, callback_type, &response);
                 return;
             }
             response.ctx.rc = store_schedule(instance, operation);
             if (response.ctx.rc != LCB_SUCCESS) {
+                store_release_value(instance, *operation);
                 operation_callback(instance, callback_type, &response);
             }
         });
@@ -555,11 +606,13 @@ LIBCOUCHBASE_API lcb_STATUS lcb_store(lcb_INSTANCE *instance, void *cookie, cons
             response.cookie = cmd->cookie();
             if (status == LCB_ERR_REQUEST_CANCELED) {
                 response.ctx.rc = status;
+                store_release_value(instance, *cmd);
                 operation_callback(instance, callback_type, &response);
                 return;
             }
             response.ctx.rc = store_execute(instance, cmd);
             if (response.ctx.rc != LCB_SUCCESS) {
+                store_release_value(instance, *cmd);
                 operation_callback(instance, callback_type, &response);
             }
         });
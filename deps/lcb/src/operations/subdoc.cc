@@ -47,6 +47,21 @@ LIBCOUCHBASE_API lcb_STATUS lcb_respsubdoc_result_value(const lcb_RESPSUBDOC *re
     return LCB_SUCCESS;
 }
 
+LIBCOUCHBASE_API lcb_STATUS lcb_respsubdoc_backbuf(const lcb_RESPSUBDOC *resp, lcb_BACKBUF *buf)
+{
+    auto *seg = reinterpret_cast<rdb_ROPESEG *>(resp->bufh);
+    if (seg == nullptr) {
+        return LCB_ERR_UNSUPPORTED_OPERATION;
+    }
+    for (size_t ii = 0; ii < resp->nres; ii++) {
+        if (resp->res[ii].nvalue && !RDB_SEG_CONTAINS(seg, resp->res[ii].value, resp->res[ii].nvalue)) {
+            return LCB_ERR_UNSUPPORTED_OPERATION;
+        }
+    }
+    *buf = seg;
+    return LCB_SUCCESS;
+}
+
 LIBCOUCHBASE_API lcb_STATUS lcb_respsubdoc_status(const lcb_RESPSUBDOC *resp)
 {
     return resp->ctx.rc;
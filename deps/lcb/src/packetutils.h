@@ -30,6 +30,7 @@ typedef struct packet_info_st packet_info;
 #else
 #include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
 #include <math.h>
+#include <vector>
 namespace lcb
 {
 class Server;
@@ -107,6 +108,55 @@ class MemcachedResponse
         release(&ctx->ior);
     }
 
+    /**
+     * Assign the payload of a successful response whose value spans several
+     * segments of the IOROPE without moving the value into one contiguous
+     * buffer. Only the flexible framing extras, extras and key are
+     * consolidated, the value is then described by value_iov() rather than
+     * value(). The header must already have been consumed.
+     *
+     * @param ior the rope structure to read from
+     * @return false if the value is already contiguous (or must be, as it is
+     *  compressed), in which case the body should be consolidated instead.
+     */
+    bool assign_scattered(rdb_IOROPE *ior)
+    {
+        if (status() != PROTOCOL_BINARY_RESPONSE_SUCCESS || vallen() == 0 ||
+            (datatype() & PROTOCOL_BINARY_DATATYPE_COMPRESSED) || rdb_get_contigsize(ior) >= bodylen()) {
+            return false;
+        }
+
+        unsigned prefix = bodylen() - vallen();
+        if (prefix) {
+            payload = rdb_get_consolidated(ior, prefix);
+        }
+
+        int niov = rdb_refread_at(ior, prefix, nullptr, 0, vallen());
+        if (niov < 1) {
+            return false;
+        }
+        value_iov_.resize(niov);
+        rdb_refread_at(ior, prefix, value_iov_.data(), niov, vallen());
+        return true;
+    }
+
+    /**
+     * Whether the value was left scattered by assign_scattered(), in which case
+     * value() must not be used.
+     */
+    bool is_scattered() const
+    {
+        return !value_iov_.empty();
+    }
+
+    /**
+     * Gets the segments of a value left scattered by assign_scattered()
+     */
+    const std::vector<nb_IOV> &value_iov() const
+    {
+        return value_iov_;
+    }
+
     /**
      * Gets the command for the packet
      */
@@ -331,6 +381,8 @@ class MemcachedResponse
     void *payload{nullptr};
     /** Segment for payload */
     void *bufh{nullptr};
+    /** The value, when it was not consolidated with the rest of the payload */
+    std::vector<nb_IOV> value_iov_{};
 
     friend class lcb::Server;
 };
@@ -278,6 +278,42 @@ int rdb_refread_ex(rdb_IOROPE *ior, nb_IOV *iov, rdb_ROPESEG **segs, unsigned ne
     return -1;
 }
 
+int rdb_refread_at(rdb_IOROPE *ior, unsigned offset, nb_IOV *iov, unsigned nelem, unsigned ndata)
+{
+    unsigned used = 0;
+    lcb_list_t *ll;
+    LCB_LIST_FOR(ll, &ior->recvd.segments)
+    {
+        rdb_ROPESEG *seg = LCB_LIST_ITEM(ll, rdb_ROPESEG, llnode);
+        unsigned cur_len;
+
+        if (offset >= seg->nused) {
+            offset -= seg->nused;
+            continue;
+        }
+
+        cur_len = MINIMUM(ndata, seg->nused - offset);
+        if (iov) {
+            if (used == nelem) {
+                return -1;
+            }
+            iov[used].iov_base = RDB_SEG_RBUF(seg) + offset;
+            iov[used].iov_len = cur_len;
+        }
+        ++used;
+        offset = 0;
+
+        ndata -= cur_len;
+        if (!ndata) {
+            return used;
+        }
+    }
+
+    /** Requested more data than we have */
+    fprintf(stderr, "RDB: refread_at was passed a size greater than our buffer (n=%u)\n", ndata);
+    return -1;
+}
+
 unsigned rdb_get_contigsize(rdb_IOROPE *ior)
 {
     rdb_ROPESEG *seg = RDB_SEG_FIRST(&ior->recvd);
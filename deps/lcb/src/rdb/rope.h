@@ -344,6 +344,20 @@ void rdb_copyread(rdb_IOROPE *ior, void *buf, unsigned n);
  */
 int rdb_refread_ex(rdb_IOROPE *ior, nb_IOV *iov, rdb_ROPESEG **segs, unsigned nelem, unsigned ndata);
 
+/**
+ * Like rdb_refread_ex(), but the data starts `offset` bytes into the IOROPE
+ * rather than at its beginning.
+ * @param ior
+ * @param[in] offset number of bytes to skip before the data
+ * @param[out] iov the iov array containing buffer offsets. May be NULL, in
+ *  which case only the number of elements required is returned.
+ * @param[in] nelem number of elements in the array
+ * @param[in] ndata number of bytes to populate the array with
+ * @return the number of IOV elements used (or required, if `iov` is NULL),
+ *  or -1 if the array did not contain enough elements.
+ */
+int rdb_refread_at(rdb_IOROPE *ior, unsigned offset, nb_IOV *iov, unsigned nelem, unsigned ndata);
+
 /**
  * Get the maximum contiguous size of the current input. This is the size of
  * data which may be read efficiently via 'get_consolidated' without actually
@@ -395,6 +409,10 @@ void rdb_seg_unref(rdb_ROPESEG *seg);
 /** pointer to the first available unused byte in the segment */
 #define RDB_SEG_WBUF(seg) (seg)->root + (seg)->start + (seg)->nused
 
+/** true if the `n` bytes at `p` lie within the segment's allocated buffer */
+#define RDB_SEG_CONTAINS(seg, p, n)                                                                                    \
+    ((const char *)(p) >= (seg)->root && (const char *)(p) + (n) <= (seg)->root + (seg)->nalloc)
+
 /** last segment in the rope structure */
 #define RDB_SEG_LAST(rope)                                                                                             \
     (LCB_LIST_TAIL(&(rope)->segments)) ? LCB_LIST_ITEM(LCB_LIST_TAIL(&(rope)->segments), rdb_ROPESEG, llnode) : NULL
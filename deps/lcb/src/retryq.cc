@@ -23,61 +23,159 @@
 #include "bucketconfig/clconfig.h"
 #include "sllist-inl.h"
 #include "mc/mcreq.h"
+#include "rnd.h"
 
 #define LOGARGS(rq, lvl) (rq)->settings, "retryq", LCB_LOG_##lvl, __FILE__, __LINE__
 #define RETRY_PKT_KEY "retry_queue"
 
 using namespace lcb;
-struct SchedNode : lcb_list_t {
-};
-struct TmoNode : lcb_list_t {
+
+/** Heap index of an operation which is not in the queue */
+static const size_t NOT_QUEUED = static_cast<size_t>(-1);
+
+/** Orders operations by their next retry time */
+struct SchedOrder {
+    static hrtime_t key(const RetryOp *op)
+    {
+        return op->trytime;
+    }
+    static size_t &index(RetryOp *op)
+    {
+        return op->schedidx;
+    }
 };
 
-struct lcb::RetryOp : mc_EPKTDATUM, SchedNode, TmoNode {
-    /**Cache the actual start time of the command. Since the start time may
-     * change if read_ts_wait is enabled, and we don't want to end up looping
-     * on a command forever. */
-    hrtime_t start;
-    hrtime_t deadline;
-    hrtime_t trytime; /**< Next retry time */
-    mc_PACKET *pkt;
-    lcb_STATUS origerr;
-    protocol_binary_response_status origstatus;
-    errmap::RetrySpec *spec;
-    explicit RetryOp(errmap::RetrySpec *spec);
-    ~RetryOp()
+/** Orders operations by their deadline */
+struct TmoOrder {
+    static hrtime_t key(const RetryOp *op)
     {
-        if (spec != nullptr) {
-            spec->unref();
-        }
+        return op->deadline;
+    }
+    static size_t &index(RetryOp *op)
+    {
+        return op->tmoidx;
     }
 };
 
-static RetryOp *from_schednode(lcb_list_t *ll)
+template <typename Order>
+static void heap_set(std::vector<RetryOp *> &heap, size_t ix, RetryOp *op)
+{
+    heap[ix] = op;
+    Order::index(op) = ix;
+}
+
+template <typename Order>
+static void heap_sift_up(std::vector<RetryOp *> &heap, size_t ix)
 {
-    return static_cast<RetryOp *>(static_cast<SchedNode *>(ll));
+    RetryOp *op = heap[ix];
+    while (ix > 0) {
+        size_t parent = (ix - 1) / 2;
+        if (Order::key(heap[parent]) <= Order::key(op)) {
+            break;
+        }
+        heap_set<Order>(heap, ix, heap[parent]);
+        ix = parent;
+    }
+    heap_set<Order>(heap, ix, op);
 }
-static RetryOp *from_tmonode(lcb_list_t *ll)
+
+template <typename Order>
+static void heap_sift_down(std::vector<RetryOp *> &heap, size_t ix)
 {
-    return static_cast<RetryOp *>(static_cast<TmoNode *>(ll));
+    RetryOp *op = heap[ix];
+    for (;;) {
+        size_t child = ix * 2 + 1;
+        if (child >= heap.size()) {
+            break;
+        }
+        if (child + 1 < heap.size() && Order::key(heap[child + 1]) < Order::key(heap[child])) {
+            child++;
+        }
+        if (Order::key(op) <= Order::key(heap[child])) {
+            break;
+        }
+        heap_set<Order>(heap, ix, heap[child]);
+        ix = child;
+    }
+    heap_set<Order>(heap, ix, op);
 }
-template <typename T>
-int list_cmp(const T &a, const T &b)
+
+template <typename Order>
+static void heap_push(std::vector<RetryOp *> &heap, RetryOp *op)
 {
-    if (a == b) {
-        return 0;
-    } else if (a > b) {
-        return 1;
+    heap.push_back(op);
+    heap_sift_up<Order>(heap, heap.size() - 1);
+}
+
+template <typename Order>
+static void heap_remove(std::vector<RetryOp *> &heap, RetryOp *op)
+{
+    size_t ix = Order::index(op);
+    lcb_assert(ix < heap.size() && heap[ix] == op);
+    Order::index(op) = NOT_QUEUED;
+
+    RetryOp *last = heap.back();
+    heap.pop_back();
+    if (ix == heap.size()) {
+        return;
+    }
+    heap_set<Order>(heap, ix, last);
+    if (ix > 0 && Order::key(last) < Order::key(heap[(ix - 1) / 2])) {
+        heap_sift_up<Order>(heap, ix);
     } else {
-        return -1;
+        heap_sift_down<Order>(heap, ix);
     }
 }
 
+/** Restores the heap after the keys of its operations have changed */
+template <typename Order>
+static void heap_rebuild(std::vector<RetryOp *> &heap)
+{
+    for (size_t ii = heap.size() / 2; ii-- > 0;) {
+        heap_sift_down<Order>(heap, ii);
+    }
+}
+
+void RetrySchedule::insert(RetryOp *op)
+{
+    heap_push<SchedOrder>(schedops, op);
+    heap_push<TmoOrder>(tmoops, op);
+}
+
+void RetrySchedule::erase(RetryOp *op)
+{
+    heap_remove<SchedOrder>(schedops, op);
+    heap_remove<TmoOrder>(tmoops, op);
+}
+
+bool RetrySchedule::contains(const RetryOp *op)
+{
+    return op->schedidx != NOT_QUEUED;
+}
+
+void RetrySchedule::reset_timeouts(hrtime_t now)
+{
+    for (RetryOp *op : schedops) {
+        op->deadline = now + (op->deadline - op->start);
+        op->start = now;
+    }
+    heap_rebuild<TmoOrder>(tmoops);
+}
+
 hrtime_t RetryQueue::get_retry_interval() const
 {
     return LCB_US2NS(settings->retry_interval);
 }
 
+hrtime_t RetryQueue::apply_jitter(hrtime_t interval, float jitter)
+{
+    if (jitter <= 0 || interval == 0) {
+        return interval;
+    }
+    double fraction = jitter * (lcb_next_rand32() / 4294967296.0);
+    return interval - (hrtime_t)((double)interval * fraction);
+}
+
 /**
  * Fuzz offset. When callback is received to schedule an operation, we may
  * retry commands whose expiry is up to this many seconds in the future. This
@@ -103,24 +201,14 @@ void RetryQueue::update_trytime(RetryOp *op, hrtime_t now)
         if (!us_trytime) {
             goto GT_DEFAULT;
         }
-        op->trytime = now + (LCB_US2NS(us_trytime));
+        op->trytime = now + apply_jitter(LCB_US2NS(us_trytime), settings->retry_jitter);
     } else {
     GT_DEFAULT:
-        op->trytime = now + (hrtime_t)((float)get_retry_interval() * (float)op->pkt->retries);
+        op->trytime = now + apply_jitter((hrtime_t)((float)get_retry_interval() * (float)op->pkt->retries),
+                                         settings->retry_jitter);
     }
 }
 
-/** Comparison routine for sorting by timeout */
-static int cmpfn_tmo(lcb_list_t *ll_a, lcb_list_t *ll_b)
-{
-    return list_cmp(from_tmonode(ll_a)->deadline, from_tmonode(ll_b)->deadline);
-}
-
-static int cmpfn_retry(lcb_list_t *ll_a, lcb_list_t *ll_b)
-{
-    return list_cmp(from_schednode(ll_a)->trytime, from_schednode(ll_b)->trytime);
-}
-
 static void assign_error(RetryOp *op, lcb_STATUS err)
 {
     if (err == LCB_ERR_NOT_MY_VBUCKET) {
@@ -143,10 +231,26 @@ static void assign_error(RetryOp *op, lcb_STATUS err)
     op->origerr = err;
 }
 
+void RetryQueue::insert(RetryOp *op)
+{
+    ops.insert(op);
+
+    if (settings->metrics) {
+        lcb_METRICS *metrics = settings->metrics;
+        metrics->retryq_depth = ops.size();
+        if (metrics->retryq_depth > metrics->retryq_max_depth) {
+            metrics->retryq_max_depth = metrics->retryq_depth;
+        }
+    }
+}
+
 void RetryQueue::erase(RetryOp *op)
 {
-    lcb_list_delete(static_cast<SchedNode *>(op));
-    lcb_list_delete(static_cast<TmoNode *>(op));
+    ops.erase(op);
+
+    if (settings->metrics) {
+        settings->metrics->retryq_depth = ops.size();
+    }
 }
 
 void RetryQueue::fail(RetryOp *op, lcb_STATUS err, hrtime_t now)
@@ -190,11 +294,8 @@ void RetryQueue::schedule(hrtime_t now)
     }
 
     /** Figure out which is first */
-    RetryOp *first_tmo = from_tmonode(LCB_LIST_HEAD(&tmoops));
-    RetryOp *first_sched = from_schednode(LCB_LIST_HEAD(&schedops));
-
-    hrtime_t schednext = first_sched->trytime;
-    hrtime_t tmonext = first_tmo->deadline;
+    hrtime_t schednext = ops.next_retry()->trytime;
+    hrtime_t tmonext = ops.next_timeout()->deadline;
     hrtime_t selected = schednext > tmonext ? tmonext : schednext;
 
     hrtime_t diff;
@@ -219,30 +320,19 @@ void RetryQueue::schedule(hrtime_t now)
 void RetryQueue::flush(bool throttle)
 {
     hrtime_t now = gethrtime();
-    lcb_list_t *ll, *ll_next;
-    lcb_list_t resched_next;
+    std::vector<RetryOp *> resched_next;
 
     /** Check timeouts first */
-    LCB_LIST_SAFE_FOR(ll, ll_next, &tmoops)
-    {
-        RetryOp *op = from_tmonode(ll);
-        hrtime_t curtmo = op->deadline;
-
-        if (curtmo <= now) {
-            fail(op, LCB_ERR_TIMEOUT, now);
-        } else {
-            break;
-        }
+    while (!ops.empty() && ops.next_timeout()->deadline <= now) {
+        fail(ops.next_timeout(), LCB_ERR_TIMEOUT, now);
     }
 
-    lcb_list_init(&resched_next);
-    LCB_LIST_SAFE_FOR(ll, ll_next, &schedops)
-    {
+    while (!ops.empty()) {
         protocol_binary_request_header hdr;
         int vbid, srvix;
         hrtime_t curnext;
 
-        RetryOp *op = from_schednode(ll);
+        RetryOp *op = ops.next_retry();
         curnext = op->trytime - TIMEFUZZ_NS;
 
         if (curnext > now && throttle) {
@@ -263,10 +353,8 @@ void RetryQueue::flush(bool throttle)
              */
             get_instance()->bootstrap(lcb::BS_REFRESH_THROTTLE);
             if (get_instance()->confmon->is_refreshing() || settings->retry[LCB_RETRY_ON_MISSINGNODE]) {
-
-                lcb_list_delete(static_cast<SchedNode *>(op));
-                lcb_list_delete(static_cast<TmoNode *>(op));
-                lcb_list_append(&resched_next, static_cast<SchedNode *>(op));
+                erase(op);
+                resched_next.push_back(op);
                 op->pkt->retries++;
                 update_trytime(op, now);
             } else {
@@ -279,6 +367,15 @@ void RetryQueue::flush(bool throttle)
                     "us, deadline_in=%" PRIu64 "us",
                     (void *)op->pkt, op->pkt->retries, cid, op->pkt->opaque, srvix, LCB_NS2US(now - op->start),
                     LCB_NS2US(op->deadline - now));
+            if (settings->metrics) {
+                lcb_METRICS *metrics = settings->metrics;
+                lcb_U64 waited = LCB_NS2US(now - op->queued);
+                metrics->packets_resent++;
+                metrics->retry_wait_us += waited;
+                if (waited > metrics->retry_wait_max_us) {
+                    metrics->retry_wait_max_us = waited;
+                }
+            }
             mc_PIPELINE *newpl = cq->pipelines[srvix];
             mcreq_enqueue_packet(newpl, op->pkt);
             newpl->flush_start(newpl);
@@ -286,11 +383,8 @@ void RetryQueue::flush(bool throttle)
         }
     }
 
-    LCB_LIST_SAFE_FOR(ll, ll_next, &resched_next)
-    {
-        RetryOp *op = from_schednode(ll);
-        lcb_list_add_sorted(&schedops, static_cast<SchedNode *>(op), cmpfn_retry);
-        lcb_list_add_sorted(&tmoops, static_cast<TmoNode *>(op), cmpfn_tmo);
+    for (RetryOp *op : resched_next) {
+        insert(op);
     }
 
     schedule(now);
@@ -317,7 +411,8 @@ static void op_dtorfn(mc_EPKTDATUM *d)
 }
 
 RetryOp::RetryOp(errmap::RetrySpec *spec_)
-    : mc_EPKTDATUM(), start(0), deadline(0), trytime(0), pkt(nullptr), origerr(LCB_SUCCESS),
+    : mc_EPKTDATUM(), start(0), deadline(0), trytime(0), queued(0), schedidx(NOT_QUEUED), tmoidx(NOT_QUEUED),
+      pkt(nullptr), origerr(LCB_SUCCESS),
       origstatus(PROTOCOL_BINARY_RESPONSE_SUCCESS), spec(spec_)
 {
     mc_EPKTDATUM::dtorfn = op_dtorfn;
@@ -328,6 +423,13 @@ RetryOp::RetryOp(errmap::RetrySpec *spec_)
     }
 }
 
+RetryOp::~RetryOp()
+{
+    if (spec != nullptr) {
+        spec->unref();
+    }
+}
+
 void RetryQueue::add(mc_EXPACKET *pkt, const lcb_STATUS err, protocol_binary_response_status status,
                      errmap::RetrySpec *spec, int options)
 {
@@ -335,6 +437,9 @@ void RetryQueue::add(mc_EXPACKET *pkt, const lcb_STATUS err, protocol_binary_res
     mc_EPKTDATUM *d = mcreq_epkt_find(pkt, RETRY_PKT_KEY);
     if (d) {
         op = static_cast<RetryOp *>(d);
+        if (RetrySchedule::contains(op)) {
+            erase(op);
+        }
     } else {
         op = new RetryOp(nullptr);
         op->start = MCREQ_PKT_RDATA(&pkt->base)->start;
@@ -411,16 +516,16 @@ void RetryQueue::add(mc_EXPACKET *pkt, const lcb_STATUS err, protocol_binary_res
     pkt->base.retries++;
     assign_error(op, err);
     hrtime_t now = gethrtime();
+    op->queued = now;
     if (options & RETRY_SCHED_IMM) {
         op->trytime = now;
     } else if (err == LCB_ERR_NOT_MY_VBUCKET) {
-        op->trytime = now + LCB_US2NS(settings->retry_nmv_interval);
+        op->trytime = now + apply_jitter(LCB_US2NS(settings->retry_nmv_interval), settings->retry_jitter);
     } else {
-        update_trytime(op);
+        update_trytime(op, now);
     }
 
-    lcb_list_add_sorted(&schedops, static_cast<SchedNode *>(op), cmpfn_retry);
-    lcb_list_add_sorted(&tmoops, static_cast<TmoNode *>(op), cmpfn_tmo);
+    insert(op);
 
     uint32_t cid = mcreq_get_cid(get_instance(), &pkt->base);
     lcb_log(LOGARGS(this, DEBUG),
@@ -437,16 +542,12 @@ void RetryQueue::add(mc_EXPACKET *pkt, const lcb_STATUS err, protocol_binary_res
 
 bool RetryQueue::empty(bool ignore_cfgreq) const
 {
-    bool is_empty = LCB_LIST_IS_EMPTY(&schedops);
-    if (is_empty) {
+    if (ops.empty()) {
         return true;
     }
     if (ignore_cfgreq) {
-        lcb_list_t *ll, *llnext;
-        LCB_LIST_SAFE_FOR(ll, llnext, &schedops)
-        {
+        for (RetryOp *op : ops) {
             protocol_binary_request_header hdr = {};
-            RetryOp *op = from_schednode(ll);
             mcreq_read_hdr(op->pkt, &hdr);
             if (hdr.request.opcode != PROTOCOL_BINARY_CMD_GET_CLUSTER_CONFIG &&
                 hdr.request.opcode != PROTOCOL_BINARY_CMD_SELECT_BUCKET) {
@@ -487,13 +588,7 @@ void RetryQueue::add_fallback(mc_PACKET *pkt)
 
 void RetryQueue::reset_timeouts(lcb_U64 now)
 {
-    lcb_list_t *ll;
-    LCB_LIST_FOR(ll, &schedops)
-    {
-        RetryOp *op = from_schednode(ll);
-        op->deadline = now + (op->deadline - op->start);
-        op->start = now;
-    }
+    ops.reset_timeouts(now);
 }
 
 RetryQueue::RetryQueue(mc_CMDQUEUE *cq_, lcbio_pTABLE table, lcb_settings *settings_)
@@ -503,20 +598,15 @@ RetryQueue::RetryQueue(mc_CMDQUEUE *cq_, lcbio_pTABLE table, lcb_settings *setti
     timer = lcbio_timer_new(table, this, rq_tick);
 
     lcb_settings_ref(settings);
-    lcb_list_init(&tmoops);
-    lcb_list_init(&schedops);
     mcreq_set_fallback_handler(cq, fallback_handler);
 }
 
 RetryQueue::~RetryQueue()
 {
-    lcb_list_t *llcur, *llnext;
     hrtime_t now = gethrtime();
 
-    LCB_LIST_SAFE_FOR(llcur, llnext, &schedops)
-    {
-        RetryOp *op = from_schednode(llcur);
-        fail(op, LCB_ERR_GENERIC, now);
+    while (!ops.empty()) {
+        fail(ops.next_retry(), LCB_ERR_GENERIC, now);
     }
 
     lcbio_timer_destroy(timer);
@@ -538,10 +628,7 @@ lcb_STATUS RetryQueue::error_for(const mc_PACKET *packet)
 
 void RetryQueue::dump(FILE *fp, mcreq_payload_dump_fn dumpfn)
 {
-    lcb_list_t *cur;
-    LCB_LIST_FOR(cur, &schedops)
-    {
-        RetryOp *op = from_schednode(cur);
+    for (RetryOp *op : ops) {
         mcreq_dump_packet(op->pkt, fp, dumpfn);
     }
 }
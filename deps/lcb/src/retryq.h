@@ -24,6 +24,7 @@
 #include "list.h"
 
 #ifdef __cplusplus
+#include <vector>
 
 /**
  * @file
@@ -42,7 +43,85 @@
 namespace lcb
 {
 
-struct RetryOp;
+struct RetryOp : mc_EPKTDATUM {
+    /**Cache the actual start time of the command. Since the start time may
+     * change if read_ts_wait is enabled, and we don't want to end up looping
+     * on a command forever. */
+    hrtime_t start;
+    hrtime_t deadline;
+    hrtime_t trytime; /**< Next retry time */
+    hrtime_t queued;  /**< Time at which the operation last entered the queue */
+    size_t schedidx;  /**< Position in RetrySchedule::schedops */
+    size_t tmoidx;    /**< Position in RetrySchedule::tmoops */
+    mc_PACKET *pkt;
+    lcb_STATUS origerr;
+    protocol_binary_response_status origstatus;
+    errmap::RetrySpec *spec;
+    explicit RetryOp(errmap::RetrySpec *spec);
+    ~RetryOp();
+};
+
+/**
+ * The operations of the retry queue, ordered twice: by their next retry time
+ * and by their deadline. Each ordering is a binary min-heap which records every
+ * operation's position inside it, so that an operation may be removed from the
+ * middle of either heap in logarithmic time once it is retried, failed or timed
+ * out.
+ */
+class RetrySchedule
+{
+  public:
+    void insert(RetryOp *op);
+    void erase(RetryOp *op);
+
+    /** Whether the operation is currently in the schedule */
+    static bool contains(const RetryOp *op);
+
+    bool empty() const
+    {
+        return schedops.empty();
+    }
+
+    size_t size() const
+    {
+        return schedops.size();
+    }
+
+    /** The operation with the earliest retry time. The schedule must not be empty */
+    RetryOp *next_retry() const
+    {
+        return schedops.front();
+    }
+
+    /** The operation with the earliest deadline. The schedule must not be empty */
+    RetryOp *next_timeout() const
+    {
+        return tmoops.front();
+    }
+
+    /**
+     * Restarts the timeout of every operation at the given time, keeping the
+     * duration of each, and reorders the operations by their new deadlines.
+     */
+    void reset_timeouts(hrtime_t now);
+
+    /** Iterates over the operations, in no particular order */
+    std::vector<RetryOp *>::const_iterator begin() const
+    {
+        return schedops.begin();
+    }
+
+    std::vector<RetryOp *>::const_iterator end() const
+    {
+        return schedops.end();
+    }
+
+  private:
+    /** Binary heap of operations in retry ordering. Keyed by 'trytime' */
+    std::vector<RetryOp *> schedops;
+    /** Binary heap of operations in timeout ordering. Keyed by 'deadline' */
+    std::vector<RetryOp *> tmoops;
+};
 
 class RetryQueue
 {
@@ -142,8 +221,21 @@ class RetryQueue
 
     inline void add_fallback(mc_PACKET *pkt);
 
+    /**
+     * Shortens the interval by a random fraction of up to 'jitter' of it, so
+     * that operations which failed at the same time (e.g. on a topology change)
+     * are spread out rather than all retried in the same tick. The interval is
+     * never lengthened, so the upper bounds of the retry strategies still hold.
+     *
+     * @param interval the interval to shorten
+     * @param jitter the largest fraction to remove from it, from 0 to 1
+     * @return an interval within [interval * (1 - jitter), interval]
+     */
+    static hrtime_t apply_jitter(hrtime_t interval, float jitter);
+
   private:
-    static void erase(RetryOp *);
+    void insert(RetryOp *);
+    void erase(RetryOp *);
     void fail(RetryOp *, lcb_STATUS, hrtime_t);
     void schedule(hrtime_t now = 0);
     void flush(bool throttle);
@@ -157,10 +249,7 @@ class RetryQueue
     enum AddOptions { RETRY_SCHED_IMM = 0x01 };
     void add(mc_EXPACKET *pkt, lcb_STATUS, protocol_binary_response_status, errmap::RetrySpec *, int options);
 
-    /** List of operations in retry ordering. Sorted by 'crtime' */
-    lcb_list_t schedops{};
-    /** List of operations in timeout ordering. Ordered by 'start_time' */
-    lcb_list_t tmoops{};
+    RetrySchedule ops;
     /** Parent command queue */
     mc_CMDQUEUE *cq;
     lcb_settings *settings;
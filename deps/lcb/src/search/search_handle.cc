@@ -129,7 +129,8 @@ void lcb_SEARCH_HANDLE_::invoke_last()
 }
 
 lcb_SEARCH_HANDLE_::lcb_SEARCH_HANDLE_(lcb_INSTANCE *instance, void *cookie, const lcb_CMDSEARCH *cmd)
-    : lcb::jsparse::Parser::Actions(), parser_(new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_FTS, this)),
+    : lcb::jsparse::Parser::Actions(),
+      parser_(new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_FTS, this, LCBT_SETTING(instance, use_row_scanner))),
       cookie_(cookie), callback_(cmd->callback()), instance_(instance)
 {
     std::string content_type("application/json");
@@ -190,6 +191,9 @@ lcb_SEARCH_HANDLE_::lcb_SEARCH_HANDLE_(lcb_INSTANCE *instance, void *cookie, con
     lcb_cmdhttp_destroy(htcmd);
     if (last_error_ == LCB_SUCCESS) {
         http_request_->set_callback(reinterpret_cast<lcb_RESPCALLBACK>(chunk_callback));
+        if (paused_) {
+            lcb_http_pause(instance_, http_request_);
+        }
     }
 }
 
@@ -71,6 +71,24 @@ struct lcb_SEARCH_HANDLE_ : lcb::jsparse::Parser::Actions {
         return LCB_SUCCESS;
     }
 
+    lcb_STATUS pause()
+    {
+        paused_ = true;
+        if (http_request_ != nullptr) {
+            lcb_http_pause(instance_, http_request_);
+        }
+        return LCB_SUCCESS;
+    }
+
+    lcb_STATUS resume()
+    {
+        paused_ = false;
+        if (http_request_ != nullptr) {
+            lcb_http_resume(instance_, http_request_);
+        }
+        return LCB_SUCCESS;
+    }
+
     lcb_STATUS last_error() const
     {
         return last_error_;
@@ -118,6 +136,7 @@ struct lcb_SEARCH_HANDLE_ : lcb::jsparse::Parser::Actions {
   private:
     const lcb_RESPHTTP *http_response_{nullptr};
     lcb_HTTP_HANDLE *http_request_{nullptr};
+    bool paused_{false};
     lcb::jsparse::Parser *parser_{nullptr};
     void *cookie_{nullptr};
     lcb_SEARCH_CALLBACK callback_{nullptr};
@@ -59,6 +59,7 @@ void lcb_default_settings(lcb_settings *settings)
     settings->nmv_retry_imm = LCB_DEFAULT_NVM_RETRY_IMM;
     settings->tcp_nodelay = LCB_DEFAULT_TCP_NODELAY;
     settings->retry_nmv_interval = LCB_DEFAULT_RETRY_NMV_INTERVAL;
+    settings->retry_jitter = (float)LCB_DEFAULT_RETRY_JITTER;
     settings->vb_noguess = LCB_DEFAULT_VB_NOGUESS;
     settings->vb_noremap = LCB_DEFAULT_VB_NOREMAP;
     settings->select_bucket = LCB_DEFAULT_SELECT_BUCKET;
@@ -82,9 +83,15 @@ void lcb_default_settings(lcb_settings *settings)
     settings->enable_durable_write = 0;
     settings->retry_strategy = lcb_retry_strategy_best_effort;
     settings->enable_unordered_execution = 1;
+    settings->prefetch_collections = 0;
+    settings->use_row_scanner = 0;
     settings->use_errmap = 1;
     settings->op_metrics_flush_interval = LCB_DEFAULT_OP_METRICS_FLUSH_INTERVAL;
     settings->op_metrics_enabled = 1;
+    settings->kv_pipeline_max_bytes = 0;
+    settings->kv_pipeline_max_requests = 0;
+    settings->kv_max_bytes = 0;
+    settings->kv_max_requests = 0;
 }
 
 LCB_INTERNAL_API
@@ -90,6 +90,7 @@
 
 #define LCB_DEFAULT_NVM_RETRY_IMM 0
 #define LCB_DEFAULT_RETRY_NMV_INTERVAL LCB_MS2US(100)
+#define LCB_DEFAULT_RETRY_JITTER 0.5
 #define LCB_DEFAULT_VB_NOGUESS 1
 #define LCB_DEFAULT_VB_NOREMAP 0
 #define LCB_DEFAULT_TCP_NODELAY 1
@@ -200,6 +201,10 @@ typedef struct lcb_settings_st {
     unsigned wait_for_config : 1;
     unsigned enable_durable_write : 1;
     unsigned enable_unordered_execution : 1;
+    /** Load the collections manifest as soon as the first configuration is received */
+    unsigned prefetch_collections : 1;
+    /** Split query, search, analytics and view rows with the RowScanner */
+    unsigned use_row_scanner : 1;
 
     lcb_RETRY_STRATEGY retry_strategy;
     short max_redir;
@@ -221,6 +226,8 @@ typedef struct lcb_settings_st {
     char *client_string;
     lcb_pERRMAP errmap;
     lcb_U32 retry_nmv_interval;
+    /** Fraction of each retry interval which is randomized */
+    float retry_jitter;
     struct lcb_METRICS_st *metrics;
     const lcbmetrics_METER *meter;
     lcbtrace_TRACER *tracer;
@@ -234,6 +241,10 @@ typedef struct lcb_settings_st {
     char *network; /** network resolution, AKA "Multi Network Configurations" */
     lcb_U32 op_metrics_flush_interval;
     unsigned op_metrics_enabled : 1;
+    lcb_SIZE kv_pipeline_max_bytes;
+    lcb_SIZE kv_pipeline_max_requests;
+    lcb_SIZE kv_max_bytes;
+    lcb_SIZE kv_max_requests;
 } lcb_settings;
 
 LCB_INTERNAL_API
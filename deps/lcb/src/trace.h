@@ -59,7 +59,7 @@
     TRACE(TRACE_BEGIN_COMMON(LIBCOUCHBASE_GET_BEGIN, instance, req, cmd, (cmd)->expiry()))
 #define TRACE_GET_END(instance, pkt, mcresp, resp)                                                                     \
     TRACE(TRACE_END_COMMON(LIBCOUCHBASE_GET_END, instance, pkt, mcresp, resp, (const char *)(resp)->value,             \
-                           (resp)->nvalue, (resp)->itmflags, (resp)->ctx.cas, mcresp->datatype()))
+                           (resp)->value ? (resp)->nvalue : 0, (resp)->itmflags, (resp)->ctx.cas, mcresp->datatype()))
 
 #define TRACE_UNLOCK_BEGIN(instance, req, cmd) TRACE(TRACE_BEGIN_SIMPLE(LIBCOUCHBASE_UNLOCK_BEGIN, instance, req, cmd))
 #define TRACE_UNLOCK_END(instance, pkt, mcresp, resp)                                                                  \
@@ -70,8 +70,8 @@
     TRACE(TRACE_END_COMMON(LIBCOUCHBASE_EXISTS_END, instance, pkt, mcresp, resp, (resp)->ctx.cas))
 
 #define TRACE_STORE_BEGIN(instance, req, cmd)                                                                          \
-    TRACE(TRACE_BEGIN_COMMON(LIBCOUCHBASE_STORE_BEGIN, instance, req, cmd, (cmd)->value().c_str(),                     \
-                             (cmd)->value().size(), (cmd)->flags(), (cmd)->cas(), (req)->request.datatype,             \
+    TRACE(TRACE_BEGIN_COMMON(LIBCOUCHBASE_STORE_BEGIN, instance, req, cmd, (cmd)->value_data(),                        \
+                             (cmd)->value_size(), (cmd)->flags(), (cmd)->cas(), (req)->request.datatype,               \
                              (cmd)->expiry()))
 
 #define TRACE_STORE_END(instance, pkt, mcresp, resp)                                                                   \
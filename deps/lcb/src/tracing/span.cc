@@ -21,6 +21,9 @@
 #include <sys/timeb.h>
 #endif
 
+#include <mutex>
+#include <unordered_set>
+
 typedef enum { TAGVAL_STRING, TAGVAL_UINT64, TAGVAL_DOUBLE, TAGVAL_BOOL } tag_type;
 typedef struct tag_value {
     sllist_node slnode;
@@ -128,6 +131,26 @@ void lcbtrace_span_add_tag_bool(lcbtrace_SPAN *span, const char *name, int value
     span->add_tag(name, 1, (bool)value);
 }
 
+/** The component tag of the spans, which only changes along with the client string */
+static const char *component_string(lcb_settings *settings)
+{
+    if (settings->client_string == nullptr) {
+        return LCB_CLIENT_ID;
+    }
+    thread_local struct {
+        std::string client_string;
+        const char *component{nullptr};
+    } cache;
+    if (cache.component == nullptr || cache.client_string != settings->client_string) {
+        cache.client_string = settings->client_string;
+        std::string component(LCB_CLIENT_ID);
+        component += " ";
+        component += settings->client_string;
+        cache.component = lcb::trace::intern_string(component.c_str(), component.size());
+    }
+    return cache.component;
+}
+
 LCB_INTERNAL_API
 void lcbtrace_span_add_system_tags(lcbtrace_SPAN *span, lcb_settings *settings, lcbtrace_THRESHOLDOPTS svc)
 {
@@ -138,12 +161,7 @@ void lcbtrace_span_add_system_tags(lcbtrace_SPAN *span, lcb_settings *settings,
         span->service(svc);
     }
     span->add_tag(LCBTRACE_TAG_SYSTEM, 0, "couchbase", 0);
-    std::string client_string(LCB_CLIENT_ID);
-    if (settings->client_string) {
-        client_string += " ";
-        client_string += settings->client_string;
-    }
-    span->add_tag(LCBTRACE_TAG_COMPONENT, 0, client_string.c_str(), client_string.size(), 1);
+    span->add_tag(LCBTRACE_TAG_COMPONENT, 0, component_string(settings), 0);
     if (settings->bucket) {
         span->add_tag(LCBTRACE_TAG_DB_INSTANCE, 0, settings->bucket, 0);
     }
@@ -218,7 +236,7 @@ const char *lcbtrace_span_get_operation(lcbtrace_SPAN *span)
     if (!span) {
         return nullptr;
     }
-    return span->m_opname.c_str();
+    return span->m_opname;
 }
 
 LIBCOUCHBASE_API
@@ -233,6 +251,13 @@ uint64_t lcbtrace_span_get_trace_id(lcbtrace_SPAN *span)
     return span->m_span_id;
 }
 
+/** Fixed tags are always strings, so asking for another type of value is an error */
+static bool has_fixed_tag(lcbtrace_SPAN *span, const char *name)
+{
+    int fixed = lcb::trace::Span::fixed_tag(name);
+    return fixed >= 0 && span->m_fixed_tags[fixed].p != nullptr;
+}
+
 LIBCOUCHBASE_API
 lcb_STATUS lcbtrace_span_get_tag_str(lcbtrace_SPAN *span, const char *name, char **value, size_t *nvalue)
 {
@@ -240,6 +265,13 @@ lcb_STATUS lcbtrace_span_get_tag_str(lcbtrace_SPAN *span, const char *name, char
         return LCB_ERR_INVALID_ARGUMENT;
     }
 
+    int fixed = lcb::trace::Span::fixed_tag(name);
+    if (fixed >= 0 && span->m_fixed_tags[fixed].p) {
+        *value = const_cast<char *>(span->m_fixed_tags[fixed].p);
+        *nvalue = span->m_fixed_tags[fixed].l;
+        return LCB_SUCCESS;
+    }
+
     sllist_iterator iter;
     SLLIST_ITERFOR(&span->m_tags, &iter)
     {
@@ -276,7 +308,7 @@ LIBCOUCHBASE_API lcb_STATUS lcbtrace_span_get_tag_uint64(lcbtrace_SPAN *span, co
         }
     }
 
-    return LCB_ERR_DOCUMENT_NOT_FOUND;
+    return has_fixed_tag(span, name) ? LCB_ERR_INVALID_ARGUMENT : LCB_ERR_DOCUMENT_NOT_FOUND;
 }
 
 LIBCOUCHBASE_API lcb_STATUS lcbtrace_span_get_tag_double(lcbtrace_SPAN *span, const char *name, double *value)
@@ -298,7 +330,7 @@ LIBCOUCHBASE_API lcb_STATUS lcbtrace_span_get_tag_double(lcbtrace_SPAN *span, co
         }
     }
 
-    return LCB_ERR_DOCUMENT_NOT_FOUND;
+    return has_fixed_tag(span, name) ? LCB_ERR_INVALID_ARGUMENT : LCB_ERR_DOCUMENT_NOT_FOUND;
 }
 
 LIBCOUCHBASE_API lcb_STATUS lcbtrace_span_get_tag_bool(lcbtrace_SPAN *span, const char *name, int *value)
@@ -320,7 +352,7 @@ LIBCOUCHBASE_API lcb_STATUS lcbtrace_span_get_tag_bool(lcbtrace_SPAN *span, cons
         }
     }
 
-    return LCB_ERR_DOCUMENT_NOT_FOUND;
+    return has_fixed_tag(span, name) ? LCB_ERR_INVALID_ARGUMENT : LCB_ERR_DOCUMENT_NOT_FOUND;
 }
 
 LIBCOUCHBASE_API int lcbtrace_span_has_tag(lcbtrace_SPAN *span, const char *name)
@@ -329,6 +361,10 @@ LIBCOUCHBASE_API int lcbtrace_span_has_tag(lcbtrace_SPAN *span, const char *name
         return 0;
     }
 
+    if (has_fixed_tag(span, name)) {
+        return 1;
+    }
+
     sllist_iterator iter;
     SLLIST_ITERFOR(&span->m_tags, &iter)
     {
@@ -414,9 +450,109 @@ LIBCOUCHBASE_API lcb_STATUS lcbtrace_span_get_is_encode(lcbtrace_SPAN *span, int
 
 using namespace lcb::trace;
 
+namespace
+{
+std::mutex interned_mutex;
+/* never destroyed, the interned strings may be referenced until the process exits */
+std::unordered_set<std::string> *interned_strings = new std::unordered_set<std::string>();
+
+/**
+ * Maps the addresses of recently interned strings to their copies. Names are
+ * nearly always literals, so this spares hashing them and taking the lock.
+ */
+struct InternCache {
+    static const size_t size = 64;
+    struct {
+        const char *source;
+        const char *interned;
+    } entries[size];
+};
+thread_local InternCache intern_cache{};
+
+/**
+ * Spans which were deleted on this thread, ready to be reused. Spans may be
+ * started and finished on different threads, so the list is capped.
+ */
+struct SpanPool {
+    static const size_t max_size = 1024;
+    std::vector<void *> free;
+
+    ~SpanPool()
+    {
+        for (void *ptr : free) {
+            ::operator delete(ptr);
+        }
+    }
+};
+thread_local SpanPool span_pool;
+
+const char *const fixed_tag_names[Span::TAG__MAX] = {
+    LCBTRACE_TAG_SYSTEM,       LCBTRACE_TAG_SPAN_KIND,    LCBTRACE_TAG_COMPONENT,     LCBTRACE_TAG_SERVICE,
+    LCBTRACE_TAG_DB_INSTANCE,  LCBTRACE_TAG_TRANSPORT,    LCBTRACE_TAG_LOCAL_ADDRESS, LCBTRACE_TAG_LOCAL_PORT,
+    LCBTRACE_TAG_PEER_ADDRESS, LCBTRACE_TAG_PEER_PORT,
+};
+} // namespace
+
+const char *lcb::trace::intern_string(const char *value, size_t nvalue)
+{
+    auto &entry = intern_cache.entries[(reinterpret_cast<uintptr_t>(value) >> 3) % InternCache::size];
+    if (entry.source == value && strncmp(entry.interned, value, nvalue) == 0 && entry.interned[nvalue] == '\0') {
+        return entry.interned;
+    }
+
+    const char *interned;
+    {
+        std::lock_guard<std::mutex> lock(interned_mutex);
+        interned = interned_strings->emplace(value, nvalue).first->c_str();
+    }
+    entry.source = value;
+    entry.interned = interned;
+    return interned;
+}
+
+void *Span::operator new(size_t size)
+{
+    auto &pool = span_pool.free;
+    if (size == sizeof(Span) && !pool.empty()) {
+        void *ptr = pool.back();
+        pool.pop_back();
+        return ptr;
+    }
+    return ::operator new(size);
+}
+
+void Span::operator delete(void *ptr)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    auto &pool = span_pool.free;
+    if (pool.size() < SpanPool::max_size) {
+        pool.push_back(ptr);
+    } else {
+        ::operator delete(ptr);
+    }
+}
+
+int Span::fixed_tag(const char *name)
+{
+    // the names are nearly always passed as the same literals
+    for (int ii = 0; ii < TAG__MAX; ii++) {
+        if (name == fixed_tag_names[ii]) {
+            return ii;
+        }
+    }
+    for (int ii = 0; ii < TAG__MAX; ii++) {
+        if (strcmp(name, fixed_tag_names[ii]) == 0) {
+            return ii;
+        }
+    }
+    return -1;
+}
+
 Span::Span(lcbtrace_TRACER *tracer, const char *opname, uint64_t start, lcbtrace_REF_TYPE ref, lcbtrace_SPAN *other,
            void *external_span)
-    : m_tracer(tracer), m_opname(opname), m_extspan(external_span)
+    : m_tracer(tracer), m_opname(intern_string(opname, strlen(opname))), m_extspan(external_span)
 {
     if (other != nullptr && ref == LCBTRACE_REF_CHILD_OF) {
         m_parent = other;
@@ -614,6 +750,12 @@ void Span::add_tag(const char *name, int copy_key, const char *value, size_t val
         m_parent->add_tag(name, copy_key, value, value_len, copy_value);
         return;
     }
+    int fixed = fixed_tag(name);
+    if (fixed >= 0) {
+        m_fixed_tags[fixed].p = copy_value ? intern_string(value, value_len) : value;
+        m_fixed_tags[fixed].l = value_len;
+        return;
+    }
     auto *val = (tag_value *)calloc(1, sizeof(tag_value));
     val->t = TAGVAL_STRING;
     val->key.need_free = copy_key;
@@ -17,8 +17,6 @@
 
 #include "internal.h"
 
-#include <iostream>
-#include <vector>
 
 #define LOGARGS(tracer, lvl) tracer->m_settings, "tracer", LCB_LOG_##lvl, __FILE__, __LINE__
 
@@ -77,79 +75,155 @@ lcbtrace_TRACER *ThresholdLoggingTracer::wrap()
     return m_wrapper;
 }
 
-QueueEntry ThresholdLoggingTracer::convert(lcbtrace_SPAN *span)
+ReportedSpan *SpanQueue::reserve(uint64_t duration)
 {
-    QueueEntry orphan;
-    orphan.duration = span->duration();
-    Json::Value entry;
-    char *value, *value2;
-    size_t nvalue, nvalue2;
-
-    entry["operation_name"] = std::string(span->m_opname);
-    if (lcbtrace_span_get_tag_str(span, LCBTRACE_TAG_OPERATION_ID, &value, &nvalue) == LCB_SUCCESS) {
-        entry["last_operation_id"] = std::string(value, value + nvalue);
+    if (m_heap.size() < m_capacity) {
+        auto idx = static_cast<uint32_t>(m_heap.size());
+        if (idx == m_entries.size()) {
+            m_entries.emplace_back();
+        }
+        m_entries[idx].duration = duration;
+        m_heap.push_back(idx);
+        sift_up(m_heap.size() - 1);
+        return &m_entries[idx];
     }
-    if (lcbtrace_span_get_tag_str(span, LCBTRACE_TAG_LOCAL_ID, &value, &nvalue) == LCB_SUCCESS) {
-        entry["last_local_id"] = std::string(value, value + nvalue);
+    if (m_heap.empty() || duration <= m_entries[m_heap[0]].duration) {
+        return nullptr;
     }
-    if (lcbtrace_span_get_tag_str(span, LCBTRACE_TAG_LOCAL_ADDRESS, &value, &nvalue) == LCB_SUCCESS) {
-        if (lcbtrace_span_get_tag_str(span, LCBTRACE_TAG_LOCAL_PORT, &value2, &nvalue2) == LCB_SUCCESS) {
-            std::string address(value, value + nvalue);
-            address.append(":");
-            address.append(value2, nvalue2);
-            entry["last_local_socket"] = address;
+    // replace the fastest span in the queue
+    ReportedSpan &entry = m_entries[m_heap[0]];
+    entry.duration = duration;
+    sift_down(0);
+    return &entry;
+}
+
+void SpanQueue::sift_up(size_t pos)
+{
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!heap_less(pos, parent)) {
+            break;
         }
+        std::swap(m_heap[pos], m_heap[parent]);
+        pos = parent;
     }
-    if (lcbtrace_span_get_tag_str(span, LCBTRACE_TAG_PEER_ADDRESS, &value, &nvalue) == LCB_SUCCESS) {
-        if (lcbtrace_span_get_tag_str(span, LCBTRACE_TAG_PEER_PORT, &value2, &nvalue2) == LCB_SUCCESS) {
-            std::string address(value, value + nvalue);
-            address.append(":");
-            address.append(value2, nvalue2);
-            entry["last_remote_socket"] = address;
+}
+
+void SpanQueue::sift_down(size_t pos)
+{
+    size_t size = m_heap.size();
+    while (true) {
+        size_t smallest = pos;
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        if (left < size && heap_less(left, smallest)) {
+            smallest = left;
+        }
+        if (right < size && heap_less(right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            break;
         }
+        std::swap(m_heap[pos], m_heap[smallest]);
+        pos = smallest;
     }
-    if (span->service() == LCBTRACE_THRESHOLD_KV) {
-        entry["last_server_duration_us"] = (Json::UInt64)span->m_last_server;
-        entry["total_server_duration_us"] = (Json::UInt64)span->m_total_server;
+}
+
+static void assign_tag(std::string &out, lcbtrace_SPAN *span, const char *name)
+{
+    char *value;
+    size_t nvalue;
+    if (lcbtrace_span_get_tag_str(span, name, &value, &nvalue) == LCB_SUCCESS) {
+        out.assign(value, nvalue);
+    } else {
+        out.clear();
     }
-    if (span->m_encode > 0) {
-        entry["encode_duration_us"] = (Json::UInt64)span->m_encode;
+}
+
+static void assign_socket(std::string &out, lcbtrace_SPAN *span, const char *address_tag, const char *port_tag)
+{
+    char *value, *value2;
+    size_t nvalue, nvalue2;
+    out.clear();
+    if (lcbtrace_span_get_tag_str(span, address_tag, &value, &nvalue) == LCB_SUCCESS) {
+        if (lcbtrace_span_get_tag_str(span, port_tag, &value2, &nvalue2) == LCB_SUCCESS) {
+            out.assign(value, nvalue);
+            out.append(":");
+            out.append(value2, nvalue2);
+        }
     }
-    entry["total_duration_us"] = (Json::UInt64)orphan.duration;
-    entry["last_dispatch_duration_us"] = (Json::UInt64)span->m_last_dispatch;
-    entry["total_dispatch_duration_us"] = (Json::UInt64)span->m_total_dispatch;
-    orphan.payload = Json::FastWriter().write(entry);
-    return orphan;
+}
+
+void ThresholdLoggingTracer::fill(ReportedSpan &entry, lcbtrace_SPAN *span)
+{
+    entry.operation_name = span->m_opname;
+    assign_tag(entry.operation_id, span, LCBTRACE_TAG_OPERATION_ID);
+    assign_tag(entry.local_id, span, LCBTRACE_TAG_LOCAL_ID);
+    assign_socket(entry.local_socket, span, LCBTRACE_TAG_LOCAL_ADDRESS, LCBTRACE_TAG_LOCAL_PORT);
+    assign_socket(entry.remote_socket, span, LCBTRACE_TAG_PEER_ADDRESS, LCBTRACE_TAG_PEER_PORT);
+    entry.has_server = span->service() == LCBTRACE_THRESHOLD_KV;
+    entry.last_server = span->m_last_server;
+    entry.total_server = span->m_total_server;
+    entry.encode = span->m_encode;
+    entry.last_dispatch = span->m_last_dispatch;
+    entry.total_dispatch = span->m_total_dispatch;
 }
 
 void ThresholdLoggingTracer::add_orphan(lcbtrace_SPAN *span)
 {
-    m_orphans.push(convert(span));
+    ReportedSpan *entry = m_orphans.reserve(span->duration());
+    if (entry) {
+        fill(*entry, span);
+    }
 }
 
 void ThresholdLoggingTracer::check_threshold(lcbtrace_SPAN *span)
 {
     if (span->is_outer()) {
-        if (span->service() == LCBTRACE_THRESHOLD__MAX) {
+        lcbtrace_THRESHOLDOPTS svc = span->service();
+        if (svc == LCBTRACE_THRESHOLD__MAX) {
             return;
         }
-        if (span->duration() > m_settings->tracer_threshold[span->service()]) {
-
-            auto it = m_queues.find(span->service_str());
-            if (it != m_queues.end()) {
-                // found the queue, so push this in.
-                it->second.push(convert(span));
-            } else {
-                // add a new queue, then push this in.
-                auto pr = m_queues.emplace(span->service_str(), FixedSpanQueue{m_threshold_queue_size});
-                pr.first->second.push(convert(span));
+        if (span->duration() > m_settings->tracer_threshold[svc]) {
+            ReportedSpan *entry = m_queues[svc].reserve(span->duration());
+            if (entry) {
+                fill(*entry, span);
             }
         }
     }
 }
 
-void ThresholdLoggingTracer::flush_queue(FixedSpanQueue &queue, const char *message, const char *service,
-                                         bool warn = false)
+static Json::Value render(const ReportedSpan &span)
+{
+    Json::Value entry;
+    entry["operation_name"] = span.operation_name;
+    if (!span.operation_id.empty()) {
+        entry["last_operation_id"] = span.operation_id;
+    }
+    if (!span.local_id.empty()) {
+        entry["last_local_id"] = span.local_id;
+    }
+    if (!span.local_socket.empty()) {
+        entry["last_local_socket"] = span.local_socket;
+    }
+    if (!span.remote_socket.empty()) {
+        entry["last_remote_socket"] = span.remote_socket;
+    }
+    if (span.has_server) {
+        entry["last_server_duration_us"] = (Json::UInt64)span.last_server;
+        entry["total_server_duration_us"] = (Json::UInt64)span.total_server;
+    }
+    if (span.encode > 0) {
+        entry["encode_duration_us"] = (Json::UInt64)span.encode;
+    }
+    entry["total_duration_us"] = (Json::UInt64)span.duration;
+    entry["last_dispatch_duration_us"] = (Json::UInt64)span.last_dispatch;
+    entry["total_dispatch_duration_us"] = (Json::UInt64)span.total_dispatch;
+    return entry;
+}
+
+void ThresholdLoggingTracer::flush_queue(SpanQueue &queue, const char *message, const char *service, bool warn = false)
 {
     Json::Value entries;
     if (nullptr != service) {
@@ -157,13 +231,7 @@ void ThresholdLoggingTracer::flush_queue(FixedSpanQueue &queue, const char *mess
     }
     entries["count"] = (Json::UInt)queue.size();
     Json::Value top;
-    while (!queue.empty()) {
-        Json::Value entry;
-        if (Json::Reader().parse(queue.top().payload, entry)) {
-            top.append(entry);
-        }
-        queue.pop();
-    }
+    queue.drain([&top](const ReportedSpan &span) { top.append(render(span)); });
     entries["top"] = top;
     std::string doc = Json::FastWriter().write(entries);
     if (!doc.empty() && doc[doc.size() - 1] == '\n') {
@@ -186,9 +254,18 @@ void ThresholdLoggingTracer::do_flush_orphans()
 
 void ThresholdLoggingTracer::do_flush_threshold()
 {
-    for (auto &element : m_queues) {
-        if (!element.second.empty()) {
-            flush_queue(element.second, "Operations over threshold", element.first.c_str());
+    static const char *services[LCBTRACE_THRESHOLD__MAX] = {
+        LCBTRACE_TAG_SERVICE_KV,     LCBTRACE_TAG_SERVICE_N1QL,      LCBTRACE_TAG_SERVICE_VIEW,
+        LCBTRACE_TAG_SERVICE_SEARCH, LCBTRACE_TAG_SERVICE_ANALYTICS,
+    };
+    /* flushed in the alphabetical order of the service names, as they were when queues were looked up by name */
+    static const lcbtrace_THRESHOLDOPTS order[LCBTRACE_THRESHOLD__MAX] = {
+        LCBTRACE_THRESHOLD_ANALYTICS, LCBTRACE_THRESHOLD_KV,   LCBTRACE_THRESHOLD_QUERY,
+        LCBTRACE_THRESHOLD_SEARCH,    LCBTRACE_THRESHOLD_VIEW,
+    };
+    for (lcbtrace_THRESHOLDOPTS svc : order) {
+        if (!m_queues[svc].empty()) {
+            flush_queue(m_queues[svc], "Operations over threshold", services[svc]);
         }
     }
 }
@@ -218,7 +295,8 @@ void ThresholdLoggingTracer::flush_threshold()
 ThresholdLoggingTracer::ThresholdLoggingTracer(lcb_INSTANCE *instance)
     : m_wrapper(nullptr), m_settings(instance->settings),
       m_threshold_queue_size(LCBT_SETTING(instance, tracer_threshold_queue_size)),
-      m_orphans(LCBT_SETTING(instance, tracer_orphaned_queue_size)), m_oflush(instance->iotable, this),
+      m_orphans(LCBT_SETTING(instance, tracer_orphaned_queue_size)),
+      m_queues(LCBTRACE_THRESHOLD__MAX, SpanQueue(m_threshold_queue_size)), m_oflush(instance->iotable, this),
       m_tflush(instance->iotable, this)
 {
     lcb_U32 tv = m_settings->tracer_orphaned_queue_flush_interval;
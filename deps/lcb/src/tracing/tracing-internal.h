@@ -23,15 +23,21 @@
 
 #ifdef __cplusplus
 
-#include <queue>
-#include <map>
+#include <algorithm>
 #include <string>
+#include <vector>
 
 namespace lcb
 {
 namespace trace
 {
 
+/**
+ * Returns a copy of the string which stays valid for the lifetime of the
+ * process. Equal strings share the same copy.
+ */
+const char *intern_string(const char *value, size_t nvalue);
+
 class Span
 {
   public:
@@ -39,6 +45,26 @@ class Span
          void *external_span);
     ~Span();
 
+    /** Spans are recycled through a per-thread free list */
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr);
+
+    /** String tags which nearly every span has, these are kept out of m_tags */
+    enum FixedTag {
+        TAG_SYSTEM = 0,
+        TAG_SPAN_KIND,
+        TAG_COMPONENT,
+        TAG_SERVICE,
+        TAG_DB_INSTANCE,
+        TAG_TRANSPORT,
+        TAG_LOCAL_ADDRESS,
+        TAG_LOCAL_PORT,
+        TAG_PEER_ADDRESS,
+        TAG_PEER_PORT,
+        TAG__MAX
+    };
+    static int fixed_tag(const char *name);
+
     void finish(uint64_t finish);
     uint64_t duration() const
     {
@@ -73,7 +99,8 @@ class Span
     void should_finish(bool finish);
 
     lcbtrace_TRACER *m_tracer;
-    std::string m_opname;
+    /** Interned, see intern_string() */
+    const char *m_opname;
     uint64_t m_span_id;
     uint64_t m_start;
     uint64_t m_finish{0};
@@ -81,6 +108,10 @@ class Span
     Span *m_parent;
     void *m_extspan;
     sllist_root m_tags{};
+    struct {
+        const char *p;
+        size_t l;
+    } m_fixed_tags[TAG__MAX]{};
     bool m_is_outer{false};
     bool m_is_dispatch{false};
     bool m_is_encode{false};
@@ -94,51 +125,91 @@ class Span
     uint64_t m_encode{0};
 };
 
+/**
+ * The fields of a span reported by the threshold logging tracer. They are
+ * only rendered as JSON when the queue holding them is flushed.
+ */
 struct ReportedSpan {
-    uint64_t duration;
-    std::string payload;
-
-    bool operator<(const ReportedSpan &rhs) const
-    {
-        return duration < rhs.duration;
-    }
+    uint64_t duration{0};
+    uint64_t last_dispatch{0};
+    uint64_t total_dispatch{0};
+    uint64_t last_server{0};
+    uint64_t total_server{0};
+    uint64_t encode{0};
+    bool has_server{false};
+    const char *operation_name{nullptr};
+    std::string operation_id;
+    std::string local_id;
+    std::string local_socket;
+    std::string remote_socket;
 };
 
-template <typename T>
-class FixedQueue : private std::priority_queue<T>
+/**
+ * Keeps the slowest spans seen since the last flush, up to a fixed number.
+ *
+ * The entries are indexed by a min-heap on their duration, so that a span
+ * which is not slow enough is rejected without looking at its tags. Entries
+ * are reused across flushes and keep the capacity of their strings.
+ */
+class SpanQueue
 {
   public:
-    explicit FixedQueue(size_t capacity) : m_capacity(capacity) {}
+    explicit SpanQueue(size_t capacity) : m_capacity(capacity) {}
+
+    /**
+     * @return the entry to fill in for a span of the given duration, or
+     *  nullptr if the queue is already full of slower spans
+     */
+    ReportedSpan *reserve(uint64_t duration);
 
-    void push(const T &item)
+    /** Passes the entries to fn, slowest first, and empties the queue */
+    template <typename Fn>
+    void drain(Fn fn)
     {
-        std::priority_queue<T>::push(item);
-        if (this->size() > m_capacity) {
-            this->c.pop_back();
+        std::sort(m_heap.begin(), m_heap.end(),
+                  [this](uint32_t a, uint32_t b) { return m_entries[a].duration > m_entries[b].duration; });
+        for (uint32_t idx : m_heap) {
+            fn(m_entries[idx]);
         }
+        m_heap.clear();
+    }
+
+    bool empty() const
+    {
+        return m_heap.empty();
+    }
+
+    size_t size() const
+    {
+        return m_heap.size();
     }
-    using std::priority_queue<T>::empty;
-    using std::priority_queue<T>::top;
-    using std::priority_queue<T>::pop;
-    using std::priority_queue<T>::size;
 
   private:
+    bool heap_less(size_t a, size_t b) const
+    {
+        return m_entries[m_heap[a]].duration < m_entries[m_heap[b]].duration;
+    }
+    void sift_up(size_t pos);
+    void sift_down(size_t pos);
+
     size_t m_capacity;
+    std::vector<ReportedSpan> m_entries;
+    /** Indices of the entries in use, the fastest span first */
+    std::vector<uint32_t> m_heap;
 };
 
-typedef ReportedSpan QueueEntry;
-typedef FixedQueue<QueueEntry> FixedSpanQueue;
 class ThresholdLoggingTracer
 {
     lcbtrace_TRACER *m_wrapper;
     lcb_settings *m_settings;
     size_t m_threshold_queue_size;
 
-    FixedSpanQueue m_orphans;
-    std::map<std::string, FixedSpanQueue> m_queues;
+    SpanQueue m_orphans;
+    /** Spans over the threshold, indexed by lcbtrace_THRESHOLDOPTS */
+    std::vector<SpanQueue> m_queues;
 
-    void flush_queue(FixedSpanQueue &queue, const char *message, const char *service, bool warn);
-    QueueEntry convert(lcbtrace_SPAN *span);
+    void flush_queue(SpanQueue &queue, const char *message, const char *service, bool warn);
+    static void fill(ReportedSpan &entry, lcbtrace_SPAN *span);
 
   public:
     ThresholdLoggingTracer(lcb_INSTANCE *instance);
@@ -36,13 +36,205 @@ static const uint32_t crc32tab[256] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d,
 };
 
+static uint32_t crc32_update_table(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    size_t x;
+
+    for (x = 0; x < len; x++)
+        crc = (crc >> 8) ^ crc32tab[(crc ^ buf[x]) & 0xff];
+
+    return crc;
+}
+
+/*
+ * Accelerated versions of crc32_update_table(). They compute the same
+ * (IEEE 802.3) CRC, so that keys keep mapping to the same vBuckets. Note that
+ * the SSE4.2 CRC32 instruction cannot be used, as it implements the
+ * Castagnoli polynomial.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define LCBVB_CRC32_PCLMUL
+#define LCBVB_CRC32_PCLMUL_TARGET __attribute__((target("pclmul,sse2")))
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define LCBVB_CRC32_PCLMUL
+#define LCBVB_CRC32_PCLMUL_TARGET
+#include <intrin.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32) && !defined(__AARCH64EB__)
+#define LCBVB_CRC32_ARMV8
+#include <arm_acle.h>
+#endif
+
+#ifdef LCBVB_CRC32_PCLMUL
+/**
+ * Shorter keys are faster to hash with the table than to fold and reduce. The
+ * carry-less multiplication is only used for a multiple of this many bytes.
+ */
+#define LCBVB_CRC32_PCLMUL_MIN_LENGTH 16
+
+static int crc32_pclmul_detect(void)
+{
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    return (regs[2] & (1 << 1)) != 0;
+#else
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ecx & bit_PCLMUL) != 0;
+#endif
+}
+
+/**
+ * Whether the CPU supports PCLMULQDQ. Every thread which races to detect it
+ * stores the same value, so the result is cached without synchronization.
+ */
+static int crc32_have_pclmul(void)
+{
+    static volatile int have_pclmul = -1;
+    if (have_pclmul < 0) {
+        have_pclmul = crc32_pclmul_detect();
+    }
+    return have_pclmul;
+}
+
+/**
+ * Folds the buffer 128 bits at a time with carry-less multiplication, then
+ * Barrett-reduces the remainder to 32 bits, as described in Intel's "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction". The length
+ * must be a nonzero multiple of 16.
+ */
+LCBVB_CRC32_PCLMUL_TARGET
+static uint32_t crc32_update_pclmul(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    /* Bit-reflected folding constants and polynomials for 0x04C11DB7 */
+    static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+    static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+    static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+    static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)buf), _mm_cvtsi32_si128((int)crc));
+    x0 = _mm_loadu_si128((const __m128i *)k3k4);
+    buf += 16;
+    len -= 16;
+
+    if (len >= 48) {
+        /* Fold four lanes in parallel, then fold them into one */
+        x2 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+        x3 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+        x4 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+        buf += 48;
+        len -= 48;
+
+        x0 = _mm_loadu_si128((const __m128i *)k1k2);
+        while (len >= 64) {
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+            x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+            x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+            x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+            x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(buf + 0x00)));
+            x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(buf + 0x10)));
+            x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(buf + 0x20)));
+            x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(buf + 0x30)));
+
+            buf += 64;
+            len -= 64;
+        }
+
+        x0 = _mm_loadu_si128((const __m128i *)k3k4);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+    }
+
+    while (len >= 16) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)buf)), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    /* Fold 128 bits to 64 bits */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    x0 = _mm_loadu_si128((const __m128i *)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x0 = _mm_loadu_si128((const __m128i *)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+#endif
+
+#ifdef LCBVB_CRC32_ARMV8
+static uint32_t crc32_update_armv8(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, buf, sizeof(word));
+        crc = __crc32d(crc, word);
+        buf += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32b(crc, *buf++);
+    }
+    return crc;
+}
+#endif
+
 static uint32_t hash_crc32(const char *key, size_t key_length)
 {
-    uint64_t x;
+    const unsigned char *buf = (const unsigned char *)key;
     uint32_t crc = UINT32_MAX;
 
-    for (x = 0; x < key_length; x++)
-        crc = (crc >> 8) ^ crc32tab[(crc ^ (uint64_t)key[x]) & 0xff];
+#if defined(LCBVB_CRC32_PCLMUL)
+    if (key_length >= LCBVB_CRC32_PCLMUL_MIN_LENGTH && crc32_have_pclmul()) {
+        size_t nfold = key_length & ~(size_t)15;
+        crc = crc32_update_pclmul(crc, buf, nfold);
+        buf += nfold;
+        key_length -= nfold;
+    }
+    crc = crc32_update_table(crc, buf, key_length);
+#elif defined(LCBVB_CRC32_ARMV8)
+    crc = crc32_update_armv8(crc, buf, key_length);
+#else
+    crc = crc32_update_table(crc, buf, key_length);
+#endif
 
     return ((~crc) >> 16) & 0x7fff;
 }
@@ -586,6 +586,117 @@ static void guess_network(cJSON *jnodes, int nsrv, const char *source, char **ne
     *network = lcb_strdup("default");
 }
 
+static const char *peek_skip_ws(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+/** Returns the position after the closing quote of the string at 'p' */
+static const char *peek_skip_string(const char *p, const char *end)
+{
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            p++;
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+static int peek_int64(const char *p, const char *end, int64_t *value)
+{
+    int negative = 0;
+    int64_t result = 0;
+    const char *digits;
+
+    if (p < end && *p == '-') {
+        negative = 1;
+        p++;
+    }
+    for (digits = p; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (result > (INT64_MAX - 9) / 10) {
+            return -1;
+        }
+        result = result * 10 + (*p - '0');
+    }
+    if (p == digits || (p < end && (*p == '.' || *p == 'e' || *p == 'E'))) {
+        return -1;
+    }
+    *value = negative ? -result : result;
+    return 0;
+}
+
+#define PEEK_KEY_IS(key, nkey, s) ((nkey) == sizeof(s) - 1 && memcmp(key, s, sizeof(s) - 1) == 0)
+
+int lcbvb_peek_revision(const char *data, lcb_SIZE ndata, int64_t *revepoch, int64_t *revid)
+{
+    const char *p = data, *end = data + ndata;
+    int depth = 0, want_key = 0, have_epoch = 0, have_rev = 0;
+
+    *revepoch = -1;
+    p = peek_skip_ws(p, end);
+    if (p == end || *p != '{') {
+        return -1;
+    }
+
+    /* Walk the document, only looking at the keys of the outermost object */
+    while (p < end) {
+        char c = *p;
+        if (c == '"') {
+            const char *key = p + 1, *next = peek_skip_string(p, end);
+            size_t nkey;
+            if (next == NULL) {
+                return -1;
+            }
+            nkey = next - key - 1;
+            p = next;
+            if (depth != 1 || !want_key) {
+                continue;
+            }
+            want_key = 0;
+            p = peek_skip_ws(p, end);
+            if (p == end || *p != ':') {
+                return -1;
+            }
+            p = peek_skip_ws(p + 1, end);
+            /* Like cJSON_GetObjectItem(), use the first occurrence of a key */
+            if (!have_rev && PEEK_KEY_IS(key, nkey, "rev")) {
+                if (peek_int64(p, end, revid) != 0) {
+                    return -1;
+                }
+                have_rev = 1;
+            } else if (!have_epoch && PEEK_KEY_IS(key, nkey, "revEpoch")) {
+                if (peek_int64(p, end, revepoch) != 0) {
+                    return -1;
+                }
+                have_epoch = 1;
+            }
+            if (have_rev && have_epoch) {
+                return 0;
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+            want_key = (c == '{' && depth == 1);
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                break;
+            }
+        } else if (c == ',' && depth == 1) {
+            want_key = 1;
+        }
+        p++;
+    }
+    return have_rev ? 0 : -1;
+}
+
+#undef PEEK_KEY_IS
+
 int lcbvb_load_json_ex(lcbvb_CONFIG *cfg, const char *data, const char *source, char **network)
 {
     cJSON *cj = NULL, *jnodes_ext = NULL, *jnodes = NULL, *buckets = NULL;
@@ -1090,10 +1201,15 @@ static int map_ketama(lcbvb_CONFIG *cfg, const void *key, size_t nkey)
     return -1;
 }
 
-int lcbvb_k2vb(lcbvb_CONFIG *cfg, const void *k, lcb_SIZE n)
+int lcbvb_hash_key(unsigned nvb, const void *k, lcb_SIZE n)
 {
     uint32_t digest = hash_crc32(k, n);
-    return digest % cfg->nvb;
+    return digest % nvb;
+}
+
+int lcbvb_k2vb(lcbvb_CONFIG *cfg, const void *k, lcb_SIZE n)
+{
+    return lcbvb_hash_key(cfg->nvb, k, n);
 }
 
 int lcbvb_vbmaster(lcbvb_CONFIG *cfg, int vbid)
@@ -364,8 +364,9 @@ lcb_STATUS lcb_VIEW_HANDLE_::request_http(const lcb_CMDVIEW *cmd)
 }
 
 lcb_VIEW_HANDLE_::lcb_VIEW_HANDLE_(lcb_INSTANCE *instance, void *cookie, const lcb_CMDVIEW *cmd)
-    : parser_(new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_VIEWS, this)), cookie_(cookie),
-      callback_(cmd->callback()), instance_(instance), include_docs_(cmd->include_documents()),
+    : parser_(
+          new lcb::jsparse::Parser(lcb::jsparse::Parser::MODE_VIEWS, this, LCBT_SETTING(instance, use_row_scanner))),
+      cookie_(cookie), callback_(cmd->callback()), instance_(instance), include_docs_(cmd->include_documents()),
       do_not_parse_rows_(cmd->do_not_parse_rows()), spatial_(false)
 {
 
@@ -0,0 +1,214 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "internal.h"
+#include "collections.h"
+#include <gtest/gtest.h>
+
+#include <string>
+
+class CollectionCacheTest : public ::testing::Test
+{
+};
+
+TEST_F(CollectionCacheTest, testDefaultCollection)
+{
+    lcb::CollectionCache cache;
+    uint32_t cid = 42;
+    ASSERT_TRUE(cache.get("_default._default", &cid));
+    ASSERT_EQ(0U, cid);
+
+    cid = 42;
+    ASSERT_TRUE(cache.get(nullptr, 0, nullptr, 0, &cid));
+    ASSERT_EQ(0U, cid);
+    ASSERT_EQ("_default._default", cache.id_to_name(0));
+}
+
+TEST_F(CollectionCacheTest, testLookupByNames)
+{
+    lcb::CollectionCache cache;
+    cache.put("inventory.airline", 8);
+    cache.put("_default.users", 9);
+
+    uint32_t cid = 0;
+    ASSERT_TRUE(cache.get("inventory", 9, "airline", 7, &cid));
+    ASSERT_EQ(8U, cid);
+    ASSERT_TRUE(cache.get(nullptr, 0, "users", 5, &cid));
+    ASSERT_EQ(9U, cid);
+    ASSERT_FALSE(cache.get("inventory", 9, "users", 5, &cid));
+    ASSERT_FALSE(cache.get("inventor", 8, "yairline", 8, &cid));
+    ASSERT_FALSE(cache.get("inventory.airline.x", &cid));
+}
+
+TEST_F(CollectionCacheTest, testGrowAndErase)
+{
+    lcb::CollectionCache cache;
+    for (uint32_t ii = 1; ii <= 1000; ++ii) {
+        cache.put("scope" + std::to_string(ii % 7) + ".coll" + std::to_string(ii), ii);
+    }
+    ASSERT_EQ(1001U, cache.size());
+
+    for (uint32_t ii = 1; ii <= 1000; ii += 2) {
+        cache.erase(ii);
+    }
+    ASSERT_EQ(501U, cache.size());
+
+    for (uint32_t ii = 1; ii <= 1000; ++ii) {
+        uint32_t cid = 0;
+        std::string path = "scope" + std::to_string(ii % 7) + ".coll" + std::to_string(ii);
+        if (ii % 2) {
+            ASSERT_FALSE(cache.get(path, &cid)) << path;
+            ASSERT_EQ("", cache.id_to_name(ii));
+        } else {
+            ASSERT_TRUE(cache.get(path, &cid)) << path;
+            ASSERT_EQ(ii, cid);
+            ASSERT_EQ(path, cache.id_to_name(ii));
+        }
+    }
+}
+
+TEST_F(CollectionCacheTest, testApplyManifest)
+{
+    lcb::CollectionCache cache;
+    std::string manifest = R"({"uid":"1a","scopes":[
+        {"name":"_default","uid":"0","collections":[{"name":"_default","uid":"0"}]},
+        {"name":"inventory","uid":"8","collections":[{"name":"airline","uid":"a"},{"name":"hotel","uid":"1f"}]}]})";
+    ASSERT_EQ(3, cache.apply_manifest(manifest.data(), manifest.size()));
+
+    uint32_t cid = 0;
+    ASSERT_TRUE(cache.get("inventory.airline", &cid));
+    ASSERT_EQ(0xaU, cid);
+    ASSERT_TRUE(cache.get("inventory.hotel", &cid));
+    ASSERT_EQ(0x1fU, cid);
+
+    /* older manifests do not override newer ones */
+    std::string stale = R"({"uid":"2","scopes":[{"name":"inventory","collections":[{"name":"route","uid":"c"}]}]})";
+    ASSERT_EQ(0, cache.apply_manifest(stale.data(), stale.size()));
+    ASSERT_FALSE(cache.get("inventory.route", &cid));
+
+    std::string garbage = "{\"scopes\":";
+    ASSERT_EQ(-1, cache.apply_manifest(garbage.data(), garbage.size()));
+}
+
+TEST_F(CollectionCacheTest, testResolutionsAreCoalesced)
+{
+    lcb::CollectionCache cache;
+    ASSERT_TRUE(cache.begin_resolve("inventory.airline"));
+    ASSERT_FALSE(cache.begin_resolve("inventory.airline"));
+    ASSERT_TRUE(cache.begin_resolve("inventory.hotel"));
+
+    int invoked = 0;
+    uint32_t seen = 0;
+    for (int ii = 0; ii < 3; ++ii) {
+        cache.wait_resolve("inventory.airline", [&](lcb_STATUS rc, const lcb_RESPGETCID *resp) {
+            ASSERT_EQ(LCB_SUCCESS, rc);
+            ASSERT_NE(nullptr, resp);
+            seen = resp->collection_id;
+            ++invoked;
+        });
+    }
+
+    lcb_RESPGETCID resp{};
+    resp.ctx.rc = LCB_SUCCESS;
+    resp.collection_id = 8;
+    cache.finish_resolve("inventory.airline", LCB_SUCCESS, &resp);
+    ASSERT_EQ(3, invoked);
+    ASSERT_EQ(8U, seen);
+
+    /* once finished, the next miss starts a new resolution */
+    ASSERT_TRUE(cache.begin_resolve("inventory.airline"));
+
+    invoked = 0;
+    cache.wait_resolve("inventory.hotel", [&](lcb_STATUS rc, const lcb_RESPGETCID *resp) {
+        ASSERT_EQ(LCB_ERR_SHEDULE_FAILURE, rc);
+        ASSERT_EQ(nullptr, resp);
+        ++invoked;
+    });
+    cache.finish_resolve("inventory.hotel", LCB_ERR_SHEDULE_FAILURE, nullptr);
+    ASSERT_EQ(1, invoked);
+}
+
+TEST_F(CollectionCacheTest, testRemappedIdEvictsOldPath)
+{
+    lcb::CollectionCache cache;
+    uint32_t cid = 0;
+    cache.put("inventory.airline", 8);
+    cache.put("inventory.hotel", 9);
+
+    /* the ID now belongs to another collection */
+    cache.put("inventory.route", 8);
+    ASSERT_FALSE(cache.get("inventory.airline", &cid));
+    ASSERT_TRUE(cache.get("inventory.route", &cid));
+    ASSERT_EQ(8U, cid);
+    ASSERT_EQ("inventory.route", cache.id_to_name(8));
+    ASSERT_EQ(3U, cache.size());
+
+    /* and the collection got a new ID */
+    cache.put("inventory.route", 10);
+    ASSERT_TRUE(cache.get("inventory.route", &cid));
+    ASSERT_EQ(10U, cid);
+    ASSERT_EQ("", cache.id_to_name(8));
+    ASSERT_TRUE(cache.get("inventory.hotel", &cid));
+    ASSERT_EQ(9U, cid);
+    ASSERT_EQ(3U, cache.size());
+}
+
+namespace
+{
+struct cid_command {
+    uint32_t cid{0};
+};
+
+void destroy_cid_command(cid_command *cmd)
+{
+    delete cmd;
+}
+} // namespace
+
+TEST_F(CollectionCacheTest, testFailedLeaderWakesFollowers)
+{
+    lcb_INSTANCE *instance;
+    ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, nullptr));
+    const std::string spec = "inventory.airline";
+    ASSERT_TRUE(instance->collcache->begin_resolve(spec));
+
+    std::vector<lcb_STATUS> seen;
+    auto operation = [&seen](const lcb_RESPGETCID *resp, cid_command *cmd) {
+        seen.push_back(resp->ctx.rc);
+        EXPECT_EQ(0U, cmd->cid);
+        return LCB_SUCCESS;
+    };
+    for (int ii = 0; ii < 3; ++ii) {
+        std::shared_ptr<cid_command> follower(new cid_command(), destroy_cid_command);
+        instance->collcache->wait_resolve(spec, make_cid_waiter(operation, follower));
+    }
+
+    /* the leader's GET_CID packet fails to be scheduled */
+    mc_PACKET pkt{};
+    pkt.flags = MCREQ_F_REQEXT;
+    pkt.u_rdata.exdata = make_cid_ctx(instance, spec, operation, new cid_command(), destroy_cid_command);
+    pkt.u_rdata.exdata->procs->fail_dtor(&pkt);
+
+    ASSERT_EQ(4U, seen.size());
+    for (lcb_STATUS rc : seen) {
+        ASSERT_EQ(LCB_ERR_SHEDULE_FAILURE, rc);
+    }
+    /* nothing is left waiting, so the next miss resolves again */
+    ASSERT_TRUE(instance->collcache->begin_resolve(spec));
+    lcb_destroy(instance);
+}
@@ -104,6 +104,12 @@ TEST_F(CtlTest, testStringCtls)
     ASSERT_EQ(LCB_SUCCESS, err);
     ASSERT_EQ(LCB_COMPRESS_IN, getSetting< lcb_COMPRESSOPTS >(instance, LCB_CNTL_COMPRESSION_OPTS));
 
+    err = lcb_cntl_string(instance, "retry_jitter", "0.25");
+    ASSERT_EQ(LCB_SUCCESS, err);
+    ASSERT_EQ(0.25, getSetting< float >(instance, LCB_CNTL_RETRY_JITTER));
+    err = lcb_cntl_string(instance, "retry_jitter", "1.5");
+    ASSERT_EQ(LCB_ERR_CONTROL_INVALID_ARGUMENT, err);
+
     err = lcb_cntl_string(instance, "unsafe_optimize", "1");
     ASSERT_EQ(LCB_SUCCESS, err);
     err = lcb_cntl_string(instance, "unsafe_optimize", "0");
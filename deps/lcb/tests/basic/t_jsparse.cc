@@ -22,6 +22,9 @@
 #include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
 #include "t_jsparse.h"
 
+#include <algorithm>
+#include <chrono>
+
 class JsonParseTest : public ::testing::Test
 {
 };
@@ -38,6 +41,7 @@ struct Context : Parser::Actions {
     bool received_done;
     std::string meta;
     std::vector<std::string> rows;
+    std::vector<const void *> row_ptrs;
     Context()
     {
         reset();
@@ -48,10 +52,12 @@ struct Context : Parser::Actions {
         received_done = false;
         meta.clear();
         rows.clear();
+        row_ptrs.clear();
     }
     void JSPARSE_on_row(const Row &row)
     {
         rows.push_back(iov2s(row.row));
+        row_ptrs.push_back(row.row.iov_base);
     }
     void JSPARSE_on_complete(const std::string &s)
     {
@@ -65,10 +71,10 @@ struct Context : Parser::Actions {
     }
 };
 
-static bool validateJsonRows(const char *txt, size_t ntxt, Parser::Mode mode)
+static bool validateJsonRows(const char *txt, size_t ntxt, Parser::Mode mode, bool use_scanner = false)
 {
     Context cx;
-    Parser parser(mode, &cx);
+    Parser parser(mode, &cx, use_scanner);
 
     for (size_t ii = 0; ii < ntxt; ii++) {
         parser.feed(txt + ii, 1);
@@ -83,10 +89,10 @@ static bool validateJsonRows(const char *txt, size_t ntxt, Parser::Mode mode)
     return true;
 }
 
-static bool validateBadParse(const char *txt, size_t ntxt, Parser::Mode mode)
+static bool validateBadParse(const char *txt, size_t ntxt, Parser::Mode mode, bool use_scanner = false)
 {
     Context cx;
-    Parser p(mode, &cx);
+    Parser p(mode, &cx, use_scanner);
     p.feed(txt, ntxt);
     EXPECT_EQ(LCB_ERR_PROTOCOL_ERROR, cx.rc);
     return true;
@@ -105,3 +111,145 @@ TEST_F(JsonParseTest, testN1QL)
     ASSERT_TRUE(validateJsonRows(JSON_n1ql_empty, sizeof(JSON_n1ql_empty), Parser::MODE_N1QL));
     ASSERT_TRUE(validateBadParse(JSON_n1ql_bad, sizeof(JSON_n1ql_bad), Parser::MODE_N1QL));
 }
+
+TEST_F(JsonParseTest, testScannerFTS)
+{
+    ASSERT_TRUE(validateJsonRows(JSON_fts_good, sizeof(JSON_fts_good), Parser::MODE_FTS, true));
+    ASSERT_TRUE(validateBadParse(JSON_fts_bad, sizeof(JSON_fts_bad), Parser::MODE_FTS, true));
+    ASSERT_TRUE(validateBadParse(JSON_fts_bad2, sizeof(JSON_fts_bad2), Parser::MODE_FTS, true));
+}
+
+TEST_F(JsonParseTest, testScannerN1QL)
+{
+    ASSERT_TRUE(validateJsonRows(JSON_n1ql_nonempty, sizeof(JSON_n1ql_nonempty), Parser::MODE_N1QL, true));
+    ASSERT_TRUE(validateJsonRows(JSON_n1ql_empty, sizeof(JSON_n1ql_empty), Parser::MODE_N1QL, true));
+    ASSERT_TRUE(validateBadParse(JSON_n1ql_bad, sizeof(JSON_n1ql_bad), Parser::MODE_N1QL, true));
+}
+
+static void feedInChunks(Parser &parser, const std::string &txt, size_t chunk)
+{
+    for (size_t ii = 0; ii < txt.size(); ii += chunk) {
+        parser.feed(txt.c_str() + ii, std::min(chunk, txt.size() - ii));
+    }
+}
+
+TEST_F(JsonParseTest, testScannerMatchesJsonsl)
+{
+    std::string txt = "{\"requestID\": \"x\", \"signature\": {\"results\": [1]}, \"results\": [ "
+                      "{\"a\": \"q\\\"uo}te\", \"b\": [1, {\"c\": null}]}, \"str]ing\", 42 , true,"
+                      "[], {}, -1.5e3 ], \"status\": \"success\", \"metrics\": {\"resultCount\": 6}}";
+
+    for (size_t chunk = 1; chunk <= txt.size(); chunk++) {
+        Context expected;
+        Parser jsonsl(Parser::MODE_N1QL, &expected);
+        feedInChunks(jsonsl, txt, chunk);
+
+        Context actual;
+        Parser scanner(Parser::MODE_N1QL, &actual, true);
+        feedInChunks(scanner, txt, chunk);
+
+        ASSERT_EQ(LCB_SUCCESS, actual.rc) << "chunk size " << chunk;
+        ASSERT_TRUE(actual.received_done) << "chunk size " << chunk;
+        ASSERT_EQ(expected.rows, actual.rows) << "chunk size " << chunk;
+
+        Json::Value expectedMeta, actualMeta;
+        ASSERT_TRUE(Json::Reader().parse(expected.meta, expectedMeta));
+        ASSERT_TRUE(Json::Reader().parse(actual.meta, actualMeta)) << actual.meta;
+        ASSERT_EQ(expectedMeta, actualMeta) << "chunk size " << chunk;
+    }
+}
+
+TEST_F(JsonParseTest, testScannerRowsAreNotCopied)
+{
+    std::string txt = "{\"results\":[{\"id\":1},{\"id\":2}],\"status\":\"success\"}";
+    Context cx;
+    Parser parser(Parser::MODE_N1QL, &cx, true);
+    parser.feed(txt);
+
+    ASSERT_EQ(2U, cx.rows.size());
+    ASSERT_EQ("{\"id\":1}", cx.rows[0]);
+    ASSERT_EQ(txt.c_str() + txt.find("{\"id\":1}"), cx.row_ptrs[0]);
+    ASSERT_EQ(txt.c_str() + txt.find("{\"id\":2}"), cx.row_ptrs[1]);
+}
+
+TEST_F(JsonParseTest, testScannerWithoutRows)
+{
+    std::string txt = "{\"errors\":[{\"code\":3000,\"msg\":\"syntax error\"}],\"status\":\"fatal\"}";
+    Context cx;
+    Parser parser(Parser::MODE_N1QL, &cx, true);
+    feedInChunks(parser, txt, 7);
+
+    ASSERT_EQ(LCB_SUCCESS, cx.rc);
+    ASSERT_FALSE(cx.received_done);
+    ASSERT_TRUE(cx.rows.empty());
+
+    lcb_IOV out;
+    parser.get_postmortem(out);
+    ASSERT_EQ(txt, iov2s(out));
+}
+
+TEST_F(JsonParseTest, testScannerViewRows)
+{
+    std::string txt = "{\"total_rows\":1,\"rows\":[{\"id\":\"doc1\",\"key\":[1,2],\"value\":{\"a\":1}}]}";
+    struct ViewContext : Context {
+        Parser *parser{nullptr};
+        Row parsed{};
+        void JSPARSE_on_row(const Row &row) override
+        {
+            parsed = row;
+            parser->parse_viewrow(parsed);
+        }
+    } cx;
+    Parser parser(Parser::MODE_VIEWS, &cx, true);
+    cx.parser = &parser;
+    parser.feed(txt);
+
+    ASSERT_TRUE(cx.received_done);
+    ASSERT_EQ("doc1", iov2s(cx.parsed.docid));
+    ASSERT_EQ("[1,2]", iov2s(cx.parsed.key));
+    ASSERT_EQ("{\"a\":1}", iov2s(cx.parsed.value));
+}
+
+/**
+ * Compares the throughput of both backends on a large query response which
+ * is received in chunks the size of a typical socket read.
+ *
+ * This is a benchmark rather than a test, run it with
+ * --gtest_also_run_disabled_tests.
+ */
+TEST_F(JsonParseTest, DISABLED_benchRowsByBackend)
+{
+    std::string txt = "{\"requestID\":\"bench\",\"signature\":{\"*\":\"*\"},\"results\":[";
+    for (int ii = 0; ii < 20000; ii++) {
+        if (ii) {
+            txt += ",";
+        }
+        txt += "{\"id\":\"user::" + std::to_string(ii) +
+               "\",\"name\":\"Some \\\"quoted\\\" name\",\"tags\":[\"a\",\"b\",\"c\"],"
+               "\"address\":{\"street\":\"1 Infinite Loop\",\"zip\":95014},\"score\":" +
+               std::to_string(ii * 0.5) + "}";
+    }
+    txt += "],\"status\":\"success\",\"metrics\":{\"resultCount\":20000}}";
+
+    const size_t chunk = 16384;
+    std::vector<std::string> expected;
+    for (bool use_scanner : {false, true}) {
+        Context cx;
+        Parser parser(Parser::MODE_N1QL, &cx, use_scanner);
+
+        auto start = std::chrono::steady_clock::now();
+        feedInChunks(parser, txt, chunk);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        ASSERT_TRUE(cx.received_done);
+        ASSERT_EQ(20000U, cx.rows.size());
+        if (use_scanner) {
+            ASSERT_EQ(expected, cx.rows);
+        } else {
+            expected = cx.rows;
+        }
+
+        double secs = std::chrono::duration<double>(elapsed).count();
+        printf("%-7s %8.1f MB/s\n", use_scanner ? "scanner" : "jsonsl", txt.size() / secs / (1024 * 1024));
+    }
+}
@@ -9,6 +9,7 @@
 #include "config.h"
 #include <gtest/gtest.h>
 #include "packetutils.h"
+#include "internal.h"
 
 class Packet : public ::testing::Test
 {
@@ -207,3 +208,52 @@ TEST_F(Packet, testKeys)
     pi.release(&ior);
     rdb_cleanup(&ior);
 }
+
+TEST_F(Packet, testScatteredValue)
+{
+    // A document larger than a read segment
+    std::string key = "doc";
+    std::string value(100, '*');
+    Pkt pkt;
+    pkt.get(key, value, 1000);
+
+    rdb_IOROPE ior;
+    rdb_init(&ior, rdb_chunkalloc_new(16));
+    pkt.rbWrite(&ior);
+
+    lcb::MemcachedResponse pi;
+    rdb_copyread(&ior, pi.hdrbytes(), pi.hdrsize());
+    rdb_consumed(&ior, pi.hdrsize());
+    ASSERT_TRUE(pi.assign_scattered(&ior));
+    ASSERT_TRUE(pi.is_scattered());
+    ASSERT_LT(1, pi.value_iov().size());
+    ASSERT_EQ(0, memcmp(key.c_str(), pi.key(), pi.keylen()));
+
+    std::string gathered;
+    for (const auto &iov : pi.value_iov()) {
+        gathered.append(static_cast<const char *>(iov.iov_base), iov.iov_len);
+    }
+    ASSERT_EQ(value, gathered);
+
+    pi.release(&ior);
+    ASSERT_EQ(0, rdb_get_nused(&ior));
+    rdb_cleanup(&ior);
+}
+
+TEST_F(Packet, testScatteredValueIsOnlyForPlainGet)
+{
+    lcb::MemcachedResponse get(PROTOCOL_BINARY_CMD_GET, 1000, PROTOCOL_BINARY_RESPONSE_SUCCESS);
+    lcb::MemcachedResponse getq(PROTOCOL_BINARY_CMD_GETQ, 1000, PROTOCOL_BINARY_RESPONSE_SUCCESS);
+
+    mc_PACKET request{};
+    ASSERT_TRUE(lcb::Server::can_scatter_value(&request, get));
+    ASSERT_FALSE(lcb::Server::can_scatter_value(&request, getq));
+
+    // The documents of a view with include_docs are fetched with the cookie as the callback. Their response is kept
+    // after the callback returns, along with a reference to its segment, so the value must be consolidated.
+    request.flags = MCREQ_F_PRIVCALLBACK;
+    ASSERT_FALSE(lcb::Server::can_scatter_value(&request, get));
+
+    request.flags = MCREQ_F_REQEXT;
+    ASSERT_FALSE(lcb::Server::can_scatter_value(&request, get));
+}
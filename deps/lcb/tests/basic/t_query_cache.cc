@@ -0,0 +1,184 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "internal.h"
+#include "n1ql/query_cache.hh"
+#include <gtest/gtest.h>
+
+#include <string>
+
+class QueryCacheTest : public ::testing::Test
+{
+  protected:
+    static Json::Value prepared(const std::string &name)
+    {
+        Json::Value plan;
+        plan["name"] = name;
+        plan["encoded_plan"] = "encoded-" + name;
+        return plan;
+    }
+};
+
+TEST_F(QueryCacheTest, testLeastRecentlyUsedIsEvicted)
+{
+    lcb_QUERY_CACHE cache;
+    cache.capacity(2);
+
+    cache.add_entry("SELECT 1", prepared("p1"));
+    cache.add_entry("SELECT 2", prepared("p2"));
+    ASSERT_NE(nullptr, cache.get_entry("SELECT 1"));
+
+    cache.add_entry("SELECT 3", prepared("p3"));
+    ASSERT_EQ(2U, cache.size());
+    ASSERT_EQ(nullptr, cache.get_entry("SELECT 2"));
+    ASSERT_NE(nullptr, cache.get_entry("SELECT 1"));
+    ASSERT_NE(nullptr, cache.get_entry("SELECT 3"));
+
+    ASSERT_EQ(3U, cache.hits());
+    ASSERT_EQ(1U, cache.misses());
+    ASSERT_EQ(1U, cache.evictions());
+
+    // Replacing an existing entry does not evict anything else
+    cache.add_entry("SELECT 1", prepared("p1"));
+    ASSERT_EQ(2U, cache.size());
+    ASSERT_EQ(1U, cache.evictions());
+}
+
+TEST_F(QueryCacheTest, testShrinkingEvicts)
+{
+    lcb_QUERY_CACHE cache;
+    ASSERT_EQ(lcb_QUERY_CACHE::default_capacity(), cache.capacity());
+
+    for (int ii = 0; ii < 10; ii++) {
+        cache.add_entry("SELECT " + std::to_string(ii), prepared(std::to_string(ii)));
+    }
+    cache.capacity(4);
+    ASSERT_EQ(4U, cache.size());
+    ASSERT_EQ(6U, cache.evictions());
+    ASSERT_NE(nullptr, cache.get_entry("SELECT 9"));
+    ASSERT_EQ(nullptr, cache.get_entry("SELECT 5"));
+}
+
+TEST_F(QueryCacheTest, testPlanIsSplicedIntoBody)
+{
+    lcb_QUERY_CACHE cache;
+    const Plan &plan = cache.add_entry("SELECT $1", prepared("p1"));
+
+    Json::Value body;
+    body["statement"] = "SELECT $1";
+    body["args"].append(42);
+    body["timeout"] = "75s";
+    body["client_context_id"] = "0000000000000001";
+
+    std::string bodystr;
+    plan.apply_plan(body, bodystr);
+
+    Json::Value parsed;
+    ASSERT_TRUE(Json::Reader().parse(bodystr, parsed)) << bodystr;
+    ASSERT_FALSE(parsed.isMember("statement"));
+    ASSERT_EQ("p1", parsed["prepared"].asString());
+    ASSERT_EQ("encoded-p1", parsed["encoded_plan"].asString());
+    ASSERT_EQ(42, parsed["args"][0].asInt());
+    ASSERT_EQ("75s", parsed["timeout"].asString());
+    ASSERT_EQ("0000000000000001", parsed["client_context_id"].asString());
+
+    Json::Value empty;
+    empty["statement"] = "SELECT $1";
+    plan.apply_plan(empty, bodystr);
+    ASSERT_TRUE(Json::Reader().parse(bodystr, parsed)) << bodystr;
+    ASSERT_EQ(2U, parsed.size());
+    ASSERT_EQ("p1", parsed["prepared"].asString());
+}
+
+TEST_F(QueryCacheTest, testOptionsAreReusedAcrossRequests)
+{
+    lcb_QUERY_CACHE cache;
+    cache.add_entry("SELECT $1", prepared("p1"));
+
+    // Every request has its own body, which only differs by context ID
+    std::string bodystr;
+    for (int ii = 0; ii < 10; ii++) {
+        Json::Value body;
+        body["statement"] = "SELECT $1";
+        body["args"].append(42);
+        body["timeout"] = "75000000us";
+        body["client_context_id"] = std::to_string(ii);
+
+        const Plan *plan = cache.get_entry("SELECT $1");
+        ASSERT_NE(nullptr, plan);
+        plan->apply_plan(body, bodystr);
+
+        Json::Value parsed;
+        ASSERT_TRUE(Json::Reader().parse(bodystr, parsed)) << bodystr;
+        ASSERT_EQ(std::to_string(ii), parsed["client_context_id"].asString());
+        ASSERT_EQ(42, parsed["args"][0].asInt());
+        ASSERT_EQ(1U, plan->options_encoded());
+    }
+
+    // Changing the options encodes them again
+    const Plan *plan = cache.get_entry("SELECT $1");
+    Json::Value body;
+    body["statement"] = "SELECT $1";
+    body["args"].append(43);
+    body["timeout"] = "75000000us";
+    plan->apply_plan(body, bodystr);
+    ASSERT_EQ(2U, plan->options_encoded());
+    Json::Value parsed;
+    ASSERT_TRUE(Json::Reader().parse(bodystr, parsed)) << bodystr;
+    ASSERT_EQ(43, parsed["args"][0].asInt());
+    ASSERT_FALSE(parsed.isMember("client_context_id"));
+
+    // As does an extra option
+    body["readonly"] = true;
+    plan->apply_plan(body, bodystr);
+    ASSERT_EQ(3U, plan->options_encoded());
+    ASSERT_TRUE(Json::Reader().parse(bodystr, parsed)) << bodystr;
+    ASSERT_TRUE(parsed["readonly"].asBool());
+
+    // Or a missing one
+    body.removeMember("readonly");
+    plan->apply_plan(body, bodystr);
+    ASSERT_EQ(4U, plan->options_encoded());
+    ASSERT_TRUE(Json::Reader().parse(bodystr, parsed)) << bodystr;
+    ASSERT_FALSE(parsed.isMember("readonly"));
+}
+
+TEST_F(QueryCacheTest, testCntls)
+{
+    lcb_INSTANCE *instance;
+    ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, nullptr));
+
+    lcb_U32 size = 0;
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_QUERY_CACHE_SIZE, &size));
+    ASSERT_EQ(5000U, size);
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "query_cache_size", "20000"));
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_QUERY_CACHE_SIZE, &size));
+    ASSERT_EQ(20000U, size);
+    size = 0;
+    ASSERT_EQ(LCB_ERR_CONTROL_INVALID_ARGUMENT, lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_QUERY_CACHE_SIZE, &size));
+
+    lcb_QUERY_CACHE_STATS stats{};
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_QUERY_CACHE_STATS, &stats));
+    ASSERT_EQ(0U, stats.hits);
+    ASSERT_EQ(0U, stats.size);
+    ASSERT_EQ(20000U, stats.capacity);
+    ASSERT_EQ(LCB_ERR_CONTROL_UNSUPPORTED_MODE,
+              lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_QUERY_CACHE_STATS, &stats));
+
+    lcb_destroy(instance);
+}
@@ -0,0 +1,202 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "internal.h"
+#include <gtest/gtest.h>
+
+#include "capi/cmd_get.hh"
+#include "capi/cmd_query.hh"
+#include "capi/cmd_subdoc.hh"
+
+#include <string>
+
+class RespCloneTest : public ::testing::Test
+{
+};
+
+TEST_F(RespCloneTest, testGetValueIsCopied)
+{
+    std::string value("{\"hello\":\"world\"}");
+    lcb_RESPGET resp{};
+    resp.ctx.rc = LCB_SUCCESS;
+    resp.ctx.key = "doc";
+    resp.ctx.cas = 0xdeadbeef;
+    resp.cookie = &resp;
+    resp.value = value.data();
+    resp.nvalue = value.size();
+    resp.itmflags = 0x02000000;
+
+    lcb_RESPBASE *clone = nullptr;
+    ASSERT_EQ(LCB_SUCCESS, lcb_resp_clone(LCB_CALLBACK_GET, &resp, &clone));
+    ASSERT_NE(nullptr, clone);
+
+    // Clobber the original to ensure nothing is shared with it.
+    std::string expected = value;
+    value.assign(value.size(), 'x');
+    resp.ctx.key = "other";
+
+    const auto *copy = reinterpret_cast<const lcb_RESPGET *>(clone);
+    const char *copyValue = nullptr;
+    size_t ncopyValue = 0;
+    ASSERT_EQ(LCB_SUCCESS, lcb_respget_value(copy, &copyValue, &ncopyValue));
+    ASSERT_EQ(expected, std::string(copyValue, ncopyValue));
+
+    const char *key = nullptr;
+    size_t nkey = 0;
+    ASSERT_EQ(LCB_SUCCESS, lcb_respget_key(copy, &key, &nkey));
+    ASSERT_EQ("doc", std::string(key, nkey));
+
+    void *cookie = nullptr;
+    lcb_respget_cookie(copy, &cookie);
+    ASSERT_EQ(&resp, cookie);
+
+    uint32_t flags = 0;
+    lcb_respget_flags(copy, &flags);
+    ASSERT_EQ(0x02000000U, flags);
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_resp_destroy(LCB_CALLBACK_GET, clone));
+}
+
+TEST_F(RespCloneTest, testScatteredGetValueIsGathered)
+{
+    std::string first("{\"hello\":");
+    std::string second("\"world\"}");
+    lcb_IOV iov[2];
+    iov[0].iov_base = &first[0];
+    iov[0].iov_len = first.size();
+    iov[1].iov_base = &second[0];
+    iov[1].iov_len = second.size();
+
+    lcb_RESPGET resp{};
+    resp.ctx.rc = LCB_SUCCESS;
+    resp.value_iov = iov;
+    resp.nvalue_iov = 2;
+    resp.nvalue = first.size() + second.size();
+
+    const lcb_IOV *valueIov = nullptr;
+    size_t nvalueIov = 0;
+    ASSERT_EQ(LCB_SUCCESS, lcb_respget_value_iov(&resp, &valueIov, &nvalueIov));
+    ASSERT_EQ(iov, valueIov);
+    ASSERT_EQ(2, nvalueIov);
+
+    lcb_RESPBASE *clone = nullptr;
+    ASSERT_EQ(LCB_SUCCESS, lcb_resp_clone(LCB_CALLBACK_GET, &resp, &clone));
+    const auto *copy = reinterpret_cast<const lcb_RESPGET *>(clone);
+    ASSERT_EQ(LCB_ERR_UNSUPPORTED_OPERATION, lcb_respget_value_iov(copy, &valueIov, &nvalueIov));
+
+    const char *value = nullptr;
+    size_t nvalue = 0;
+    ASSERT_EQ(LCB_SUCCESS, lcb_respget_value(copy, &value, &nvalue));
+    ASSERT_EQ(first + second, std::string(value, nvalue));
+    ASSERT_EQ(LCB_SUCCESS, lcb_resp_destroy(LCB_CALLBACK_GET, clone));
+
+    // Reading the value contiguously gathers it into a buffer owned by the response
+    ASSERT_EQ(LCB_SUCCESS, lcb_respget_value(&resp, &value, &nvalue));
+    ASSERT_EQ(first + second, std::string(value, nvalue));
+    ASSERT_EQ(resp.value_buf, value);
+    ASSERT_EQ(LCB_ERR_UNSUPPORTED_OPERATION, lcb_respget_value_iov(&resp, &valueIov, &nvalueIov));
+    delete[] resp.value_buf;
+}
+
+TEST_F(RespCloneTest, testSubdocEntriesAreCopied)
+{
+    std::string first("\"one\"");
+    std::string second("2");
+    lcb_SDENTRY entries[3];
+    entries[0].value = first.data();
+    entries[0].nvalue = first.size();
+    entries[0].status = LCB_SUCCESS;
+    entries[1].value = nullptr;
+    entries[1].nvalue = 0;
+    entries[1].status = LCB_ERR_SUBDOC_PATH_NOT_FOUND;
+    entries[2].value = second.data();
+    entries[2].nvalue = second.size();
+    entries[2].status = LCB_SUCCESS;
+
+    lcb_RESPSUBDOC resp{};
+    resp.ctx.rc = LCB_SUCCESS;
+    resp.res = entries;
+    resp.nres = 3;
+
+    lcb_RESPBASE *clone = nullptr;
+    ASSERT_EQ(LCB_SUCCESS, lcb_resp_clone(LCB_CALLBACK_SDLOOKUP, &resp, &clone));
+    first.assign(first.size(), 'x');
+    second.assign(second.size(), 'x');
+
+    const auto *copy = reinterpret_cast<const lcb_RESPSUBDOC *>(clone);
+    ASSERT_EQ(3U, lcb_respsubdoc_result_size(copy));
+    ASSERT_EQ(LCB_ERR_SUBDOC_PATH_NOT_FOUND, lcb_respsubdoc_result_status(copy, 1));
+
+    const char *value = nullptr;
+    size_t nvalue = 0;
+    lcb_respsubdoc_result_value(copy, 0, &value, &nvalue);
+    ASSERT_EQ("\"one\"", std::string(value, nvalue));
+    lcb_respsubdoc_result_value(copy, 1, &value, &nvalue);
+    ASSERT_EQ(0U, nvalue);
+    lcb_respsubdoc_result_value(copy, 2, &value, &nvalue);
+    ASSERT_EQ("2", std::string(value, nvalue));
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_resp_destroy(LCB_CALLBACK_SDLOOKUP, clone));
+}
+
+TEST_F(RespCloneTest, testQueryRowAndContextAreCopied)
+{
+    std::string row("{\"id\":1}");
+    std::string statement("SELECT 1");
+
+    lcb_RESPQUERY resp{};
+    resp.ctx.rc = LCB_SUCCESS;
+    resp.ctx.statement = statement.c_str();
+    resp.ctx.statement_len = statement.size();
+    resp.row = row.c_str();
+    resp.nrow = row.size();
+    resp.handle = reinterpret_cast<lcb_QUERY_HANDLE *>(&resp);
+
+    lcb_RESPBASE *clone = nullptr;
+    ASSERT_EQ(LCB_SUCCESS, lcb_resp_clone(LCB_CALLBACK_QUERY, &resp, &clone));
+    row.assign(row.size(), 'x');
+    statement.assign(statement.size(), 'x');
+
+    const auto *copy = reinterpret_cast<const lcb_RESPQUERY *>(clone);
+    const char *copyRow = nullptr;
+    size_t ncopyRow = 0;
+    lcb_respquery_row(copy, &copyRow, &ncopyRow);
+    ASSERT_EQ("{\"id\":1}", std::string(copyRow, ncopyRow));
+
+    const lcb_QUERY_ERROR_CONTEXT *ctx = nullptr;
+    lcb_respquery_error_context(copy, &ctx);
+    const char *copyStatement = nullptr;
+    size_t ncopyStatement = 0;
+    lcb_errctx_query_statement(ctx, &copyStatement, &ncopyStatement);
+    ASSERT_EQ("SELECT 1", std::string(copyStatement, ncopyStatement));
+
+    // The request handle does not outlive the original response.
+    lcb_QUERY_HANDLE *handle = nullptr;
+    lcb_respquery_handle(copy, &handle);
+    ASSERT_EQ(nullptr, handle);
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_resp_destroy(LCB_CALLBACK_QUERY, clone));
+}
+
+TEST_F(RespCloneTest, testUnsupportedType)
+{
+    lcb_RESPGET resp{};
+    lcb_RESPBASE *clone = nullptr;
+    ASSERT_EQ(LCB_ERR_UNSUPPORTED_OPERATION, lcb_resp_clone(LCB_CALLBACK_HTTP, &resp, &clone));
+    ASSERT_EQ(nullptr, clone);
+}
@@ -0,0 +1,168 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "internal.h"
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+using lcb::RetryOp;
+using lcb::RetrySchedule;
+
+class RetryScheduleTest : public ::testing::Test
+{
+  protected:
+    RetryOp *addOp(hrtime_t trytime, hrtime_t start, hrtime_t deadline)
+    {
+        ops.emplace_back(new RetryOp(nullptr));
+        RetryOp *op = ops.back().get();
+        op->trytime = trytime;
+        op->start = start;
+        op->deadline = deadline;
+        schedule.insert(op);
+        return op;
+    }
+
+    /** Empties the schedule in retry order, returning the retry times */
+    std::vector<hrtime_t> drainRetries()
+    {
+        std::vector<hrtime_t> times;
+        while (!schedule.empty()) {
+            RetryOp *op = schedule.next_retry();
+            times.push_back(op->trytime);
+            schedule.erase(op);
+        }
+        return times;
+    }
+
+    /** Empties the schedule in timeout order, returning the deadlines */
+    std::vector<hrtime_t> drainTimeouts()
+    {
+        std::vector<hrtime_t> times;
+        while (!schedule.empty()) {
+            RetryOp *op = schedule.next_timeout();
+            times.push_back(op->deadline);
+            schedule.erase(op);
+        }
+        return times;
+    }
+
+    RetrySchedule schedule;
+    std::vector<std::unique_ptr<RetryOp>> ops;
+};
+
+TEST_F(RetryScheduleTest, testRetryOrder)
+{
+    const hrtime_t trytimes[] = {50, 10, 70, 20, 90, 60, 30, 80, 40};
+    for (hrtime_t trytime : trytimes) {
+        addOp(trytime, 0, 1000);
+    }
+    ASSERT_EQ(9U, schedule.size());
+    ASSERT_EQ(std::vector<hrtime_t>({10, 20, 30, 40, 50, 60, 70, 80, 90}), drainRetries());
+    for (const auto &op : ops) {
+        ASSERT_FALSE(RetrySchedule::contains(op.get()));
+    }
+}
+
+TEST_F(RetryScheduleTest, testTimeoutOrder)
+{
+    // The deadlines are not in the same order as the retry times
+    const hrtime_t deadlines[] = {500, 900, 100, 700, 300, 800, 200, 600, 400};
+    hrtime_t trytime = 10;
+    for (hrtime_t deadline : deadlines) {
+        addOp(trytime, 0, deadline);
+        trytime += 10;
+    }
+    ASSERT_EQ(10, schedule.next_retry()->trytime);
+    ASSERT_EQ(std::vector<hrtime_t>({100, 200, 300, 400, 500, 600, 700, 800, 900}), drainTimeouts());
+}
+
+TEST_F(RetryScheduleTest, testRemoveFromMiddle)
+{
+    const hrtime_t trytimes[] = {50, 10, 70, 20, 90, 60, 30, 80, 40};
+    std::vector<RetryOp *> added;
+    for (hrtime_t trytime : trytimes) {
+        added.push_back(addOp(trytime, 0, 1000 - trytime));
+    }
+
+    // Neither the first nor the last of either heap
+    schedule.erase(added[0]);
+    schedule.erase(added[5]);
+    schedule.erase(added[6]);
+    ASSERT_FALSE(RetrySchedule::contains(added[0]));
+    ASSERT_TRUE(RetrySchedule::contains(added[1]));
+    ASSERT_EQ(6U, schedule.size());
+
+    // The removed operations may be queued again
+    added[5]->trytime = 5;
+    schedule.insert(added[5]);
+    ASSERT_EQ(added[5], schedule.next_retry());
+    ASSERT_EQ(std::vector<hrtime_t>({5, 10, 20, 40, 70, 80, 90}), drainRetries());
+
+    for (size_t ii = 0; ii < added.size(); ii++) {
+        if (ii != 0 && ii != 6) {
+            schedule.insert(added[ii]);
+        }
+    }
+    schedule.erase(added[3]);
+    ASSERT_EQ(std::vector<hrtime_t>({910, 920, 930, 940, 960, 990}), drainTimeouts());
+}
+
+TEST_F(RetryScheduleTest, testResetTimeouts)
+{
+    // A long timeout which started early, and a short one which started late
+    RetryOp *early = addOp(10, 0, 1000);
+    RetryOp *late = addOp(20, 800, 1100);
+    RetryOp *other = addOp(30, 500, 1200);
+    ASSERT_EQ(early, schedule.next_timeout());
+
+    schedule.reset_timeouts(2000);
+    ASSERT_EQ(2000, early->start);
+    ASSERT_EQ(3000, early->deadline);
+    ASSERT_EQ(2000, late->start);
+    ASSERT_EQ(2300, late->deadline);
+    ASSERT_EQ(2000, other->start);
+    ASSERT_EQ(2700, other->deadline);
+
+    // The timeout order follows the new deadlines, the retry order is unchanged
+    ASSERT_EQ(late, schedule.next_timeout());
+    ASSERT_EQ(early, schedule.next_retry());
+    ASSERT_EQ(std::vector<hrtime_t>({2300, 2700, 3000}), drainTimeouts());
+}
+
+TEST_F(RetryScheduleTest, testJitterBounds)
+{
+    const hrtime_t interval = 1000000;
+    const float jitters[] = {0.1f, 0.5f, 1.0f};
+    for (float jitter : jitters) {
+        auto lower = (hrtime_t)((double)interval * (1 - jitter));
+        bool shortened = false;
+        for (int ii = 0; ii < 1000; ii++) {
+            hrtime_t jittered = lcb::RetryQueue::apply_jitter(interval, jitter);
+            ASSERT_GE(jittered, lower);
+            ASSERT_LE(jittered, interval);
+            shortened = shortened || jittered < interval;
+        }
+        ASSERT_TRUE(shortened);
+    }
+
+    // Without jitter, or without an interval, nothing changes
+    ASSERT_EQ(interval, lcb::RetryQueue::apply_jitter(interval, 0));
+    ASSERT_EQ(0, lcb::RetryQueue::apply_jitter(0, 0.5f));
+}
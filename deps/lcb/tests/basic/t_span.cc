@@ -0,0 +1,182 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "internal.h"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+class SpanTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, nullptr));
+        tracer = lcb_get_tracer(instance);
+        ASSERT_NE(nullptr, tracer);
+    }
+
+    void TearDown() override
+    {
+        lcb_destroy(instance);
+    }
+
+    static std::string tag(lcbtrace_SPAN *span, const char *name)
+    {
+        char *value = nullptr;
+        size_t nvalue = 0;
+        if (lcbtrace_span_get_tag_str(span, name, &value, &nvalue) != LCB_SUCCESS) {
+            return "<missing>";
+        }
+        return std::string(value, nvalue);
+    }
+
+    lcb_INSTANCE *instance{nullptr};
+    lcbtrace_TRACER *tracer{nullptr};
+};
+
+TEST_F(SpanTest, testOperationNameIsInterned)
+{
+    std::string name1("custom_operation");
+    std::string name2("custom_operation");
+    lcbtrace_SPAN *span1 = lcbtrace_span_start(tracer, name1.c_str(), 0, nullptr);
+    lcbtrace_SPAN *span2 = lcbtrace_span_start(tracer, name2.c_str(), 0, nullptr);
+
+    name1.assign("overwritten");
+    ASSERT_STREQ("custom_operation", lcbtrace_span_get_operation(span1));
+    ASSERT_EQ(lcbtrace_span_get_operation(span1), lcbtrace_span_get_operation(span2));
+
+    lcbtrace_span_finish(span1, LCBTRACE_NOW);
+    lcbtrace_span_finish(span2, LCBTRACE_NOW);
+}
+
+TEST_F(SpanTest, testFixedTags)
+{
+    lcbtrace_SPAN *span = lcbtrace_span_start(tracer, LCBTRACE_OP_GET, 0, nullptr);
+    lcbtrace_span_add_system_tags(span, instance->settings, LCBTRACE_THRESHOLD_KV);
+
+    ASSERT_EQ("couchbase", tag(span, LCBTRACE_TAG_SYSTEM));
+    ASSERT_EQ("client", tag(span, LCBTRACE_TAG_SPAN_KIND));
+    ASSERT_EQ(0U, tag(span, LCBTRACE_TAG_COMPONENT).find(LCB_CLIENT_ID));
+
+    // copied values must not refer to the caller's buffer
+    std::string address("10.0.0.1");
+    lcbtrace_span_add_tag_str(span, LCBTRACE_TAG_PEER_ADDRESS, address.c_str());
+    address.assign("garbage!");
+    ASSERT_EQ("10.0.0.1", tag(span, LCBTRACE_TAG_PEER_ADDRESS));
+    ASSERT_EQ("<missing>", tag(span, LCBTRACE_TAG_PEER_PORT));
+
+    // names are matched by value as well
+    std::string name(LCBTRACE_TAG_PEER_PORT);
+    lcbtrace_span_add_tag_str(span, name.c_str(), "11210");
+    ASSERT_EQ("11210", tag(span, LCBTRACE_TAG_PEER_PORT));
+
+    uint64_t u64;
+    ASSERT_EQ(LCB_ERR_INVALID_ARGUMENT, lcbtrace_span_get_tag_uint64(span, LCBTRACE_TAG_PEER_PORT, &u64));
+    ASSERT_EQ(LCB_ERR_DOCUMENT_NOT_FOUND, lcbtrace_span_get_tag_uint64(span, LCBTRACE_TAG_RETRIES, &u64));
+
+    // other tags still live in the list
+    lcbtrace_span_add_tag_str(span, LCBTRACE_TAG_OPERATION_ID, "0x2a");
+    lcbtrace_span_add_tag_uint64(span, LCBTRACE_TAG_RETRIES, 3);
+    ASSERT_EQ("0x2a", tag(span, LCBTRACE_TAG_OPERATION_ID));
+    ASSERT_EQ(LCB_SUCCESS, lcbtrace_span_get_tag_uint64(span, LCBTRACE_TAG_RETRIES, &u64));
+    ASSERT_EQ(3U, u64);
+
+    lcbtrace_span_finish(span, LCBTRACE_NOW);
+}
+
+TEST_F(SpanTest, testFinishedSpansAreReused)
+{
+    lcbtrace_SPAN *span1 = lcbtrace_span_start(tracer, LCBTRACE_OP_GET, 0, nullptr);
+    lcbtrace_span_add_tag_str(span1, LCBTRACE_TAG_OPERATION_ID, "0x2a");
+    lcbtrace_span_add_tag_str(span1, LCBTRACE_TAG_PEER_ADDRESS, "10.0.0.1");
+    lcbtrace_span_finish(span1, LCBTRACE_NOW);
+
+    // the most recently finished span is handed out first
+    lcbtrace_SPAN *span2 = lcbtrace_span_start(tracer, LCBTRACE_OP_UPSERT, 0, nullptr);
+    ASSERT_EQ(span1, span2);
+
+    // and nothing of its previous use is left
+    ASSERT_STREQ(LCBTRACE_OP_UPSERT, lcbtrace_span_get_operation(span2));
+    ASSERT_EQ("<missing>", tag(span2, LCBTRACE_TAG_OPERATION_ID));
+    ASSERT_EQ("<missing>", tag(span2, LCBTRACE_TAG_PEER_ADDRESS));
+
+    lcbtrace_SPAN *span3 = lcbtrace_span_start(tracer, LCBTRACE_OP_GET, 0, nullptr);
+    ASSERT_NE(span2, span3);
+    lcbtrace_span_finish(span3, LCBTRACE_NOW);
+    lcbtrace_span_finish(span2, LCBTRACE_NOW);
+}
+
+TEST_F(SpanTest, testInternedStringsAreStable)
+{
+    std::string value("interned_value");
+    const char *interned = lcb::trace::intern_string(value.c_str(), value.size());
+    ASSERT_NE(value.c_str(), interned);
+    ASSERT_STREQ("interned_value", interned);
+
+    // interning many more strings neither moves nor changes the copy
+    for (int ii = 0; ii < 10000; ii++) {
+        std::string other = "other_" + std::to_string(ii);
+        lcb::trace::intern_string(other.c_str(), other.size());
+    }
+    std::string copy("interned_value");
+    ASSERT_EQ(interned, lcb::trace::intern_string(copy.c_str(), copy.size()));
+    ASSERT_STREQ("interned_value", interned);
+
+    // a reused buffer with different contents is not mistaken for the old string
+    value.assign("different_value");
+    const char *changed = lcb::trace::intern_string(value.c_str(), value.size());
+    ASSERT_STREQ("different_value", changed);
+    ASSERT_EQ(interned, lcb::trace::intern_string(copy.c_str(), copy.size()));
+}
+
+/**
+ * Measures the tracing overhead of a single KV operation with the default
+ * threshold logging tracer: an outer span with the tags added by
+ * LCBTRACE_KV_START and LCBTRACE_KV_FINISH.
+ *
+ * This is a benchmark rather than a test, run it with
+ * --gtest_also_run_disabled_tests.
+ */
+TEST_F(SpanTest, DISABLED_benchKvSpanLifecycle)
+{
+    const int iterations = 200000;
+    const char *host = "127.0.0.1";
+    const char *port = "11210";
+
+    auto start = std::chrono::steady_clock::now();
+    for (int ii = 0; ii < iterations; ii++) {
+        lcbtrace_SPAN *span = lcbtrace_span_start(tracer, LCBTRACE_OP_GET, LCBTRACE_NOW, nullptr);
+        span->is_outer(true);
+        span->is_dispatch(true);
+        lcbtrace_span_add_tag_str(span, LCBTRACE_TAG_OPERATION_ID, "0x2a");
+        lcbtrace_span_add_system_tags(span, instance->settings, LCBTRACE_THRESHOLD_KV);
+        span->increment_server(10);
+        lcbtrace_span_add_tag_str_nocopy(span, LCBTRACE_TAG_TRANSPORT, "IP.TCP");
+        lcbtrace_span_add_tag_str_nocopy(span, LCBTRACE_TAG_LOCAL_ADDRESS, host);
+        lcbtrace_span_add_tag_str_nocopy(span, LCBTRACE_TAG_LOCAL_PORT, port);
+        lcbtrace_span_add_tag_str_nocopy(span, LCBTRACE_TAG_PEER_ADDRESS, host);
+        lcbtrace_span_add_tag_str_nocopy(span, LCBTRACE_TAG_PEER_PORT, port);
+        lcbtrace_span_finish(span, LCBTRACE_NOW);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double nsPerOp = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    printf("%8.1f ns/span\n", nsPerOp);
+}
@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "internal.h"
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using lcb::trace::ReportedSpan;
+using lcb::trace::SpanQueue;
+
+class SpanQueueTest : public ::testing::Test
+{
+  protected:
+    static std::vector<uint64_t> drain(SpanQueue &queue)
+    {
+        std::vector<uint64_t> durations;
+        queue.drain([&durations](const ReportedSpan &span) { durations.push_back(span.duration); });
+        return durations;
+    }
+};
+
+TEST_F(SpanQueueTest, testKeepsSlowest)
+{
+    SpanQueue queue(3);
+    const uint64_t durations[] = {50, 10, 70, 20, 90, 60, 30};
+    const char *names[] = {"op50", "op10", "op70", "op20", "op90", "op60", "op30"};
+    for (size_t ii = 0; ii < 7; ii++) {
+        ReportedSpan *entry = queue.reserve(durations[ii]);
+        if (entry) {
+            entry->operation_name = names[ii];
+        }
+    }
+    ASSERT_EQ(3U, queue.size());
+
+    std::vector<std::string> kept;
+    queue.drain([&kept](const ReportedSpan &span) { kept.emplace_back(span.operation_name); });
+    ASSERT_EQ(std::vector<std::string>({"op90", "op70", "op60"}), kept);
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST_F(SpanQueueTest, testRejectsFasterWhenFull)
+{
+    SpanQueue queue(2);
+    ASSERT_NE(nullptr, queue.reserve(100));
+    ASSERT_NE(nullptr, queue.reserve(200));
+    ASSERT_EQ(nullptr, queue.reserve(100));
+    ASSERT_EQ(nullptr, queue.reserve(50));
+    ASSERT_NE(nullptr, queue.reserve(150));
+    ASSERT_EQ(std::vector<uint64_t>({200, 150}), drain(queue));
+
+    // the queue is usable again once drained
+    ASSERT_NE(nullptr, queue.reserve(1));
+    ASSERT_EQ(std::vector<uint64_t>({1}), drain(queue));
+}
+
+TEST_F(SpanQueueTest, testZeroCapacity)
+{
+    SpanQueue queue(0);
+    ASSERT_EQ(nullptr, queue.reserve(100));
+    ASSERT_TRUE(queue.empty());
+}
@@ -16,6 +16,7 @@
  */
 #include "config.h"
 #include "iotests.h"
+#include <libcouchbase/pktfwd.h>
 
 class MutateUnitTest : public MockUnitTest
 {
@@ -1039,3 +1040,57 @@ TEST_F(MutateUnitTest, testMutateInPreservesExpiry)
         ASSERT_EQ(0, res.expiry);
     }
 }
+
+struct NoCopyStoreCookie {
+    int stored{0};
+    int released{0};
+};
+
+extern "C" {
+static void testStoreNoCopyCallback(lcb_INSTANCE *, int, const lcb_RESPSTORE *resp)
+{
+    NoCopyStoreCookie *cookie;
+    lcb_respstore_cookie(resp, (void **)&cookie);
+    EXPECT_EQ(LCB_SUCCESS, lcb_respstore_status(resp));
+    ++cookie->stored;
+}
+
+static void testStoreNoCopyFlushedCallback(lcb_INSTANCE *, const void *cookie)
+{
+    ++static_cast<NoCopyStoreCookie *>(const_cast<void *>(cookie))->released;
+}
+}
+
+/**
+ * @test Store a value without copying it
+ * @pre store a value lent with lcb_cmdstore_value_nocopy
+ * @post the value is stored, and the buffer is released exactly once
+ */
+TEST_F(MutateUnitTest, testStoreValueNoCopy)
+{
+    lcb_INSTANCE *instance;
+    HandleWrap hw;
+    createConnection(hw, &instance);
+
+    (void)lcb_install_callback(instance, LCB_CALLBACK_STORE, (lcb_RESPCALLBACK)testStoreNoCopyCallback);
+    lcb_set_pktflushed_callback(instance, testStoreNoCopyFlushedCallback);
+
+    std::string key("testStoreValueNoCopy");
+    std::string value(64 * 1024, 'x');
+
+    NoCopyStoreCookie cookie;
+    lcb_CMDSTORE *cmd;
+    lcb_cmdstore_create(&cmd, LCB_STORE_UPSERT);
+    lcb_cmdstore_key(cmd, key.c_str(), key.size());
+    lcb_cmdstore_value_nocopy(cmd, value.c_str(), value.size());
+    EXPECT_EQ(LCB_SUCCESS, lcb_store(instance, &cookie, cmd));
+    lcb_cmdstore_destroy(cmd);
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+
+    ASSERT_EQ(1, cookie.stored);
+    ASSERT_EQ(1, cookie.released);
+
+    Item itm;
+    getKey(instance, key, itm);
+    ASSERT_EQ(value, itm.val);
+}
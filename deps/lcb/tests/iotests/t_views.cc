@@ -115,6 +115,7 @@ struct ViewRow {
     string key;
     string value;
     string docid;
+    string docValue;
 
     struct {
         lcb_STATUS rc;
@@ -152,6 +153,9 @@ struct ViewRow {
                 lcb_respget_cas(rg, &docContents.cas);
                 lcb_respget_key(rg, &docContents.key, &docContents.nkey);
                 lcb_respget_value(rg, &docContents.value, &docContents.nvalue);
+                if (docContents.value != nullptr) {
+                    docValue.assign(docContents.value, docContents.nvalue);
+                }
 
                 string tmpId(docContents.key, docContents.nkey);
                 EXPECT_EQ(tmpId, docid);
@@ -548,4 +552,43 @@ TEST_F(ViewsUnitTest, testBackslashDocid)
     ASSERT_EQ(0, vi.rows.size());
     lcb_cmdview_destroy(cmd);
 }
+
+TEST_F(ViewsUnitTest, testIncludeDocsLargeDocument)
+{
+    SKIP_UNLESS_MOCK();
+    HandleWrap hw;
+    lcb_INSTANCE *instance;
+    lcb_STATUS rc;
+    connectBeerSample(hw, &instance);
+
+    // The document spans several read buffers, and is kept until its row is delivered
+    string key("large_brewery");
+    string doc(R"({"type":"brewery", "name":"Large Brewery", "description":")");
+    doc.append(1024 * 1024, 'x');
+    doc.append("\"}");
+    storeKey(instance, key, doc);
+
+    const char *ddoc = "beer", *view = "brewery_beers";
+    const char *optstr = R"(stale=false&key=["large_brewery"])";
+
+    ViewInfo vi;
+    lcb_CMDVIEW *cmd;
+
+    lcb_cmdview_create(&cmd);
+    lcb_cmdview_callback(cmd, viewCallback);
+    lcb_cmdview_design_document(cmd, ddoc, strlen(ddoc));
+    lcb_cmdview_view_name(cmd, view, strlen(view));
+    lcb_cmdview_option_string(cmd, optstr, strlen(optstr));
+    lcb_cmdview_include_docs(cmd, true);
+    rc = lcb_view(instance, &vi, cmd);
+    lcb_cmdview_destroy(cmd);
+    ASSERT_STATUS_EQ(LCB_SUCCESS, rc);
+    lcb_wait(instance, LCB_WAIT_DEFAULT);
+    ASSERT_STATUS_EQ(LCB_SUCCESS, vi.err);
+    ASSERT_EQ(1, vi.rows.size());
+    ASSERT_STATUS_EQ(LCB_SUCCESS, vi.rows[0].docContents.rc);
+    ASSERT_EQ(doc, vi.rows[0].docValue);
+
+    removeKey(instance, key);
+}
 } // namespace
@@ -0,0 +1,169 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2011-2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "mctest.h"
+#include "mc/mcreq-flush-inl.h"
+#include <libcouchbase/couchbase.h>
+
+class McBudget : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, nullptr));
+        cq.cqdata = instance;
+    }
+
+    void TearDown() override
+    {
+        cq.cqdata = nullptr;
+        lcb_destroy(instance);
+    }
+
+    lcb_STATUS schedule(const char *key, mc_PIPELINE **pipeline = nullptr)
+    {
+        PacketWrap pw;
+        pw.setCopyKey(key);
+        lcb_STATUS rc =
+            mcreq_basic_packet(&cq, &pw.keybuf, 0, &pw.hdr, 0, 0, &pw.pkt, &pw.pipeline, 0);
+        if (pipeline) {
+            *pipeline = pw.pipeline;
+        }
+        if (rc != LCB_SUCCESS) {
+            return rc;
+        }
+        pw.setHeaderSize();
+        pw.copyHeader();
+        mcreq_sched_add(pw.pipeline, pw.pkt);
+        return rc;
+    }
+
+    lcb_INSTANCE *instance{nullptr};
+    CQWrap cq;
+};
+
+TEST_F(McBudget, testChargedUntilWiped)
+{
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "kv_max_requests", "3"));
+
+    mcreq_sched_enter(&cq);
+    for (int ii = 0; ii < 3; ii++) {
+        char kbuf[32];
+        sprintf(kbuf, "key_%d", ii);
+        ASSERT_EQ(LCB_SUCCESS, schedule(kbuf));
+    }
+    ASSERT_EQ(LCB_ERR_REQUEST_BUDGET_EXCEEDED, schedule("key_3"));
+    ASSERT_EQ(3U, cq.budget_npackets);
+    ASSERT_EQ(1U, cq.budget_nrejected);
+
+    lcb_SIZE nbytes = 0, npackets = 0;
+    for (unsigned ii = 0; ii < cq.npipelines; ii++) {
+        nbytes += cq.pipelines[ii]->budget_nbytes;
+        npackets += cq.pipelines[ii]->budget_npackets;
+    }
+    ASSERT_EQ(cq.budget_nbytes, nbytes);
+    ASSERT_EQ(3U, npackets);
+    ASSERT_GE(nbytes, 3U * 24U);
+
+    lcb_KV_BUDGET_STATS stats{};
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KV_BUDGET_STATS, &stats));
+    ASSERT_EQ(0U, stats.nrequests); // the instance's own queue is untouched
+
+    // Packets stay charged while they wait for a response
+    mcreq_sched_leave(&cq, 0);
+    ASSERT_EQ(3U, cq.budget_npackets);
+
+    cq.clearPipelines();
+    for (unsigned ii = 0; ii < cq.npipelines; ii++) {
+        nb_IOV iov[64];
+        unsigned nb;
+        while ((nb = mcreq_flush_iov_fill(cq.pipelines[ii], iov, 64, nullptr))) {
+            mcreq_flush_done(cq.pipelines[ii], nb, nb);
+        }
+    }
+    ASSERT_EQ(0U, cq.budget_npackets);
+    ASSERT_EQ(0U, cq.budget_nbytes);
+    for (unsigned ii = 0; ii < cq.npipelines; ii++) {
+        ASSERT_EQ(0U, cq.pipelines[ii]->budget_npackets);
+        ASSERT_EQ(0U, cq.pipelines[ii]->budget_nbytes);
+    }
+
+    // Failing a scheduling context releases the budget as well
+    mcreq_sched_enter(&cq);
+    ASSERT_EQ(LCB_SUCCESS, schedule("key_3"));
+    ASSERT_EQ(1U, cq.budget_npackets);
+    mcreq_sched_fail(&cq);
+    ASSERT_EQ(0U, cq.budget_npackets);
+    ASSERT_EQ(0U, cq.budget_nbytes);
+}
+
+TEST_F(McBudget, testPipelineLimit)
+{
+    lcb_SIZE limit = 1;
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_KV_PIPELINE_MAX_REQUESTS, &limit));
+
+    mcreq_sched_enter(&cq);
+    mc_PIPELINE *full = nullptr;
+    ASSERT_EQ(LCB_SUCCESS, schedule("key_0", &full));
+
+    unsigned nrejected = 0, naccepted = 0;
+    for (int ii = 1; ii < 64; ii++) {
+        char kbuf[32];
+        sprintf(kbuf, "key_%d", ii);
+        mc_PIPELINE *pipeline = nullptr;
+        lcb_STATUS rc = schedule(kbuf, &pipeline);
+        if (pipeline == full) {
+            ASSERT_EQ(LCB_ERR_REQUEST_BUDGET_EXCEEDED, rc);
+            nrejected++;
+        } else if (rc == LCB_SUCCESS) {
+            naccepted++;
+        } else {
+            // other pipelines fill up after their first packet
+            ASSERT_EQ(LCB_ERR_REQUEST_BUDGET_EXCEEDED, rc);
+            ASSERT_EQ(1U, pipeline->budget_npackets);
+        }
+    }
+    ASSERT_NE(0U, nrejected);
+    ASSERT_EQ(cq.npipelines - 1, naccepted);
+    ASSERT_EQ(63U - naccepted, cq.budget_nrejected);
+
+    mcreq_sched_fail(&cq);
+    ASSERT_EQ(0U, cq.budget_npackets);
+}
+
+TEST_F(McBudget, testCheckBeforeAllocating)
+{
+    ASSERT_EQ(LCB_SUCCESS, lcb_cntl_string(instance, "kv_max_requests", "1"));
+
+    // Nothing is charged by checking, so every pipeline may take a packet
+    for (unsigned ii = 0; ii < cq.npipelines; ii++) {
+        ASSERT_EQ(LCB_SUCCESS, mcreq_check_budget(&cq, cq.pipelines[ii]));
+    }
+    ASSERT_EQ(0U, cq.budget_npackets);
+    ASSERT_EQ(0U, cq.budget_nrejected);
+
+    mcreq_sched_enter(&cq);
+    ASSERT_EQ(LCB_SUCCESS, schedule("key_0"));
+    for (unsigned ii = 0; ii < cq.npipelines; ii++) {
+        ASSERT_EQ(LCB_ERR_REQUEST_BUDGET_EXCEEDED, mcreq_check_budget(&cq, cq.pipelines[ii]));
+    }
+    ASSERT_EQ(1U, cq.budget_npackets);
+    ASSERT_EQ(cq.npipelines, cq.budget_nrejected);
+
+    mcreq_sched_fail(&cq);
+    ASSERT_EQ(LCB_SUCCESS, mcreq_check_budget(&cq, cq.pipelines[0]));
+}
@@ -0,0 +1,168 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "mctest.h"
+#include "mc/compress.h"
+#include "settings.h"
+
+#include <string>
+
+class McCompress : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        settings = lcb_settings_new();
+    }
+
+    void TearDown() override
+    {
+        lcb_settings_unref(settings);
+    }
+
+    lcb_settings *settings{nullptr};
+};
+
+TEST_F(McCompress, testScratchBuffersAreReused)
+{
+    mc_SCRATCHPOOL *pool = mcreq_scratch_new();
+
+    void *first = mcreq_scratch_alloc(pool, 5000);
+    ASSERT_NE(nullptr, first);
+    mcreq_scratch_release(pool, first);
+
+    // Any size within the same class gets the same buffer back
+    void *second = mcreq_scratch_alloc(pool, 8192);
+    ASSERT_EQ(first, second);
+
+    // While it is in use, another one is allocated
+    void *third = mcreq_scratch_alloc(pool, 6000);
+    ASSERT_NE(second, third);
+    mcreq_scratch_release(pool, second);
+    mcreq_scratch_release(pool, third);
+
+    // Buffers larger than the biggest class are not kept
+    void *large = mcreq_scratch_alloc(pool, 4 * 1024 * 1024);
+    ASSERT_NE(nullptr, large);
+    memset(large, 0xff, 4 * 1024 * 1024);
+    mcreq_scratch_release(pool, large);
+
+    // Neither is anything allocated without a pool
+    void *unpooled = mcreq_scratch_alloc(nullptr, 100);
+    ASSERT_NE(nullptr, unpooled);
+    mcreq_scratch_release(nullptr, unpooled);
+
+    mcreq_scratch_free(pool);
+}
+
+TEST_F(McCompress, testCompressAndInflate)
+{
+    CQWrap cq;
+    mc_PIPELINE *pipeline = cq.pipelines[0];
+    std::string value;
+    for (int ii = 0; ii < 1000; ii++) {
+        value.append("{\"name\":\"compressible\",\"index\":").append(std::to_string(ii)).append("},");
+    }
+
+    mc_PACKET *packet = mcreq_allocate_packet(pipeline);
+    mcreq_reserve_header(pipeline, packet, 24);
+    lcb_VALBUF vbuf{LCB_KV_COPY, {{value.data(), value.size()}}};
+    int should_compress = 1;
+    ASSERT_EQ(0, mcreq_compress_value(pipeline, packet, &vbuf, settings, &should_compress));
+    ASSERT_EQ(1, should_compress);
+    ASSERT_LT(packet->u_value.single.size, value.size());
+    /* the value is compressed in place, without going through the scratch buffers */
+    ASSERT_EQ(nullptr, cq.scratch);
+
+    const void *inflated = nullptr;
+    size_t ninflated = 0;
+    void *freeptr = nullptr;
+    mc_SCRATCHPOOL *pool = mcreq_queue_scratch(&cq);
+    ASSERT_EQ(0, mcreq_inflate_value2(pool, SPAN_BUFFER(&packet->u_value.single), packet->u_value.single.size,
+                                      &inflated, &ninflated, &freeptr));
+    ASSERT_EQ(value, std::string(static_cast<const char *>(inflated), ninflated));
+    mcreq_scratch_release(pool, freeptr);
+
+    mcreq_wipe_packet(pipeline, packet);
+    mcreq_release_packet(pipeline, packet);
+}
+
+TEST_F(McCompress, testCompressFragments)
+{
+    CQWrap cq;
+    mc_PIPELINE *pipeline = cq.pipelines[0];
+    std::string value;
+    for (int ii = 0; ii < 1000; ii++) {
+        value.append("{\"name\":\"fragmented\",\"index\":").append(std::to_string(ii)).append("},");
+    }
+
+    lcb_IOV iov[3];
+    size_t third = value.size() / 3;
+    iov[0].iov_base = &value[0];
+    iov[0].iov_len = third;
+    iov[1].iov_base = &value[third];
+    iov[1].iov_len = third;
+    iov[2].iov_base = &value[2 * third];
+    iov[2].iov_len = value.size() - 2 * third;
+
+    mc_PACKET *packet = mcreq_allocate_packet(pipeline);
+    mcreq_reserve_header(pipeline, packet, 24);
+    lcb_VALBUF vbuf{};
+    vbuf.vtype = LCB_KV_IOVCOPY;
+    vbuf.u_buf.multi.iov = iov;
+    vbuf.u_buf.multi.niov = 3;
+    vbuf.u_buf.multi.total_length = value.size();
+    int should_compress = 1;
+    ASSERT_EQ(0, mcreq_compress_value(pipeline, packet, &vbuf, settings, &should_compress));
+    ASSERT_EQ(1, should_compress);
+    ASSERT_LT(packet->u_value.single.size, value.size());
+
+    const void *inflated = nullptr;
+    size_t ninflated = 0;
+    void *freeptr = nullptr;
+    ASSERT_EQ(0, mcreq_inflate_value(SPAN_BUFFER(&packet->u_value.single), packet->u_value.single.size, &inflated,
+                                     &ninflated, &freeptr));
+    ASSERT_EQ(value, std::string(static_cast<const char *>(inflated), ninflated));
+    free(freeptr);
+
+    mcreq_wipe_packet(pipeline, packet);
+    mcreq_release_packet(pipeline, packet);
+}
+
+TEST_F(McCompress, testIncompressibleValueIsCopied)
+{
+    CQWrap cq;
+    mc_PIPELINE *pipeline = cq.pipelines[0];
+    std::string value;
+    uint32_t state = 0x12345678;
+    for (int ii = 0; ii < 8192; ii++) {
+        state = state * 1103515245 + 12345;
+        value.push_back(static_cast<char>(state >> 24));
+    }
+
+    mc_PACKET *packet = mcreq_allocate_packet(pipeline);
+    mcreq_reserve_header(pipeline, packet, 24);
+    lcb_VALBUF vbuf{LCB_KV_COPY, {{value.data(), value.size()}}};
+    int should_compress = 1;
+    ASSERT_EQ(0, mcreq_compress_value(pipeline, packet, &vbuf, settings, &should_compress));
+    ASSERT_EQ(0, should_compress);
+    ASSERT_EQ(value.size(), packet->u_value.single.size);
+    ASSERT_EQ(0, memcmp(value.data(), SPAN_BUFFER(&packet->u_value.single), value.size()));
+
+    mcreq_wipe_packet(pipeline, packet);
+    mcreq_release_packet(pipeline, packet);
+}
@@ -0,0 +1,185 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "mctest.h"
+#include "mc/mcreq-flush-inl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+class McPipelineFind : public ::testing::Test
+{
+};
+
+static mc_PACKET *enqueuePacket(mc_PIPELINE *pl)
+{
+    mc_PACKET *pkt = mcreq_allocate_packet(pl);
+    EXPECT_EQ(LCB_SUCCESS, mcreq_reserve_header(pl, pkt, MCREQ_PKT_BASESIZE));
+    memset(SPAN_BUFFER(&pkt->kh_span), 0, MCREQ_PKT_BASESIZE);
+    mcreq_enqueue_packet(pl, pkt);
+    return pkt;
+}
+
+static void flushPipeline(mc_PIPELINE *pl)
+{
+    nb_IOV iov[64];
+    unsigned nb;
+    while ((nb = mcreq_flush_iov_fill(pl, iov, 64, nullptr))) {
+        mcreq_flush_done(pl, nb, nb);
+    }
+}
+
+extern "C" {
+static void failcb(mc_PIPELINE *, mc_PACKET *, lcb_STATUS, void *arg)
+{
+    (*reinterpret_cast<unsigned *>(arg))++;
+}
+}
+
+TEST_F(McPipelineFind, testOutOfOrderRemoval)
+{
+    CQWrap cq;
+    mc_PIPELINE *pl = cq.pipelines[0];
+
+    std::vector<mc_PACKET *> pkts;
+    for (int ii = 0; ii < 1000; ii++) {
+        pkts.push_back(enqueuePacket(pl));
+    }
+    flushPipeline(pl);
+
+    std::vector<mc_PACKET *> older(pkts.begin(), pkts.begin() + 500);
+    std::vector<mc_PACKET *> newer(pkts.begin() + 500, pkts.end());
+
+    // Responses for the newer half arrive in an arbitrary order
+    std::vector<mc_PACKET *> arrivals(newer);
+    std::mt19937 rng(42);
+    std::shuffle(arrivals.begin(), arrivals.end(), rng);
+    for (mc_PACKET *pkt : arrivals) {
+        uint32_t opaque = pkt->opaque;
+        ASSERT_EQ(pkt, mcreq_pipeline_find(pl, opaque));
+        ASSERT_EQ(pkt, mcreq_pipeline_remove(pl, opaque));
+        ASSERT_EQ(nullptr, mcreq_pipeline_find(pl, opaque));
+    }
+
+    std::vector<uint32_t> remaining;
+    for (mc_PACKET *pkt : older) {
+        ASSERT_EQ(pkt, mcreq_pipeline_find(pl, pkt->opaque));
+        remaining.push_back(pkt->opaque);
+    }
+
+    // The older half is failed, which must also drop them from the index
+    unsigned nfailed = 0;
+    ASSERT_EQ(older.size(), mcreq_pipeline_fail(pl, LCB_ERR_GENERIC, failcb, &nfailed));
+    ASSERT_EQ(older.size(), nfailed);
+    ASSERT_TRUE(SLLIST_IS_EMPTY(&pl->requests));
+    for (uint32_t opaque : remaining) {
+        ASSERT_EQ(nullptr, mcreq_pipeline_find(pl, opaque));
+    }
+
+    // Release the buffers in the order they were allocated
+    for (mc_PACKET *pkt : newer) {
+        mcreq_packet_handled(pl, pkt);
+    }
+}
+
+TEST_F(McPipelineFind, testRemoveLastKeepsListConsistent)
+{
+    CQWrap cq;
+    mc_PIPELINE *pl = cq.pipelines[0];
+
+    mc_PACKET *first = enqueuePacket(pl);
+    mc_PACKET *second = enqueuePacket(pl);
+    flushPipeline(pl);
+
+    ASSERT_EQ(second, mcreq_pipeline_remove(pl, second->opaque));
+    mcreq_packet_handled(pl, second);
+
+    // Appending after removing the tail must link from the new tail
+    mc_PACKET *third = enqueuePacket(pl);
+    flushPipeline(pl);
+    ASSERT_EQ(first, mcreq_first_packet(pl));
+    ASSERT_EQ(&third->slnode, first->slnode.next);
+
+    ASSERT_EQ(first, mcreq_pipeline_remove(pl, first->opaque));
+    mcreq_packet_handled(pl, first);
+    ASSERT_EQ(third, mcreq_first_packet(pl));
+    ASSERT_EQ(third, mcreq_pipeline_remove(pl, third->opaque));
+    mcreq_packet_handled(pl, third);
+    ASSERT_TRUE(SLLIST_IS_EMPTY(&pl->requests));
+}
+
+TEST_F(McPipelineFind, testRemoveNewestFirst)
+{
+    CQWrap cq;
+    mc_PIPELINE *pl = cq.pipelines[0];
+
+    std::vector<mc_PACKET *> pkts;
+    for (unsigned ii = 0; ii < 4096; ii++) {
+        pkts.push_back(enqueuePacket(pl));
+    }
+    flushPipeline(pl);
+
+    for (auto it = pkts.rbegin(); it != pkts.rend(); ++it) {
+        mc_PACKET *pkt = mcreq_pipeline_remove(pl, (*it)->opaque);
+        ASSERT_EQ(*it, pkt);
+        ASSERT_EQ(nullptr, mcreq_pipeline_find(pl, (*it)->opaque));
+        mcreq_packet_handled(pl, pkt);
+        if (it + 1 != pkts.rend()) {
+            ASSERT_EQ(pkts.front(), mcreq_first_packet(pl));
+        }
+    }
+    ASSERT_TRUE(SLLIST_IS_EMPTY(&pl->requests));
+}
+
+/*
+ * Reports the cost of matching a response to its request against the number
+ * of requests in flight on the pipeline. Responses are handled newest first,
+ * which is the worst case for a search from the head of the request list.
+ *
+ * This is a benchmark rather than a test, run it with
+ * --gtest_also_run_disabled_tests.
+ */
+TEST_F(McPipelineFind, DISABLED_benchDispatchByQueueDepth)
+{
+    const unsigned depths[] = {16, 256, 4096, 32768};
+
+    for (unsigned depth : depths) {
+        CQWrap cq;
+        mc_PIPELINE *pl = cq.pipelines[0];
+
+        std::vector<mc_PACKET *> pkts;
+        pkts.reserve(depth);
+        for (unsigned ii = 0; ii < depth; ii++) {
+            pkts.push_back(enqueuePacket(pl));
+        }
+        flushPipeline(pl);
+
+        auto start = std::chrono::steady_clock::now();
+        for (auto it = pkts.rbegin(); it != pkts.rend(); ++it) {
+            mc_PACKET *pkt = mcreq_pipeline_remove(pl, (*it)->opaque);
+            ASSERT_EQ(*it, pkt);
+            mcreq_packet_handled(pl, pkt);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        double nsPerOp = std::chrono::duration<double, std::nano>(elapsed).count() / depth;
+        printf("depth=%-6u %8.1f ns/response\n", depth, nsPerOp);
+        ASSERT_TRUE(SLLIST_IS_EMPTY(&pl->requests));
+    }
+}
@@ -0,0 +1,120 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "mctest.h"
+#include "mc/mcreq-flush-inl.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+class McPipelineTimeout : public ::testing::Test
+{
+};
+
+static mc_PACKET *enqueueWithDeadline(mc_PIPELINE *pl, hrtime_t deadline)
+{
+    mc_PACKET *pkt = mcreq_allocate_packet(pl);
+    EXPECT_EQ(LCB_SUCCESS, mcreq_reserve_header(pl, pkt, MCREQ_PKT_BASESIZE));
+    memset(SPAN_BUFFER(&pkt->kh_span), 0, MCREQ_PKT_BASESIZE);
+    MCREQ_PKT_RDATA(pkt)->start = 0;
+    MCREQ_PKT_RDATA(pkt)->deadline = deadline;
+    mcreq_enqueue_packet(pl, pkt);
+    return pkt;
+}
+
+static void flushPipeline(mc_PIPELINE *pl)
+{
+    nb_IOV iov[64];
+    unsigned nb;
+    while ((nb = mcreq_flush_iov_fill(pl, iov, 64, nullptr))) {
+        mcreq_flush_done(pl, nb, nb);
+    }
+}
+
+extern "C" {
+static void recordcb(mc_PIPELINE *, mc_PACKET *pkt, lcb_STATUS, void *arg)
+{
+    reinterpret_cast<std::vector<hrtime_t> *>(arg)->push_back(MCREQ_PKT_RDATA(pkt)->deadline);
+}
+}
+
+TEST_F(McPipelineTimeout, testExpiresInDeadlineOrder)
+{
+    CQWrap cq;
+    mc_PIPELINE *pl = cq.pipelines[0];
+
+    std::vector<hrtime_t> deadlines;
+    for (hrtime_t ii = 1; ii <= 200; ii++) {
+        deadlines.push_back(ii * 10);
+    }
+    std::mt19937 rng(7);
+    std::shuffle(deadlines.begin(), deadlines.end(), rng);
+
+    std::vector<mc_PACKET *> pkts;
+    for (hrtime_t deadline : deadlines) {
+        pkts.push_back(enqueueWithDeadline(pl, deadline));
+    }
+    ASSERT_EQ(10U, MCREQ_PKT_RDATA(mcreq_next_expiring(pl))->deadline);
+
+    // Removing the earliest packet exposes the next one
+    mc_PACKET *earliest = mcreq_next_expiring(pl);
+    ASSERT_EQ(earliest, mcreq_pipeline_remove(pl, earliest->opaque));
+    ASSERT_EQ(20U, MCREQ_PKT_RDATA(mcreq_next_expiring(pl))->deadline);
+
+    std::vector<hrtime_t> expired;
+    ASSERT_EQ(49U, mcreq_pipeline_timeout(pl, LCB_ERR_TIMEOUT, recordcb, &expired, 500));
+    ASSERT_EQ(49U, expired.size());
+    ASSERT_TRUE(std::is_sorted(expired.begin(), expired.end()));
+    ASSERT_EQ(20U, expired.front());
+    ASSERT_EQ(500U, expired.back());
+    ASSERT_EQ(510U, MCREQ_PKT_RDATA(mcreq_next_expiring(pl))->deadline);
+
+    // Nothing else has expired yet
+    expired.clear();
+    ASSERT_EQ(0U, mcreq_pipeline_timeout(pl, LCB_ERR_TIMEOUT, recordcb, &expired, 505));
+
+    ASSERT_EQ(150U, mcreq_pipeline_fail(pl, LCB_ERR_GENERIC, recordcb, &expired));
+    ASSERT_EQ(nullptr, mcreq_next_expiring(pl));
+    ASSERT_TRUE(SLLIST_IS_EMPTY(&pl->requests));
+
+    // The packets are only released once flushed, which keeps the buffers
+    // from being released out of order
+    mcreq_packet_handled(pl, earliest);
+    flushPipeline(pl);
+}
+
+TEST_F(McPipelineTimeout, testResetTimeoutsReordersHeap)
+{
+    CQWrap cq;
+    mc_PIPELINE *pl = cq.pipelines[0];
+
+    // The first packet has the longest timeout, but the earliest deadline
+    mc_PACKET *first = enqueueWithDeadline(pl, 100);
+    MCREQ_PKT_RDATA(first)->start = 0;
+    mc_PACKET *second = enqueueWithDeadline(pl, 150);
+    MCREQ_PKT_RDATA(second)->start = 100;
+    flushPipeline(pl);
+    ASSERT_EQ(first, mcreq_next_expiring(pl));
+
+    mcreq_reset_timeouts(pl, 1000);
+    ASSERT_EQ(second, mcreq_next_expiring(pl));
+    ASSERT_EQ(1050U, MCREQ_PKT_RDATA(second)->deadline);
+
+    std::vector<hrtime_t> expired;
+    ASSERT_EQ(2U, mcreq_pipeline_fail(pl, LCB_ERR_GENERIC, recordcb, &expired));
+}
@@ -111,3 +111,47 @@ TEST_F(RefTest, testRefConsolidate)
     rp3.unrefSegment(0);
     delete ior;
 }
+
+TEST_F(RefTest, testSegContains)
+{
+    IORope *ior = new IORope(rdb_chunkalloc_new(4));
+    ior->feed("12345678");
+
+    char *p = rdb_get_consolidated(ior, 8);
+    rdb_ROPESEG *seg = rdb_get_first_segment(ior);
+    ASSERT_TRUE(RDB_SEG_CONTAINS(seg, p, 8));
+    ASSERT_TRUE(RDB_SEG_CONTAINS(seg, p + 4, 4));
+
+    char outside[8];
+    ASSERT_FALSE(RDB_SEG_CONTAINS(seg, outside, sizeof(outside)));
+    ASSERT_FALSE(RDB_SEG_CONTAINS(seg, seg->root + seg->nalloc - 2, 4));
+    delete ior;
+}
+
+TEST_F(RefTest, testRefreadAt)
+{
+    IORope ior(rdb_chunkalloc_new(4));
+    ior.feed("0123456789");
+
+    // Only count the elements required
+    ASSERT_EQ(3, rdb_refread_at(&ior, 2, NULL, 0, 7));
+
+    nb_IOV iovs[3];
+    ASSERT_EQ(3, rdb_refread_at(&ior, 2, iovs, 3, 7));
+    ASSERT_EQ(2, iovs[0].iov_len);
+    ASSERT_EQ(0, memcmp(iovs[0].iov_base, "23", 2));
+    ASSERT_EQ(4, iovs[1].iov_len);
+    ASSERT_EQ(0, memcmp(iovs[1].iov_base, "4567", 4));
+    ASSERT_EQ(1, iovs[2].iov_len);
+    ASSERT_EQ(0, memcmp(iovs[2].iov_base, "8", 1));
+
+    // Offsets may skip whole segments
+    ASSERT_EQ(1, rdb_refread_at(&ior, 5, iovs, 3, 2));
+    ASSERT_EQ(0, memcmp(iovs[0].iov_base, "56", 2));
+
+    // Too few elements
+    ASSERT_EQ(-1, rdb_refread_at(&ior, 0, iovs, 2, 10));
+
+    // Nothing was consumed
+    ASSERT_EQ(10, ior.usedSize());
+}
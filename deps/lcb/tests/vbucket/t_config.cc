@@ -17,8 +17,10 @@
 
 #include <libcouchbase/vbucket.h>
 #include <gtest/gtest.h>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <random>
 #include <vector>
 #include <map>
 #include "contrib/lcb-jsoncpp/lcb-jsoncpp.h"
@@ -176,6 +178,232 @@ TEST_F(ConfigTest, testAltMap)
     lcbvb_destroy(cfg);
 }
 
+/* Bitwise CRC32, independent of the table and of any accelerated version */
+static int referenceKeyToVbucket(const char *key, size_t nkey, int nvb)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t ii = 0; ii < nkey; ii++) {
+        crc ^= (unsigned char)key[ii];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return (int)((((~crc) >> 16) & 0x7fff) % nvb);
+}
+
+TEST_F(ConfigTest, testKeyHashing)
+{
+    // With 32768 vBuckets the vBucket ID is the hash itself
+    lcbvb_CONFIG *cfg = lcbvb_create();
+    lcbvb_genconfig(cfg, 4, 1, 32768);
+
+    std::mt19937 rng(1);
+    std::vector<char> buf(512);
+    for (char &c : buf) {
+        c = (char)rng();
+    }
+
+    ASSERT_EQ(referenceKeyToVbucket("", 0, 32768), lcbvb_k2vb(cfg, "", 0));
+    ASSERT_EQ(referenceKeyToVbucket("Dummy Key", 9, 32768), lcbvb_k2vb(cfg, "Dummy Key", 9));
+    for (size_t offset = 0; offset < 16; offset++) {
+        for (size_t nkey = 0; nkey <= 300; nkey++) {
+            const char *key = &buf[offset];
+            ASSERT_EQ(referenceKeyToVbucket(key, nkey, 32768), lcbvb_k2vb(cfg, key, nkey))
+                << "offset=" << offset << ", nkey=" << nkey;
+        }
+    }
+    for (unsigned nvb : {1, 64, 1024}) {
+        ASSERT_EQ(referenceKeyToVbucket("Dummy Key", 9, nvb), lcbvb_hash_key(nvb, "Dummy Key", 9));
+    }
+    ASSERT_EQ(lcbvb_k2vb(cfg, buf.data(), 100), lcbvb_hash_key(32768, buf.data(), 100));
+    lcbvb_destroy(cfg);
+}
+
+/*
+ * Reports the cost of mapping a key to its vBucket for a few distributions of
+ * key lengths: plain document IDs, composite keys and long composite keys.
+ *
+ * This is a benchmark rather than a test, run it with
+ * --gtest_also_run_disabled_tests.
+ */
+TEST_F(ConfigTest, DISABLED_benchKeyToVbucket)
+{
+    struct Distribution {
+        const char *name;
+        size_t minlen;
+        size_t maxlen;
+    } distributions[] = {{"id", 8, 24}, {"composite", 32, 96}, {"long", 128, 250}};
+
+    lcbvb_CONFIG *cfg = lcbvb_create();
+    lcbvb_genconfig(cfg, 4, 1, 1024);
+    std::mt19937 rng(42);
+    const char *words[] = {"tenant", "acme", "user", "order", "2026-10-16", "invoice", "item", "shipment"};
+
+    for (const Distribution &dist : distributions) {
+        std::uniform_int_distribution<size_t> lengths(dist.minlen, dist.maxlen);
+        vector<string> keys;
+        size_t nbytes = 0;
+        for (int ii = 0; ii < 10000; ii++) {
+            size_t len = lengths(rng);
+            string key;
+            while (key.size() < len) {
+                key += words[rng() % 8];
+                key += "::" + std::to_string(rng() % 100000) + "::";
+            }
+            key.resize(len);
+            nbytes += len;
+            keys.push_back(key);
+        }
+
+        const int niters = 50;
+        unsigned sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int iter = 0; iter < niters; iter++) {
+            for (const string &key : keys) {
+                sum += lcbvb_k2vb(cfg, key.c_str(), key.size());
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        printf("%-10s %3zu-%3zu bytes %8.1f ns/key %6.2f ns/byte\n", dist.name, dist.minlen, dist.maxlen,
+               ns / (niters * keys.size()), ns / ((double)niters * nbytes));
+        ASSERT_NE(0U, sum);
+    }
+    lcbvb_destroy(cfg);
+}
+
+static void checkPeekRevision(const string &json)
+{
+    lcbvb_CONFIG *cfg = lcbvb_create();
+    ASSERT_EQ(0, lcbvb_load_json(cfg, json.c_str()));
+    int64_t revepoch = 0, revid = 0;
+    int rv = lcbvb_peek_revision(json.c_str(), json.size(), &revepoch, &revid);
+    if (cfg->revid < 0) {
+        ASSERT_NE(0, rv);
+    } else {
+        ASSERT_EQ(0, rv);
+        ASSERT_EQ(cfg->revepoch, revepoch);
+        ASSERT_EQ(cfg->revid, revid);
+    }
+    lcbvb_destroy(cfg);
+}
+
+TEST_F(ConfigTest, testPeekRevision)
+{
+    int64_t revepoch, revid;
+    string json;
+
+    json = R"({"rev":42,"revEpoch":3})";
+    ASSERT_EQ(0, lcbvb_peek_revision(json.c_str(), json.size(), &revepoch, &revid));
+    ASSERT_EQ(3, revepoch);
+    ASSERT_EQ(42, revid);
+
+    // Only top-level fields count, and the epoch is optional
+    json = R"({"nodes":[{"rev":1,"x":"\"rev\":2"}],"ext":{"revEpoch":7}, "rev" : 1234 })";
+    ASSERT_EQ(0, lcbvb_peek_revision(json.c_str(), json.size(), &revepoch, &revid));
+    ASSERT_EQ(-1, revepoch);
+    ASSERT_EQ(1234, revid);
+
+    // The first occurrence wins, as it does for the parser
+    json = R"({"rev":5,"rev":6})";
+    ASSERT_EQ(0, lcbvb_peek_revision(json.c_str(), json.size(), &revepoch, &revid));
+    ASSERT_EQ(5, revid);
+
+    // Anything unusual must be left to the parser
+    const char *bad[] = {R"({"nodes":[{"rev":1}]})", R"({"rev":1.5})", R"({"rev":1e3})", R"({"rev":"1"})",
+                         R"({"rev":99999999999999999999})", R"({"rev":1,"revEpoch":null})", R"([{"rev":1}])",
+                         R"({"rev":)", ""};
+    for (const char *b : bad) {
+        ASSERT_NE(0, lcbvb_peek_revision(b, strlen(b), &revepoch, &revid)) << b;
+    }
+
+    const char *files[] = {"full_25.json", "terse_25.json", "terse_30.json", "memd_25.json", "memd_45.json"};
+    for (const char *fname : files) {
+        checkPeekRevision(getConfigFile(fname));
+    }
+
+    lcbvb_CONFIG *cfg = lcbvb_create();
+    lcbvb_genconfig(cfg, 4, 1, 64);
+    cfg->revepoch = 2;
+    cfg->revid = 9000;
+    char *tmp = lcbvb_save_json(cfg);
+    checkPeekRevision(tmp);
+    free(tmp);
+    lcbvb_destroy(cfg);
+}
+
+/**
+ * Replay the configurations a client sees during a rebalance. Every revision is
+ * seen many times, as each NOT_MY_VBUCKET reply carries the configuration of the
+ * node which sent it, and some nodes lag behind.
+ *
+ * This is a benchmark rather than a test, run it with
+ * --gtest_also_run_disabled_tests.
+ */
+TEST_F(ConfigTest, DISABLED_benchConfigReplay)
+{
+    const int nrevs = 64, ncopies = 32;
+    lcbvb_CONFIG *cfg = lcbvb_create();
+    lcbvb_genconfig(cfg, 4, 1, 1024);
+    cfg->revepoch = 1;
+
+    vector<string> revisions;
+    std::mt19937 rng(42);
+    for (int rev = 1; rev <= nrevs; rev++) {
+        for (int ii = 0; ii < 16; ii++) {
+            lcbvb_VBUCKET &vb = cfg->vbuckets[rng() % cfg->nvb];
+            std::swap(vb.servers[0], vb.servers[1]);
+        }
+        cfg->revid = rev;
+        char *tmp = lcbvb_save_json(cfg);
+        revisions.emplace_back(tmp);
+        free(tmp);
+    }
+    lcbvb_destroy(cfg);
+
+    vector<const string *> stream;
+    for (int rev = 0; rev < nrevs; rev++) {
+        for (int ii = 0; ii < ncopies; ii++) {
+            stream.push_back(&revisions[rev]);
+            if (rev > 0 && rng() % 4 == 0) {
+                stream.push_back(&revisions[rev - 1]);
+            }
+        }
+    }
+
+    for (int gated = 0; gated < 2; gated++) {
+        lcbvb_CONFIG *current = nullptr;
+        size_t nparsed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const string *json : stream) {
+            int64_t revepoch, revid;
+            if (gated && current &&
+                lcbvb_peek_revision(json->c_str(), json->size(), &revepoch, &revid) == 0 &&
+                revepoch <= current->revepoch && revid <= current->revid) {
+                continue;
+            }
+            lcbvb_CONFIG *next = lcbvb_create();
+            ASSERT_EQ(0, lcbvb_load_json(next, json->c_str()));
+            nparsed++;
+            if (current == nullptr || next->revid > current->revid) {
+                std::swap(current, next);
+            }
+            if (next) {
+                lcbvb_destroy(next);
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        ASSERT_EQ(nrevs, current->revid);
+        printf("%-6s %5zu configs (%4zu bytes) %5zu parsed %8.1f us total %6.2f us/config\n",
+               gated ? "peek" : "parse", stream.size(), revisions.back().size(), nparsed,
+               std::chrono::duration<double, std::micro>(elapsed).count(),
+               std::chrono::duration<double, std::micro>(elapsed).count() / stream.size());
+        lcbvb_destroy(current);
+    }
+}
+
 TEST_F(ConfigTest, testGetReplicaNode)
 {
     lcbvb_CONFIG *cfg = lcbvb_create();
@@ -80,11 +80,13 @@ export class AnalyticsExecutor {
       })
     })
 
-    this._conn.analyticsQuery(
+    const control = this._conn.analyticsQuery(
       queryData,
       queryFlags,
       options.parentSpan,
       lcbTimeout,
+      options.rowBatchSize,
+      options.rowBatchBytes,
       (err, flags, data) => {
         if (!(flags & binding.LCBX_RESP_F_NONFINAL)) {
           if (err) {
@@ -138,10 +140,20 @@ export class AnalyticsExecutor {
           return
         }
 
+        if (flags & binding.LCBX_RESP_F_ROWBATCH) {
+          data.forEach((rowData: any) => {
+            emitter.emit('row', JSON.parse(rowData))
+          })
+          return
+        }
+
         const row = JSON.parse(data)
         emitter.emit('row', row)
       }
     )
+    if (control) {
+      emitter._setStreamControl(control)
+    }
 
     return emitter
   }
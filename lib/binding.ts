@@ -13,6 +13,7 @@ export enum CppSdCmdType {}
 export enum CppSdOpFlag {}
 export enum CppSdSpecFlag {}
 export enum CppConnType {}
+export enum CppConnFlags {}
 export enum CppViewQueryFlags {}
 export enum CppQueryFlags {}
 export enum CppSearchQueryFlags {}
@@ -22,20 +23,32 @@ export enum CppQueryRespFlags {}
 export enum CppSearchQueryRespFlags {}
 export enum CppAnalyticsQueryRespFlags {}
 
-export interface CppLogData {
-  severity: CppLogSeverity
-  srcFile: string
-  srcLine: number
-  subsys: string
-  message: string
+export interface CppLogFunc {
+  (
+    severities: CppLogSeverity[],
+    srcFiles: string[],
+    srcLines: number[],
+    subsystems: string[],
+    messages: string[]
+  ): void
 }
 
-export interface CppLogFunc {
-  (data: CppLogData): void
+export interface CppLogFilter {
+  minSeverity?: CppLogSeverity
+  subsystems?: string[]
+}
+
+export interface CppValueRecorderSnapshot {
+  count: number
+  min: number
+  max: number
+  mean: number
+  percentiles: { [percentile: string]: number }
 }
 
 export interface CppValueRecorder {
   recordValue(value: number): void
+  recordSnapshot?(snapshot: CppValueRecorderSnapshot): void
 }
 
 export interface CppMeter {
@@ -54,10 +67,29 @@ export interface CppTracer {
   requestSpan(name: string, parent: CppRequestSpan | undefined): CppRequestSpan
 }
 
+export interface CppPoolStats {
+  cookieHits: number
+  cookieMisses: number
+  stringArenaHits: number
+  stringArenaMisses: number
+  zeroCopyBuffers: number
+}
+
+export interface CppStreamControl {
+  pause(): boolean
+  resume(): boolean
+}
+
 export type CppBytes = string | Buffer
 export type CppTranscoder = any
 export type CppCas = any
 export type CppMutationToken = any
+export type CppGetMultiResult = [err: CppError | null, cas: CppCas, value: any]
+export type CppUpsertMultiResult = [
+  err: CppError | null,
+  cas: CppCas,
+  token: CppMutationToken
+]
 
 export interface CppErrorBase extends Error {
   code: number
@@ -137,13 +169,20 @@ export interface CppConnection {
     connStr: string,
     username: string | undefined,
     password: string | undefined,
-    logFn: CppLogFunc,
+    logFn: CppLogFunc | undefined,
     tracer: CppTracer | undefined,
-    meter: CppMeter | undefined
+    meter: CppMeter | undefined,
+    flags: CppConnFlags,
+    meterEmitInterval: number | undefined,
+    logFilter: CppLogFilter | undefined
   ): any
 
   connect(callback: (err: CppError | null) => void): void
   shutdown(): void
+  setCompletionHandler(handler: (completions: any[]) => void): void
+  poolStats(): CppPoolStats
+  keyShard(key: CppBytes, numShards: number): number
+  keyShards(keys: CppBytes[], numShards: number): number[]
   selectBucket(
     bucketName: string,
     callback: (err: CppError | null) => void
@@ -207,6 +246,29 @@ export interface CppConnection {
     ) => void
   ): void
 
+  getMulti(
+    scopeName: string,
+    collectionName: string,
+    keys: CppBytes[],
+    transcoder: CppTranscoder,
+    parentSpan: CppRequestSpan | undefined,
+    timeoutMs: number | undefined,
+    callback: (err: CppError | null, results: CppGetMultiResult[]) => void
+  ): void
+
+  upsertMulti(
+    scopeName: string,
+    collectionName: string,
+    keys: CppBytes[],
+    values: any[],
+    transcoder: CppTranscoder,
+    expirySecs: number | undefined,
+    duraMode: CppDurabilityMode | undefined,
+    parentSpan: CppRequestSpan | undefined,
+    timeoutMs: number | undefined,
+    callback: (err: CppError | null, results: CppUpsertMultiResult[]) => void
+  ): void
+
   remove(
     scopeName: string,
     collectionName: string,
@@ -323,36 +385,42 @@ export interface CppConnection {
     flags: CppQueryFlags,
     parentSpan: CppRequestSpan | undefined,
     timeoutMs: number | undefined,
+    rowBatchSize: number | undefined,
+    rowBatchBytes: number | undefined,
     callback: (
       err: CppError | null,
       flags: CppQueryRespFlags,
       data: any
     ) => void
-  ): void
+  ): CppStreamControl
 
   analyticsQuery(
     queryData: CppBytes,
     flags: CppAnalyticsQueryFlags,
     parentSpan: CppRequestSpan | undefined,
     timeoutMs: number | undefined,
+    rowBatchSize: number | undefined,
+    rowBatchBytes: number | undefined,
     callback: (
       err: CppError | null,
       flags: CppAnalyticsQueryRespFlags,
       data: any
     ) => void
-  ): void
+  ): CppStreamControl
 
   searchQuery(
     queryData: CppBytes,
     flags: CppSearchQueryFlags,
     parentSpan: CppRequestSpan | undefined,
     timeoutMs: number | undefined,
+    rowBatchSize: number | undefined,
+    rowBatchBytes: number | undefined,
     callback: (
       err: CppError | null,
       flags: CppSearchQueryRespFlags,
       data: any
     ) => void
-  ): void
+  ): CppStreamControl
 
   httpRequest(
     httpType: CppHttpType,
@@ -507,6 +575,7 @@ export interface CppBinding {
   LCB_ERR_HTTP: CppErrType
   LCB_ERR_QUERY: CppErrType
   LCB_ERR_TOPOLOGY_CHANGE: CppErrType
+  LCB_ERR_REQUEST_BUDGET_EXCEEDED: CppErrType
 
   LCB_LOG_TRACE: CppLogSeverity
   LCB_LOG_DEBUG: CppLogSeverity
@@ -587,6 +656,15 @@ export interface CppBinding {
     | CppQueryRespFlags
     | CppSearchQueryRespFlags
     | CppAnalyticsQueryRespFlags
+  LCBX_RESP_F_ROWBATCH:
+    | CppQueryRespFlags
+    | CppSearchQueryRespFlags
+    | CppAnalyticsQueryRespFlags
+
+  LCBX_CONNFLAG_ZEROCOPY_VALUES: CppConnFlags
+  LCBX_CONNFLAG_BATCH_COMPLETIONS: CppConnFlags
+  LCBX_CONNFLAG_IO_THREAD: CppConnFlags
+  LCBX_CONNFLAG_PARALLEL_COMPRESSION: CppConnFlags
 }
 // Load it with require
 const binding: CppBinding = bindings('couchbase_impl')
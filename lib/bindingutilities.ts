@@ -3,11 +3,12 @@ import binding, {
   CppReplicaMode,
   CppStoreOpType,
 } from './binding'
-import { CppError } from './binding'
+import { CppError, CppTranscoder } from './binding'
 import { ErrorContext } from './errorcontexts'
 import * as errctxs from './errorcontexts'
 import * as errs from './errors'
 import { DurabilityLevel } from './generaltypes'
+import { DefaultTranscoder, Transcoder } from './transcoders'
 
 /**
  * @internal
@@ -67,6 +68,23 @@ export function duraLevelToCppDuraMode(
   throw new errs.InvalidDurabilityLevel()
 }
 
+/**
+ * Returns the transcoder to pass to the binding.  The stock DefaultTranscoder
+ * is implemented natively, so it is passed as undefined to allow the binding
+ * to avoid calling back into JS for every encode and decode.  Subclasses are
+ * always passed through since they may override its behaviour.
+ *
+ * @internal
+ */
+export function transcoderToCppTranscoder(
+  transcoder: Transcoder
+): CppTranscoder | undefined {
+  if (transcoder.constructor === DefaultTranscoder) {
+    return undefined
+  }
+  return transcoder
+}
+
 /**
  * Wraps an error which has occurred within libcouchbase.
  */
@@ -182,6 +200,8 @@ export function translateCppError(err: CppError | null): Error | null {
       return new errs.AuthenticationFailureError(codeErr, context)
     case binding.LCB_ERR_TEMPORARY_FAILURE:
       return new errs.TemporaryFailureError(codeErr, context)
+    case binding.LCB_ERR_REQUEST_BUDGET_EXCEEDED:
+      return new errs.RequestBudgetExceededError(codeErr, context)
     case binding.LCB_ERR_PARSING_FAILURE:
       return new errs.ParsingFailureError(codeErr, context)
     case binding.LCB_ERR_CAS_MISMATCH:
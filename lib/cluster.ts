@@ -23,7 +23,7 @@ import {
 import { ClusterClosedError, NeedOpenBucketError } from './errors'
 import { EventingFunctionManager } from './eventingfunctionmanager'
 import { libLogger } from './logging'
-import { LogFunc, defaultLogger } from './logging'
+import { LogFunc, LogSeverity, defaultLogger } from './logging'
 import { LoggingMeter, Meter } from './metrics'
 import { QueryExecutor } from './queryexecutor'
 import { QueryIndexManager } from './queryindexmanager'
@@ -124,10 +124,77 @@ export interface ConnectOptions {
    */
   meter?: Meter
 
+  /**
+   * Specifies how often the values aggregated for the value recorders of a
+   * custom meter which implement recordSnapshot are passed to them,
+   * specified in milliseconds.  Defaults to 10 seconds.
+   */
+  meterEmitInterval?: number
+
   /**
    * Specifies a logging function to use when outputting logging.
    */
   logFunc?: LogFunc
+
+  /**
+   * Specifies the lowest severity of the messages passed to the logging
+   * function, anything below it is discarded before being formatted.  When
+   * using the default logger, this defaults to the lowest severity enabled
+   * for the `debug` library when the cluster is connected.  Severities which
+   * are enabled later, for example with `debug.enable()`, are not logged by
+   * connections which are already open; set this option to receive them.
+   */
+  logLevel?: LogSeverity
+
+  /**
+   * Specifies the sub-systems whose messages are passed to the logging
+   * function, messages from any other sub-system are discarded before being
+   * formatted.  Defaults to all sub-systems.
+   */
+  logSubsystems?: string[]
+
+  /**
+   * Specifies that large document values should be returned as Buffers which
+   * reference the network read buffers directly rather than being copied.
+   * Such a Buffer holds its underlying read buffer in memory until it is
+   * garbage collected.  Large Buffers passed as document values are likewise
+   * written to the network without being copied, and must not be modified
+   * until the operation has completed.
+   */
+  zeroCopyValues?: boolean
+
+  /**
+   * Specifies that operation results which arrive within the same event loop
+   * tick should be delivered to JavaScript together, rather than invoking a
+   * separate native callback for each operation.  This reduces the overhead
+   * of each completion when many operations are outstanding.
+   */
+  batchCompletions?: boolean
+
+  /**
+   * Specifies that network and protocol processing should be performed on a
+   * dedicated native thread rather than on the JavaScript event loop.  This
+   * cannot be combined with a custom tracer or meter, and disables the read
+   * side of zeroCopyValues.
+   */
+  ioThread?: boolean
+
+  /**
+   * Specifies that large document values should be compressed on the libuv
+   * threadpool rather than on the JavaScript event loop.  Such operations are
+   * only sent once their value has been compressed, and so may be sent after
+   * operations which were issued later.  This has no effect together with
+   * ioThread, which already compresses values off the event loop.
+   */
+  parallelCompression?: boolean
+
+  /**
+   * Specifies the number of connections to open to each bucket.  Key-value
+   * operations are spread across these by vBucket, so operations on the same
+   * key are always sent over the same connection and remain ordered.  This
+   * allows throughput to each node to scale beyond that of a single socket.
+   */
+  kvConnections?: number
 }
 
 /**
@@ -154,7 +221,15 @@ export class Cluster {
   private _transcoder: Transcoder
   private _tracer: RequestTracer
   private _meter: Meter
+  private _meterEmitInterval: number
   private _logFunc: LogFunc
+  private _logLevel?: LogSeverity
+  private _logSubsystems?: string[]
+  private _zeroCopyValues: boolean
+  private _batchCompletions: boolean
+  private _ioThread: boolean
+  private _parallelCompression: boolean
+  private _kvConnections: number
 
   /**
   @internal
@@ -181,6 +256,14 @@ export class Cluster {
     this._analyticsTimeout = options.analyticsTimeout || 0
     this._searchTimeout = options.searchTimeout || 0
     this._managementTimeout = options.managementTimeout || 0
+    this._zeroCopyValues = options.zeroCopyValues || false
+    this._batchCompletions = options.batchCompletions || false
+    this._ioThread = options.ioThread || false
+    this._parallelCompression = options.parallelCompression || false
+    this._kvConnections = options.kvConnections || 1
+    this._meterEmitInterval = options.meterEmitInterval || 0
+    this._logLevel = options.logLevel
+    this._logSubsystems = options.logSubsystems
 
     if (options.transcoder) {
       this._transcoder = options.transcoder
@@ -489,7 +572,10 @@ export class Cluster {
       trustStorePath: this._trustStorePath,
       tracer: this._tracer,
       meter: this._meter,
+      meterEmitInterval: this._meterEmitInterval,
       logFunc: this._logFunc,
+      logLevel: this._logLevel,
+      logSubsystems: this._logSubsystems,
       kvTimeout: this._kvTimeout,
       kvDurableTimeout: this._kvDurableTimeout,
       viewTimeout: this._viewTimeout,
@@ -497,6 +583,11 @@ export class Cluster {
       analyticsTimeout: this._analyticsTimeout,
       searchTimeout: this._searchTimeout,
       managementTimeout: this._managementTimeout,
+      zeroCopyValues: this._zeroCopyValues,
+      batchCompletions: this._batchCompletions,
+      ioThread: this._ioThread,
+      parallelCompression: this._parallelCompression,
+      kvConnections: this._kvConnections,
       ...extraOpts,
     }
 
@@ -7,7 +7,11 @@ import {
 } from './binarycollection'
 import binding, { CppReplicaMode, CppSdOpFlag } from './binding'
 import { CppStoreOpType } from './binding'
-import { duraLevelToCppDuraMode, translateCppError } from './bindingutilities'
+import {
+  duraLevelToCppDuraMode,
+  transcoderToCppTranscoder,
+  translateCppError,
+} from './bindingutilities'
 import { Connection } from './connection'
 import {
   CounterResult,
@@ -567,7 +571,9 @@ export class Collection {
       return this._projectedGet(key, options, callback)
     }
 
-    const transcoder = options.transcoder || this.transcoder
+    const transcoder = transcoderToCppTranscoder(
+      options.transcoder || this.transcoder
+    )
     const parentSpan = options.parentSpan
     const lcbTimeout = options.timeout ? options.timeout * 1000 : undefined
 
@@ -899,7 +905,9 @@ export class Collection {
       options = {}
     }
 
-    const transcoder = options.transcoder || this.transcoder
+    const transcoder = transcoderToCppTranscoder(
+      options.transcoder || this.transcoder
+    )
     const parentSpan = options.parentSpan
     const lcbTimeout = options.timeout ? options.timeout * 1000 : undefined
 
@@ -1005,7 +1013,9 @@ export class Collection {
       options = {}
     }
 
-    const transcoder = options.transcoder || this.transcoder
+    const transcoder = transcoderToCppTranscoder(
+      options.transcoder || this.transcoder
+    )
     const parentSpan = options.parentSpan
     const lcbTimeout = options.timeout ? options.timeout * 1000 : undefined
 
@@ -1320,7 +1330,9 @@ export class Collection {
       GetReplicaResult
     >((replicas) => replicas)
 
-    const transcoder = options.transcoder || this.transcoder
+    const transcoder = transcoderToCppTranscoder(
+      options.transcoder || this.transcoder
+    )
     const lcbTimeout = options.timeout ? options.timeout * 1000 : undefined
 
     this._conn.getReplica(
@@ -1381,7 +1393,9 @@ export class Collection {
     const cppDuraMode = duraLevelToCppDuraMode(options.durabilityLevel)
     const persistTo = options.durabilityPersistTo
     const replicateTo = options.durabilityReplicateTo
-    const transcoder = options.transcoder || this.transcoder
+    const transcoder = transcoderToCppTranscoder(
+      options.transcoder || this.transcoder
+    )
     const parentSpan = options.parentSpan
     const lcbTimeout = options.timeout ? options.timeout * 1000 : undefined
 
@@ -1,15 +1,24 @@
 /* eslint jsdoc/require-jsdoc: off */
 import binding, {
+  CppBytes,
   CppConnection,
   CppLogFunc,
+  CppLogSeverity,
   CppError,
   CppTracer,
   CppMeter,
+  CppPoolStats,
 } from './binding'
 import { translateCppError } from './bindingutilities'
 import { ConnSpec } from './connspec'
-import { ConnectionClosedError } from './errors'
-import { LogFunc } from './logging'
+import { ConnectionClosedError, InvalidArgumentError } from './errors'
+import {
+  batchLogFunc,
+  defaultLogger,
+  defaultLogLevel,
+  LogFunc,
+  LogSeverity,
+} from './logging'
 import { NoopMeter, LoggingMeter, Meter } from './metrics'
 import { NoopTracer, ThresholdLoggingTracer, RequestTracer } from './tracing'
 
@@ -26,6 +35,28 @@ function getClientString() {
   return `couchnode/${couchnodeVer} (node/${nodeVer}; v8/${v8Ver}; ssl/${sslVer})`
 }
 
+// Invokes the operation callbacks which were staged by the binding during a
+// single tick.  The completions are passed as a flat array of alternating
+// callbacks and argument arrays.
+function dispatchCompletions(completions: any[]): void {
+  let firstErr: any = undefined
+  for (let i = 0; i < completions.length; i += 2) {
+    try {
+      completions[i].apply(undefined, completions[i + 1])
+    } catch (e) {
+      // A throwing callback must not prevent the remaining completions from
+      // being delivered, so the error is only rethrown once they have been.
+      if (firstErr === undefined) {
+        firstErr = e
+      }
+    }
+  }
+
+  if (firstErr !== undefined) {
+    throw firstErr
+  }
+}
+
 export interface ConnectionOptions {
   connStr: string
   username?: string
@@ -44,7 +75,15 @@ export interface ConnectionOptions {
   managementTimeout?: number
   tracer?: RequestTracer
   meter?: Meter
+  meterEmitInterval?: number
   logFunc?: LogFunc
+  logLevel?: LogSeverity
+  logSubsystems?: string[]
+  zeroCopyValues?: boolean
+  batchCompletions?: boolean
+  ioThread?: boolean
+  parallelCompression?: boolean
+  kvConnections?: number
 }
 
 type ErrCallback = (err: Error | null) => void
@@ -79,6 +118,7 @@ type ConnectWaitFunc = () => void
 
 export class Connection {
   private _inst: CppConnection
+  private _shards: CppConnection[]
   private _connected: boolean
   private _opened: boolean
   private _closed: boolean
@@ -215,17 +255,74 @@ export class Connection {
 
     // This conversion relies on the LogSeverity and CppLogSeverity enumerations
     // always being in sync.  There is a test that ensures this.
-    const lcbLogFunc = options.logFunc as any as CppLogFunc
-
-    this._inst = new binding.Connection(
-      lcbConnType,
-      lcbConnStr,
-      options.username,
-      options.password,
-      lcbLogFunc,
-      lcbTracer,
-      lcbMeter
-    )
+    let lcbLogFunc: CppLogFunc | undefined = undefined
+    if (options.logFunc) {
+      lcbLogFunc = batchLogFunc(options.logFunc) as any as CppLogFunc
+    }
+
+    // Messages are filtered natively before they are formatted, so the
+    // default logger only receives the severities `debug` will output.
+    let logLevel = options.logLevel
+    if (logLevel === undefined && options.logFunc === defaultLogger) {
+      logLevel = defaultLogLevel()
+    }
+    const lcbLogFilter = {
+      minSeverity: logLevel as any as CppLogSeverity | undefined,
+      subsystems: options.logSubsystems,
+    }
+
+    let lcbConnFlags = 0
+    if (options.zeroCopyValues) {
+      lcbConnFlags |= binding.LCBX_CONNFLAG_ZEROCOPY_VALUES
+    }
+    if (options.batchCompletions) {
+      lcbConnFlags |= binding.LCBX_CONNFLAG_BATCH_COMPLETIONS
+    }
+    if (options.ioThread) {
+      // Custom tracers and meters are implemented in JavaScript, which the
+      // native I/O thread has no way to call into.
+      if (lcbTracer || lcbMeter) {
+        throw new InvalidArgumentError(
+          new Error('ioThread cannot be used with a custom tracer or meter')
+        )
+      }
+      lcbConnFlags |= binding.LCBX_CONNFLAG_IO_THREAD
+    }
+    if (options.parallelCompression) {
+      lcbConnFlags |= binding.LCBX_CONNFLAG_PARALLEL_COMPRESSION
+    }
+
+    // Only bucket connections are sharded, as they are the only ones which
+    // perform key-value operations.
+    let numShards = 1
+    if (lcbDsnObj.bucket && options.kvConnections) {
+      numShards = Math.max(Math.floor(options.kvConnections), 1)
+    }
+
+    this._shards = []
+    for (let i = 0; i < numShards; ++i) {
+      const inst = new binding.Connection(
+        lcbConnType,
+        lcbConnStr,
+        options.username,
+        options.password,
+        lcbLogFunc,
+        lcbTracer,
+        lcbMeter,
+        lcbConnFlags,
+        options.meterEmitInterval,
+        lcbLogFilter
+      )
+
+      if (options.batchCompletions) {
+        inst.setCompletionHandler(dispatchCompletions)
+      }
+
+      this._shards.push(inst)
+    }
+
+    // The first shard also performs every operation which is not key-value.
+    this._inst = this._shards[0]
 
     // If a bucket name is specified, this connection is immediately marked as
     // opened, with the assumption that the binding is doing this implicitly.
@@ -235,24 +332,33 @@ export class Connection {
   }
 
   connect(callback: (err: Error | null) => void): void {
-    this._inst.connect((err) => {
-      if (err) {
-        this._closed = true
-        this._closedErr = translateCppError(err)
-        callback(this._closedErr)
-
-        this._connectWaiters.forEach((waitFn) => waitFn())
-        this._connectWaiters = []
+    let remaining = this._shards.length
+    let connectErr: CppError | null = null
 
+    const onShardConnect = (err: CppError | null) => {
+      if (err && !connectErr) {
+        connectErr = err
+      }
+      if (--remaining > 0) {
         return
       }
 
-      this._connected = true
-      callback(null)
+      // The connection is only usable once every shard has connected.
+      if (connectErr) {
+        this._closed = true
+        this._closedErr = translateCppError(connectErr)
+        callback(this._closedErr)
+      } else {
+        this._connected = true
+        callback(null)
+      }
 
-      this._connectWaiters.forEach((waitFn) => waitFn())
+      const waiters = this._connectWaiters
       this._connectWaiters = []
-    })
+      waiters.forEach((waitFn) => waitFn())
+    }
+
+    this._shards.forEach((inst) => inst.connect(onShardConnect))
   }
 
   selectBucket(
@@ -269,6 +375,10 @@ export class Connection {
     })
   }
 
+  poolStats(): CppPoolStats {
+    return this._inst.poolStats()
+  }
+
   close(callback: (err: Error | null) => void): void {
     if (this._closed) {
       return
@@ -276,7 +386,7 @@ export class Connection {
 
     this._closed = true
     this._closedErr = new ConnectionClosedError()
-    this._inst.shutdown()
+    this._shards.forEach((inst) => inst.shutdown())
 
     callback(null)
   }
@@ -284,61 +394,99 @@ export class Connection {
   get(
     ...args: CppCbToNew<CppConnection['get']>
   ): ReturnType<CppConnection['get']> {
-    return this._proxyToConn(this._inst, this._inst.get, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.get, ...args)
+    )
   }
 
   exists(
     ...args: CppCbToNew<CppConnection['exists']>
   ): ReturnType<CppConnection['exists']> {
-    return this._proxyToConn(this._inst, this._inst.exists, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.exists, ...args)
+    )
   }
 
   getReplica(
     ...args: CppCbToNew<CppConnection['getReplica']>
   ): ReturnType<CppConnection['getReplica']> {
-    return this._proxyToConn(this._inst, this._inst.getReplica, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.getReplica, ...args)
+    )
   }
 
   store(
     ...args: CppCbToNew<CppConnection['store']>
   ): ReturnType<CppConnection['store']> {
-    return this._proxyToConn(this._inst, this._inst.store, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.store, ...args)
+    )
+  }
+
+  // Note that the per-item errors within the results of the multi-operations
+  // are not translated, callers are expected to use translateCppError.
+  getMulti(
+    ...args: CppCbToNew<CppConnection['getMulti']>
+  ): ReturnType<CppConnection['getMulti']> {
+    return this._proxyMultiToShards(args, [2], (inst, shardArgs) =>
+      this._proxyToConn(inst, inst.getMulti, ...shardArgs)
+    )
+  }
+
+  upsertMulti(
+    ...args: CppCbToNew<CppConnection['upsertMulti']>
+  ): ReturnType<CppConnection['upsertMulti']> {
+    return this._proxyMultiToShards(args, [2, 3], (inst, shardArgs) =>
+      this._proxyToConn(inst, inst.upsertMulti, ...shardArgs)
+    )
   }
 
   remove(
     ...args: CppCbToNew<CppConnection['remove']>
   ): ReturnType<CppConnection['remove']> {
-    return this._proxyToConn(this._inst, this._inst.remove, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.remove, ...args)
+    )
   }
 
   touch(
     ...args: CppCbToNew<CppConnection['touch']>
   ): ReturnType<CppConnection['touch']> {
-    return this._proxyToConn(this._inst, this._inst.touch, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.touch, ...args)
+    )
   }
 
   unlock(
     ...args: CppCbToNew<CppConnection['unlock']>
   ): ReturnType<CppConnection['unlock']> {
-    return this._proxyToConn(this._inst, this._inst.unlock, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.unlock, ...args)
+    )
   }
 
   counter(
     ...args: CppCbToNew<CppConnection['counter']>
   ): ReturnType<CppConnection['counter']> {
-    return this._proxyToConn(this._inst, this._inst.counter, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.counter, ...args)
+    )
   }
 
   lookupIn(
     ...args: CppCbToNew<CppConnection['lookupIn']>
   ): ReturnType<CppConnection['lookupIn']> {
-    return this._proxyToConn(this._inst, this._inst.lookupIn, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.lookupIn, ...args)
+    )
   }
 
   mutateIn(
     ...args: CppCbToNew<CppConnection['mutateIn']>
   ): ReturnType<CppConnection['mutateIn']> {
-    return this._proxyToConn(this._inst, this._inst.mutateIn, ...args)
+    return this._proxyToShard(args, (inst) =>
+      this._proxyToConn(inst, inst.mutateIn, ...args)
+    )
   }
 
   viewQuery(
@@ -349,19 +497,19 @@ export class Connection {
 
   query(
     ...args: CppCbToNew<CppConnection['query']>
-  ): ReturnType<CppConnection['query']> {
+  ): ReturnType<CppConnection['query']> | undefined {
     return this._proxyToConn(this._inst, this._inst.query, ...args)
   }
 
   analyticsQuery(
     ...args: CppCbToNew<CppConnection['analyticsQuery']>
-  ): ReturnType<CppConnection['analyticsQuery']> {
+  ): ReturnType<CppConnection['analyticsQuery']> | undefined {
     return this._proxyToConn(this._inst, this._inst.analyticsQuery, ...args)
   }
 
   searchQuery(
     ...args: CppCbToNew<CppConnection['searchQuery']>
-  ): ReturnType<CppConnection['searchQuery']> {
+  ): ReturnType<CppConnection['searchQuery']> | undefined {
     return this._proxyToConn(this._inst, this._inst.searchQuery, ...args)
   }
 
@@ -383,6 +531,140 @@ export class Connection {
     return this._proxyToConn(this._inst, this._inst.diag, ...args)
   }
 
+  // Routes a key-value operation to the shard which owns its key, which is
+  // the third of its arguments.  Operations on a sharded connection are held
+  // until the vBucket map is known, so that a key is never sent over more
+  // than one shard.
+  private _proxyToShard(
+    args: any[],
+    fn: (inst: CppConnection) => void
+  ): void {
+    if (this._shards.length === 1 || this._closed) {
+      return fn(this._inst)
+    }
+
+    // Mapping the key validates it, even while the map is not yet known.
+    const key = args[2] as CppBytes
+    const shard = this._inst.keyShard(key, this._shards.length)
+
+    if (!this._connected) {
+      this._deferUntilConnected(args[args.length - 1], () =>
+        this._proxyToShard(args, fn)
+      )
+      return
+    }
+
+    fn(shard >= 0 ? this._shards[shard] : this._inst)
+  }
+
+  // Splits a multi-operation into one per shard, the arguments at splitIdxs
+  // are arrays with an entry per key.  The results are reassembled in the
+  // original key order, reporting the first error any shard returned.
+  private _proxyMultiToShards<Args extends any[]>(
+    args: Args,
+    splitIdxs: number[],
+    fn: (inst: CppConnection, shardArgs: Args) => void
+  ): void {
+    if (this._shards.length === 1 || this._closed) {
+      return fn(this._inst, args)
+    }
+
+    // Everything which can be checked up front is checked before any of the
+    // shards is dispatched, or the operation is deferred, so that bad
+    // arguments are thrown as they are for an unsharded connection.
+    const keys = args[2] as CppBytes[]
+    splitIdxs.forEach((argIdx) => {
+      const splitArg = args[argIdx]
+      if (!Array.isArray(splitArg) || splitArg.length !== keys.length) {
+        throw new Error('bad keys passed')
+      }
+    })
+    const callback = args[args.length - 1]
+
+    const keyShards = this._inst.keyShards(keys, this._shards.length)
+
+    if (!this._connected) {
+      this._deferUntilConnected(callback, () =>
+        this._proxyMultiToShards(args, splitIdxs, fn)
+      )
+      return
+    }
+
+    const shardIdxs: number[][] = this._shards.map(() => [])
+    keyShards.forEach((shard, idx) => {
+      shardIdxs[Math.max(shard, 0)].push(idx)
+    })
+
+    let remaining = shardIdxs.filter((idxs) => idxs.length > 0).length
+    if (remaining <= 1) {
+      const shard = Math.max(
+        shardIdxs.findIndex((idxs) => idxs.length > 0),
+        0
+      )
+      return fn(this._shards[shard], args)
+    }
+
+    const results: any[] = new Array(keys.length)
+    let firstErr: Error | null = null
+    const onShardDone = () => {
+      if (--remaining === 0) {
+        callback(firstErr, results)
+      }
+    }
+
+    let numDispatched = 0
+    for (let shard = 0; shard < shardIdxs.length; ++shard) {
+      const idxs = shardIdxs[shard]
+      if (idxs.length === 0) {
+        continue
+      }
+
+      const shardArgs: any[] = args.slice()
+      splitIdxs.forEach((argIdx) => {
+        shardArgs[argIdx] = idxs.map((idx) => args[argIdx][idx])
+      })
+      shardArgs[shardArgs.length - 1] = (
+        err: Error | null,
+        shardResults: any[] | undefined
+      ) => {
+        if (err && !firstErr) {
+          firstErr = err
+        }
+        if (shardResults) {
+          idxs.forEach((idx, i) => {
+            results[idx] = shardResults[i]
+          })
+        }
+        onShardDone()
+      }
+
+      try {
+        fn(this._shards[shard], shardArgs as Args)
+      } catch (e) {
+        // Nothing was dispatched yet, so this behaves as it would for an
+        // unsharded connection.
+        if (numDispatched === 0) {
+          throw e
+        }
+
+        // Otherwise the shards which were already dispatched cannot be
+        // recalled.  The operation fails with this error once they are done,
+        // and the remaining shards are never dispatched.
+        if (!firstErr) {
+          firstErr = e as Error
+        }
+        remaining -= shardIdxs
+          .slice(shard)
+          .filter((otherIdxs) => otherIdxs.length > 0).length
+        if (remaining === 0) {
+          callback(firstErr, results)
+        }
+        return
+      }
+      numDispatched++
+    }
+  }
+
   private _proxyOnBootstrap<FArgs extends any[], CbArgs extends any[]>(
     thisArg: CppConnection,
     fn: (
@@ -396,35 +678,51 @@ export class Connection {
     if (this._closed || this._connected) {
       return this._proxyToConn(thisArg, fn, ...newArgs)
     } else {
-      this._connectWaiters.push(() => {
+      const callback = newArgs[newArgs.length - 1] as ErrCallback
+      this._deferUntilConnected(callback, () => {
         return this._proxyToConn(thisArg, fn, ...newArgs)
       })
     }
   }
 
-  private _proxyToConn<FArgs extends any[], CbArgs extends any[]>(
+  // Holds an operation until the connection has connected, or failed to.  An
+  // error thrown when it is finally dispatched is passed to its callback, as
+  // its caller has long since returned.
+  private _deferUntilConnected(callback: ErrCallback, fn: () => void): void {
+    this._connectWaiters.push(() => {
+      try {
+        fn()
+      } catch (e) {
+        callback(e as Error)
+      }
+    })
+  }
+
+  private _proxyToConn<FArgs extends any[], CbArgs extends any[], R>(
     thisArg: CppConnection,
     fn: (
       ...cppArgs: [
         ...FArgs,
         (...cppCbArgs: [CppError | null, ...CbArgs]) => void
       ]
-    ) => void,
+    ) => R,
     ...newArgs: [...FArgs, (...newCbArgs: [Error | null, ...CbArgs]) => void]
-  ) {
+  ): R | undefined {
     const wrappedArgs = newArgs
     const callback = wrappedArgs.pop() as (
       ...cbArgs: [Error | null, ...CbArgs]
     ) => void
 
     if (this._closed) {
-      return (callback as any as ErrCallback)(this._closedErr)
+      const closedCallback = callback as any as ErrCallback
+      closedCallback(this._closedErr)
+      return undefined
     }
 
     wrappedArgs.push((err: CppError | null, ...cbArgs: CbArgs) => {
       const translatedErr = translateCppError(err)
       callback.apply(undefined, [translatedErr, ...cbArgs])
     })
-    fn.apply(thisArg, wrappedArgs)
+    return fn.apply(thisArg, wrappedArgs)
   }
 }
@@ -171,6 +171,20 @@ export class TemporaryFailureError extends CouchbaseError {
   }
 }
 
+/**
+ * Indicates that the operation was rejected because too many requests, or
+ * too much request data, were already queued for the cluster.  Attempting
+ * the same operation once outstanding operations complete may succeed.
+ *
+ * @category Error Handling
+ */
+export class RequestBudgetExceededError extends TemporaryFailureError {
+  constructor(cause?: Error, context?: ErrorContext) {
+    super(cause, context)
+    this.message = 'request budget exceeded'
+  }
+}
+
 /**
  * Indicates that a parsing failure occured.
  *
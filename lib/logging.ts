@@ -130,6 +130,49 @@ function logToDebug(data: LogData): void {
  * The default logger which is used by the SDK.  This logger uses the `debug`
  * library to write its log messages in a way that is easily accessible.
  *
+ * The severities which `debug` outputs are read when a cluster connects, see
+ * {@link ConnectOptions.logLevel}.
+ *
  * @category Logging
  */
 export const defaultLogger: LogFunc = logToDebug
+
+/**
+ * @internal
+ * Returns the lowest severity which the default logger currently outputs,
+ * so that anything below it can be discarded before it is formatted.  When
+ * no severity is enabled, a level above every severity is returned.
+ */
+export function defaultLogLevel(): LogSeverity {
+  for (let sev = LogSeverity.Trace; sev <= LogSeverity.Fatal; ++sev) {
+    if (severityLoggers[sev].enabled) {
+      return sev
+    }
+  }
+  return LogSeverity.Fatal + 1
+}
+
+/**
+ * @internal
+ * Adapts a log function to the native logger, which passes the messages of
+ * each batch in a single call, as an array for each of their fields.
+ */
+export function batchLogFunc(logFunc: LogFunc) {
+  return (
+    severities: LogSeverity[],
+    srcFiles: string[],
+    srcLines: number[],
+    subsystems: string[],
+    messages: string[]
+  ): void => {
+    for (let i = 0; i < messages.length; ++i) {
+      logFunc({
+        severity: severities[i],
+        srcFile: srcFiles[i],
+        srcLine: srcLines[i],
+        subsys: subsystems[i],
+        message: messages[i],
+      })
+    }
+  }
+}
@@ -6,6 +6,38 @@ export interface LoggingMeterOptions {
   emitInterval?: number
 }
 
+/**
+ * A summary of the values recorded by a value recorder over one emit
+ * interval of the meter.
+ */
+export interface ValueRecorderSnapshot {
+  /**
+   * The number of values which were recorded.
+   */
+  count: number
+
+  /**
+   * The smallest value which was recorded.
+   */
+  min: number
+
+  /**
+   * The largest value which was recorded.
+   */
+  max: number
+
+  /**
+   * The mean of the recorded values.
+   */
+  mean: number
+
+  /**
+   * The recorded values at the 50th, 90th, 99th, 99.9th and 100th
+   * percentiles, keyed by percentile.
+   */
+  percentiles: { [percentile: string]: number }
+}
+
 /**
  * Provides an interface for recording values.
  */
@@ -16,6 +48,15 @@ export interface ValueRecorder {
    * @param value The value to record.
    */
   recordValue(value: number): void
+
+  /**
+   * Records a summary of many values.  When this is implemented, values are
+   * aggregated natively and this is invoked once per emit interval of the
+   * meter, rather than invoking recordValue for every value.
+   *
+   * @param snapshot The summary of the values recorded since the last call.
+   */
+  recordSnapshot?(snapshot: ValueRecorderSnapshot): void
 }
 
 /**
@@ -114,11 +114,13 @@ export class QueryExecutor {
       })
     })
 
-    this._conn.query(
+    const control = this._conn.query(
       queryData,
       queryFlags,
       options.parentSpan,
       lcbTimeout,
+      options.rowBatchSize,
+      options.rowBatchBytes,
       (err, flags, data) => {
         if (!(flags & binding.LCBX_RESP_F_NONFINAL)) {
           if (err) {
@@ -180,10 +182,20 @@ export class QueryExecutor {
           return
         }
 
+        if (flags & binding.LCBX_RESP_F_ROWBATCH) {
+          data.forEach((rowData: any) => {
+            emitter.emit('row', JSON.parse(rowData))
+          })
+          return
+        }
+
         const row = JSON.parse(data)
         emitter.emit('row', row)
       }
     )
+    if (control) {
+      emitter._setStreamControl(control)
+    }
 
     return emitter
   }
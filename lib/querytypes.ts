@@ -379,4 +379,18 @@ export interface QueryOptions {
    * The timeout for this operation, represented in milliseconds.
    */
   timeout?: number
+
+  /**
+   * The maximum number of rows to deliver from the network layer at once.
+   * Batching rows reduces the per-row overhead when streaming large results.
+   * Rows which do not fill a batch are still delivered without delay.
+   */
+  rowBatchSize?: number
+
+  /**
+   * The maximum number of bytes of rows to deliver from the network layer at
+   * once.  This can be used together with rowBatchSize, in which case the
+   * batch is delivered as soon as either limit is reached.
+   */
+  rowBatchBytes?: number
 }
@@ -109,11 +109,13 @@ export class SearchExecutor {
       })
     })
 
-    this._conn.searchQuery(
+    const control = this._conn.searchQuery(
       queryData,
       queryFlags,
       options.parentSpan,
       lcbTimeout,
+      options.rowBatchSize,
+      options.rowBatchBytes,
       (err, flags, data) => {
         if (!(flags & binding.LCBX_RESP_F_NONFINAL)) {
           if (err) {
@@ -134,10 +136,20 @@ export class SearchExecutor {
           return
         }
 
+        if (flags & binding.LCBX_RESP_F_ROWBATCH) {
+          data.forEach((rowData: any) => {
+            emitter.emit('row', JSON.parse(rowData))
+          })
+          return
+        }
+
         const row = JSON.parse(data)
         emitter.emit('row', row)
       }
     )
+    if (control) {
+      emitter._setStreamControl(control)
+    }
 
     return emitter
   }
@@ -1,5 +1,6 @@
 /* eslint jsdoc/require-jsdoc: off */
 import EventEmitter from 'events'
+import { CppStreamControl } from './binding'
 
 /**
  * @internal
@@ -75,6 +76,10 @@ export class StreamablePromise<T> extends EventEmitter implements Promise<T> {
  * streaming of results by listening for the row and meta events.
  */
 export class StreamableRowPromise<T, TRow, TMeta> extends StreamablePromise<T> {
+  private _control: CppStreamControl | undefined
+  private _paused = false
+  private _pendingEvents: [string | symbol, any[]][] = []
+
   constructor(fn: (rows: TRow[], meta: TMeta) => T) {
     super((emitter, resolve, reject) => {
       let err: Error | undefined
@@ -93,6 +98,80 @@ export class StreamableRowPromise<T, TRow, TMeta> extends StreamablePromise<T> {
       })
     })
   }
+
+  /**
+   * Stops the delivery of rows, and stops reading further rows from the
+   * network until {@link resume} is called.  Rows which were already
+   * received at the time of pausing are held until the stream is resumed.
+   */
+  pause(): this {
+    if (!this._paused) {
+      this._paused = true
+      if (this._control) {
+        this._control.pause()
+      }
+    }
+    return this
+  }
+
+  /**
+   * Resumes the delivery of rows after a call to {@link pause}.
+   */
+  resume(): this {
+    if (!this._paused) {
+      return this
+    }
+
+    this._paused = false
+
+    // The handlers of the held events may pause the stream again, in which
+    // case the remaining events stay held.
+    while (!this._paused && this._pendingEvents.length > 0) {
+      const [event, args] = this._pendingEvents.shift() as [
+        string | symbol,
+        any[]
+      ]
+      super.emit(event, ...args)
+    }
+
+    if (!this._paused && this._control) {
+      this._control.resume()
+    }
+    return this
+  }
+
+  /**
+   * Returns whether the stream is currently paused.
+   */
+  isPaused(): boolean {
+    return this._paused
+  }
+
+  /**
+   * @internal
+   */
+  emit(event: string | symbol, ...args: any[]): boolean {
+    const isStreamEvent =
+      event === 'row' ||
+      event === 'meta' ||
+      event === 'error' ||
+      event === 'end'
+    if (isStreamEvent && (this._paused || this._pendingEvents.length > 0)) {
+      this._pendingEvents.push([event, args])
+      return true
+    }
+    return super.emit(event, ...args)
+  }
+
+  /**
+   * @internal
+   */
+  _setStreamControl(control: CppStreamControl): void {
+    this._control = control
+    if (this._paused) {
+      control.pause()
+    }
+  }
 }
 
 /**
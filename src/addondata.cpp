@@ -13,6 +13,35 @@ AddonData::~AddonData()
     auto instances = _instances;
     std::for_each(instances.begin(), instances.end(),
                   [](Instance *inst) { delete inst; });
+
+    _subdocResultTemplate.Reset();
+    _subdocEntryTemplate.Reset();
+    _streamControlTemplate.Reset();
+}
+
+void AddonData::init(Isolate *isolate)
+{
+    Nan::HandleScope scope;
+
+#define X(name)                                                                \
+    _name_##name.Set(isolate,                                                  \
+                     String::NewFromUtf8(isolate, #name,                       \
+                                         NewStringType::kInternalized)         \
+                         .ToLocalChecked());
+    ADDONDATA_NAMES(X)
+#undef X
+
+    // The sub-document results are created from templates with all of their
+    // properties pre-declared, so that every result shares a single shape.
+    Local<ObjectTemplate> resultTpl = Nan::New<ObjectTemplate>();
+    Nan::SetTemplate(resultTpl, names::cas(), Nan::Null());
+    Nan::SetTemplate(resultTpl, names::content(), Nan::Null());
+    _subdocResultTemplate.Reset(resultTpl);
+
+    Local<ObjectTemplate> entryTpl = Nan::New<ObjectTemplate>();
+    Nan::SetTemplate(entryTpl, names::error(), Nan::Null());
+    Nan::SetTemplate(entryTpl, names::value(), Nan::Null());
+    _subdocEntryTemplate.Reset(entryTpl);
 }
 
 void AddonData::add_instance(class Instance *conn)
@@ -35,8 +64,11 @@ NAN_MODULE_INIT(Init)
 {
     auto data = new AddonData();
 
+    // The data is attached before it is initialized, as initializing it
+    // already uses the names:: accessors.
     auto isolate = v8::Isolate::GetCurrent();
     Nan::SetIsolateData(isolate, data);
+    data->init(isolate);
     node::AddEnvironmentCleanupHook(isolate, cleanup, isolate);
 }
 
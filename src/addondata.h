@@ -11,12 +11,53 @@ namespace couchnode
 
 using namespace v8;
 
+// Strings which are used repeatedly while building response objects.  These
+// are created once per isolate rather than being re-internalized per use.
+#define ADDONDATA_NAMES(X)                                                     \
+    X(analytics)                                                               \
+    X(bucket)                                                                  \
+    X(cas)                                                                     \
+    X(client_context_id)                                                       \
+    X(code)                                                                    \
+    X(collection)                                                              \
+    X(content)                                                                 \
+    X(context)                                                                 \
+    X(ctxtype)                                                                 \
+    X(decode)                                                                  \
+    X(design_document)                                                         \
+    X(encode)                                                                  \
+    X(error)                                                                   \
+    X(error_message)                                                           \
+    X(first_error_code)                                                        \
+    X(first_error_message)                                                     \
+    X(headers)                                                                 \
+    X(http_response_body)                                                      \
+    X(http_response_code)                                                      \
+    X(index)                                                                   \
+    X(index_name)                                                              \
+    X(key)                                                                     \
+    X(kv)                                                                      \
+    X(opaque)                                                                  \
+    X(parameters)                                                              \
+    X(query)                                                                   \
+    X(ref)                                                                     \
+    X(scope)                                                                   \
+    X(search)                                                                  \
+    X(statement)                                                               \
+    X(statusCode)                                                              \
+    X(status_code)                                                             \
+    X(value)                                                                   \
+    X(view)                                                                    \
+    X(views)
+
 class AddonData
 {
 public:
     AddonData();
     ~AddonData();
 
+    void init(Isolate *isolate);
+
     void add_instance(class Instance *conn);
     void remove_instance(class Instance *conn);
 
@@ -24,6 +65,13 @@ public:
     Nan::Persistent<Function> _connectionConstructor;
     Nan::Persistent<Function> _casConstructor;
     Nan::Persistent<Function> _mutationtokenConstructor;
+    Nan::Persistent<ObjectTemplate> _subdocResultTemplate;
+    Nan::Persistent<ObjectTemplate> _subdocEntryTemplate;
+    Nan::Persistent<ObjectTemplate> _streamControlTemplate;
+
+#define X(name) Eternal<String> _name_##name;
+    ADDONDATA_NAMES(X)
+#undef X
 };
 
 namespace addondata
@@ -35,6 +83,21 @@ AddonData *Get();
 
 } // namespace addondata
 
+namespace names
+{
+
+#define X(name)                                                                \
+    inline Local<String> name()                                                \
+    {                                                                          \
+        Isolate *isolate = Isolate::GetCurrent();                              \
+        AddonData *data = Nan::GetIsolateData<AddonData>(isolate);             \
+        return data->_name_##name.Get(isolate);                                \
+    }
+ADDONDATA_NAMES(X)
+#undef X
+
+} // namespace names
+
 } // namespace couchnode
 
 #endif // ADDONDATA_H
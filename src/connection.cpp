@@ -2,6 +2,7 @@
 
 #include "error.h"
 #include "logger.h"
+#include "respreader.h"
 
 namespace couchnode
 {
@@ -29,10 +30,17 @@ NAN_MODULE_INIT(Connection::Init)
     Nan::SetPrototypeMethod(tpl, "selectBucket", fnSelectBucket);
     Nan::SetPrototypeMethod(tpl, "shutdown", fnShutdown);
     Nan::SetPrototypeMethod(tpl, "cntl", fnCntl);
+    Nan::SetPrototypeMethod(tpl, "setCompletionHandler",
+                            fnSetCompletionHandler);
+    Nan::SetPrototypeMethod(tpl, "poolStats", fnPoolStats);
+    Nan::SetPrototypeMethod(tpl, "keyShard", fnKeyShard);
+    Nan::SetPrototypeMethod(tpl, "keyShards", fnKeyShards);
     Nan::SetPrototypeMethod(tpl, "get", fnGet);
     Nan::SetPrototypeMethod(tpl, "exists", fnExists);
     Nan::SetPrototypeMethod(tpl, "getReplica", fnGetReplica);
     Nan::SetPrototypeMethod(tpl, "store", fnStore);
+    Nan::SetPrototypeMethod(tpl, "getMulti", fnGetMulti);
+    Nan::SetPrototypeMethod(tpl, "upsertMulti", fnUpsertMulti);
     Nan::SetPrototypeMethod(tpl, "remove", fnRemove);
     Nan::SetPrototypeMethod(tpl, "touch", fnTouch);
     Nan::SetPrototypeMethod(tpl, "unlock", fnUnlock);
@@ -57,21 +65,49 @@ NAN_METHOD(Connection::fnNew)
 {
     Nan::HandleScope scope;
 
-    if (info.Length() != 7) {
-        return Nan::ThrowError(Error::create("expected 7 parameters"));
+    if (info.Length() != 10) {
+        return Nan::ThrowError(Error::create("expected 10 parameters"));
+    }
+
+    uint32_t connFlags = 0;
+    if (!ValueParser::parseUint(&connFlags, info[7])) {
+        return Nan::ThrowError(Error::create("must pass integer for flags"));
+    }
+
+    bool useIoThread = (connFlags & LCBX_CONNFLAG_IO_THREAD) != 0;
+    if (useIoThread) {
+        // The tracer and meter would be invoked from the I/O thread, where
+        // there is no way to call into JS.
+        if (!info[5]->IsUndefined() && !info[5]->IsNull()) {
+            return Nan::ThrowError(
+                Error::create("cannot use a tracer with an io thread"));
+        }
+        if (!info[6]->IsUndefined() && !info[6]->IsNull()) {
+            return Nan::ThrowError(
+                Error::create("cannot use a meter with an io thread"));
+        }
     }
 
     lcb_STATUS err;
 
+    IoThread *ioThread = nullptr;
+    if (useIoThread) {
+        ioThread = new IoThread();
+    }
+
     lcb_io_opt_st *iops;
     lcbuv_options_t iopsOptions;
 
     iopsOptions.version = 0;
-    iopsOptions.v.v0.loop = Nan::GetCurrentEventLoop();
+    iopsOptions.v.v0.loop =
+        ioThread ? ioThread->loop() : Nan::GetCurrentEventLoop();
     iopsOptions.v.v0.startsop_noop = 1;
 
     err = lcb_create_libuv_io_opts(0, &iops, &iopsOptions);
     if (err != LCB_SUCCESS) {
+        if (ioThread) {
+            delete ioThread;
+        }
         return Nan::ThrowError(Error::create(err));
     }
 
@@ -137,9 +173,46 @@ NAN_METHOD(Connection::fnNew)
                 Error::create("must pass function for logger"));
         }
 
+        int minSeverity = LCB_LOG_TRACE;
+        std::vector<std::string> subsystems;
+        if (!info[9]->IsUndefined() && !info[9]->IsNull()) {
+            if (!info[9]->IsObject()) {
+                return Nan::ThrowError(
+                    Error::create("must pass object for log filter"));
+            }
+            Local<Object> filterObj = info[9].As<Object>();
+
+            Local<Value> minSeverityVal =
+                Nan::Get(filterObj, Nan::New("minSeverity").ToLocalChecked())
+                    .ToLocalChecked();
+            if (!minSeverityVal->IsUndefined() && !minSeverityVal->IsNull()) {
+                if (!minSeverityVal->IsNumber()) {
+                    return Nan::ThrowError(
+                        Error::create("must pass integer for log severity"));
+                }
+                minSeverity = Nan::To<int>(minSeverityVal).FromJust();
+            }
+
+            Local<Value> subsystemsVal =
+                Nan::Get(filterObj, Nan::New("subsystems").ToLocalChecked())
+                    .ToLocalChecked();
+            if (!subsystemsVal->IsUndefined() && !subsystemsVal->IsNull()) {
+                if (!subsystemsVal->IsArray()) {
+                    return Nan::ThrowError(
+                        Error::create("must pass array for log subsystems"));
+                }
+                Local<Array> subsystemsArr = subsystemsVal.As<Array>();
+                for (uint32_t i = 0; i < subsystemsArr->Length(); ++i) {
+                    Nan::Utf8String subsys(
+                        Nan::Get(subsystemsArr, i).ToLocalChecked());
+                    subsystems.emplace_back(*subsys, subsys.length());
+                }
+            }
+        }
+
         Local<Function> logFn = info[4].As<Function>();
         if (!logFn.IsEmpty()) {
-            logger = new Logger(logFn);
+            logger = new Logger(logFn, minSeverity, std::move(subsystems));
             lcb_createopts_logger(createOpts, logger->lcbProcs());
         }
     }
@@ -158,6 +231,14 @@ NAN_METHOD(Connection::fnNew)
         }
     }
 
+    uint32_t meterEmitInterval = 0;
+    if (!info[8]->IsUndefined() && !info[8]->IsNull()) {
+        if (!ValueParser::parseUint(&meterEmitInterval, info[8])) {
+            return Nan::ThrowError(
+                Error::create("must pass integer for meter emit interval"));
+        }
+    }
+
     Meter *meter = nullptr;
     if (!info[6]->IsUndefined() && !info[6]->IsNull()) {
         if (!info[6]->IsObject()) {
@@ -166,7 +247,7 @@ NAN_METHOD(Connection::fnNew)
 
         Local<Object> meterVal = info[6].As<Object>();
         if (!meterVal.IsEmpty()) {
-            meter = new Meter(meterVal);
+            meter = new Meter(meterVal, meterEmitInterval);
             lcb_createopts_meter(createOpts, meter->lcbProcs());
         }
     }
@@ -198,11 +279,18 @@ NAN_METHOD(Connection::fnNew)
         if (meter) {
             delete meter;
         }
+        if (ioThread) {
+            delete ioThread;
+        }
 
         return Nan::ThrowError(Error::create(err));
     }
 
-    Instance *inst = new Instance(instance, logger, tracer, meter);
+    Instance *inst =
+        new Instance(instance, connFlags, logger, tracer, meter, ioThread);
+    if (ioThread) {
+        ioThread->start(instance);
+    }
 
     Connection *obj = new Connection(inst);
     obj->Wrap(info.This());
@@ -226,7 +314,11 @@ NAN_METHOD(Connection::fnConnect)
     }
     inst->_bootstrapCookie = new Cookie("connect", info[0].As<Function>());
 
-    lcb_STATUS ec = lcb_connect(inst->_instance);
+    lcb_STATUS ec;
+    {
+        IoThread::Lock lock(inst->_ioThread);
+        ec = lcb_connect(inst->_instance);
+    }
     if (ec != LCB_SUCCESS) {
         return Nan::ThrowError(Error::create(ec));
     }
@@ -257,7 +349,11 @@ NAN_METHOD(Connection::fnSelectBucket)
     }
     inst->_openCookie = new Cookie("open", info[1].As<Function>());
 
-    lcb_STATUS ec = lcb_open(inst->_instance, *bucketName, bucketName.length());
+    lcb_STATUS ec;
+    {
+        IoThread::Lock lock(inst->_ioThread);
+        ec = lcb_open(inst->_instance, *bucketName, bucketName.length());
+    }
     if (ec != LCB_SUCCESS) {
         return Nan::ThrowError(Error::create(ec));
     }
@@ -278,6 +374,127 @@ NAN_METHOD(Connection::fnShutdown)
     info.GetReturnValue().Set(true);
 }
 
+NAN_METHOD(Connection::fnSetCompletionHandler)
+{
+    Connection *me = ObjectWrap::Unwrap<Connection>(info.This());
+    Instance *inst = me->_instance;
+    Nan::HandleScope scope;
+
+    if (info.Length() != 1) {
+        return Nan::ThrowError(Error::create("expected 1 parameter"));
+    }
+
+    if (!info[0]->IsFunction()) {
+        return Nan::ThrowError(
+            Error::create("must pass function for completion handler"));
+    }
+
+    inst->setCompletionHandler(info[0].As<Function>());
+
+    info.GetReturnValue().Set(true);
+}
+
+NAN_METHOD(Connection::fnPoolStats)
+{
+    Connection *me = ObjectWrap::Unwrap<Connection>(info.This());
+    Instance *inst = me->_instance;
+    Nan::HandleScope scope;
+
+    Local<Object> statsObj = Nan::New<Object>();
+    Nan::Set(statsObj, Nan::New("cookieHits").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(
+                 inst->_cookiePool.hits())));
+    Nan::Set(statsObj, Nan::New("cookieMisses").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(
+                 inst->_cookiePool.misses())));
+    Nan::Set(statsObj, Nan::New("stringArenaHits").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(
+                 inst->_stringArena.hits())));
+    Nan::Set(statsObj, Nan::New("stringArenaMisses").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(
+                 inst->_stringArena.misses())));
+    Nan::Set(statsObj, Nan::New("zeroCopyBuffers").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(ZeroCopyBuffers::live())));
+
+    info.GetReturnValue().Set(statsObj);
+}
+
+// Keys are spread across the shards by vBucket rather than by server, so that
+// every shard carries a share of the traffic to each node while all operations
+// on a single key still share one connection.
+static int shardForKey(Instance *inst, const char *key, size_t nkey,
+                       uint32_t numShards)
+{
+    int vbid = inst ? inst->vbucketForKey(key, nkey) : -1;
+    if (vbid < 0) {
+        return -1;
+    }
+    return static_cast<int>(static_cast<uint32_t>(vbid) % numShards);
+}
+
+NAN_METHOD(Connection::fnKeyShard)
+{
+    Connection *me = ObjectWrap::Unwrap<Connection>(info.This());
+    Instance *inst = me->_instance;
+    Nan::HandleScope scope;
+    ValueParser parser;
+
+    if (info.Length() != 2) {
+        return Nan::ThrowError(Error::create("expected 2 parameters"));
+    }
+
+    const char *key = nullptr;
+    size_t nkey = 0;
+    if (!parser.parseString(&key, &nkey, info[0])) {
+        return Nan::ThrowError(Error::create("bad key passed"));
+    }
+
+    uint32_t numShards = 0;
+    if (!ValueParser::parseUint(&numShards, info[1]) || numShards == 0) {
+        return Nan::ThrowError(Error::create("bad shard count passed"));
+    }
+
+    info.GetReturnValue().Set(
+        Nan::New<Number>(shardForKey(inst, key, nkey, numShards)));
+}
+
+NAN_METHOD(Connection::fnKeyShards)
+{
+    Connection *me = ObjectWrap::Unwrap<Connection>(info.This());
+    Instance *inst = me->_instance;
+    Nan::HandleScope scope;
+
+    if (info.Length() != 2) {
+        return Nan::ThrowError(Error::create("expected 2 parameters"));
+    }
+    if (!info[0]->IsArray()) {
+        return Nan::ThrowError(Error::create("bad keys passed"));
+    }
+    Local<Array> keys = info[0].As<Array>();
+
+    uint32_t numShards = 0;
+    if (!ValueParser::parseUint(&numShards, info[1]) || numShards == 0) {
+        return Nan::ThrowError(Error::create("bad shard count passed"));
+    }
+
+    uint32_t numKeys = keys->Length();
+    Local<Array> shards = Nan::New<Array>(numKeys);
+    for (uint32_t i = 0; i < numKeys; ++i) {
+        ValueParser parser;
+        const char *key = nullptr;
+        size_t nkey = 0;
+        if (!parser.parseString(&key, &nkey,
+                                Nan::Get(keys, i).ToLocalChecked())) {
+            return Nan::ThrowError(Error::create("bad key passed"));
+        }
+
+        Nan::Set(shards, i,
+                 Nan::New<Number>(shardForKey(inst, key, nkey, numShards)));
+    }
+
+    info.GetReturnValue().Set(shards);
+}
+
 enum CntlFormat {
     CntlInvalid = 0,
     CntlTimeValue = 1,
@@ -309,6 +526,8 @@ NAN_METHOD(Connection::fnCntl)
     int mode = Nan::To<int>(info[0]).FromJust();
     int option = Nan::To<int>(info[1]).FromJust();
 
+    IoThread::Lock lock(inst->_ioThread);
+
     CntlFormat fmt = getCntlFormat(option);
     if (fmt == CntlTimeValue) {
         if (mode == LCB_CNTL_GET) {
@@ -42,11 +42,17 @@ private:
     static NAN_METHOD(fnSelectBucket);
     static NAN_METHOD(fnShutdown);
     static NAN_METHOD(fnCntl);
+    static NAN_METHOD(fnSetCompletionHandler);
+    static NAN_METHOD(fnPoolStats);
+    static NAN_METHOD(fnKeyShard);
+    static NAN_METHOD(fnKeyShards);
 
     static NAN_METHOD(fnGet);
     static NAN_METHOD(fnExists);
     static NAN_METHOD(fnGetReplica);
     static NAN_METHOD(fnStore);
+    static NAN_METHOD(fnGetMulti);
+    static NAN_METHOD(fnUpsertMulti);
     static NAN_METHOD(fnRemove);
     static NAN_METHOD(fnTouch);
     static NAN_METHOD(fnUnlock);
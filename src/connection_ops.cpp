@@ -175,8 +175,8 @@ NAN_METHOD(Connection::fnStore)
         {
             Nan::TryCatch tryCatch;
             parseRes =
-                enc.parseDocValue<&lcb_cmdstore_value, &lcb_cmdstore_flags>(
-                    info[4]);
+                enc.parseDocValue<&lcb_cmdstore_value, &lcb_cmdstore_flags,
+                                  &lcb_cmdstore_value_nocopy>(info[4]);
             if (tryCatch.HasCaught()) {
                 errVal = tryCatch.Exception();
             }
@@ -233,7 +233,183 @@ NAN_METHOD(Connection::fnStore)
         // No need to do anything special for everyone else
     }
 
-    lcb_STATUS err = enc.execute<&lcb_store>();
+    lcb_STATUS err = enc.executeCompressed<&lcb_store>();
+    if (err) {
+        return Nan::ThrowError(Error::create(err));
+    }
+
+    return info.GetReturnValue().Set(true);
+}
+
+NAN_METHOD(Connection::fnGetMulti)
+{
+    Connection *me = ObjectWrap::Unwrap<Connection>(info.This());
+    Instance *inst = me->_instance;
+    Nan::HandleScope scope;
+    OpBuilder<lcb_CMDGET> enc(inst);
+
+    if (!enc.parseParentSpan(info[4])) {
+        return Nan::ThrowError(Error::create("bad parent span passed"));
+    }
+    enc.beginTrace(LCBTRACE_SERVICE_KV, "getMulti");
+
+    if (!enc.parseOption<&lcb_cmdget_collection>(info[0], info[1])) {
+        return Nan::ThrowError(Error::create("bad scope/collection passed"));
+    }
+    if (!info[2]->IsArray()) {
+        return Nan::ThrowError(Error::create("bad keys passed"));
+    }
+    Local<Array> keys = info[2].As<Array>();
+    if (!enc.parseTranscoder(info[3])) {
+        return Nan::ThrowError(Error::create("bad transcoder passed"));
+    }
+    if (!enc.parseOption<&lcb_cmdget_timeout>(info[5])) {
+        return Nan::ThrowError(Error::create("bad timeout passed"));
+    }
+    if (!enc.parseCallback(info[6])) {
+        return Nan::ThrowError(Error::create("bad callback passed"));
+    }
+
+    uint32_t numKeys = keys->Length();
+    if (numKeys == 0) {
+        return Nan::ThrowError(Error::create("bad keys passed"));
+    }
+
+    // Every key is parsed before any of them is scheduled, a bad key must
+    // not leave the items before it in flight.
+    std::vector<std::pair<const char *, size_t>> parsedKeys(numKeys);
+    for (uint32_t i = 0; i < numKeys; ++i) {
+        Local<Value> key = Nan::Get(keys, i).ToLocalChecked();
+        if (!enc.valueParser().parseString(&parsedKeys[i].first,
+                                           &parsedKeys[i].second, key)) {
+            return Nan::ThrowError(Error::create("bad key passed"));
+        }
+    }
+
+    lcb_STATUS err = enc.beginBatch(numKeys);
+    if (err) {
+        return Nan::ThrowError(Error::create(err));
+    }
+
+    for (uint32_t i = 0; i < numKeys; ++i) {
+        lcb_cmdget_key(enc.cmd(), parsedKeys[i].first, parsedKeys[i].second);
+        enc.executeBatchItem<&lcb_get>(i);
+    }
+
+    err = enc.commitBatch();
+    if (err) {
+        return Nan::ThrowError(Error::create(err));
+    }
+
+    return info.GetReturnValue().Set(true);
+}
+
+NAN_METHOD(Connection::fnUpsertMulti)
+{
+    Connection *me = ObjectWrap::Unwrap<Connection>(info.This());
+    Instance *inst = me->_instance;
+    Nan::HandleScope scope;
+    OpBuilder<lcb_CMDSTORE> enc(inst, LCB_STORE_UPSERT);
+
+    if (!enc.parseParentSpan(info[7])) {
+        return Nan::ThrowError(Error::create("bad parent span passed"));
+    }
+    enc.beginTrace(LCBTRACE_SERVICE_KV, "upsertMulti");
+
+    if (!enc.parseOption<&lcb_cmdstore_collection>(info[0], info[1])) {
+        return Nan::ThrowError(Error::create("bad scope/collection passed"));
+    }
+    if (!info[2]->IsArray()) {
+        return Nan::ThrowError(Error::create("bad keys passed"));
+    }
+    Local<Array> keys = info[2].As<Array>();
+    if (!info[3]->IsArray()) {
+        return Nan::ThrowError(Error::create("bad values passed"));
+    }
+    Local<Array> values = info[3].As<Array>();
+    if (!enc.parseTranscoder(info[4])) {
+        return Nan::ThrowError(Error::create("bad transcoder passed"));
+    }
+    if (ValueParser::isSet(info[5])) {
+        if (ValueParser::asInt64(info[5]) < 0) {
+            lcb_cmdstore_preserve_expiry(enc.cmd(), 1);
+        } else {
+            if (!enc.parseOption<&lcb_cmdstore_expiry>(info[5])) {
+                return Nan::ThrowError(Error::create("bad expiry passed"));
+            }
+        }
+    }
+    lcb_DURABILITY_LEVEL durabilityLevel =
+        static_cast<lcb_DURABILITY_LEVEL>(ValueParser::asUint(info[6]));
+    if (durabilityLevel != LCB_DURABILITYLEVEL_NONE) {
+        lcb_cmdstore_durability(enc.cmd(), durabilityLevel);
+    }
+    if (!enc.parseOption<&lcb_cmdstore_timeout>(info[8])) {
+        return Nan::ThrowError(Error::create("bad timeout passed"));
+    }
+    if (!enc.parseCallback(info[9])) {
+        return Nan::ThrowError(Error::create("bad callback passed"));
+    }
+
+    uint32_t numKeys = keys->Length();
+    if (numKeys == 0 || values->Length() != numKeys) {
+        return Nan::ThrowError(Error::create("bad keys passed"));
+    }
+
+    // Every key and value is parsed and encoded before any of them is
+    // scheduled, a bad item must not leave the items before it in flight.
+    struct ParsedItem {
+        const char *key;
+        size_t nkey;
+        const char *bytes;
+        size_t nbytes;
+        uint32_t flags;
+    };
+    std::vector<ParsedItem> items(numKeys);
+    for (uint32_t i = 0; i < numKeys; ++i) {
+        ParsedItem &item = items[i];
+        Local<Value> key = Nan::Get(keys, i).ToLocalChecked();
+        if (!enc.valueParser().parseString(&item.key, &item.nkey, key)) {
+            return Nan::ThrowError(Error::create("bad key passed"));
+        }
+
+        Local<Value> errVal;
+        bool parseRes;
+        {
+            Nan::TryCatch tryCatch;
+            Local<Value> encoded;
+            parseRes =
+                enc.encodeDocValue(Nan::Get(values, i).ToLocalChecked(),
+                                   &encoded, &item.flags) &&
+                enc.valueParser().parseString(&item.bytes, &item.nbytes,
+                                              encoded);
+            if (tryCatch.HasCaught()) {
+                errVal = tryCatch.Exception();
+            }
+        }
+        if (!parseRes) {
+            if (!errVal.IsEmpty()) {
+                return Nan::ThrowError(errVal);
+            }
+
+            return Nan::ThrowError(Error::create("bad value passed"));
+        }
+    }
+
+    lcb_STATUS err = enc.beginBatch(numKeys);
+    if (err) {
+        return Nan::ThrowError(Error::create(err));
+    }
+
+    for (uint32_t i = 0; i < numKeys; ++i) {
+        const ParsedItem &item = items[i];
+        lcb_cmdstore_key(enc.cmd(), item.key, item.nkey);
+        lcb_cmdstore_value(enc.cmd(), item.bytes, item.nbytes);
+        lcb_cmdstore_flags(enc.cmd(), item.flags);
+        enc.executeBatchItem<&lcb_store>(i);
+    }
+
+    err = enc.commitBatch();
     if (err) {
         return Nan::ThrowError(Error::create(err));
     }
@@ -623,7 +799,9 @@ NAN_METHOD(Connection::fnViewQuery)
     }
     enc.beginTrace(LCBTRACE_SERVICE_VIEW, "viewQuery");
 
-    lcb_cmdview_callback(enc.cmd(), &Instance::lcbViewDataHandler);
+    lcb_cmdview_callback(
+        enc.cmd(),
+        &Instance::ioRespHandler<lcb_RESPVIEW, &Instance::lcbViewDataHandler>);
 
     if (!enc.parseOption<&lcb_cmdview_design_document>(info[0])) {
         return Nan::ThrowError(Error::create("bad ddoc name passed"));
@@ -665,7 +843,11 @@ NAN_METHOD(Connection::fnQuery)
     }
     enc.beginTrace(LCBTRACE_SERVICE_QUERY, "query");
 
-    lcb_cmdquery_callback(enc.cmd(), &Instance::lcbQueryDataHandler);
+    lcb_cmdquery_callback(
+        enc.cmd(),
+        &StreamOpCookie::respHandler<lcb_RESPQUERY, &lcb_respquery_cookie,
+                                     &lcb_respquery_is_final,
+                                     &Instance::lcbQueryDataHandler>);
 
     if (!enc.parseOption<&lcb_cmdquery_payload>(info[0])) {
         return Nan::ThrowError(Error::create("bad query passed"));
@@ -679,16 +861,27 @@ NAN_METHOD(Connection::fnQuery)
     if (!enc.parseOption<&lcb_cmdquery_timeout>(info[3])) {
         return Nan::ThrowError(Error::create("bad timeout passed"));
     }
-    if (!enc.parseCallback(info[4])) {
+    uint32_t maxRows = 0;
+    if (!ValueParser::parseUint(&maxRows, info[4])) {
+        return Nan::ThrowError(Error::create("bad row batch size passed"));
+    }
+    uint32_t maxBytes = 0;
+    if (!ValueParser::parseUint(&maxBytes, info[5])) {
+        return Nan::ThrowError(Error::create("bad row batch bytes passed"));
+    }
+    if (!enc.parseCallback(info[6])) {
         return Nan::ThrowError(Error::create("bad callback passed"));
     }
 
-    lcb_STATUS err = enc.execute<&lcb_query>();
+    lcb_STATUS err;
+    Nan::MaybeLocal<Object> controlM =
+        enc.executeStream<lcb_QUERY_HANDLE, &lcb_cmdquery_handle,
+                          &lcb_query>(maxRows, maxBytes, &err);
     if (err) {
         return Nan::ThrowError(Error::create(err));
     }
 
-    return info.GetReturnValue().Set(true);
+    return info.GetReturnValue().Set(controlM.ToLocalChecked());
 }
 
 NAN_METHOD(Connection::fnAnalyticsQuery)
@@ -703,7 +896,11 @@ NAN_METHOD(Connection::fnAnalyticsQuery)
     }
     enc.beginTrace(LCBTRACE_SERVICE_ANALYTICS, "analyticsQuery");
 
-    lcb_cmdanalytics_callback(enc.cmd(), &Instance::lcbAnalyticsDataHandler);
+    lcb_cmdanalytics_callback(
+        enc.cmd(), &StreamOpCookie::respHandler<
+                       lcb_RESPANALYTICS, &lcb_respanalytics_cookie,
+                       &lcb_respanalytics_is_final,
+                       &Instance::lcbAnalyticsDataHandler>);
 
     if (!enc.parseOption<&lcb_cmdanalytics_payload>(info[0])) {
         return Nan::ThrowError(Error::create("bad query passed"));
@@ -717,16 +914,27 @@ NAN_METHOD(Connection::fnAnalyticsQuery)
     if (!enc.parseOption<&lcb_cmdanalytics_timeout>(info[3])) {
         return Nan::ThrowError(Error::create("bad timeout passed"));
     }
-    if (!enc.parseCallback(info[4])) {
+    uint32_t maxRows = 0;
+    if (!ValueParser::parseUint(&maxRows, info[4])) {
+        return Nan::ThrowError(Error::create("bad row batch size passed"));
+    }
+    uint32_t maxBytes = 0;
+    if (!ValueParser::parseUint(&maxBytes, info[5])) {
+        return Nan::ThrowError(Error::create("bad row batch bytes passed"));
+    }
+    if (!enc.parseCallback(info[6])) {
         return Nan::ThrowError(Error::create("bad callback passed"));
     }
 
-    lcb_STATUS err = enc.execute<&lcb_analytics>();
+    lcb_STATUS err;
+    Nan::MaybeLocal<Object> controlM =
+        enc.executeStream<lcb_ANALYTICS_HANDLE, &lcb_cmdanalytics_handle,
+                          &lcb_analytics>(maxRows, maxBytes, &err);
     if (err) {
         return Nan::ThrowError(Error::create(err));
     }
 
-    return info.GetReturnValue().Set(true);
+    return info.GetReturnValue().Set(controlM.ToLocalChecked());
 }
 
 NAN_METHOD(Connection::fnSearchQuery)
@@ -741,7 +949,11 @@ NAN_METHOD(Connection::fnSearchQuery)
     }
     enc.beginTrace(LCBTRACE_SERVICE_SEARCH, "searchQuery");
 
-    lcb_cmdsearch_callback(enc.cmd(), &Instance::lcbSearchDataHandler);
+    lcb_cmdsearch_callback(
+        enc.cmd(),
+        &StreamOpCookie::respHandler<lcb_RESPSEARCH, &lcb_respsearch_cookie,
+                                     &lcb_respsearch_is_final,
+                                     &Instance::lcbSearchDataHandler>);
 
     if (!enc.parseOption<&lcb_cmdsearch_payload>(info[0])) {
         return Nan::ThrowError(Error::create("bad query passed"));
@@ -750,16 +962,27 @@ NAN_METHOD(Connection::fnSearchQuery)
     if (!enc.parseOption<&lcb_cmdsearch_timeout>(info[3])) {
         return Nan::ThrowError(Error::create("bad timeout passed"));
     }
-    if (!enc.parseCallback(info[4])) {
+    uint32_t maxRows = 0;
+    if (!ValueParser::parseUint(&maxRows, info[4])) {
+        return Nan::ThrowError(Error::create("bad row batch size passed"));
+    }
+    uint32_t maxBytes = 0;
+    if (!ValueParser::parseUint(&maxBytes, info[5])) {
+        return Nan::ThrowError(Error::create("bad row batch bytes passed"));
+    }
+    if (!enc.parseCallback(info[6])) {
         return Nan::ThrowError(Error::create("bad callback passed"));
     }
 
-    lcb_STATUS err = enc.execute<&lcb_search>();
+    lcb_STATUS err;
+    Nan::MaybeLocal<Object> controlM =
+        enc.executeStream<lcb_SEARCH_HANDLE, &lcb_cmdsearch_handle,
+                          &lcb_search>(maxRows, maxBytes, &err);
     if (err) {
         return Nan::ThrowError(Error::create(err));
     }
 
-    return info.GetReturnValue().Set(true);
+    return info.GetReturnValue().Set(controlM.ToLocalChecked());
 }
 
 NAN_METHOD(Connection::fnHttpRequest)
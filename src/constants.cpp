@@ -169,6 +169,7 @@ NAN_MODULE_INIT(Init)
     X(LCB_ERR_HTTP)
     X(LCB_ERR_QUERY)
     X(LCB_ERR_TOPOLOGY_CHANGE)
+    X(LCB_ERR_REQUEST_BUDGET_EXCEEDED)
 
     X(LCB_LOG_TRACE)
     X(LCB_LOG_DEBUG)
@@ -253,6 +254,12 @@ NAN_MODULE_INIT(Init)
     X(LCB_TYPE_CLUSTER)
 
     X(LCBX_RESP_F_NONFINAL)
+    X(LCBX_RESP_F_ROWBATCH)
+
+    X(LCBX_CONNFLAG_ZEROCOPY_VALUES)
+    X(LCBX_CONNFLAG_BATCH_COMPLETIONS)
+    X(LCBX_CONNFLAG_IO_THREAD)
+    X(LCBX_CONNFLAG_PARALLEL_COMPRESSION)
 
 #undef X
 }
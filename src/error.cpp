@@ -1,5 +1,7 @@
 #include "error.h"
 
+#include "addondata.h"
+
 namespace couchnode
 {
 
@@ -10,8 +12,7 @@ NAN_MODULE_INIT(Error::Init)
 Local<Value> Error::create(const std::string &msg, lcb_STATUS err)
 {
     Local<Object> errObj = Nan::Error(msg.c_str()).As<Object>();
-    Nan::Set(errObj, Nan::New<String>("code").ToLocalChecked(),
-             Nan::New<Integer>(err));
+    Nan::Set(errObj, names::code(), Nan::New<Integer>(err));
 
     return errObj;
 }
@@ -23,8 +24,7 @@ Local<Value> Error::create(lcb_STATUS err)
     }
 
     Local<Object> errObj = Nan::Error(lcb_strerror_long(err)).As<Object>();
-    Nan::Set(errObj, Nan::New<String>("code").ToLocalChecked(),
-             Nan::New<Integer>(err));
+    Nan::Set(errObj, names::code(), Nan::New<Integer>(err));
 
     return errObj;
 }
@@ -2,19 +2,77 @@
 
 #include "error.h"
 #include "logger.h"
+#include "opbuilder.h"
+
+#include <libcouchbase/pktfwd.h>
+#include <libcouchbase/vbucket.h>
 
 namespace couchnode
 {
 
-Instance::Instance(lcb_INSTANCE *instance, Logger *logger,
-                   RequestTracer *tracer, Meter *meter)
+/*
+ * Delivers the result of a bootstrap or bucket open, which is reported on the
+ * I/O thread, to the V8 thread.
+ */
+class StatusCompletion : public IoThread::Completion
+{
+public:
+    StatusCompletion(Instance *inst, void (Instance::*fn)(lcb_STATUS),
+                     lcb_STATUS err)
+        : _inst(inst)
+        , _fn(fn)
+        , _err(err)
+    {
+    }
+
+    void deliver() override
+    {
+        (_inst->*_fn)(_err);
+    }
+
+private:
+    Instance *_inst;
+    void (Instance::*_fn)(lcb_STATUS);
+    lcb_STATUS _err;
+};
+
+/*
+ * Delivers the release of an operations value, which libcouchbase reports on
+ * the I/O thread, to the V8 thread where the buffer holding it lives.
+ */
+class ValueReleaseCompletion : public IoThread::Completion
+{
+public:
+    ValueReleaseCompletion(OpCookie *cookie)
+        : _cookie(cookie)
+    {
+    }
+
+    void deliver() override
+    {
+        OpCookie::releaseValue(_cookie);
+    }
+
+private:
+    OpCookie *_cookie;
+};
+
+Instance::Instance(lcb_INSTANCE *instance, uint32_t flags, Logger *logger,
+                   RequestTracer *tracer, Meter *meter, IoThread *ioThread)
     : _instance(instance)
+    , _flags(flags)
     , _logger(logger)
     , _tracer(tracer)
     , _meter(meter)
     , _clientStringCache(nullptr)
+    , _vbucketCount(0)
+    , _ioThread(ioThread)
     , _bootstrapCookie(nullptr)
     , _openCookie(nullptr)
+    , _completionCookie(nullptr)
+    , _numCompletions(0)
+    , _pendingCompressions(0)
+    , _shuttingDown(false)
 {
     _parent = addondata::Get();
     _parent->add_instance(this);
@@ -27,48 +85,46 @@ Instance::Instance(lcb_INSTANCE *instance, Logger *logger,
     uv_check_init(Nan::GetCurrentEventLoop(), _shutdownProc);
     _shutdownProc->data = this;
 
+    _completionWatch = new uv_check_t();
+    uv_check_init(Nan::GetCurrentEventLoop(), _completionWatch);
+    _completionWatch->data = this;
+
+    _completionIdle = new uv_idle_t();
+    uv_idle_init(Nan::GetCurrentEventLoop(), _completionIdle);
+    _completionIdle->data = this;
+
+    _rowFlushWatch = new uv_check_t();
+    uv_check_init(Nan::GetCurrentEventLoop(), _rowFlushWatch);
+    _rowFlushWatch->data = this;
+
+    _rowFlushIdle = new uv_idle_t();
+    uv_idle_init(Nan::GetCurrentEventLoop(), _rowFlushIdle);
+    _rowFlushIdle->data = this;
+
     lcb_set_cookie(instance, reinterpret_cast<void *>(this));
     lcb_set_bootstrap_callback(instance, &lcbBootstapHandler);
     lcb_set_open_callback(instance, &lcbOpenHandler);
-    lcb_install_callback(
-        instance, LCB_CALLBACK_GET,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbGetRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_EXISTS,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbExistsRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_GETREPLICA,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbGetReplicaRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_STORE,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbStoreRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_COUNTER,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbCounterRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_REMOVE,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbRemoveRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_TOUCH,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbTouchRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_UNLOCK,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbUnlockRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_SDLOOKUP,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbLookupRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_SDMUTATE,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbMutateRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_PING,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbPingRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_DIAG,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbDiagRespHandler));
-    lcb_install_callback(
-        instance, LCB_CALLBACK_HTTP,
-        reinterpret_cast<lcb_RESPCALLBACK>(&lcbHttpDataHandler));
+    lcb_set_pktflushed_callback(instance, &lcbValueReleasedHandler);
+    installCallback<lcb_RESPGET, &lcbGetRespHandler>(LCB_CALLBACK_GET);
+    installCallback<lcb_RESPEXISTS, &lcbExistsRespHandler>(
+        LCB_CALLBACK_EXISTS);
+    installCallback<lcb_RESPGETREPLICA, &lcbGetReplicaRespHandler>(
+        LCB_CALLBACK_GETREPLICA);
+    installCallback<lcb_RESPSTORE, &lcbStoreRespHandler>(LCB_CALLBACK_STORE);
+    installCallback<lcb_RESPCOUNTER, &lcbCounterRespHandler>(
+        LCB_CALLBACK_COUNTER);
+    installCallback<lcb_RESPREMOVE, &lcbRemoveRespHandler>(
+        LCB_CALLBACK_REMOVE);
+    installCallback<lcb_RESPTOUCH, &lcbTouchRespHandler>(LCB_CALLBACK_TOUCH);
+    installCallback<lcb_RESPUNLOCK, &lcbUnlockRespHandler>(
+        LCB_CALLBACK_UNLOCK);
+    installCallback<lcb_RESPSUBDOC, &lcbLookupRespHandler>(
+        LCB_CALLBACK_SDLOOKUP);
+    installCallback<lcb_RESPSUBDOC, &lcbMutateRespHandler>(
+        LCB_CALLBACK_SDMUTATE);
+    installCallback<lcb_RESPPING, &lcbPingRespHandler>(LCB_CALLBACK_PING);
+    installCallback<lcb_RESPDIAG, &lcbDiagRespHandler>(LCB_CALLBACK_DIAG);
+    installCallback<lcb_RESPHTTP, &lcbHttpDataHandler>(LCB_CALLBACK_HTTP);
 }
 
 Instance::~Instance()
@@ -92,14 +148,55 @@ Instance::~Instance()
         _shutdownProc = nullptr;
     }
 
-    if (_instance) {
+    if (_completionWatch) {
+        uv_check_stop(_completionWatch);
+        uv_close(reinterpret_cast<uv_handle_t *>(_completionWatch),
+                 [](uv_handle_t *handle) { delete handle; });
+        _completionWatch = nullptr;
+    }
+
+    if (_completionIdle) {
+        uv_idle_stop(_completionIdle);
+        uv_close(reinterpret_cast<uv_handle_t *>(_completionIdle),
+                 [](uv_handle_t *handle) { delete handle; });
+        _completionIdle = nullptr;
+    }
+
+    if (_rowFlushWatch) {
+        uv_check_stop(_rowFlushWatch);
+        uv_close(reinterpret_cast<uv_handle_t *>(_rowFlushWatch),
+                 [](uv_handle_t *handle) { delete handle; });
+        _rowFlushWatch = nullptr;
+    }
+
+    if (_rowFlushIdle) {
+        uv_idle_stop(_rowFlushIdle);
+        uv_close(reinterpret_cast<uv_handle_t *>(_rowFlushIdle),
+                 [](uv_handle_t *handle) { delete handle; });
+        _rowFlushIdle = nullptr;
+    }
+
+    // Any operations which are failed during destruction are delivered
+    // directly, as there will be no further ticks to deliver them on.
+    _flags &= ~LCBX_CONNFLAG_BATCH_COMPLETIONS;
+    _completions.Reset();
+    _numCompletions = 0;
+
+    if (_ioThread) {
+        // The I/O thread destroys the instance itself, delivering anything
+        // which is failed in doing so before it exits.
+        delete _ioThread;
+        _ioThread = nullptr;
+        _instance = nullptr;
+    } else if (_instance) {
         lcb_destroy(_instance);
         _instance = nullptr;
     }
 
     // If there is a custom hooks registered, we need to deactivate them here
-    // since the GC might be the one invoking us, which will cause problems
-    // as we can't call into v8 during garbage collection.
+    // since anything which outlives the instance must not call into v8.  We
+    // are always destroyed from the shutdown handler, so the hooks can still
+    // pass on whatever they have buffered before doing so.
     if (_logger) {
         _logger->disconnect();
     }
@@ -129,20 +226,164 @@ Instance::~Instance()
         delete _openCookie;
         _openCookie = nullptr;
     }
+    if (_completionCookie) {
+        delete _completionCookie;
+        _completionCookie = nullptr;
+    }
 }
 
 void Instance::uvShutdownHandler(uv_check_t *handle)
 {
-    delete reinterpret_cast<Instance *>(handle->data);
+    Instance *me = reinterpret_cast<Instance *>(handle->data);
+
+    // Compressions still running on the threadpool reference the instance
+    // when they finish, the handler runs again on the next loop iteration.
+    if (me->_pendingCompressions > 0) {
+        return;
+    }
+
+    me->flushCompletions();
+    delete me;
+}
+
+void Instance::uvCompletionHandler(uv_check_t *handle)
+{
+    Instance *me = reinterpret_cast<Instance *>(handle->data);
+    me->flushCompletions();
+}
+
+void Instance::uvCompletionIdleHandler(uv_idle_t *)
+{
+    // Nothing to do, an active idle handle only prevents the poll phase
+    // from blocking while completions are staged.
+}
+
+void Instance::setCompletionHandler(Local<Function> handler)
+{
+    if (_completionCookie) {
+        delete _completionCookie;
+        _completionCookie = nullptr;
+    }
+    _completionCookie = new Cookie("couchbase::completions", handler);
+}
+
+void Instance::stageCompletion(Local<Function> callback, int argc,
+                               Local<Value> argv[])
+{
+    Local<Array> args = Nan::New<Array>(argc);
+    for (int i = 0; i < argc; ++i) {
+        Nan::Set(args, i, argv[i]);
+    }
+
+    if (_numCompletions == 0) {
+        _completions.Reset(Nan::New<Array>());
+
+        // Completions are delivered in the check phase, immediately after
+        // the poll phase in which the responses were read.  Completions can
+        // also be staged outside of the poll phase (timeouts are failed from
+        // the timers phase), so the idle handle keeps the poll phase from
+        // blocking until they have been delivered.
+        uv_check_start(_completionWatch, &uvCompletionHandler);
+        uv_idle_start(_completionIdle, &uvCompletionIdleHandler);
+    }
+
+    Local<Array> completions = Nan::New(_completions);
+    Nan::Set(completions, _numCompletions++, callback);
+    Nan::Set(completions, _numCompletions++, args);
+}
+
+void Instance::flushCompletions()
+{
+    Nan::HandleScope scope;
+
+    if (_completionWatch) {
+        uv_check_stop(_completionWatch);
+    }
+    if (_completionIdle) {
+        uv_idle_stop(_completionIdle);
+    }
+
+    if (_numCompletions == 0) {
+        return;
+    }
+
+    // Reset the staging area before invoking the handler, since completions
+    // staged by the handler itself belong to the next delivery.
+    Local<Array> completions = Nan::New(_completions);
+    _completions.Reset();
+    _numCompletions = 0;
+
+    Local<Value> args[] = {completions};
+    _completionCookie->Call(1, args);
+}
+
+void Instance::uvRowFlushHandler(uv_check_t *handle)
+{
+    Instance *me = reinterpret_cast<Instance *>(handle->data);
+    me->flushRows();
+}
+
+void Instance::uvRowFlushIdleHandler(uv_idle_t *)
+{
+    // As with completions, this only keeps the poll phase from blocking
+    // while rows are waiting to be flushed.
+}
+
+void Instance::scheduleRowFlush(StreamOpCookie *cookie)
+{
+    if (_rowFlushes.empty() && _rowFlushWatch) {
+        // Rows are usually read in the poll phase, but resuming a paused
+        // request can deliver buffered rows from any phase.
+        uv_check_start(_rowFlushWatch, &uvRowFlushHandler);
+        uv_idle_start(_rowFlushIdle, &uvRowFlushIdleHandler);
+    }
+    _rowFlushes.push_back(cookie);
+}
+
+void Instance::cancelRowFlush(StreamOpCookie *cookie)
+{
+    auto cookieIter =
+        std::find(_rowFlushes.begin(), _rowFlushes.end(), cookie);
+    if (cookieIter != _rowFlushes.end()) {
+        _rowFlushes.erase(cookieIter);
+    }
+    if (_rowFlushes.empty() && _rowFlushIdle) {
+        uv_idle_stop(_rowFlushIdle);
+    }
+}
+
+void Instance::flushRows()
+{
+    Nan::HandleScope scope;
+
+    if (_rowFlushWatch) {
+        uv_check_stop(_rowFlushWatch);
+    }
+    if (_rowFlushIdle) {
+        uv_idle_stop(_rowFlushIdle);
+    }
+
+    // Rows which are received by the time the flush completes are delivered
+    // by the following loop iteration instead.
+    std::vector<StreamOpCookie *> flushes;
+    flushes.swap(_rowFlushes);
+    for (StreamOpCookie *cookie : flushes) {
+        cookie->flushScheduledRows();
+    }
 }
 
 void Instance::shutdown()
 {
+    _shuttingDown = true;
     uv_check_start(_shutdownProc, &uvShutdownHandler);
 }
 
 const char *Instance::bucketName()
 {
+    if (_ioThread) {
+        return _bucketNameCache.empty() ? nullptr : _bucketNameCache.c_str();
+    }
+
     const char *value = nullptr;
     lcb_cntl(_instance, LCB_CNTL_GET, LCB_CNTL_BUCKETNAME, &value);
     return value;
@@ -156,8 +397,12 @@ const char *Instance::clientString()
     }
 
     // Fetch from libcouchbase if we have not done that yet.
-    const char *lcbClientString;
-    lcb_cntl(_instance, LCB_CNTL_GET, LCB_CNTL_CLIENT_STRING, &lcbClientString);
+    const char *lcbClientString = nullptr;
+    {
+        IoThread::Lock lock(_ioThread);
+        lcb_cntl(_instance, LCB_CNTL_GET, LCB_CNTL_CLIENT_STRING,
+                 &lcbClientString);
+    }
     if (!lcbClientString) {
         // Backup string in case something goes wrong
         lcbClientString = "couchbase-nodejs-sdk";
@@ -183,10 +428,56 @@ void Instance::uvFlushHandler(uv_prepare_t *handle)
     lcb_sched_flush(me->_instance);
 }
 
+void Instance::cacheBucketName()
+{
+    // Responses are handled on the V8 thread, which cannot query the name
+    // from libcouchbase while the I/O thread is using the instance.
+    const char *value = nullptr;
+    lcb_cntl(_instance, LCB_CNTL_GET, LCB_CNTL_BUCKETNAME, &value);
+    _bucketNameCache = value ? value : "";
+}
+
+void Instance::cacheVbucketCount()
+{
+    // The number of vBuckets is fixed for the lifetime of a bucket, so it
+    // is all that is needed to map keys without touching the live config.
+    lcbvb_CONFIG *config = nullptr;
+    lcb_cntl(_instance, LCB_CNTL_GET, LCB_CNTL_VBCONFIG, &config);
+    if (config && LCBVB_DISTTYPE(config) == LCBVB_DIST_VBUCKET) {
+        _vbucketCount = lcbvb_get_nvbuckets(config);
+    }
+}
+
+int Instance::vbucketForKey(const char *key, size_t nkey) const
+{
+    unsigned nvb = _vbucketCount;
+    if (nvb == 0) {
+        return -1;
+    }
+
+    return lcbvb_hash_key(nvb, key, nkey);
+}
+
 void Instance::lcbBootstapHandler(lcb_INSTANCE *instance, lcb_STATUS err)
 {
     Instance *me = Instance::fromLcbInst(instance);
 
+    if (me->_ioThread) {
+        // A failed instance is left for the I/O thread to destroy once the
+        // connection is shut down, as it is the only thread using it.
+        if (err == 0) {
+            int flushMode = 0;
+            lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_SCHED_IMPLICIT_FLUSH,
+                     &flushMode);
+            me->cacheBucketName();
+            me->cacheVbucketCount();
+        }
+
+        me->_ioThread->complete(
+            new StatusCompletion(me, &Instance::deliverBootstrap, err));
+        return;
+    }
+
     if (err != 0) {
         lcb_set_bootstrap_callback(instance, [](lcb_INSTANCE *, lcb_STATUS) {});
         lcb_destroy_async(instance, NULL);
@@ -197,16 +488,22 @@ void Instance::lcbBootstapHandler(lcb_INSTANCE *instance, lcb_STATUS err)
         int flushMode = 0;
         lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_SCHED_IMPLICIT_FLUSH,
                  &flushMode);
+        me->cacheVbucketCount();
     }
 
-    if (me->_bootstrapCookie) {
+    me->deliverBootstrap(err);
+}
+
+void Instance::deliverBootstrap(lcb_STATUS err)
+{
+    if (_bootstrapCookie) {
         Nan::HandleScope scope;
 
         Local<Value> args[] = {Error::create(err)};
-        me->_bootstrapCookie->Call(1, args);
+        _bootstrapCookie->Call(1, args);
 
-        delete me->_bootstrapCookie;
-        me->_bootstrapCookie = nullptr;
+        delete _bootstrapCookie;
+        _bootstrapCookie = nullptr;
     }
 }
 
@@ -214,15 +511,53 @@ void Instance::lcbOpenHandler(lcb_INSTANCE *instance, lcb_STATUS err)
 {
     Instance *me = Instance::fromLcbInst(instance);
 
-    if (me->_openCookie) {
+    if (me->_ioThread) {
+        if (err == 0) {
+            me->cacheBucketName();
+            me->cacheVbucketCount();
+        }
+
+        me->_ioThread->complete(
+            new StatusCompletion(me, &Instance::deliverOpen, err));
+        return;
+    }
+
+    if (err == 0) {
+        me->cacheVbucketCount();
+    }
+
+    me->deliverOpen(err);
+}
+
+void Instance::deliverOpen(lcb_STATUS err)
+{
+    if (_openCookie) {
         Nan::HandleScope scope;
 
         Local<Value> args[] = {Error::create(err)};
-        me->_openCookie->Call(1, args);
+        _openCookie->Call(1, args);
+
+        delete _openCookie;
+        _openCookie = nullptr;
+    }
+}
+
+void Instance::lcbValueReleasedHandler(lcb_INSTANCE *instance,
+                                       const void *cookie)
+{
+    Instance *me = Instance::fromLcbInst(instance);
 
-        delete me->_openCookie;
-        me->_openCookie = nullptr;
+    // Only store operations lend their value to libcouchbase, and these are
+    // always scheduled with a regular OpCookie.
+    OpCookie *opCookie =
+        reinterpret_cast<OpCookie *>(const_cast<void *>(cookie));
+
+    if (me->onIoThread()) {
+        me->_ioThread->complete(new ValueReleaseCompletion(opCookie));
+        return;
     }
+
+    OpCookie::releaseValue(opCookie);
 }
 
 } // namespace couchnode
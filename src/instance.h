@@ -4,21 +4,31 @@
 
 #include "addondata.h"
 #include "cookie.h"
+#include "iothread.h"
+#include "lcbx.h"
 #include "logger.h"
 #include "metrics.h"
+#include "objectpool.h"
+#include "stringarena.h"
 #include "tracing.h"
 #include "valueparser.h"
 
+#include <atomic>
 #include <libcouchbase/couchbase.h>
 #include <libcouchbase/libuv_io_opts.h>
 #include <nan.h>
 #include <node.h>
+#include <string>
+#include <vector>
 
 namespace couchnode
 {
 
 using namespace v8;
 
+class OpCookie;
+class StreamOpCookie;
+
 class Instance
 {
 public:
@@ -29,8 +39,9 @@ public:
         return inst;
     }
 
-    Instance(lcb_INSTANCE *instance, Logger *logger, RequestTracer *tracer,
-             Meter *meter);
+    Instance(lcb_INSTANCE *instance, uint32_t flags, Logger *logger,
+             RequestTracer *tracer, Meter *meter,
+             IoThread *ioThread = nullptr);
     ~Instance();
 
     lcb_INSTANCE *lcbHandle() const
@@ -40,14 +51,92 @@ public:
 
     void shutdown();
 
+    // Values are copied out of the network buffers on the I/O thread, so
+    // there is nothing for a Buffer to reference when one is used.
+    bool zeroCopyValues() const
+    {
+        return (_flags & LCBX_CONNFLAG_ZEROCOPY_VALUES) != 0 && !_ioThread;
+    }
+
+    // Large Buffers passed as document values are written from directly, in
+    // which case they must not be modified until the operation completes.
+    bool zeroCopyWrites() const
+    {
+        return (_flags & LCBX_CONNFLAG_ZEROCOPY_VALUES) != 0;
+    }
+
+    // Large values are compressed on the libuv threadpool before they are
+    // scheduled.  With an I/O thread, compression already happens off the V8
+    // thread, and without the bundled snappy there is nothing to do it with.
+    bool parallelCompression() const
+    {
+#ifdef LCBX_HAVE_SNAPPY
+        return (_flags & LCBX_CONNFLAG_PARALLEL_COMPRESSION) != 0 &&
+               !_ioThread;
+#else
+        return false;
+#endif
+    }
+
+    // Indicates whether the caller is running on this instances I/O thread,
+    // which is never the case unless the instance was created with one.
+    bool onIoThread() const
+    {
+        return _ioThread && _ioThread->onIoThread();
+    }
+
+    // The tracer is only accessible from the V8 thread when the instance is
+    // not being driven by an I/O thread.
+    lcbtrace_TRACER *lcbTracer() const
+    {
+        if (_ioThread) {
+            return nullptr;
+        }
+        return lcb_get_tracer(_instance);
+    }
+
+    bool batchCompletions() const
+    {
+        return (_flags & LCBX_CONNFLAG_BATCH_COMPLETIONS) != 0 &&
+               _completionCookie != nullptr;
+    }
+
+    void setCompletionHandler(Local<Function> handler);
+    void stageCompletion(Local<Function> callback, int argc,
+                         Local<Value> argv[]);
+    void flushCompletions();
+
+    void scheduleRowFlush(StreamOpCookie *cookie);
+    void cancelRowFlush(StreamOpCookie *cookie);
+    void flushRows();
+
     const char *bucketName();
     const char *clientString();
 
+    // Maps a key to its vBucket, or returns -1 if the bucket does not use
+    // vBuckets or its configuration has not been received yet.
+    int vbucketForKey(const char *key, size_t nkey) const;
+
+    template <typename RespType,
+              void (*Handler)(lcb_INSTANCE *, int, const RespType *)>
+    static void ioRespHandler(lcb_INSTANCE *instance, int cbtype,
+                              const RespType *resp);
+
     static void uvFlushHandler(uv_prepare_t *handle);
     static void uvShutdownHandler(uv_check_t *handle);
+    static void uvCompletionHandler(uv_check_t *handle);
+    static void uvCompletionIdleHandler(uv_idle_t *handle);
+    static void uvRowFlushHandler(uv_check_t *handle);
+    static void uvRowFlushIdleHandler(uv_idle_t *handle);
     static void lcbRegisterCallbacks(lcb_INSTANCE *instance);
+    void deliverBootstrap(lcb_STATUS err);
+    void deliverOpen(lcb_STATUS err);
+    void cacheBucketName();
+    void cacheVbucketCount();
     static void lcbBootstapHandler(lcb_INSTANCE *instance, lcb_STATUS err);
     static void lcbOpenHandler(lcb_INSTANCE *instance, lcb_STATUS err);
+    static void lcbValueReleasedHandler(lcb_INSTANCE *instance,
+                                        const void *cookie);
     static void lcbGetRespHandler(lcb_INSTANCE *instance, int cbtype,
                                   const lcb_RESPGET *resp);
     static void lcbExistsRespHandler(lcb_INSTANCE *instance, int cbtype,
@@ -85,17 +174,105 @@ public:
 
     AddonData *_parent;
     lcb_INSTANCE *_instance;
+    uint32_t _flags;
     Logger *_logger;
     RequestTracer *_tracer;
     Meter *_meter;
     uv_prepare_t *_flushWatch;
     uv_check_t *_shutdownProc;
+    uv_check_t *_completionWatch;
+    uv_idle_t *_completionIdle;
+    uv_check_t *_rowFlushWatch;
+    uv_idle_t *_rowFlushIdle;
     const char *_clientStringCache;
+    std::string _bucketNameCache;
+    std::atomic<unsigned> _vbucketCount;
+    IoThread *_ioThread;
 
     Cookie *_bootstrapCookie;
     Cookie *_openCookie;
+    Cookie *_completionCookie;
+    Nan::Persistent<Array> _completions;
+    uint32_t _numCompletions;
+    std::vector<StreamOpCookie *> _rowFlushes;
+    unsigned _pendingCompressions;
+    bool _shuttingDown;
+
+    ObjectPool<OpCookie> _cookiePool;
+    StringArena _stringArena;
+
+private:
+    template <typename RespType,
+              void (*Handler)(lcb_INSTANCE *, int, const RespType *)>
+    void installCallback(int cbtype)
+    {
+        lcb_install_callback(_instance, cbtype,
+                             reinterpret_cast<lcb_RESPCALLBACK>(
+                                 &ioRespHandler<RespType, Handler>));
+    }
 };
 
+/*
+ * Delivers a response received on the I/O thread to its handler on the V8
+ * thread.  The response is either a clone owned by the completion, or the
+ * original response while the I/O thread waits for it to be handled.
+ */
+template <typename RespType,
+          void (*Handler)(lcb_INSTANCE *, int, const RespType *)>
+class RespCompletion : public IoThread::Completion
+{
+public:
+    RespCompletion(lcb_INSTANCE *instance, int cbtype, const RespType *resp,
+                   bool owned)
+        : _instance(instance)
+        , _cbtype(cbtype)
+        , _resp(resp)
+        , _owned(owned)
+    {
+    }
+
+    ~RespCompletion()
+    {
+        if (_owned) {
+            lcb_resp_destroy(_cbtype, const_cast<RespType *>(_resp));
+        }
+    }
+
+    void deliver() override
+    {
+        Handler(_instance, _cbtype, _resp);
+    }
+
+private:
+    lcb_INSTANCE *_instance;
+    int _cbtype;
+    const RespType *_resp;
+    bool _owned;
+};
+
+template <typename RespType,
+          void (*Handler)(lcb_INSTANCE *, int, const RespType *)>
+void Instance::ioRespHandler(lcb_INSTANCE *instance, int cbtype,
+                             const RespType *resp)
+{
+    Instance *me = Instance::fromLcbInst(instance);
+    if (!me->onIoThread()) {
+        Handler(instance, cbtype, resp);
+        return;
+    }
+
+    // Responses which cannot be copied only live for the duration of this
+    // callback, so those are handled while the I/O thread waits.
+    lcb_RESPBASE *clone = nullptr;
+    if (lcb_resp_clone(cbtype, resp, &clone) == LCB_SUCCESS) {
+        me->_ioThread->complete(new RespCompletion<RespType, Handler>(
+            instance, cbtype, static_cast<const RespType *>(clone), true));
+    } else {
+        me->_ioThread->completeSync(new RespCompletion<RespType, Handler>(
+            instance, cbtype, resp, false));
+    }
+}
+
 } // namespace couchnode
 
 #endif // CONNECTION_H
@@ -23,8 +23,9 @@ void Instance::lcbGetRespHandler(lcb_INSTANCE *instance, int cbtype,
 
         {
             Nan::TryCatch tryCatch;
-            valueVal =
-                rdr.parseDocValue<&lcb_respget_value, lcb_respget_flags>();
+            valueVal = rdr.parseDocValue<&lcb_respget_value, &lcb_respget_flags,
+                                         &lcb_respget_backbuf,
+                                         &lcb_respget_value_iov>();
             if (tryCatch.HasCaught()) {
                 errVal = tryCatch.Exception();
             }
@@ -86,7 +87,8 @@ void Instance::lcbGetReplicaRespHandler(lcb_INSTANCE *instance, int cbtype,
         {
             Nan::TryCatch tryCatch;
             valueVal = rdr.parseDocValue<&lcb_respgetreplica_value,
-                                         &lcb_respgetreplica_flags>();
+                                         &lcb_respgetreplica_flags,
+                                         &lcb_respgetreplica_backbuf>();
             if (tryCatch.HasCaught()) {
                 errVal = tryCatch.Exception();
                 tryCatch.Reset();
@@ -213,30 +215,33 @@ void Instance::lcbLookupRespHandler(lcb_INSTANCE *instance, int cbtype,
     if (rc == LCB_SUCCESS) {
         size_t numResults = rdr.getValue<&lcb_respsubdoc_result_size>();
 
+        AddonData *data = addondata::Get();
+        Local<ObjectTemplate> entryTpl = Nan::New(data->_subdocEntryTemplate);
+
         Local<Array> resArr = Nan::New<Array>(numResults);
         for (size_t i = 0; i < numResults; ++i) {
-            Local<Object> resObj = Nan::New<Object>();
+            Local<Object> resObj = Nan::NewInstance(entryTpl).ToLocalChecked();
 
             lcb_STATUS itemstatus =
                 rdr.getValue<&lcb_respsubdoc_result_status>(i);
-            Nan::Set(resObj, Nan::New("error").ToLocalChecked(),
-                     Error::create(itemstatus));
+            Nan::Set(resObj, names::error(), Error::create(itemstatus));
 
             if (itemstatus == LCB_SUCCESS) {
-                Nan::Set(resObj, Nan::New("value").ToLocalChecked(),
-                         rdr.parseValue<&lcb_respsubdoc_result_value>(i));
+                Nan::Set(resObj, names::value(),
+                         rdr.parseValue<&lcb_respsubdoc_result_value,
+                                        &lcb_respsubdoc_backbuf>(i));
             } else {
-                Nan::Set(resObj, Nan::New("value").ToLocalChecked(),
-                         Nan::Null());
+                Nan::Set(resObj, names::value(), Nan::Null());
             }
 
             Nan::Set(resArr, i, resObj);
         }
 
-        Local<Object> resObj = Nan::New<Object>();
-        Nan::Set(resObj, Nan::New("cas").ToLocalChecked(),
-                 rdr.decodeCas<&lcb_respsubdoc_cas>());
-        Nan::Set(resObj, Nan::New("content").ToLocalChecked(), resArr);
+        Local<Object> resObj =
+            Nan::NewInstance(Nan::New(data->_subdocResultTemplate))
+                .ToLocalChecked();
+        Nan::Set(resObj, names::cas(), rdr.decodeCas<&lcb_respsubdoc_cas>());
+        Nan::Set(resObj, names::content(), resArr);
         resVal = resObj;
     } else {
         resVal = Nan::Null();
@@ -262,8 +267,7 @@ void Instance::lcbMutateRespHandler(lcb_INSTANCE *instance, int cbtype,
 
             // Include the specific index that failed.
             Local<Object> errObj = errVal.As<Object>();
-            Nan::Set(errObj, Nan::New("index").ToLocalChecked(),
-                     Nan::New(static_cast<int>(i)));
+            Nan::Set(errObj, names::index(), Nan::New(static_cast<int>(i)));
         }
     }
 
@@ -271,27 +275,31 @@ void Instance::lcbMutateRespHandler(lcb_INSTANCE *instance, int cbtype,
     if (rc == LCB_SUCCESS) {
         size_t numResults = rdr.getValue<&lcb_respsubdoc_result_size>();
 
+        AddonData *data = addondata::Get();
+        Local<ObjectTemplate> entryTpl = Nan::New(data->_subdocEntryTemplate);
+
         Local<Array> resArr = Nan::New<Array>(numResults);
         for (size_t i = 0; i < numResults; ++i) {
-            Local<Object> resObj = Nan::New<Object>();
+            Local<Object> resObj = Nan::NewInstance(entryTpl).ToLocalChecked();
 
             lcb_STATUS itemstatus =
                 rdr.getValue<&lcb_respsubdoc_result_status>(i);
             if (itemstatus == LCB_SUCCESS) {
-                Nan::Set(resObj, Nan::New("value").ToLocalChecked(),
-                         rdr.parseValue<&lcb_respsubdoc_result_value>(i));
+                Nan::Set(resObj, names::value(),
+                         rdr.parseValue<&lcb_respsubdoc_result_value,
+                                        &lcb_respsubdoc_backbuf>(i));
             } else {
-                Nan::Set(resObj, Nan::New("value").ToLocalChecked(),
-                         Nan::Null());
+                Nan::Set(resObj, names::value(), Nan::Null());
             }
 
             Nan::Set(resArr, i, resObj);
         }
 
-        Local<Object> resObj = Nan::New<Object>();
-        Nan::Set(resObj, Nan::New("cas").ToLocalChecked(),
-                 rdr.decodeCas<&lcb_respsubdoc_cas>());
-        Nan::Set(resObj, Nan::New("content").ToLocalChecked(), resArr);
+        Local<Object> resObj =
+            Nan::NewInstance(Nan::New(data->_subdocResultTemplate))
+                .ToLocalChecked();
+        Nan::Set(resObj, names::cas(), rdr.decodeCas<&lcb_respsubdoc_cas>());
+        Nan::Set(resObj, names::content(), resArr);
         resVal = resObj;
     } else {
         resVal = Nan::Null();
@@ -344,9 +352,9 @@ void Instance::lcbQueryDataHandler(lcb_INSTANCE *instance, int cbtype,
     Local<Value> flagsVal = Nan::New<Number>(rflags);
 
     if (rflags & LCBX_RESP_F_NONFINAL) {
-        rdr.invokeNonFinalCallback(errVal, flagsVal, dataRes);
+        rdr.invokeRowCallback(errVal, flagsVal, dataRes);
     } else {
-        rdr.invokeCallback(errVal, flagsVal, dataRes);
+        rdr.invokeStreamCallback(errVal, flagsVal, dataRes);
     }
 }
 
@@ -369,9 +377,9 @@ void Instance::lcbAnalyticsDataHandler(lcb_INSTANCE *instance, int cbtype,
     Local<Value> flagsVal = Nan::New<Number>(rflags);
 
     if (rflags & LCBX_RESP_F_NONFINAL) {
-        rdr.invokeNonFinalCallback(errVal, flagsVal, dataRes);
+        rdr.invokeRowCallback(errVal, flagsVal, dataRes);
     } else {
-        rdr.invokeCallback(errVal, flagsVal, dataRes);
+        rdr.invokeStreamCallback(errVal, flagsVal, dataRes);
     }
 }
 
@@ -393,9 +401,9 @@ void Instance::lcbSearchDataHandler(lcb_INSTANCE *instance, int cbtype,
     Local<Value> flagsVal = Nan::New<Number>(rflags);
 
     if (rflags & LCBX_RESP_F_NONFINAL) {
-        rdr.invokeNonFinalCallback(errVal, flagsVal, dataRes);
+        rdr.invokeRowCallback(errVal, flagsVal, dataRes);
     } else {
-        rdr.invokeCallback(errVal, flagsVal, dataRes);
+        rdr.invokeStreamCallback(errVal, flagsVal, dataRes);
     }
 }
 
@@ -427,9 +435,8 @@ void Instance::lcbHttpDataHandler(lcb_INSTANCE *instance, int cbtype,
         }
 
         Local<Object> dataObj = Nan::New<Object>();
-        Nan::Set(dataObj, Nan::New("statusCode").ToLocalChecked(),
-                 httpStatusRes);
-        Nan::Set(dataObj, Nan::New("headers").ToLocalChecked(), headersRes);
+        Nan::Set(dataObj, names::statusCode(), httpStatusRes);
+        Nan::Set(dataObj, names::headers(), headersRes);
         dataVal = dataObj;
     } else {
         rflags |= LCBX_RESP_F_NONFINAL;
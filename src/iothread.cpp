@@ -0,0 +1,303 @@
+#include "iothread.h"
+
+#include <nan.h>
+
+namespace couchnode
+{
+
+static thread_local IoThread *currentIoThread = nullptr;
+
+/*
+ * Wraps a completion which references memory owned by the I/O thread, the
+ * I/O thread is released once it has been delivered.
+ */
+class IoThread::SyncCompletion : public IoThread::Completion
+{
+public:
+    SyncCompletion(IoThread *thread, Completion *completion, bool *done)
+        : _thread(thread)
+        , _completion(completion)
+        , _done(done)
+    {
+    }
+
+    void deliver() override
+    {
+        _completion->deliver();
+        delete _completion;
+
+        uv_mutex_lock(&_thread->_stateLock);
+        *_done = true;
+        uv_cond_broadcast(&_thread->_stateCond);
+        uv_mutex_unlock(&_thread->_stateLock);
+    }
+
+private:
+    IoThread *_thread;
+    Completion *_completion;
+    bool *_done;
+};
+
+IoThread::Lock::Lock(IoThread *thread)
+    : _thread(thread)
+{
+    // The I/O thread already holds the lock whenever it calls into us.
+    if (!_thread || _thread->onIoThread()) {
+        _thread = nullptr;
+        return;
+    }
+
+    // Only the outermost lock on the V8 thread needs to acquire it.
+    if (_thread->_lockDepth++ > 0) {
+        return;
+    }
+
+    _thread->_lockWaiters.fetch_add(1);
+    if (_thread->_started && !_thread->_stopping) {
+        uv_async_send(_thread->_requestAsync);
+    }
+    uv_mutex_lock(&_thread->_lcbLock);
+}
+
+IoThread::Lock::~Lock()
+{
+    if (!_thread || --_thread->_lockDepth > 0) {
+        return;
+    }
+
+    uv_mutex_unlock(&_thread->_lcbLock);
+
+    uv_mutex_lock(&_thread->_stateLock);
+    _thread->_lockWaiters.fetch_sub(1);
+    uv_cond_broadcast(&_thread->_stateCond);
+    uv_mutex_unlock(&_thread->_stateLock);
+}
+
+IoThread::IoThread()
+    : _instance(nullptr)
+    , _lockWaiters(0)
+    , _lockDepth(0)
+    , _flushPending(false)
+    , _stopping(false)
+    , _started(false)
+    , _stopped(false)
+{
+    uv_mutex_init(&_lcbLock);
+    uv_mutex_init(&_stateLock);
+    uv_cond_init(&_stateCond);
+
+    _loop = new uv_loop_t();
+    uv_loop_init(_loop);
+
+    _requestAsync = new uv_async_t();
+    uv_async_init(_loop, _requestAsync, &uvRequestHandler);
+    _requestAsync->data = this;
+
+    _completionAsync = nullptr;
+}
+
+IoThread::~IoThread()
+{
+    if (_started) {
+        stop();
+    } else {
+        uv_close(reinterpret_cast<uv_handle_t *>(_requestAsync),
+                 [](uv_handle_t *handle) { delete handle; });
+        uv_run(_loop, UV_RUN_DEFAULT);
+    }
+    _requestAsync = nullptr;
+
+    if (_completionAsync) {
+        uv_close(reinterpret_cast<uv_handle_t *>(_completionAsync),
+                 [](uv_handle_t *handle) { delete handle; });
+        _completionAsync = nullptr;
+    }
+
+    uv_loop_close(_loop);
+    delete _loop;
+    _loop = nullptr;
+
+    uv_cond_destroy(&_stateCond);
+    uv_mutex_destroy(&_stateLock);
+    uv_mutex_destroy(&_lcbLock);
+}
+
+bool IoThread::onIoThread() const
+{
+    return currentIoThread == this;
+}
+
+void IoThread::start(lcb_INSTANCE *instance)
+{
+    // The completion handle keeps the V8 threads loop alive for as long as
+    // the thread runs, much like the instances sockets otherwise would.
+    _completionAsync = new uv_async_t();
+    uv_async_init(Nan::GetCurrentEventLoop(), _completionAsync,
+                  &uvCompletionHandler);
+    _completionAsync->data = this;
+
+    _instance = instance;
+    _started = true;
+    uv_thread_create(&_thread, &threadMain, this);
+}
+
+void IoThread::stop()
+{
+    if (!_started || _stopping) {
+        return;
+    }
+
+    _stopping = true;
+    uv_async_send(_requestAsync);
+
+    // Completions must keep being delivered while the instance is destroyed,
+    // as the I/O thread may be waiting for one of them to be handled.
+    uv_mutex_lock(&_stateLock);
+    while (!_stopped) {
+        uv_mutex_unlock(&_stateLock);
+        drainCompletions();
+        uv_mutex_lock(&_stateLock);
+
+        if (!_stopped) {
+            uv_cond_timedwait(&_stateCond, &_stateLock, 1000000);
+        }
+    }
+    uv_mutex_unlock(&_stateLock);
+
+    uv_thread_join(&_thread);
+    drainCompletions();
+}
+
+void IoThread::post(Request *request)
+{
+    _requests.push(request);
+    uv_async_send(_requestAsync);
+}
+
+void IoThread::requestFlush()
+{
+    _flushPending = true;
+    uv_async_send(_requestAsync);
+}
+
+void IoThread::complete(Completion *completion)
+{
+    _completions.push(completion);
+    uv_async_send(_completionAsync);
+}
+
+void IoThread::completeSync(Completion *completion)
+{
+    bool done = false;
+    complete(new SyncCompletion(this, completion, &done));
+
+    // The V8 thread may need the instance lock to finish what it is doing
+    // before it gets to the completion, so it is released while waiting.
+    uv_mutex_unlock(&_lcbLock);
+
+    uv_mutex_lock(&_stateLock);
+    uv_cond_broadcast(&_stateCond);
+    while (!done) {
+        uv_cond_wait(&_stateCond, &_stateLock);
+    }
+    uv_mutex_unlock(&_stateLock);
+
+    uv_mutex_lock(&_lcbLock);
+}
+
+void IoThread::threadMain(void *arg)
+{
+    IoThread *me = reinterpret_cast<IoThread *>(arg);
+    currentIoThread = me;
+
+    uv_mutex_lock(&me->_lcbLock);
+
+    while (!me->_stopping) {
+        uv_run(me->_loop, UV_RUN_ONCE);
+    }
+    me->drainRequests();
+
+    // Destroying the instance fails every operation which is still pending,
+    // their completions are delivered to the V8 thread as usual.
+    lcb_destroy(me->_instance);
+    me->_instance = nullptr;
+
+    uv_close(reinterpret_cast<uv_handle_t *>(me->_requestAsync),
+             [](uv_handle_t *handle) { delete handle; });
+    uv_run(me->_loop, UV_RUN_NOWAIT);
+    uv_walk(
+        me->_loop,
+        [](uv_handle_t *handle, void *) {
+            if (!uv_is_closing(handle)) {
+                uv_close(handle, nullptr);
+            }
+        },
+        nullptr);
+    uv_run(me->_loop, UV_RUN_DEFAULT);
+
+    uv_mutex_unlock(&me->_lcbLock);
+
+    uv_mutex_lock(&me->_stateLock);
+    me->_stopped = true;
+    uv_cond_broadcast(&me->_stateCond);
+    uv_mutex_unlock(&me->_stateLock);
+
+    currentIoThread = nullptr;
+}
+
+void IoThread::uvRequestHandler(uv_async_t *handle)
+{
+    IoThread *me = reinterpret_cast<IoThread *>(handle->data);
+    me->yieldLock();
+    me->drainRequests();
+}
+
+void IoThread::uvCompletionHandler(uv_async_t *handle)
+{
+    IoThread *me = reinterpret_cast<IoThread *>(handle->data);
+    Nan::HandleScope scope;
+    me->drainCompletions();
+}
+
+void IoThread::drainRequests()
+{
+    bool flush = _flushPending.exchange(false);
+    while (Request *request = _requests.pop()) {
+        request->run(_instance);
+        delete request;
+        flush = true;
+    }
+
+    // Everything scheduled by the requests drained here is written out
+    // together, rather than once per request.
+    if (flush) {
+        lcb_sched_flush(_instance);
+    }
+}
+
+void IoThread::drainCompletions()
+{
+    while (Completion *completion = _completions.pop()) {
+        completion->deliver();
+        delete completion;
+    }
+}
+
+void IoThread::yieldLock()
+{
+    if (_lockWaiters == 0) {
+        return;
+    }
+
+    uv_mutex_unlock(&_lcbLock);
+
+    uv_mutex_lock(&_stateLock);
+    while (_lockWaiters > 0) {
+        uv_cond_wait(&_stateCond, &_stateLock);
+    }
+    uv_mutex_unlock(&_stateLock);
+
+    uv_mutex_lock(&_lcbLock);
+}
+
+} // namespace couchnode
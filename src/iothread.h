@@ -0,0 +1,121 @@
+#pragma once
+#ifndef IOTHREAD_H
+#define IOTHREAD_H
+
+#include "spscqueue.h"
+
+#include <atomic>
+#include <libcouchbase/couchbase.h>
+#include <uv.h>
+
+namespace couchnode
+{
+
+/*
+ * Runs a libcouchbase instance on a dedicated native event loop thread.
+ * Operations are handed to the I/O thread as requests, and their results are
+ * handed back to the V8 thread as completions, each through a lock-free queue
+ * with a uv_async_t used to wake the receiving side.
+ *
+ * Everything the I/O thread does with the instance happens while holding the
+ * instance lock.  The V8 thread may briefly take it over with IoThread::Lock
+ * for the few calls which need a synchronous answer from libcouchbase, the
+ * I/O thread yields it between loop iterations whenever this is requested.
+ */
+class IoThread
+{
+public:
+    // A unit of work executed by the I/O thread.
+    class Request
+    {
+    public:
+        virtual ~Request()
+        {
+        }
+
+        virtual void run(lcb_INSTANCE *instance) = 0;
+    };
+
+    // A unit of work executed by the V8 thread.
+    class Completion
+    {
+    public:
+        virtual ~Completion()
+        {
+        }
+
+        virtual void deliver() = 0;
+    };
+
+    // Holds the instance lock for its lifetime, this may be nested and is a
+    // no-op when used on the I/O thread or without an I/O thread.
+    class Lock
+    {
+    public:
+        Lock(IoThread *thread);
+        ~Lock();
+
+    private:
+        IoThread *_thread;
+    };
+
+    IoThread();
+    ~IoThread();
+
+    uv_loop_t *loop() const
+    {
+        return _loop;
+    }
+
+    bool onIoThread() const;
+
+    // Begins running the loop for the instance, which must have been created
+    // using this threads loop.  Must be called from the V8 thread.
+    void start(lcb_INSTANCE *instance);
+
+    // Destroys the instance and stops the thread, delivering any completions
+    // produced in the process.  Must be called from the V8 thread.
+    void stop();
+
+    // Called from the V8 thread.
+    void post(Request *request);
+    void requestFlush();
+
+    // Called from the I/O thread.
+    void complete(Completion *completion);
+    void completeSync(Completion *completion);
+
+private:
+    class SyncCompletion;
+
+    static void threadMain(void *arg);
+    static void uvRequestHandler(uv_async_t *handle);
+    static void uvCompletionHandler(uv_async_t *handle);
+
+    void drainRequests();
+    void drainCompletions();
+    void yieldLock();
+
+    uv_loop_t *_loop;
+    uv_thread_t _thread;
+    uv_async_t *_requestAsync;
+    uv_async_t *_completionAsync;
+    lcb_INSTANCE *_instance;
+
+    uv_mutex_t _lcbLock;
+    uv_mutex_t _stateLock;
+    uv_cond_t _stateCond;
+    std::atomic<int> _lockWaiters;
+    int _lockDepth;
+    std::atomic<bool> _flushPending;
+    std::atomic<bool> _stopping;
+    bool _started;
+    bool _stopped;
+
+    SpscQueue<Request> _requests;
+    SpscQueue<Completion> _completions;
+};
+
+} // namespace couchnode
+
+#endif // IOTHREAD_H
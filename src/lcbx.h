@@ -4,8 +4,16 @@
 
 #include <libcouchbase/couchbase.h>
 
+enum lcbx_CONNFLAG {
+    LCBX_CONNFLAG_ZEROCOPY_VALUES = 1 << 1,
+    LCBX_CONNFLAG_BATCH_COMPLETIONS = 1 << 2,
+    LCBX_CONNFLAG_IO_THREAD = 1 << 3,
+    LCBX_CONNFLAG_PARALLEL_COMPRESSION = 1 << 4,
+};
+
 enum lcbx_RESP_F {
     LCBX_RESP_F_NONFINAL = 0x01,
+    LCBX_RESP_F_ROWBATCH = 0x02,
 };
 
 enum lcbx_SDCMD {
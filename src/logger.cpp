@@ -1,14 +1,34 @@
 #include "logger.h"
 
+#include <cstring>
+
 namespace couchnode
 {
 
-Logger::Logger(Local<Function> callback)
+const size_t Logger::MAX_BUFFERED;
+
+Logger::Logger(Local<Function> callback, int minSeverity,
+               std::vector<std::string> subsystems)
     : _enabled(true)
     , _callback(callback)
-    , _logBuffer(nullptr)
-    , _logBufferLen(0)
+    , _minSeverity(minSeverity)
+    , _subsystems(std::move(subsystems))
+    , _active(0)
 {
+    for (Buffer &buffer : _buffers) {
+        buffer.count = 0;
+        buffer.dropped = 0;
+    }
+
+    uv_mutex_init(&_buffersLock);
+
+    _drainAsync = new uv_async_t();
+    uv_async_init(Nan::GetCurrentEventLoop(), _drainAsync, &uvDrainHandler);
+    _drainAsync->data = this;
+
+    // Logging alone should not keep the process alive.
+    uv_unref(reinterpret_cast<uv_handle_t *>(_drainAsync));
+
     lcb_logger_create(&_lcbLogger, this);
     lcb_logger_callback(_lcbLogger, &lcbHandler);
 }
@@ -17,6 +37,13 @@ Logger::~Logger()
 {
     lcb_logger_destroy(_lcbLogger);
     _lcbLogger = nullptr;
+
+    // Anything still buffered was passed on by disconnect(), and nothing is
+    // logged once libcouchbase is gone.
+    uv_close(reinterpret_cast<uv_handle_t *>(_drainAsync),
+             [](uv_handle_t *handle) { delete handle; });
+    _drainAsync = nullptr;
+    uv_mutex_destroy(&_buffersLock);
 }
 
 const lcb_LOGGER *Logger::lcbProcs() const
@@ -26,55 +53,150 @@ const lcb_LOGGER *Logger::lcbProcs() const
 
 void Logger::disconnect()
 {
+    // The instance is only ever destroyed from the event loop, once
+    // libcouchbase is gone, so whatever it logged while shutting down can
+    // still be passed to JavaScript.
+    drain();
     _enabled = false;
 }
 
+bool Logger::wanted(const char *subsys, int severity) const
+{
+    if (severity < _minSeverity) {
+        return false;
+    }
+    if (_subsystems.empty()) {
+        return true;
+    }
+    if (!subsys) {
+        return false;
+    }
+    for (const std::string &wantedSubsys : _subsystems) {
+        if (wantedSubsys == subsys) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void Logger::handler(unsigned int iid, const char *subsys, int severity,
                      const char *srcfile, int srcline, const char *fmt,
                      va_list ap)
 {
-    if (!_enabled) {
+    if (!_enabled || !wanted(subsys, severity)) {
         return;
     }
 
-    Nan::HandleScope scope;
-    va_list apCopy;
+    uv_mutex_lock(&_buffersLock);
 
-    if (!_logBuffer) {
-        _logBufferLen = 2048;
-        _logBuffer = new char[_logBufferLen];
+    Buffer &buffer = _buffers[_active];
+    bool wasEmpty = buffer.count == 0 && buffer.dropped == 0;
+    if (buffer.count == MAX_BUFFERED) {
+        buffer.dropped++;
+        uv_mutex_unlock(&_buffersLock);
+        return;
+    }
+    if (buffer.count == buffer.records.size()) {
+        buffer.records.emplace_back();
     }
 
+    Record &record = buffer.records[buffer.count++];
+    record.severity = severity;
+    record.srcFile.assign(srcfile ? srcfile : "");
+    record.srcLine = srcline;
+    record.subsys.assign(subsys ? subsys : "");
+
     // Due the fact that the call to vsnprintf modifies the va_list itself, we
     // cannot invoke vsnprintf twice, in order to get around this, we copy this
     // list for the first call and then use the original list if needed for the
     // second call.
+    va_list apCopy;
     va_copy(apCopy, ap);
 
-    int genLen = vsnprintf(_logBuffer, _logBufferLen, fmt, apCopy);
-    if (genLen >= _logBufferLen) {
-        _logBufferLen = genLen + 1;
-        delete[] _logBuffer;
-        _logBuffer = new char[_logBufferLen];
-        vsnprintf(_logBuffer, _logBufferLen, fmt, ap);
+    std::string &message = record.message;
+    message.resize(message.capacity());
+    int genLen = vsnprintf(&message[0], message.size() + 1, fmt, apCopy);
+    if (genLen < 0) {
+        genLen = 0;
+    } else if (static_cast<size_t>(genLen) > message.size()) {
+        message.resize(genLen);
+        vsnprintf(&message[0], genLen + 1, fmt, ap);
     }
+    message.resize(genLen);
 
     va_end(apCopy);
 
-    Local<Object> infoObj = Nan::New<Object>();
-    Nan::Set(infoObj, Nan::New<String>("severity").ToLocalChecked(),
-             Nan::New(severity));
-    Nan::Set(infoObj, Nan::New<String>("srcFile").ToLocalChecked(),
-             Nan::New(srcfile).ToLocalChecked());
-    Nan::Set(infoObj, Nan::New<String>("srcLine").ToLocalChecked(),
-             Nan::New(srcline));
-    Nan::Set(infoObj, Nan::New<String>("subsys").ToLocalChecked(),
-             Nan::New(subsys).ToLocalChecked());
-    Nan::Set(infoObj, Nan::New<String>("message").ToLocalChecked(),
-             Nan::New(_logBuffer).ToLocalChecked());
-
-    Local<Value> args[] = {infoObj};
-    Nan::Call(_callback, 1, args);
+    uv_mutex_unlock(&_buffersLock);
+
+    // A single wakeup is enough for everything logged until the next batch.
+    if (wasEmpty) {
+        uv_async_send(_drainAsync);
+    }
+}
+
+void Logger::drain()
+{
+    uv_mutex_lock(&_buffersLock);
+    Buffer &buffer = _buffers[_active];
+    _active ^= 1;
+    uv_mutex_unlock(&_buffersLock);
+
+    if (_enabled && (buffer.count > 0 || buffer.dropped > 0)) {
+        Nan::HandleScope scope;
+
+        // The batch is passed as one array per field, which avoids creating
+        // an object per message only for JavaScript to take it apart again.
+        int numRecords = static_cast<int>(buffer.count);
+        if (buffer.dropped > 0) {
+            numRecords++;
+        }
+        Local<Array> severities = Nan::New<Array>(numRecords);
+        Local<Array> srcFiles = Nan::New<Array>(numRecords);
+        Local<Array> srcLines = Nan::New<Array>(numRecords);
+        Local<Array> subsystems = Nan::New<Array>(numRecords);
+        Local<Array> messages = Nan::New<Array>(numRecords);
+
+        auto addRecord = [&](uint32_t index, int severity,
+                             const char *srcfile, int srcline,
+                             const char *subsys, const char *message) {
+            Nan::Set(severities, index, Nan::New(severity));
+            Nan::Set(srcFiles, index, Nan::New(srcfile).ToLocalChecked());
+            Nan::Set(srcLines, index, Nan::New(srcline));
+            Nan::Set(subsystems, index, Nan::New(subsys).ToLocalChecked());
+            Nan::Set(messages, index, Nan::New(message).ToLocalChecked());
+        };
+
+        uint32_t index = 0;
+        for (size_t i = 0; i < buffer.count; ++i) {
+            const Record &record = buffer.records[i];
+            addRecord(index++, record.severity, record.srcFile.c_str(),
+                      record.srcLine, record.subsys.c_str(),
+                      record.message.c_str());
+        }
+
+        if (buffer.dropped > 0) {
+            char message[128];
+            snprintf(message, sizeof(message),
+                     "%zu log messages were dropped, as more were logged "
+                     "than could be buffered",
+                     buffer.dropped);
+            addRecord(index++, LCB_LOG_WARN, __FILE__, __LINE__, "logger",
+                      message);
+        }
+
+        Local<Value> args[] = {severities, srcFiles, srcLines, subsystems,
+                               messages};
+        Nan::Call(_callback, 5, args);
+    }
+
+    buffer.count = 0;
+    buffer.dropped = 0;
+}
+
+void Logger::uvDrainHandler(uv_async_t *handle)
+{
+    Logger *me = reinterpret_cast<Logger *>(handle->data);
+    me->drain();
 }
 
 void Logger::lcbHandler(const lcb_LOGGER *procs, uint64_t iid,
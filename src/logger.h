@@ -2,19 +2,36 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <atomic>
 #include <libcouchbase/couchbase.h>
 #include <nan.h>
 #include <node.h>
+#include <string>
+#include <vector>
 
 namespace couchnode
 {
 
 using namespace v8;
 
+/*
+ * Passes the messages logged by libcouchbase to a JavaScript function.
+ *
+ * Messages are filtered by severity and subsystem before being formatted,
+ * and are then buffered and passed to JavaScript in batches on the thread
+ * which created the logger, whichever thread they were logged from.  Each
+ * batch is a single call, passing an array for each field of the messages.
+ * When more messages are logged between two batches than can be buffered,
+ * the excess is dropped and the number of dropped messages is logged instead.
+ */
 class Logger
 {
 public:
-    Logger(Local<Function> callback);
+    // The number of messages which may be buffered between batches.
+    static const size_t MAX_BUFFERED = 1024;
+
+    Logger(Local<Function> callback, int minSeverity,
+           std::vector<std::string> subsystems);
     ~Logger();
 
     const lcb_LOGGER *lcbProcs() const;
@@ -22,19 +39,46 @@ public:
     void disconnect();
 
 private:
+    struct Record {
+        int severity;
+        std::string srcFile;
+        int srcLine;
+        std::string subsys;
+        std::string message;
+    };
+
+    // The records are reused from one batch to the next, so that their
+    // strings keep their capacity.
+    struct Buffer {
+        std::vector<Record> records;
+        size_t count;
+        size_t dropped;
+    };
+
+    bool wanted(const char *subsys, int severity) const;
     void handler(unsigned int iid, const char *subsys, int severity,
                  const char *srcfile, int srcline, const char *fmt, va_list ap);
+    void drain();
+
+    static void uvDrainHandler(uv_async_t *handle);
 
     static void lcbHandler(const lcb_LOGGER *procs, uint64_t iid,
                            const char *subsys, lcb_LOG_SEVERITY severity,
                            const char *srcfile, int srcline, const char *fmt,
                            va_list ap);
 
-    bool _enabled;
+    std::atomic<bool> _enabled;
     lcb_LOGGER *_lcbLogger;
     Nan::Callback _callback;
-    char *_logBuffer;
-    int _logBufferLen;
+    int _minSeverity;
+    std::vector<std::string> _subsystems;
+
+    uv_async_t *_drainAsync;
+    uv_mutex_t _buffersLock;
+    Buffer _buffers[2];
+    // The buffer messages are currently logged to, the other one is only
+    // touched by the thread draining it.
+    int _active;
 };
 
 } // namespace couchnode
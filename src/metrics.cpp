@@ -1,8 +1,16 @@
 #include "metrics.h"
 
+#include <algorithm>
+
+#ifdef LCBX_HAVE_HDRHISTOGRAM
+#include <hdr_histogram.h>
+#endif
+
 namespace couchnode
 {
 
+const uint32_t Meter::DEFAULT_EMIT_INTERVAL;
+
 Meter *unwrapMeter(const lcbmetrics_METER *procs)
 {
     Meter *meter = nullptr;
@@ -34,7 +42,7 @@ static const lcbmetrics_VALUERECORDER *
 lcbMeterValueRecorder(const lcbmetrics_METER *procs, const char *name,
                       const lcbmetrics_TAG *tags, size_t ntags)
 {
-    const Meter *meter = unwrapMeter(procs);
+    Meter *meter = unwrapMeter(procs);
     if (meter) {
         return meter->valueRecorder(name, tags, ntags);
     }
@@ -52,14 +60,16 @@ void lcbValueRecorderDtor(const lcbmetrics_VALUERECORDER *procs)
 void lcbValueRecorderRecordValue(const lcbmetrics_VALUERECORDER *procs,
                                  uint64_t value)
 {
-    const ValueRecorder *recorder = unwrapValueRecorder(procs);
+    ValueRecorder *recorder = unwrapValueRecorder(procs);
     if (recorder) {
         recorder->recordValue(value);
     }
 }
 
-Meter::Meter(Local<Object> impl)
+Meter::Meter(Local<Object> impl, uint32_t emitInterval)
     : _enabled(true)
+    , _emitInterval(emitInterval ? emitInterval : DEFAULT_EMIT_INTERVAL)
+    , _emitTimer(nullptr)
 {
     lcbmetrics_meter_create(&_lcbMeter, this);
     lcbmetrics_meter_dtor_callback(_lcbMeter, &lcbMeterDtor);
@@ -74,6 +84,12 @@ Meter::Meter(Local<Object> impl)
 
 Meter::~Meter()
 {
+    stopEmitting();
+    for (ValueRecorder *recorder : _aggregated) {
+        recorder->detach();
+    }
+    _aggregated.clear();
+
     _impl.Reset();
     _valueRecorderImpl.Reset();
     lcbmetrics_meter_destroy(_lcbMeter);
@@ -87,7 +103,70 @@ const lcbmetrics_METER *Meter::lcbProcs() const
 
 void Meter::disconnect()
 {
+    // The instance is only ever destroyed from the event loop, so whatever
+    // was aggregated since the last emit can still be passed to JavaScript.
+    emitSnapshots();
+
     _enabled = false;
+    stopEmitting();
+}
+
+void Meter::addAggregated(ValueRecorder *recorder)
+{
+    _aggregated.push_back(recorder);
+
+    if (!_emitTimer && _enabled) {
+        _emitTimer = new uv_timer_t();
+        uv_timer_init(Nan::GetCurrentEventLoop(), _emitTimer);
+        _emitTimer->data = this;
+        uv_timer_start(_emitTimer, &uvEmitHandler, _emitInterval,
+                       _emitInterval);
+
+        // Metrics should never be the reason the process stays alive.
+        uv_unref(reinterpret_cast<uv_handle_t *>(_emitTimer));
+    }
+}
+
+void Meter::removeAggregated(ValueRecorder *recorder)
+{
+    _aggregated.erase(
+        std::remove(_aggregated.begin(), _aggregated.end(), recorder),
+        _aggregated.end());
+}
+
+void Meter::stopEmitting()
+{
+    if (_emitTimer) {
+        uv_timer_stop(_emitTimer);
+        uv_close(reinterpret_cast<uv_handle_t *>(_emitTimer),
+                 [](uv_handle_t *handle) { delete handle; });
+        _emitTimer = nullptr;
+    }
+}
+
+void Meter::emitSnapshots()
+{
+    if (!_enabled) {
+        return;
+    }
+
+    // Recorders may be created or destroyed by the JavaScript invoked here,
+    // so only those which are still aggregated when their turn comes are
+    // emitted.
+    Nan::HandleScope scope;
+    std::vector<ValueRecorder *> recorders(_aggregated);
+    for (ValueRecorder *recorder : recorders) {
+        if (std::find(_aggregated.begin(), _aggregated.end(), recorder) !=
+            _aggregated.end()) {
+            recorder->emitSnapshot();
+        }
+    }
+}
+
+void Meter::uvEmitHandler(uv_timer_t *handle)
+{
+    Meter *me = reinterpret_cast<Meter *>(handle->data);
+    me->emitSnapshots();
 }
 
 void Meter::destroy(const Meter *meter)
@@ -97,7 +176,7 @@ void Meter::destroy(const Meter *meter)
 
 const lcbmetrics_VALUERECORDER *Meter::valueRecorder(const char *name,
                                                      const lcbmetrics_TAG *tags,
-                                                     size_t ntags) const
+                                                     size_t ntags)
 {
     if (!_enabled) {
         return nullptr;
@@ -127,10 +206,11 @@ const lcbmetrics_VALUERECORDER *Meter::valueRecorder(const char *name,
         return nullptr;
     }
 
-    return (new ValueRecorder(res.As<Object>()))->lcbProcs();
+    return (new ValueRecorder(this, res.As<Object>()))->lcbProcs();
 }
 
-ValueRecorder::ValueRecorder(Local<Object> impl)
+ValueRecorder::ValueRecorder(Meter *meter, Local<Object> impl)
+    : _meter(nullptr)
 {
     lcbmetrics_valuerecorder_create(&_lcbValueRecorder, this);
     lcbmetrics_valuerecorder_dtor_callback(_lcbValueRecorder,
@@ -143,12 +223,46 @@ ValueRecorder::ValueRecorder(Local<Object> impl)
         Nan::Get(impl, Nan::New("recordValue").ToLocalChecked())
             .ToLocalChecked()
             .As<Function>());
+
+#ifdef LCBX_HAVE_HDRHISTOGRAM
+    _histogram = nullptr;
+
+    Local<Value> recordSnapshotVal =
+        Nan::Get(impl, Nan::New("recordSnapshot").ToLocalChecked())
+            .ToLocalChecked();
+    if (recordSnapshotVal->IsFunction()) {
+        _recordSnapshotImpl.Reset(recordSnapshotVal.As<Function>());
+
+        // The values are latencies in microseconds, this matches the range
+        // used by the logging meter in libcouchbase.
+        hdr_init(1, 30e9, 3, &_histogram);
+        _meter = meter;
+        _meter->addAggregated(this);
+    }
+#endif
 }
 
 ValueRecorder::~ValueRecorder()
 {
+    if (_meter) {
+        // Recorders are destroyed along with the instance, pass on whatever
+        // was recorded since the last emit.
+        if (_meter->enabled()) {
+            emitSnapshot();
+        }
+        _meter->removeAggregated(this);
+        _meter = nullptr;
+    }
+#ifdef LCBX_HAVE_HDRHISTOGRAM
+    if (_histogram) {
+        hdr_close(_histogram);
+        _histogram = nullptr;
+    }
+#endif
+
     _impl.Reset();
     _recordValueImpl.Reset();
+    _recordSnapshotImpl.Reset();
     lcbmetrics_valuerecorder_destroy(_lcbValueRecorder);
     _lcbValueRecorder = nullptr;
 }
@@ -163,8 +277,20 @@ void ValueRecorder::destroy(const ValueRecorder *recorder)
     delete recorder;
 }
 
-void ValueRecorder::recordValue(uint64_t value) const
+void ValueRecorder::detach()
+{
+    _meter = nullptr;
+}
+
+void ValueRecorder::recordValue(uint64_t value)
 {
+#ifdef LCBX_HAVE_HDRHISTOGRAM
+    if (_histogram) {
+        hdr_record_value(_histogram, static_cast<int64_t>(value));
+        return;
+    }
+#endif
+
     Nan::HandleScope scope;
     Local<Object> impl = Nan::New(_impl);
     Local<Function> recordValueImpl = Nan::New(_recordValueImpl);
@@ -177,4 +303,49 @@ void ValueRecorder::recordValue(uint64_t value) const
     Nan::Call(recordValueImpl, impl, 1, argv);
 }
 
+void ValueRecorder::emitSnapshot()
+{
+#ifdef LCBX_HAVE_HDRHISTOGRAM
+    if (!_histogram || _histogram->total_count == 0) {
+        return;
+    }
+
+    Nan::HandleScope scope;
+    Local<Object> impl = Nan::New(_impl);
+    Local<Function> recordSnapshotImpl = Nan::New(_recordSnapshotImpl);
+    if (impl.IsEmpty() || recordSnapshotImpl.IsEmpty()) {
+        return;
+    }
+
+    static const double percentiles[] = {50.0, 90.0, 99.0, 99.9, 100.0};
+    static const char *percentileNames[] = {"50", "90", "99", "99.9", "100"};
+
+    Local<Object> percentilesVal = Nan::New<Object>();
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]);
+         ++i) {
+        Nan::Set(percentilesVal,
+                 Nan::New(percentileNames[i]).ToLocalChecked(),
+                 Nan::New<Number>(static_cast<double>(
+                     hdr_value_at_percentile(_histogram, percentiles[i]))));
+    }
+
+    Local<Object> snapshotVal = Nan::New<Object>();
+    Nan::Set(snapshotVal, Nan::New("count").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(_histogram->total_count)));
+    Nan::Set(snapshotVal, Nan::New("min").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(hdr_min(_histogram))));
+    Nan::Set(snapshotVal, Nan::New("max").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(hdr_max(_histogram))));
+    Nan::Set(snapshotVal, Nan::New("mean").ToLocalChecked(),
+             Nan::New<Number>(hdr_mean(_histogram)));
+    Nan::Set(snapshotVal, Nan::New("percentiles").ToLocalChecked(),
+             percentilesVal);
+
+    hdr_reset(_histogram);
+
+    Local<Value> argv[] = {snapshotVal};
+    Nan::Call(recordSnapshotImpl, impl, 1, argv);
+#endif
+}
+
 } // namespace couchnode
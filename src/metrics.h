@@ -5,16 +5,27 @@
 #include <libcouchbase/couchbase.h>
 #include <nan.h>
 #include <node.h>
+#include <vector>
+
+#ifdef LCBX_HAVE_HDRHISTOGRAM
+struct hdr_histogram;
+#endif
 
 namespace couchnode
 {
 
 using namespace v8;
 
+class ValueRecorder;
+
 class Meter
 {
 public:
-    Meter(Local<Object> impl);
+    // How often aggregated values are passed to JavaScript by default, in
+    // milliseconds.
+    static const uint32_t DEFAULT_EMIT_INTERVAL = 10000;
+
+    Meter(Local<Object> impl, uint32_t emitInterval);
     ~Meter();
 
     const lcbmetrics_METER *lcbProcs() const;
@@ -22,32 +33,60 @@ public:
 
     const lcbmetrics_VALUERECORDER *valueRecorder(const char *name,
                                                   const lcbmetrics_TAG *tags,
-                                                  size_t ntags) const;
+                                                  size_t ntags);
 
     void disconnect();
+    bool enabled() const
+    {
+        return _enabled;
+    }
+
+    void addAggregated(ValueRecorder *recorder);
+    void removeAggregated(ValueRecorder *recorder);
 
 protected:
+    static void uvEmitHandler(uv_timer_t *handle);
+    void emitSnapshots();
+    void stopEmitting();
+
     bool _enabled;
     lcbmetrics_METER *_lcbMeter;
     Nan::Persistent<Object> _impl;
     Nan::Persistent<Function> _valueRecorderImpl;
+
+    uint32_t _emitInterval;
+    uv_timer_t *_emitTimer;
+    std::vector<ValueRecorder *> _aggregated;
 };
 
+/*
+ * Passes the values recorded by libcouchbase to a JavaScript value recorder.
+ * When the recorder implements recordSnapshot, the values are aggregated
+ * into a histogram instead, and only a snapshot of it is passed to
+ * JavaScript each emit interval of the meter.
+ */
 class ValueRecorder
 {
 public:
-    ValueRecorder(Local<Object> impl);
+    ValueRecorder(Meter *meter, Local<Object> impl);
     ~ValueRecorder();
 
     const lcbmetrics_VALUERECORDER *lcbProcs() const;
     static void destroy(const ValueRecorder *meter);
 
-    void recordValue(uint64_t value) const;
+    void recordValue(uint64_t value);
+    void emitSnapshot();
+    void detach();
 
 protected:
     lcbmetrics_VALUERECORDER *_lcbValueRecorder;
+    Meter *_meter;
     Nan::Persistent<Object> _impl;
     Nan::Persistent<Function> _recordValueImpl;
+    Nan::Persistent<Function> _recordSnapshotImpl;
+#ifdef LCBX_HAVE_HDRHISTOGRAM
+    hdr_histogram *_histogram;
+#endif
 };
 
 } // namespace couchnode
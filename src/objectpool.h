@@ -0,0 +1,84 @@
+#pragma once
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <new>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace couchnode
+{
+
+/*
+ * A simple free-list of storage for objects of a single type.  Destroyed
+ * objects have their storage retained (up to maxFree objects) so that the
+ * next object created can reuse it without touching the allocator.
+ * Note that T only needs to be a complete type where create and destroy
+ * are used, which allows pools to be members of classes that T refers to.
+ */
+template <typename T>
+class ObjectPool
+{
+public:
+    explicit ObjectPool(size_t maxFree = 1024)
+        : _maxFree(maxFree)
+        , _hits(0)
+        , _misses(0)
+    {
+    }
+
+    ~ObjectPool()
+    {
+        for (size_t i = 0; i < _free.size(); ++i) {
+            ::operator delete(_free[i]);
+        }
+    }
+
+    template <typename... Ts>
+    T *create(Ts &&...args)
+    {
+        void *mem;
+        if (!_free.empty()) {
+            mem = _free.back();
+            _free.pop_back();
+            ++_hits;
+        } else {
+            mem = ::operator new(sizeof(T));
+            ++_misses;
+        }
+
+        return new (mem) T(std::forward<Ts>(args)...);
+    }
+
+    void destroy(T *obj)
+    {
+        obj->~T();
+
+        if (_free.size() < _maxFree) {
+            _free.push_back(obj);
+        } else {
+            ::operator delete(obj);
+        }
+    }
+
+    uint64_t hits() const
+    {
+        return _hits;
+    }
+
+    uint64_t misses() const
+    {
+        return _misses;
+    }
+
+private:
+    std::vector<void *> _free;
+    size_t _maxFree;
+    uint64_t _hits;
+    uint64_t _misses;
+};
+
+} // namespace couchnode
+
+#endif // OBJECTPOOL_H
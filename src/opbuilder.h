@@ -3,12 +3,19 @@
 #define OPBUILDER_H
 
 #include "connection.h"
+#include "error.h"
 #include "instance.h"
 #include "lcbx.h"
 #include "tracespan.h"
 #include "tracing.h"
+#include "transcoder.h"
 #include "valueparser.h"
 #include <libcouchbase/couchbase.h>
+#include <vector>
+
+#ifdef LCBX_HAVE_SNAPPY
+#include <snappy.h>
+#endif
 
 namespace couchnode
 {
@@ -25,6 +32,7 @@ public:
         , _inst(inst)
         , _parentSpan(parentSpan)
         , _traceSpan(span)
+        , _completed(false)
     {
         _callback.Reset(callback.GetFunction());
         _transcoder.Reset(transcoder);
@@ -37,6 +45,7 @@ public:
 
         _callback.Reset();
         _transcoder.Reset();
+        _heldValue.Reset();
 
         if (_parentSpan) {
             delete _parentSpan;
@@ -61,16 +70,610 @@ public:
 
     Local<Value> invokeCallback(int argc, Local<Value> argv[])
     {
+        if (_inst->batchCompletions()) {
+            // The completion is delivered along with all others from the
+            // same tick, the JS layer is responsible for invoking it.
+            _inst->stageCompletion(_callback.GetFunction(), argc, argv);
+            return Nan::Undefined();
+        }
+
         return _callback.Call(argc, argv, asyncContext()).ToLocalChecked();
     }
 
+    // Invoked on the I/O thread once the operation has been scheduled.
+    void dispatched()
+    {
+    }
+
+    // Keeps the buffer holding the operations value alive while libcouchbase
+    // references it rather than a copy of it.
+    void holdValue(Local<Object> buffer)
+    {
+        _heldValue.Reset(buffer);
+    }
+
+    // Destroys the cookie of a completed operation.  Should libcouchbase
+    // still reference the value, this is deferred until it is released.
+    static void complete(OpCookie *cookie)
+    {
+        if (!cookie->_heldValue.IsEmpty()) {
+            cookie->_completed = true;
+            return;
+        }
+
+        cookie->_inst->_cookiePool.destroy(cookie);
+    }
+
+    // Invoked once libcouchbase no longer references the value, which may
+    // happen either before or after the operation has completed.
+    static void releaseValue(OpCookie *cookie)
+    {
+        cookie->_heldValue.Reset();
+
+        if (cookie->_completed) {
+            cookie->_inst->_cookiePool.destroy(cookie);
+        }
+    }
+
+    // Reports an operation which the I/O thread failed to schedule.
+    static void failDispatch(OpCookie *cookie, lcb_STATUS err)
+    {
+        cookie->endTrace();
+
+        Local<Value> args[] = {Error::create(err)};
+        cookie->invokeCallback(1, args);
+
+        cookie->_inst->_cookiePool.destroy(cookie);
+    }
+
     Instance *_inst;
     Nan::Callback _callback;
     Nan::Persistent<Object> _transcoder;
     WrappedRequestSpan *_parentSpan;
     TraceSpan _traceSpan;
+    Nan::Persistent<Object> _heldValue;
+    bool _completed;
+};
+
+/*
+ * A single cookie shared by every operation of a batch.  Each operation is
+ * scheduled with a tagged pointer to its item slot, which allows the response
+ * readers to distinguish batch items from regular OpCookie's and to record
+ * the result at the correct index.  The callback is invoked once, after every
+ * item in the batch has completed.
+ */
+class BatchOpCookie : public OpCookie
+{
+public:
+    struct Item {
+        BatchOpCookie *batch;
+        size_t index;
+    };
+
+    BatchOpCookie(Instance *inst, const Nan::Callback &callback,
+                  const Nan::Persistent<Object> &transcoder, TraceSpan span,
+                  WrappedRequestSpan *parentSpan, size_t numItems)
+        : OpCookie(inst, callback, transcoder, span, parentSpan)
+        , _items(numItems)
+        , _remaining(numItems)
+    {
+        for (size_t i = 0; i < numItems; ++i) {
+            _items[i].batch = this;
+            _items[i].index = i;
+        }
+
+        _results.Reset(Nan::New<Array>(static_cast<int>(numItems)));
+    }
+
+    ~BatchOpCookie()
+    {
+        _results.Reset();
+    }
+
+    void *itemCookie(size_t index)
+    {
+        uintptr_t itemPtr = reinterpret_cast<uintptr_t>(&_items[index]);
+        return reinterpret_cast<void *>(itemPtr | ITEM_TAG);
+    }
+
+    static Item *fromCookie(void *cookie)
+    {
+        uintptr_t itemPtr = reinterpret_cast<uintptr_t>(cookie);
+        if (!(itemPtr & ITEM_TAG)) {
+            return nullptr;
+        }
+        return reinterpret_cast<Item *>(itemPtr & ~ITEM_TAG);
+    }
+
+    // Records the result for an item, returning true once every item in the
+    // batch has completed.
+    bool setResult(size_t index, Local<Value> result)
+    {
+        Nan::Set(Nan::New(_results), static_cast<uint32_t>(index), result);
+        return --_remaining == 0;
+    }
+
+    // Records the result for an item which could not be scheduled, in the
+    // same form as an item which failed once it was dispatched.
+    bool failItem(size_t index, lcb_STATUS err)
+    {
+        Local<Array> resArr = Nan::New<Array>(1);
+        Nan::Set(resArr, 0, Error::create(err));
+        return setResult(index, resArr);
+    }
+
+    Local<Array> results()
+    {
+        return Nan::New(_results);
+    }
+
+private:
+    static const uintptr_t ITEM_TAG = 0x1;
+
+    std::vector<Item> _items;
+    Nan::Persistent<Array> _results;
+    size_t _remaining;
+};
+
+/*
+ * The cookie used by streaming query, analytics and search requests.  Rows
+ * are accumulated into batches which are delivered to JS once the configured
+ * row or byte limit is reached, or at the end of the current loop iteration.
+ * The request can additionally be paused, which stops reading from the
+ * network until it is resumed.
+ */
+class StreamOpCookie : public OpCookie
+{
+public:
+    StreamOpCookie(Instance *inst, const Nan::Callback &callback,
+                   const Nan::Persistent<Object> &transcoder, TraceSpan span,
+                   WrappedRequestSpan *parentSpan, uint32_t maxRows,
+                   uint32_t maxBytes)
+        : OpCookie(inst, callback, transcoder, span, parentSpan)
+        , _queryHandle(nullptr)
+        , _analyticsHandle(nullptr)
+        , _searchHandle(nullptr)
+        , _maxRows(maxRows)
+        , _maxBytes(maxBytes)
+        , _numRows(0)
+        , _numBytes(0)
+        , _flushScheduled(false)
+        , _paused(false)
+    {
+    }
+
+    ~StreamOpCookie()
+    {
+        if (_flushScheduled) {
+            _inst->cancelRowFlush(this);
+        }
+
+        if (!_control.IsEmpty()) {
+            Nan::SetInternalFieldPointer(Nan::New(_control), 0, nullptr);
+            _control.Reset();
+        }
+
+        _rows.Reset();
+    }
+
+    // Rows are only batched when a limit above a single row was requested,
+    // otherwise each row is delivered on its own as it always has been.
+    bool batchRows() const
+    {
+        return _maxRows > 1 || _maxBytes > 0;
+    }
+
+    void addRow(Local<Value> row, size_t nbytes)
+    {
+        if (_numRows == 0) {
+            _rows.Reset(Nan::New<Array>());
+        }
+
+        Nan::Set(Nan::New(_rows), _numRows++, row);
+        _numBytes += nbytes;
+
+        if ((_maxRows > 0 && _numRows >= _maxRows) ||
+            (_maxBytes > 0 && _numBytes >= _maxBytes)) {
+            flushRows();
+        } else if (!_flushScheduled) {
+            _flushScheduled = true;
+            _inst->scheduleRowFlush(this);
+        }
+    }
+
+    // Delivers any pending rows to JS as a single non-final callback.
+    void flushRows()
+    {
+        if (_flushScheduled) {
+            _flushScheduled = false;
+            _inst->cancelRowFlush(this);
+        }
+
+        if (_numRows == 0) {
+            return;
+        }
+
+        Local<Array> rows = Nan::New(_rows);
+        _rows.Reset();
+        _numRows = 0;
+        _numBytes = 0;
+
+        Local<Value> argsArr[] = {
+            Nan::Null(),
+            Nan::New<Number>(LCBX_RESP_F_NONFINAL | LCBX_RESP_F_ROWBATCH),
+            rows};
+        invokeCallback(3, argsArr);
+    }
+
+    // Invoked by the instance for cookies whose flush was scheduled, these
+    // have already been removed from the instances list of pending flushes.
+    void flushScheduledRows()
+    {
+        _flushScheduled = false;
+        flushRows();
+    }
+
+    // Returns the location libcouchbase should store the request handle in.
+    template <typename HandleType>
+    HandleType **handle();
+
+    // The response callback for streaming requests.  libcouchbase releases
+    // the request handle once the final response has been delivered, so on
+    // an I/O thread it is detached before the response is handed over.
+    template <typename RespType,
+              lcb_STATUS (*CookieFn)(const RespType *, void **),
+              int (*FinalFn)(const RespType *),
+              void (*Handler)(lcb_INSTANCE *, int, const RespType *)>
+    static void respHandler(lcb_INSTANCE *instance, int cbtype,
+                            const RespType *resp)
+    {
+        if (FinalFn(resp) && Instance::fromLcbInst(instance)->onIoThread()) {
+            void *cookie = nullptr;
+            if (CookieFn(resp, &cookie) == LCB_SUCCESS) {
+                reinterpret_cast<StreamOpCookie *>(cookie)->_detachHandle();
+            }
+        }
+
+        Instance::ioRespHandler<RespType, Handler>(instance, cbtype, resp);
+    }
+
+    void pause()
+    {
+        IoThread::Lock lock(_inst->_ioThread);
+
+        if (_paused) {
+            return;
+        }
+        _paused = true;
+        _applyPause();
+    }
+
+    void resume()
+    {
+        IoThread::Lock lock(_inst->_ioThread);
+
+        if (!_paused) {
+            return;
+        }
+        _paused = false;
+
+        lcb_INSTANCE *instance = _inst->lcbHandle();
+        if (_queryHandle) {
+            lcb_query_resume(instance, _queryHandle);
+        } else if (_analyticsHandle) {
+            lcb_analytics_resume(instance, _analyticsHandle);
+        } else if (_searchHandle) {
+            lcb_search_resume(instance, _searchHandle);
+        }
+    }
+
+    // A request which was paused before the I/O thread got to schedule it
+    // is paused as soon as it has been.
+    void dispatched()
+    {
+        if (_paused) {
+            _applyPause();
+        }
+    }
+
+    static void failDispatch(StreamOpCookie *cookie, lcb_STATUS err)
+    {
+        cookie->endTrace();
+
+        Local<Value> args[] = {Error::create(err), Nan::New<Number>(0)};
+        cookie->invokeCallback(2, args);
+
+        delete cookie;
+    }
+
+    // Returns the object handed back to JS to control the request.  It only
+    // holds a weak reference to this cookie, which is cleared once the
+    // request has completed.
+    Local<Object> control()
+    {
+        if (!_control.IsEmpty()) {
+            return Nan::New(_control);
+        }
+
+        AddonData *data = addondata::Get();
+        if (data->_streamControlTemplate.IsEmpty()) {
+            Local<ObjectTemplate> tpl = Nan::New<ObjectTemplate>();
+            tpl->SetInternalFieldCount(1);
+            Nan::SetTemplate(tpl, "pause", Nan::New<FunctionTemplate>(fnPause));
+            Nan::SetTemplate(tpl, "resume",
+                             Nan::New<FunctionTemplate>(fnResume));
+            data->_streamControlTemplate.Reset(tpl);
+        }
+
+        Local<Object> control =
+            Nan::NewInstance(Nan::New(data->_streamControlTemplate))
+                .ToLocalChecked();
+        Nan::SetInternalFieldPointer(control, 0, this);
+        _control.Reset(control);
+        return control;
+    }
+
+private:
+    void _applyPause()
+    {
+        lcb_INSTANCE *instance = _inst->lcbHandle();
+        if (_queryHandle) {
+            lcb_query_pause(instance, _queryHandle);
+        } else if (_analyticsHandle) {
+            lcb_analytics_pause(instance, _analyticsHandle);
+        } else if (_searchHandle) {
+            lcb_search_pause(instance, _searchHandle);
+        }
+    }
+
+    void _detachHandle()
+    {
+        _queryHandle = nullptr;
+        _analyticsHandle = nullptr;
+        _searchHandle = nullptr;
+    }
+
+    static StreamOpCookie *_fromControl(Local<Object> control)
+    {
+        return reinterpret_cast<StreamOpCookie *>(
+            Nan::GetInternalFieldPointer(control, 0));
+    }
+
+    static NAN_METHOD(fnPause)
+    {
+        StreamOpCookie *cookie = _fromControl(info.This());
+        if (cookie) {
+            cookie->pause();
+        }
+        info.GetReturnValue().Set(cookie != nullptr);
+    }
+
+    static NAN_METHOD(fnResume)
+    {
+        StreamOpCookie *cookie = _fromControl(info.This());
+        if (cookie) {
+            cookie->resume();
+        }
+        info.GetReturnValue().Set(cookie != nullptr);
+    }
+
+    lcb_QUERY_HANDLE *_queryHandle;
+    lcb_ANALYTICS_HANDLE *_analyticsHandle;
+    lcb_SEARCH_HANDLE *_searchHandle;
+    Nan::Persistent<Array> _rows;
+    Nan::Persistent<Object> _control;
+    uint32_t _maxRows;
+    uint32_t _maxBytes;
+    uint32_t _numRows;
+    size_t _numBytes;
+    bool _flushScheduled;
+    bool _paused;
+};
+
+template <>
+inline lcb_QUERY_HANDLE **StreamOpCookie::handle<lcb_QUERY_HANDLE>()
+{
+    return &_queryHandle;
+}
+
+template <>
+inline lcb_ANALYTICS_HANDLE **StreamOpCookie::handle<lcb_ANALYTICS_HANDLE>()
+{
+    return &_analyticsHandle;
+}
+
+template <>
+inline lcb_SEARCH_HANDLE **StreamOpCookie::handle<lcb_SEARCH_HANDLE>()
+{
+    return &_searchHandle;
+}
+
+/*
+ * Commands which only reference memory they own can be handed to the I/O
+ * thread as they are.  The remaining ones reference memory owned by the
+ * builder, and are instead scheduled from the V8 thread while holding the
+ * instance lock.
+ */
+template <typename CmdType>
+struct IoQueueable {
+    static const bool value = true;
+};
+
+template <>
+struct IoQueueable<lcb_CMDHTTP> {
+    static const bool value = false;
+};
+
+template <>
+struct IoQueueable<lcb_CMDPING> {
+    static const bool value = false;
+};
+
+template <>
+struct IoQueueable<lcb_CMDDIAG> {
+    static const bool value = false;
+};
+
+template <typename CookieType>
+class FailedOpCompletion : public IoThread::Completion
+{
+public:
+    FailedOpCompletion(CookieType *cookie, lcb_STATUS err)
+        : _cookie(cookie)
+        , _err(err)
+    {
+    }
+
+    void deliver() override
+    {
+        Nan::HandleScope scope;
+        CookieType::failDispatch(_cookie, _err);
+    }
+
+private:
+    CookieType *_cookie;
+    lcb_STATUS _err;
 };
 
+/*
+ * Schedules a command on the I/O thread, taking ownership of the command.
+ */
+template <typename CmdType, typename CookieType,
+          lcb_STATUS (*ExecFn)(lcb_INSTANCE *, void *, const CmdType *)>
+class OpRequest : public IoThread::Request
+{
+public:
+    OpRequest(IoThread *thread, CmdType *cmd, CookieType *cookie)
+        : _thread(thread)
+        , _cmd(cmd)
+        , _cookie(cookie)
+    {
+    }
+
+    ~OpRequest()
+    {
+        lcbx_cmd_destroy(_cmd);
+    }
+
+    void run(lcb_INSTANCE *instance) override
+    {
+        lcb_STATUS err = ExecFn(instance, _cookie, _cmd);
+        if (err != LCB_SUCCESS) {
+            _thread->complete(new FailedOpCompletion<CookieType>(_cookie, err));
+            return;
+        }
+
+        _cookie->dispatched();
+    }
+
+private:
+    IoThread *_thread;
+    CmdType *_cmd;
+    CookieType *_cookie;
+};
+
+#ifdef LCBX_HAVE_SNAPPY
+/*
+ * Compresses the value of a store operation on the libuv threadpool, and
+ * schedules the operation from the V8 thread once it has finished.  The
+ * cookie holds the uncompressed value for the duration, so the worker reads
+ * it in place.  Values which do not compress well enough are sent as they
+ * are, without libcouchbase compressing them a second time.
+ */
+template <lcb_STATUS (*ExecFn)(lcb_INSTANCE *, void *, const lcb_CMDSTORE *)>
+class CompressRequest
+{
+public:
+    CompressRequest(Instance *inst, lcb_CMDSTORE *cmd, OpCookie *cookie,
+                    const char *value, size_t nvalue, float minRatio)
+        : _inst(inst)
+        , _cmd(cmd)
+        , _cookie(cookie)
+        , _value(value)
+        , _nvalue(nvalue)
+        , _minRatio(minRatio)
+        , _compressed(nullptr)
+        , _ncompressed(0)
+    {
+        _work.data = this;
+    }
+
+    ~CompressRequest()
+    {
+        lcbx_cmd_destroy(_cmd);
+        free(_compressed);
+    }
+
+    void start()
+    {
+        ++_inst->_pendingCompressions;
+        uv_queue_work(Nan::GetCurrentEventLoop(), &_work, &uvWork,
+                      &uvAfterWork);
+    }
+
+private:
+    static void uvWork(uv_work_t *req)
+    {
+        CompressRequest *me = reinterpret_cast<CompressRequest *>(req->data);
+        me->_compressed = reinterpret_cast<char *>(
+            malloc(snappy::MaxCompressedLength(me->_nvalue)));
+        if (!me->_compressed) {
+            return;
+        }
+        snappy::RawCompress(me->_value, me->_nvalue, me->_compressed,
+                            &me->_ncompressed);
+    }
+
+    static void uvAfterWork(uv_work_t *req, int status)
+    {
+        CompressRequest *me = reinterpret_cast<CompressRequest *>(req->data);
+        Instance *inst = me->_inst;
+        Nan::HandleScope scope;
+
+        --inst->_pendingCompressions;
+        if (status != 0 || inst->_shuttingDown) {
+            OpCookie::failDispatch(me->_cookie, LCB_ERR_REQUEST_CANCELED);
+            delete me;
+            return;
+        }
+
+        Local<Object> buffer;
+        if (me->_ncompressed > 0 &&
+            static_cast<float>(me->_ncompressed) / me->_nvalue <=
+                me->_minRatio &&
+            Nan::NewBuffer(me->_compressed, me->_ncompressed,
+                           [](char *data, void *) { free(data); }, nullptr)
+                .ToLocal(&buffer)) {
+            // The buffer now owns the compressed value, and replaces the
+            // uncompressed one as the value held by the cookie.
+            me->_compressed = nullptr;
+            me->_cookie->holdValue(buffer);
+            lcb_cmdstore_value_nocopy(me->_cmd, node::Buffer::Data(buffer),
+                                      node::Buffer::Length(buffer));
+            lcb_cmdstore_datatype(me->_cmd, LCB_VALUE_F_SNAPPYCOMP);
+        } else {
+            lcb_cmdstore_skip_compression(me->_cmd, 1);
+        }
+
+        lcb_STATUS err = ExecFn(inst->lcbHandle(), me->_cookie, me->_cmd);
+        if (err != LCB_SUCCESS) {
+            OpCookie::failDispatch(me->_cookie, err);
+        }
+        delete me;
+    }
+
+    uv_work_t _work;
+    Instance *_inst;
+    lcb_CMDSTORE *_cmd;
+    OpCookie *_cookie;
+    const char *_value;
+    size_t _nvalue;
+    float _minRatio;
+    char *_compressed;
+    size_t _ncompressed;
+};
+#endif
+
 template <typename CmdType>
 class CmdBuilder
 {
@@ -274,6 +877,14 @@ public:
         return _cmd;
     }
 
+    // Releases ownership of the command to the caller.
+    CmdType *releaseCmd()
+    {
+        CmdType *cmd = _cmd;
+        _cmd = nullptr;
+        return cmd;
+    }
+
 protected:
     template <typename T, lcb_STATUS (*SetFn)(CmdType *, T)>
     bool _parseIntOption(Local<Value> value)
@@ -315,14 +926,32 @@ public:
     OpBuilder(Instance *inst, Ts... args)
         : CmdBuilder<CmdType>(_valueParser, args...)
         , _inst(inst)
+        , _valueParser(&inst->_stringArena)
         , _parentSpan(nullptr)
+        , _batchCookie(nullptr)
+        , _batchLock(nullptr)
+        , _batchScheduled(0)
+        , _batchErr(LCB_SUCCESS)
     {
     }
 
     ~OpBuilder()
     {
+        if (_batchCookie) {
+            // The batch was never committed, none of its items are in flight
+            // and the shared cookie can be discarded.
+            lcb_sched_fail(_inst->lcbHandle());
+            delete _batchCookie;
+            _batchCookie = nullptr;
+        }
+        if (_batchLock) {
+            delete _batchLock;
+            _batchLock = nullptr;
+        }
+
         _callback.Reset();
         _transcoder.Reset();
+        _heldValue.Reset();
 
         if (_parentSpan) {
             delete _parentSpan;
@@ -377,16 +1006,23 @@ public:
         return true;
     }
 
-    template <lcb_STATUS (*BytesFn)(CmdType *, const char *, size_t),
-              lcb_STATUS (*FlagsFn)(CmdType *, uint32_t)>
-    bool parseDocValue(Local<Value> value)
+    // Encodes a document value with the operations transcoder, yielding the
+    // bytes to store (a string or a buffer) and their flags.
+    bool encodeDocValue(Local<Value> value, Local<Value> *bytesOut,
+                        uint32_t *flagsOut)
     {
         ScopedTraceSpan encSpan = this->startEncodeTrace();
 
+        if (this->_transcoder.IsEmpty()) {
+            // No transcoder was provided, use the native default transcoder
+            // to avoid the round-trip through JS for every operation.
+            return DefaultTranscoder::encode(value, bytesOut, flagsOut);
+        }
+
         Local<Object> transcoderObj = Nan::New(this->_transcoder);
 
         Nan::MaybeLocal<Value> encodeFnValM =
-            Nan::Get(transcoderObj, Nan::New("encode").ToLocalChecked());
+            Nan::Get(transcoderObj, names::encode());
         if (encodeFnValM.IsEmpty()) {
             return false;
         }
@@ -418,21 +1054,36 @@ public:
         if (valueValM.IsEmpty()) {
             return false;
         }
-        Local<Value> valueVal = valueValM.ToLocalChecked();
+        *bytesOut = valueValM.ToLocalChecked();
 
         Nan::MaybeLocal<Value> flagsValM = Nan::Get(resArr, 1);
         if (flagsValM.IsEmpty()) {
             return false;
         }
-        Local<Value> flagsVal = flagsValM.ToLocalChecked();
 
-        if (!this->template parseOption<BytesFn>(valueVal)) {
+        *flagsOut = 0;
+        return ValueParser::parseUint(flagsOut, flagsValM.ToLocalChecked());
+    }
+
+    // Parses the document value of an operation.  If the command can be
+    // given its value without copying it (NoCopyFn), large values are lent
+    // to libcouchbase, and the buffer holding them is kept alive by the
+    // operations cookie until libcouchbase releases it.
+    template <lcb_STATUS (*BytesFn)(CmdType *, const char *, size_t),
+              lcb_STATUS (*FlagsFn)(CmdType *, uint32_t),
+              lcb_STATUS (*NoCopyFn)(CmdType *, const char *, size_t) =
+                  nullptr>
+    bool parseDocValue(Local<Value> value)
+    {
+        Local<Value> encoded;
+        uint32_t flags;
+        if (!encodeDocValue(value, &encoded, &flags)) {
             return false;
         }
-        if (!this->template parseOption<FlagsFn>(flagsVal)) {
+        if (!this->template _parseDocBytes<BytesFn, NoCopyFn>(encoded)) {
             return false;
         }
-        return true;
+        return FlagsFn(this->cmd(), flags) == LCB_SUCCESS;
     }
 
     template <typename SubCmdType, typename... Ts>
@@ -469,31 +1120,292 @@ public:
             }
         }
 
-        OpCookie *cookie =
-            new OpCookie(this->_inst, this->_callback, this->_transcoder,
-                         this->_traceSpan, this->_parentSpan);
+        OpCookie *cookie = this->_inst->_cookiePool.create(
+            this->_inst, this->_callback, this->_transcoder, this->_traceSpan,
+            this->_parentSpan);
 
         // ownership of the parent span wrapper transfers to the opcookie
         _parentSpan = nullptr;
 
+        if (!_heldValue.IsEmpty()) {
+            cookie->holdValue(Nan::New(_heldValue));
+            _heldValue.Reset();
+        }
+
+        IoThread *ioThread = this->_inst->_ioThread;
+        if (ioThread && IoQueueable<CmdType>::value) {
+            ioThread->post(new OpRequest<CmdType, OpCookie, ExecFn>(
+                ioThread, this->releaseCmd(), cookie));
+            return LCB_SUCCESS;
+        }
+
+        lcb_STATUS err;
+        {
+            IoThread::Lock lock(ioThread);
+            err = ExecFn(this->_inst->lcbHandle(), cookie, this->cmd());
+        }
+        if (ioThread && err == LCB_SUCCESS) {
+            ioThread->requestFlush();
+        }
+        if (err != LCB_SUCCESS) {
+            // If the result was unsuccessful, we need to destroy the cookie
+            // since we won't see it in any callbacks.
+            this->_inst->_cookiePool.destroy(cookie);
+        }
+
+        return err;
+    }
+
+    // Executes a store operation, compressing its value on the libuv
+    // threadpool first when it is large enough for that to be worthwhile.
+    // The operation is then scheduled once compression has finished, which
+    // may be after operations that were executed later.
+    template <lcb_STATUS (*ExecFn)(lcb_INSTANCE *, void *, const CmdType *)>
+    lcb_STATUS executeCompressed()
+    {
+#ifdef LCBX_HAVE_SNAPPY
+        if (!this->_inst->parallelCompression() || _heldValue.IsEmpty()) {
+            return this->template execute<ExecFn>();
+        }
+
+        Local<Object> value = Nan::New(_heldValue);
+        size_t nvalue = node::Buffer::Length(value);
+
+        lcb_INSTANCE *instance = this->_inst->lcbHandle();
+        int compressOpts = 0;
+        lcb_U32 minSize = 0;
+        float minRatio = 0;
+        lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_COMPRESSION_OPTS,
+                 &compressOpts);
+        lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_COMPRESSION_MIN_SIZE,
+                 &minSize);
+        lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_COMPRESSION_MIN_RATIO,
+                 &minRatio);
+        if ((compressOpts & LCB_COMPRESS_OUT) == 0 ||
+            nvalue < COMPRESS_OFFLOAD_MIN_SIZE || nvalue < minSize) {
+            return this->template execute<ExecFn>();
+        }
+
+        if (_traceSpan) {
+            lcb_STATUS err =
+                lcbx_cmd_parent_span(this->cmd(), _traceSpan.span());
+            if (err != LCB_SUCCESS) {
+                return err;
+            }
+        }
+
+        OpCookie *cookie = this->_inst->_cookiePool.create(
+            this->_inst, this->_callback, this->_transcoder, this->_traceSpan,
+            this->_parentSpan);
+
+        // ownership of the parent span wrapper transfers to the opcookie
+        _parentSpan = nullptr;
+
+        cookie->holdValue(value);
+        _heldValue.Reset();
+
+        (new CompressRequest<ExecFn>(this->_inst, this->releaseCmd(), cookie,
+                                     node::Buffer::Data(value), nvalue,
+                                     minRatio))
+            ->start();
+        return LCB_SUCCESS;
+#else
+        return this->template execute<ExecFn>();
+#endif
+    }
+
+    // Executes a streaming request, returning the object which controls it
+    // or an empty handle if the request failed to be dispatched.
+    template <typename HandleType,
+              lcb_STATUS (*HandleFn)(CmdType *, HandleType **),
+              lcb_STATUS (*ExecFn)(lcb_INSTANCE *, void *, const CmdType *)>
+    Nan::MaybeLocal<Object> executeStream(uint32_t maxRows, uint32_t maxBytes,
+                                          lcb_STATUS *errOut)
+    {
+        if (_traceSpan) {
+            lcb_STATUS err =
+                lcbx_cmd_parent_span(this->cmd(), _traceSpan.span());
+            if (err != LCB_SUCCESS) {
+                *errOut = err;
+                return Nan::MaybeLocal<Object>();
+            }
+        }
+
+        StreamOpCookie *cookie = new StreamOpCookie(
+            this->_inst, this->_callback, this->_transcoder, this->_traceSpan,
+            this->_parentSpan, maxRows, maxBytes);
+
+        // ownership of the parent span wrapper transfers to the opcookie
+        _parentSpan = nullptr;
+
+        HandleFn(this->cmd(), cookie->handle<HandleType>());
+
+        IoThread *ioThread = this->_inst->_ioThread;
+        if (ioThread) {
+            ioThread->post(new OpRequest<CmdType, StreamOpCookie, ExecFn>(
+                ioThread, this->releaseCmd(), cookie));
+            *errOut = LCB_SUCCESS;
+            return cookie->control();
+        }
+
         lcb_STATUS err = ExecFn(this->_inst->lcbHandle(), cookie, this->cmd());
         if (err != LCB_SUCCESS) {
             // If the result was unsuccessful, we need to destroy the cookie
             // since we won't see it in any callbacks.
             delete cookie;
+            *errOut = err;
+            return Nan::MaybeLocal<Object>();
         }
 
-        return err;
+        *errOut = LCB_SUCCESS;
+        return cookie->control();
+    }
+
+    // Begins a batch of operations sharing this builders callback, transcoder
+    // and trace span.  Each item is scheduled with executeBatchItem after the
+    // command has been updated for it, and the batch is dispatched by
+    // commitBatch.  Every item must be validated before the batch is begun,
+    // as once an item is scheduled it can no longer be recalled; it may
+    // already have been deferred until the client is bootstrapped.  When
+    // running with an I/O thread, the instance lock is held until the batch
+    // is committed.
+    lcb_STATUS beginBatch(size_t numItems)
+    {
+        if (_traceSpan) {
+            lcb_STATUS err =
+                lcbx_cmd_parent_span(this->cmd(), _traceSpan.span());
+            if (err != LCB_SUCCESS) {
+                return err;
+            }
+        }
+
+        _batchCookie =
+            new BatchOpCookie(this->_inst, this->_callback, this->_transcoder,
+                              this->_traceSpan, this->_parentSpan, numItems);
+        _batchScheduled = 0;
+        _batchErr = LCB_SUCCESS;
+
+        // ownership of the parent span wrapper transfers to the opcookie
+        _parentSpan = nullptr;
+
+        if (this->_inst->_ioThread) {
+            _batchLock = new IoThread::Lock(this->_inst->_ioThread);
+        }
+
+        lcb_sched_enter(this->_inst->lcbHandle());
+        return LCB_SUCCESS;
+    }
+
+    // Schedules an item of the batch.  An item which libcouchbase refuses
+    // (such as one rejected by the request budget) fails on its own, its
+    // error is delivered in its slot of the batch results.
+    template <lcb_STATUS (*ExecFn)(lcb_INSTANCE *, void *, const CmdType *)>
+    void executeBatchItem(size_t index)
+    {
+        lcb_STATUS err = ExecFn(this->_inst->lcbHandle(),
+                                _batchCookie->itemCookie(index), this->cmd());
+        if (err != LCB_SUCCESS) {
+            _batchCookie->failItem(index, err);
+            if (_batchErr == LCB_SUCCESS) {
+                _batchErr = err;
+            }
+            return;
+        }
+
+        ++_batchScheduled;
+    }
+
+    // Dispatches the batch.  If none of its items could be scheduled, the
+    // batch is discarded instead and the first error is returned, so that it
+    // fails the same way a single operation would.
+    lcb_STATUS commitBatch()
+    {
+        if (_batchScheduled == 0) {
+            return _batchErr;
+        }
+
+        lcb_sched_leave(this->_inst->lcbHandle());
+
+        // ownership of the batch cookie transfers to the scheduled operations
+        _batchCookie = nullptr;
+
+        if (_batchLock) {
+            delete _batchLock;
+            _batchLock = nullptr;
+            this->_inst->_ioThread->requestFlush();
+        }
+
+        return LCB_SUCCESS;
     }
 
 protected:
+    // Values smaller than this are cheaper to copy than to keep alive.
+    static const size_t NOCOPY_MIN_SIZE = 16 * 1024;
+
+    // Values smaller than this are compressed faster than a round trip
+    // through the threadpool takes.
+    static const size_t COMPRESS_OFFLOAD_MIN_SIZE = 64 * 1024;
+
+    template <lcb_STATUS (*BytesFn)(CmdType *, const char *, size_t),
+              lcb_STATUS (*NoCopyFn)(CmdType *, const char *, size_t)>
+    bool _parseDocBytes(Local<Value> value)
+    {
+        if (NoCopyFn != nullptr) {
+            Local<Object> buffer;
+            if (_lendableBuffer(value).ToLocal(&buffer)) {
+                _heldValue.Reset(buffer);
+                return NoCopyFn(this->cmd(), node::Buffer::Data(buffer),
+                                node::Buffer::Length(buffer)) == LCB_SUCCESS;
+            }
+        }
+
+        return this->template parseOption<BytesFn>(value);
+    }
+
+    // Returns the buffer to lend to libcouchbase for a value, if it is large
+    // enough to be worth it.  Strings are encoded straight into a new buffer
+    // instead of the string arena, as the arena is reused by the next op.
+    // Buffers passed by the application are only lent when it opted in, as
+    // they could otherwise be modified while the operation is in flight.
+    MaybeLocal<Object> _lendableBuffer(Local<Value> value)
+    {
+        if (node::Buffer::HasInstance(value)) {
+            size_t length = node::Buffer::Length(value);
+            if (_inst->zeroCopyWrites() && length >= NOCOPY_MIN_SIZE) {
+                return value.As<Object>();
+            }
+
+            // Values compressed on the threadpool must not change while the
+            // worker reads them, so a private copy is made to lend instead.
+            if (_inst->parallelCompression() &&
+                length >= COMPRESS_OFFLOAD_MIN_SIZE) {
+                return Nan::CopyBuffer(node::Buffer::Data(value), length);
+            }
+            return MaybeLocal<Object>();
+        }
+
+        if (value->IsString() &&
+            static_cast<size_t>(value.As<String>()->Length()) >=
+                NOCOPY_MIN_SIZE) {
+            return node::Buffer::New(Isolate::GetCurrent(), value.As<String>(),
+                                     node::UTF8);
+        }
+
+        return MaybeLocal<Object>();
+    }
+
     Instance *_inst;
     ValueParser _valueParser;
     std::vector<Nan::Utf8String *> _strings;
     Nan::Callback _callback;
     Nan::Persistent<Object> _transcoder;
+    Nan::Persistent<Object> _heldValue;
     WrappedRequestSpan *_parentSpan;
     TraceSpan _traceSpan;
+    BatchOpCookie *_batchCookie;
+    IoThread::Lock *_batchLock;
+    size_t _batchScheduled;
+    lcb_STATUS _batchErr;
 };
 
 } // namespace couchnode
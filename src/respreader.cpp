@@ -1 +1,8 @@
 #include "respreader.h"
+
+namespace couchnode
+{
+
+std::atomic<size_t> ZeroCopyBuffers::_live(0);
+
+} // namespace couchnode
@@ -6,10 +6,43 @@
 #include "instance.h"
 #include "mutationtoken.h"
 #include "opbuilder.h"
+#include "transcoder.h"
+#include <libcouchbase/pktfwd.h>
 
 namespace couchnode
 {
 
+// Values smaller than this are always copied, since wrapping them would pin
+// an entire network read segment for the lifetime of the returned Buffer.
+static const size_t ZEROCOPY_MIN_SIZE = 4096;
+
+// Counts the Buffers which still reference the network buffer their value was
+// read into.  These may outlive the connection which read them, so the count
+// covers every connection.
+class ZeroCopyBuffers
+{
+public:
+    static size_t live()
+    {
+        return _live;
+    }
+
+    static void acquire(lcb_BACKBUF backbuf)
+    {
+        lcb_backbuf_ref(backbuf);
+        ++_live;
+    }
+
+    static void release(char *, void *hint)
+    {
+        lcb_backbuf_unref(reinterpret_cast<lcb_BACKBUF>(hint));
+        --_live;
+    }
+
+private:
+    static std::atomic<size_t> _live;
+};
+
 template <typename RespType, typename CtxType,
           lcb_STATUS (*CtxFn)(const RespType *, const CtxType **)>
 class CtxReader
@@ -97,15 +130,30 @@ public:
     RespReader(lcb_INSTANCE *instance, const RespType *resp)
         : _instance(instance)
         , _resp(resp)
+        , _cookie(nullptr)
+        , _batchItem(nullptr)
     {
-        lcb_STATUS rc = CookieFn(_resp, reinterpret_cast<void **>(&_cookie));
+        void *cookie = nullptr;
+        lcb_STATUS rc = CookieFn(_resp, &cookie);
         if (rc != LCB_SUCCESS) {
-            _cookie = nullptr;
+            return;
+        }
+
+        _batchItem = BatchOpCookie::fromCookie(cookie);
+        if (_batchItem) {
+            _cookie = _batchItem->batch;
+        } else {
+            _cookie = reinterpret_cast<OpCookie *>(cookie);
         }
     }
 
     Instance *instance() const
     {
+        // Responses handed over by an I/O thread may outlive the libcouchbase
+        // instance, so the instance is taken from the cookie where possible.
+        if (_cookie) {
+            return _cookie->_inst;
+        }
         return Instance::fromLcbInst(_instance);
     }
 
@@ -189,25 +237,24 @@ public:
         Local<Object> errValObj = errVal.As<Object>();
 
         CtxReader<RespType, lcb_KEY_VALUE_ERROR_CONTEXT, CtxFn> ctxRdr(_resp);
-        Nan::Set(errValObj, Nan::New<String>("ctxtype").ToLocalChecked(),
-                 Nan::New<String>("kv").ToLocalChecked());
-        Nan::Set(errValObj, Nan::New<String>("status_code").ToLocalChecked(),
+        Nan::Set(errValObj, names::ctxtype(), names::kv());
+        Nan::Set(errValObj, names::status_code(),
                  ctxRdr.template parseValue<&lcb_errctx_kv_status_code>());
-        Nan::Set(errValObj, Nan::New<String>("opaque").ToLocalChecked(),
+        Nan::Set(errValObj, names::opaque(),
                  ctxRdr.template parseValue<&lcb_errctx_kv_opaque>());
-        Nan::Set(errValObj, Nan::New<String>("cas").ToLocalChecked(),
+        Nan::Set(errValObj, names::cas(),
                  ctxRdr.template decodeCas<&lcb_errctx_kv_cas>());
-        Nan::Set(errValObj, Nan::New<String>("key").ToLocalChecked(),
+        Nan::Set(errValObj, names::key(),
                  ctxRdr.template parseValue<&lcb_errctx_kv_key>());
-        Nan::Set(errValObj, Nan::New<String>("bucket").ToLocalChecked(),
+        Nan::Set(errValObj, names::bucket(),
                  ctxRdr.template parseValue<&lcb_errctx_kv_bucket>());
-        Nan::Set(errValObj, Nan::New<String>("collection").ToLocalChecked(),
+        Nan::Set(errValObj, names::collection(),
                  ctxRdr.template parseValue<&lcb_errctx_kv_collection>());
-        Nan::Set(errValObj, Nan::New<String>("scope").ToLocalChecked(),
+        Nan::Set(errValObj, names::scope(),
                  ctxRdr.template parseValue<&lcb_errctx_kv_scope>());
-        Nan::Set(errValObj, Nan::New<String>("context").ToLocalChecked(),
+        Nan::Set(errValObj, names::context(),
                  ctxRdr.template parseValue<&lcb_errctx_kv_context>());
-        Nan::Set(errValObj, Nan::New<String>("ref").ToLocalChecked(),
+        Nan::Set(errValObj, names::ref(),
                  ctxRdr.template parseValue<&lcb_errctx_kv_ref>());
 
         return errVal;
@@ -225,26 +272,25 @@ public:
         Local<Object> errValObj = errVal.As<Object>();
 
         CtxReader<RespType, lcb_VIEW_ERROR_CONTEXT, CtxFn> ctxRdr(_resp);
-        Nan::Set(errValObj, Nan::New<String>("ctxtype").ToLocalChecked(),
-                 Nan::New<String>("views").ToLocalChecked());
+        Nan::Set(errValObj, names::ctxtype(), names::views());
         Nan::Set(
-            errValObj, Nan::New<String>("first_error_code").ToLocalChecked(),
+            errValObj, names::first_error_code(),
             ctxRdr.template parseValue<&lcb_errctx_view_first_error_code>());
         Nan::Set(
-            errValObj, Nan::New<String>("first_error_message").ToLocalChecked(),
+            errValObj, names::first_error_message(),
             ctxRdr.template parseValue<&lcb_errctx_view_first_error_message>());
         Nan::Set(
-            errValObj, Nan::New<String>("design_document").ToLocalChecked(),
+            errValObj, names::design_document(),
             ctxRdr.template parseValue<&lcb_errctx_view_design_document>());
-        Nan::Set(errValObj, Nan::New<String>("view").ToLocalChecked(),
+        Nan::Set(errValObj, names::view(),
                  ctxRdr.template parseValue<&lcb_errctx_view_view>());
-        Nan::Set(errValObj, Nan::New<String>("parameters").ToLocalChecked(),
+        Nan::Set(errValObj, names::parameters(),
                  ctxRdr.template parseValue<&lcb_errctx_view_query_params>());
         Nan::Set(
-            errValObj, Nan::New<String>("http_response_code").ToLocalChecked(),
+            errValObj, names::http_response_code(),
             ctxRdr.template parseValue<&lcb_errctx_view_http_response_code>());
         Nan::Set(
-            errValObj, Nan::New<String>("http_response_body").ToLocalChecked(),
+            errValObj, names::http_response_body(),
             ctxRdr.template parseValue<&lcb_errctx_view_http_response_body>());
 
         return errVal;
@@ -262,27 +308,26 @@ public:
         Local<Object> errValObj = errVal.As<Object>();
 
         CtxReader<RespType, lcb_QUERY_ERROR_CONTEXT, CtxFn> ctxRdr(_resp);
-        Nan::Set(errValObj, Nan::New<String>("ctxtype").ToLocalChecked(),
-                 Nan::New<String>("query").ToLocalChecked());
+        Nan::Set(errValObj, names::ctxtype(), names::query());
         Nan::Set(
-            errValObj, Nan::New<String>("first_error_code").ToLocalChecked(),
+            errValObj, names::first_error_code(),
             ctxRdr.template parseValue<&lcb_errctx_query_first_error_code>());
         Nan::Set(
-            errValObj, Nan::New<String>("first_error_message").ToLocalChecked(),
+            errValObj, names::first_error_message(),
             ctxRdr
                 .template parseValue<&lcb_errctx_query_first_error_message>());
-        Nan::Set(errValObj, Nan::New<String>("statement").ToLocalChecked(),
+        Nan::Set(errValObj, names::statement(),
                  ctxRdr.template parseValue<&lcb_errctx_query_statement>());
         Nan::Set(
-            errValObj, Nan::New<String>("client_context_id").ToLocalChecked(),
+            errValObj, names::client_context_id(),
             ctxRdr.template parseValue<&lcb_errctx_query_client_context_id>());
-        Nan::Set(errValObj, Nan::New<String>("parameters").ToLocalChecked(),
+        Nan::Set(errValObj, names::parameters(),
                  ctxRdr.template parseValue<&lcb_errctx_query_query_params>());
         Nan::Set(
-            errValObj, Nan::New<String>("http_response_code").ToLocalChecked(),
+            errValObj, names::http_response_code(),
             ctxRdr.template parseValue<&lcb_errctx_query_http_response_code>());
         Nan::Set(
-            errValObj, Nan::New<String>("http_response_body").ToLocalChecked(),
+            errValObj, names::http_response_body(),
             ctxRdr.template parseValue<&lcb_errctx_query_http_response_body>());
 
         return errVal;
@@ -300,23 +345,22 @@ public:
         Local<Object> errValObj = errVal.As<Object>();
 
         CtxReader<RespType, lcb_SEARCH_ERROR_CONTEXT, CtxFn> ctxRdr(_resp);
-        Nan::Set(errValObj, Nan::New<String>("ctxtype").ToLocalChecked(),
-                 Nan::New<String>("search").ToLocalChecked());
+        Nan::Set(errValObj, names::ctxtype(), names::search());
         Nan::Set(
-            errValObj, Nan::New<String>("error_message").ToLocalChecked(),
+            errValObj, names::error_message(),
             ctxRdr.template parseValue<&lcb_errctx_search_error_message>());
-        Nan::Set(errValObj, Nan::New<String>("index_name").ToLocalChecked(),
+        Nan::Set(errValObj, names::index_name(),
                  ctxRdr.template parseValue<&lcb_errctx_search_index_name>());
-        Nan::Set(errValObj, Nan::New<String>("query").ToLocalChecked(),
+        Nan::Set(errValObj, names::query(),
                  ctxRdr.template parseValue<&lcb_errctx_search_query>());
-        Nan::Set(errValObj, Nan::New<String>("parameters").ToLocalChecked(),
+        Nan::Set(errValObj, names::parameters(),
                  ctxRdr.template parseValue<&lcb_errctx_search_params>());
         Nan::Set(
-            errValObj, Nan::New<String>("http_response_code").ToLocalChecked(),
+            errValObj, names::http_response_code(),
             ctxRdr
                 .template parseValue<&lcb_errctx_search_http_response_code>());
         Nan::Set(
-            errValObj, Nan::New<String>("http_response_body").ToLocalChecked(),
+            errValObj, names::http_response_body(),
             ctxRdr
                 .template parseValue<&lcb_errctx_search_http_response_body>());
 
@@ -335,28 +379,27 @@ public:
         Local<Object> errValObj = errVal.As<Object>();
 
         CtxReader<RespType, lcb_ANALYTICS_ERROR_CONTEXT, CtxFn> ctxRdr(_resp);
-        Nan::Set(errValObj, Nan::New<String>("ctxtype").ToLocalChecked(),
-                 Nan::New<String>("analytics").ToLocalChecked());
+        Nan::Set(errValObj, names::ctxtype(), names::analytics());
         Nan::Set(
-            errValObj, Nan::New<String>("first_error_code").ToLocalChecked(),
+            errValObj, names::first_error_code(),
             ctxRdr
                 .template parseValue<&lcb_errctx_analytics_first_error_code>());
         Nan::Set(errValObj,
-                 Nan::New<String>("first_error_message").ToLocalChecked(),
+                 names::first_error_message(),
                  ctxRdr.template parseValue<
                      &lcb_errctx_analytics_first_error_message>());
-        Nan::Set(errValObj, Nan::New<String>("statement").ToLocalChecked(),
+        Nan::Set(errValObj, names::statement(),
                  ctxRdr.template parseValue<&lcb_errctx_analytics_statement>());
         Nan::Set(errValObj,
-                 Nan::New<String>("client_context_id").ToLocalChecked(),
+                 names::client_context_id(),
                  ctxRdr.template parseValue<
                      &lcb_errctx_analytics_client_context_id>());
         Nan::Set(errValObj,
-                 Nan::New<String>("http_response_code").ToLocalChecked(),
+                 names::http_response_code(),
                  ctxRdr.template parseValue<
                      &lcb_errctx_analytics_http_response_code>());
         Nan::Set(errValObj,
-                 Nan::New<String>("http_response_body").ToLocalChecked(),
+                 names::http_response_body(),
                  ctxRdr.template parseValue<
                      &lcb_errctx_analytics_http_response_body>());
 
@@ -401,6 +444,37 @@ public:
         return Nan::CopyBuffer(value, nvalue).ToLocalChecked();
     }
 
+    template <lcb_STATUS (*ValFn)(const RespType *, const char **, size_t *),
+              lcb_STATUS (*BufFn)(const RespType *, lcb_BACKBUF *)>
+    Local<Value> parseValue() const
+    {
+        const char *value = NULL;
+        size_t nvalue = 0;
+        if (ValFn(_resp, &value, &nvalue) != LCB_SUCCESS) {
+            return Nan::Null();
+        }
+
+        return _parseValueBackbuf<BufFn>(value, nvalue);
+    }
+
+    template <lcb_STATUS (*ValFn)(const RespType *, const char **, size_t *),
+              lcb_STATUS (*BufFn)(const RespType *, lcb_BACKBUF *),
+              lcb_STATUS (*IovFn)(const RespType *, const lcb_IOV **,
+                                  size_t *)>
+    Local<Value> parseValue() const
+    {
+        // A value which lcb left scattered across its network buffers is
+        // gathered straight into the Buffer, rather than first being made
+        // contiguous by lcb and then copied.
+        const lcb_IOV *iov = nullptr;
+        size_t niov = 0;
+        if (IovFn != nullptr && IovFn(_resp, &iov, &niov) == LCB_SUCCESS) {
+            return _parseValueIov(iov, niov);
+        }
+
+        return parseValue<ValFn, BufFn>();
+    }
+
     template <lcb_STATUS (*ValFn)(const RespType *, size_t, const char **,
                                   size_t *)>
     Local<Value> parseValue(size_t index) const
@@ -414,16 +488,54 @@ public:
         return Nan::CopyBuffer(value, nvalue).ToLocalChecked();
     }
 
+    template <lcb_STATUS (*ValFn)(const RespType *, size_t, const char **,
+                                  size_t *),
+              lcb_STATUS (*BufFn)(const RespType *, lcb_BACKBUF *)>
+    Local<Value> parseValue(size_t index) const
+    {
+        const char *value = NULL;
+        size_t nvalue = 0;
+        if (ValFn(_resp, index, &value, &nvalue) != LCB_SUCCESS) {
+            return Nan::Null();
+        }
+
+        return _parseValueBackbuf<BufFn>(value, nvalue);
+    }
+
     template <lcb_STATUS (*BytesFn)(const RespType *, const char **, size_t *),
-              lcb_STATUS (*FlagsFn)(const RespType *, uint32_t *)>
+              lcb_STATUS (*FlagsFn)(const RespType *, uint32_t *),
+              lcb_STATUS (*BufFn)(const RespType *, lcb_BACKBUF *),
+              lcb_STATUS (*IovFn)(const RespType *, const lcb_IOV **,
+                                  size_t *) = nullptr>
     Local<Value> parseDocValue() const
     {
         ScopedTraceSpan decodeTrace = this->_cookie->startDecodeTrace();
 
+        if (this->_cookie->_transcoder.IsEmpty()) {
+            // No transcoder was provided, use the native default transcoder,
+            // only materializing a Buffer when raw bytes are to be returned.
+            const char *bytes = NULL;
+            size_t nbytes = 0;
+            uint32_t flags = 0;
+            FlagsFn(_resp, &flags);
+            if (!DefaultTranscoder::isText(flags)) {
+                return parseValue<BytesFn, BufFn, IovFn>();
+            }
+            if (BytesFn(_resp, &bytes, &nbytes) != LCB_SUCCESS) {
+                return Nan::Undefined();
+            }
+
+            Local<Value> decodedVal;
+            if (DefaultTranscoder::decode(&decodedVal, bytes, nbytes, flags)) {
+                return decodedVal;
+            }
+            return _parseValueBackbuf<BufFn>(bytes, nbytes);
+        }
+
         Local<Object> transcoderObj = Nan::New(this->_cookie->_transcoder);
 
         Nan::MaybeLocal<Value> decodeFnValM =
-            Nan::Get(transcoderObj, Nan::New("decode").ToLocalChecked());
+            Nan::Get(transcoderObj, names::decode());
         if (decodeFnValM.IsEmpty()) {
             return Nan::Undefined();
         }
@@ -436,7 +548,7 @@ public:
 
         Local<Function> decodeFn = decodeFnM.ToLocalChecked();
 
-        Local<Value> valueVal = parseValue<BytesFn>();
+        Local<Value> valueVal = parseValue<BytesFn, BufFn, IovFn>();
         Local<Value> flagsVal = parseValue<FlagsFn>();
 
         Local<Value> argsArr[] = {valueVal, flagsVal};
@@ -461,6 +573,11 @@ public:
     template <typename... Ts>
     void invokeCallback(Ts... args) const
     {
+        if (_batchItem) {
+            _completeBatchItem(args...);
+            return;
+        }
+
         OpCookie *lclCookie = cookie();
 
         lclCookie->endTrace();
@@ -468,13 +585,116 @@ public:
         Local<Value> argsArr[] = {args...};
         lclCookie->invokeCallback(sizeof...(args), argsArr);
 
+        OpCookie::complete(lclCookie);
+    }
+
+    // Delivers a row of a streaming request, either on its own or as part of
+    // a batch of rows when the request asked for rows to be batched.
+    void invokeRowCallback(Local<Value> errVal, Local<Value> flagsVal,
+                           Local<Value> rowVal) const
+    {
+        StreamOpCookie *lclCookie = static_cast<StreamOpCookie *>(cookie());
+
+        if (!lclCookie->batchRows()) {
+            invokeNonFinalCallback(errVal, flagsVal, rowVal);
+            return;
+        }
+
+        size_t nbytes = 0;
+        if (node::Buffer::HasInstance(rowVal)) {
+            nbytes = node::Buffer::Length(rowVal);
+        }
+        lclCookie->addRow(rowVal, nbytes);
+    }
+
+    template <typename... Ts>
+    void invokeStreamCallback(Ts... args) const
+    {
+        StreamOpCookie *lclCookie = static_cast<StreamOpCookie *>(cookie());
+
+        // Rows which are still pending must be delivered before the meta-data.
+        lclCookie->flushRows();
+
+        lclCookie->endTrace();
+
+        Local<Value> argsArr[] = {args...};
+        lclCookie->invokeCallback(sizeof...(args), argsArr);
+
         delete lclCookie;
     }
 
 private:
+    template <typename... Ts>
+    void _completeBatchItem(Ts... args) const
+    {
+        BatchOpCookie *batch = _batchItem->batch;
+
+        Local<Value> argsArr[] = {args...};
+        Local<Array> resArr = Nan::New<Array>(sizeof...(args));
+        for (uint32_t i = 0; i < sizeof...(args); ++i) {
+            Nan::Set(resArr, i, argsArr[i]);
+        }
+
+        if (!batch->setResult(_batchItem->index, resArr)) {
+            return;
+        }
+
+        batch->endTrace();
+
+        Local<Value> cbArgs[] = {Nan::Null(), batch->results()};
+        batch->invokeCallback(2, cbArgs);
+
+        delete batch;
+    }
+
+    template <lcb_STATUS (*BufFn)(const RespType *, lcb_BACKBUF *)>
+    Local<Value> _parseValueBackbuf(const char *value, size_t nvalue) const
+    {
+        if (!instance()->zeroCopyValues() || nvalue < ZEROCOPY_MIN_SIZE) {
+            return Nan::CopyBuffer(value, nvalue).ToLocalChecked();
+        }
+
+        lcb_BACKBUF backbuf;
+        if (BufFn(_resp, &backbuf) != LCB_SUCCESS) {
+            // The value does not live in the network buffer (for instance it
+            // was inflated into temporary storage), so it must be copied.
+            return Nan::CopyBuffer(value, nvalue).ToLocalChecked();
+        }
+
+        // The Buffer takes a reference to the segment which backs it, this is
+        // released by the free callback once the Buffer is collected.
+        ZeroCopyBuffers::acquire(backbuf);
+        Nan::MaybeLocal<Object> bufferM =
+            Nan::NewBuffer(const_cast<char *>(value), nvalue,
+                           &ZeroCopyBuffers::release, backbuf);
+        if (bufferM.IsEmpty()) {
+            return Nan::CopyBuffer(value, nvalue).ToLocalChecked();
+        }
+
+        return bufferM.ToLocalChecked();
+    }
+
+    Local<Value> _parseValueIov(const lcb_IOV *iov, size_t niov) const
+    {
+        size_t nvalue = 0;
+        for (size_t i = 0; i < niov; ++i) {
+            nvalue += iov[i].iov_len;
+        }
+
+        Local<Object> buffer =
+            Nan::NewBuffer(static_cast<uint32_t>(nvalue)).ToLocalChecked();
+        char *data = node::Buffer::Data(buffer);
+        for (size_t i = 0; i < niov; ++i) {
+            memcpy(data, iov[i].iov_base, iov[i].iov_len);
+            data += iov[i].iov_len;
+        }
+        return buffer;
+    }
+
     lcb_INSTANCE *_instance;
     const RespType *_resp;
     OpCookie *_cookie;
+    BatchOpCookie::Item *_batchItem;
 };
 
 } // namespace couchnode
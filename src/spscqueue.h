@@ -0,0 +1,108 @@
+#pragma once
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace couchnode
+{
+
+/*
+ * An unbounded single-producer single-consumer queue of pointers.  Items are
+ * stored in fixed size blocks which are linked together as the queue grows,
+ * and each block is freed by the consumer once it has been drained.  Neither
+ * side ever takes a lock, push may only be called by the producing thread and
+ * pop only by the consuming thread.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    SpscQueue()
+        : _head(new Block())
+        , _readPos(0)
+        , _tail(_head)
+    {
+    }
+
+    ~SpscQueue()
+    {
+        while (_head) {
+            Block *next = _head->next.load(std::memory_order_relaxed);
+            delete _head;
+            _head = next;
+        }
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    void push(T *item)
+    {
+        Block *tail = _tail;
+        size_t pos = tail->committed.load(std::memory_order_relaxed);
+        if (pos < BLOCK_SIZE) {
+            tail->items[pos] = item;
+            tail->committed.store(pos + 1, std::memory_order_release);
+            return;
+        }
+
+        // The current block is full, the item is written to a new block which
+        // is published to the consumer by linking it to the current one.
+        Block *block = new Block();
+        block->items[0] = item;
+        block->committed.store(1, std::memory_order_relaxed);
+        tail->next.store(block, std::memory_order_release);
+        _tail = block;
+    }
+
+    // Returns the next item, or nullptr if the queue is currently empty.
+    T *pop()
+    {
+        Block *head = _head;
+        if (_readPos == BLOCK_SIZE) {
+            Block *next = head->next.load(std::memory_order_acquire);
+            if (!next) {
+                return nullptr;
+            }
+
+            // The producer never touches a block again once it has linked the
+            // next one, so the drained block can be freed here.
+            delete head;
+            _head = head = next;
+            _readPos = 0;
+        }
+
+        if (_readPos == head->committed.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return head->items[_readPos++];
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 256;
+
+    struct Block {
+        Block()
+            : committed(0)
+            , next(nullptr)
+        {
+        }
+
+        T *items[BLOCK_SIZE];
+        std::atomic<size_t> committed;
+        std::atomic<Block *> next;
+    };
+
+    // The consumer and producer state are kept on separate cache lines so
+    // the two threads do not contend on them.
+    Block *_head;
+    size_t _readPos;
+    char _padding[64 - sizeof(Block *) - sizeof(size_t)];
+    Block *_tail;
+};
+
+} // namespace couchnode
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,140 @@
+#pragma once
+#ifndef STRINGARENA_H
+#define STRINGARENA_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace couchnode
+{
+
+/*
+ * A bump allocator for the temporary string conversions performed while
+ * building a command.  Users take a mark before allocating and rewind to it
+ * once the command has been scheduled (libcouchbase copies everything it
+ * needs at that point), which allows nested users to share a single arena.
+ * Up to MAX_RETAINED_CHUNKS chunks are retained across rewinds, so
+ * steady-state traffic does not allocate.  Chunks beyond that, and those
+ * allocated larger than CHUNK_SIZE for a single oversized string, are freed
+ * once the arena is rewound to empty.
+ */
+class StringArena
+{
+public:
+    static const size_t CHUNK_SIZE = 16 * 1024;
+    static const size_t MAX_RETAINED_CHUNKS = 4;
+
+    struct Mark {
+        size_t chunk;
+        size_t offset;
+    };
+
+    StringArena()
+        : _chunkIdx(0)
+        , _offset(0)
+        , _hits(0)
+        , _misses(0)
+    {
+    }
+
+    ~StringArena()
+    {
+        for (size_t i = 0; i < _chunks.size(); ++i) {
+            delete[] _chunks[i].data;
+        }
+    }
+
+    Mark mark() const
+    {
+        Mark m;
+        m.chunk = _chunkIdx;
+        m.offset = _offset;
+        return m;
+    }
+
+    void rewind(const Mark &m)
+    {
+        _chunkIdx = m.chunk;
+        _offset = m.offset;
+
+        // Nothing can reference the arena once it is rewound to empty.
+        if (_chunkIdx == 0 && _offset == 0) {
+            _trim();
+        }
+    }
+
+    char *alloc(size_t size)
+    {
+        bool allocated = false;
+
+        while (true) {
+            if (_chunkIdx < _chunks.size()) {
+                Chunk &chunk = _chunks[_chunkIdx];
+                if (chunk.size - _offset >= size) {
+                    char *data = chunk.data + _offset;
+                    _offset += size;
+
+                    if (allocated) {
+                        ++_misses;
+                    } else {
+                        ++_hits;
+                    }
+                    return data;
+                }
+
+                // Skip over any chunk which cannot fit this allocation, its
+                // space becomes available again when the arena is rewound.
+                ++_chunkIdx;
+                _offset = 0;
+                continue;
+            }
+
+            Chunk chunk;
+            chunk.size = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+            chunk.data = new char[chunk.size];
+            _chunks.push_back(chunk);
+            allocated = true;
+        }
+    }
+
+    uint64_t hits() const
+    {
+        return _hits;
+    }
+
+    uint64_t misses() const
+    {
+        return _misses;
+    }
+
+private:
+    struct Chunk {
+        char *data;
+        size_t size;
+    };
+
+    void _trim()
+    {
+        size_t numKept = 0;
+        for (size_t i = 0; i < _chunks.size(); ++i) {
+            Chunk &chunk = _chunks[i];
+            if (chunk.size > CHUNK_SIZE || numKept == MAX_RETAINED_CHUNKS) {
+                delete[] chunk.data;
+                continue;
+            }
+            _chunks[numKept++] = chunk;
+        }
+        _chunks.resize(numKept);
+    }
+
+    std::vector<Chunk> _chunks;
+    size_t _chunkIdx;
+    size_t _offset;
+    uint64_t _hits;
+    uint64_t _misses;
+};
+
+} // namespace couchnode
+
+#endif // STRINGARENA_H
@@ -48,7 +48,7 @@ public:
     static TraceSpan beginOpTrace(Instance *inst, lcbtrace_SERVICE service,
                                   const char *opName, TraceSpan parent)
     {
-        lcbtrace_TRACER *tracer = lcb_get_tracer(inst->lcbHandle());
+        lcbtrace_TRACER *tracer = inst->lcbTracer();
         if (!tracer) {
             return TraceSpan();
         }
@@ -76,7 +76,7 @@ public:
             return TraceSpan();
         }
 
-        lcbtrace_TRACER *tracer = lcb_get_tracer(inst->lcbHandle());
+        lcbtrace_TRACER *tracer = inst->lcbTracer();
         if (!tracer) {
             return TraceSpan();
         }
@@ -86,8 +86,7 @@ public:
         ref.span = opSpan.span();
         lcbtrace_SPAN *span = lcbtrace_span_start(
             tracer, LCBTRACE_OP_REQUEST_ENCODING, LCBTRACE_NOW, &ref);
-        lcbtrace_span_add_tag_str(span, LCBTRACE_TAG_COMPONENT,
-                                  inst->clientString());
+        addChildTags(inst, tracer, span);
 
         return TraceSpan(span);
     }
@@ -98,7 +97,7 @@ public:
             return NULL;
         }
 
-        lcbtrace_TRACER *tracer = lcb_get_tracer(inst->lcbHandle());
+        lcbtrace_TRACER *tracer = inst->lcbTracer();
         if (!tracer) {
             return NULL;
         }
@@ -108,13 +107,24 @@ public:
         ref.span = opSpan.span();
         lcbtrace_SPAN *span = lcbtrace_span_start(
             tracer, LCBTRACE_OP_RESPONSE_DECODING, LCBTRACE_NOW, &ref);
-        lcbtrace_span_add_tag_str(span, LCBTRACE_TAG_COMPONENT,
-                                  inst->clientString());
+        addChildTags(inst, tracer, span);
 
         return TraceSpan(span);
     }
 
 private:
+    // The threshold logging tracer only reports the duration of these
+    // spans, so tagging them is only worth it for external tracers.
+    static void addChildTags(Instance *inst, lcbtrace_TRACER *tracer,
+                             lcbtrace_SPAN *span)
+    {
+        if (tracer->flags & LCBTRACE_F_THRESHOLD) {
+            return;
+        }
+        lcbtrace_span_add_tag_str(span, LCBTRACE_TAG_COMPONENT,
+                                  inst->clientString());
+    }
+
     TraceSpan(lcbtrace_SPAN *span)
         : _span(span)
     {
@@ -130,7 +140,7 @@ public:
         : _reqSpan(val, true)
         , _span(nullptr)
     {
-        lcbtrace_TRACER *tracer = lcb_get_tracer(inst->lcbHandle());
+        lcbtrace_TRACER *tracer = inst->lcbTracer();
         if (!tracer) {
             _span = nullptr;
             return;
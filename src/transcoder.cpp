@@ -0,0 +1,130 @@
+#include "transcoder.h"
+
+namespace couchnode
+{
+
+bool DefaultTranscoder::encode(Local<Value> value, Local<Value> *encoded,
+                               uint32_t *flags)
+{
+    // If its a buffer, write that directly as raw.
+    if (node::Buffer::HasInstance(value)) {
+        *flags = CF_RAW | NF_RAW;
+        *encoded = value;
+        return true;
+    }
+
+    // If its a string, encode it as a UTF8 string.
+    if (value->IsString()) {
+        *flags = CF_UTF8 | NF_UTF8;
+        *encoded = value;
+        return true;
+    }
+
+    // Encode it to JSON and save that otherwise.
+    Nan::MaybeLocal<String> jsonM =
+        JSON::Stringify(Nan::GetCurrentContext(), value);
+    if (jsonM.IsEmpty()) {
+        return false;
+    }
+
+    // JSON.stringify yields undefined for undefined, functions, symbols and
+    // objects whose toJSON() returns undefined, which V8 reports as the text
+    // "undefined".  That is never valid JSON, so it cannot be anything else.
+    Local<String> json = jsonM.ToLocalChecked();
+    if (json->StrictEquals(Nan::New("undefined").ToLocalChecked())) {
+        throwUnencodable();
+        return false;
+    }
+
+    *flags = CF_JSON | NF_JSON;
+    *encoded = json;
+    return true;
+}
+
+void DefaultTranscoder::throwUnencodable()
+{
+    // The JS transcoder passes undefined on to Buffer.from(), which throws a
+    // TypeError.  Make the same call, so that the same error is thrown.
+    Local<Object> global = Nan::GetCurrentContext()->Global();
+    Local<Value> bufferVal;
+    if (!Nan::Get(global, Nan::New("Buffer").ToLocalChecked())
+             .ToLocal(&bufferVal) ||
+        !bufferVal->IsObject()) {
+        return;
+    }
+    Local<Object> bufferObj = bufferVal.As<Object>();
+
+    Local<Value> fromVal;
+    if (!Nan::Get(bufferObj, Nan::New("from").ToLocalChecked())
+             .ToLocal(&fromVal) ||
+        !fromVal->IsFunction()) {
+        return;
+    }
+
+    Local<Value> args[] = {Nan::Undefined()};
+    Nan::Call(fromVal.As<Function>(), bufferObj, 1, args);
+}
+
+uint32_t DefaultTranscoder::format(uint32_t flags)
+{
+    uint32_t format = flags & NF_MASK;
+    uint32_t cfformat = flags & CF_MASK;
+
+    if (cfformat != CF_NONE) {
+        if (cfformat == CF_JSON) {
+            format = NF_JSON;
+        } else if (cfformat == CF_RAW) {
+            format = NF_RAW;
+        } else if (cfformat == CF_UTF8) {
+            format = NF_UTF8;
+        } else if (cfformat != CF_PRIVATE) {
+            // Unknown CF Format!  The following will force
+            //   fallback to reporting RAW data.
+            format = NF_UNKNOWN;
+        }
+    }
+
+    return format;
+}
+
+bool DefaultTranscoder::isText(uint32_t flags)
+{
+    uint32_t fmt = format(flags);
+    return fmt == NF_UTF8 || fmt == NF_JSON;
+}
+
+bool DefaultTranscoder::decode(Local<Value> *out, const char *bytes,
+                               size_t nbytes, uint32_t flags)
+{
+    uint32_t format = DefaultTranscoder::format(flags);
+
+    if (format != NF_UTF8 && format != NF_JSON) {
+        // Default to returning a Buffer if all else fails.
+        return false;
+    }
+
+    Nan::MaybeLocal<String> strM =
+        Nan::New<String>(bytes ? bytes : "", static_cast<int>(nbytes));
+    if (strM.IsEmpty()) {
+        return false;
+    }
+
+    if (format == NF_UTF8) {
+        *out = strM.ToLocalChecked();
+        return true;
+    }
+
+    // If we encounter a parse error, assume that we need to return bytes
+    // instead of an object.
+    Nan::TryCatch tryCatch;
+    Nan::MaybeLocal<Value> parsedM =
+        JSON::Parse(Nan::GetCurrentContext(), strM.ToLocalChecked());
+    if (parsedM.IsEmpty()) {
+        return false;
+    }
+
+    *out = parsedM.ToLocalChecked();
+    return true;
+}
+
+} // namespace couchnode
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef TRANSCODER_H
+#define TRANSCODER_H
+
+#include "valueparser.h"
+#include <nan.h>
+#include <node.h>
+
+namespace couchnode
+{
+
+using namespace v8;
+
+/*
+ * Native implementation of the DefaultTranscoder from lib/transcoders.ts.
+ * This is used whenever the JS layer passes no transcoder to an operation,
+ * and must remain byte-for-byte compatible with the JS implementation.
+ */
+class DefaultTranscoder
+{
+public:
+    static const uint32_t NF_JSON = 0x00;
+    static const uint32_t NF_RAW = 0x02;
+    static const uint32_t NF_UTF8 = 0x04;
+    static const uint32_t NF_MASK = 0xff;
+    static const uint32_t NF_UNKNOWN = 0x100;
+
+    static const uint32_t CF_NONE = 0x00 << 24;
+    static const uint32_t CF_PRIVATE = 0x01 << 24;
+    static const uint32_t CF_JSON = 0x02 << 24;
+    static const uint32_t CF_RAW = 0x03 << 24;
+    static const uint32_t CF_UTF8 = 0x04 << 24;
+    static const uint32_t CF_MASK = 0xffu << 24;
+
+    // Encodes a value into flags and the Buffer or String holding the bytes
+    // to store for it.  Values which cannot be encoded to JSON throw the same
+    // TypeError as the JS transcoder.
+    static bool encode(Local<Value> value, Local<Value> *encoded,
+                       uint32_t *flags);
+
+    // Decodes bytes and flags into a JS value.  Returns false when the
+    // result should be the raw bytes as a Buffer, which the caller builds.
+    static bool decode(Local<Value> *out, const char *bytes, size_t nbytes,
+                       uint32_t flags);
+
+    // Whether values with these flags are decoded from text, rather than
+    // being returned as raw bytes.
+    static bool isText(uint32_t flags);
+
+private:
+    static uint32_t format(uint32_t flags);
+    static void throwUnencodable();
+};
+
+} // namespace couchnode
+
+#endif // TRANSCODER_H
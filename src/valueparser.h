@@ -3,6 +3,7 @@
 #define VALUEPARSER_H
 
 #include "cas.h"
+#include "stringarena.h"
 #include <libcouchbase/couchbase.h>
 #include <stdint.h>
 #include <vector>
@@ -16,14 +17,27 @@ class ValueParser
 {
 public:
     ValueParser()
+        : _arena(nullptr)
     {
     }
 
+    explicit ValueParser(StringArena *arena)
+        : _arena(arena)
+    {
+        if (_arena) {
+            _arenaMark = _arena->mark();
+        }
+    }
+
     ~ValueParser()
     {
         for (size_t i = 0; i < _strings.size(); ++i) {
             delete _strings[i];
         }
+
+        if (_arena) {
+            _arena->rewind(_arenaMark);
+        }
     }
 
     template <typename T, typename V>
@@ -48,6 +62,10 @@ public:
             return true;
         }
 
+        if (_arena) {
+            return _parseArenaString(val, nval, str);
+        }
+
         Nan::Utf8String *utfStr = new Nan::Utf8String(str);
 
         if (utfStr->length() == 0) {
@@ -147,7 +165,51 @@ public:
     }
 
 private:
+    template <typename T, typename V>
+    bool _parseArenaString(const T **val, V *nval, Local<Value> value)
+    {
+        Nan::MaybeLocal<String> strM = Nan::To<String>(value);
+        if (strM.IsEmpty()) {
+            return false;
+        }
+        Local<String> str = strM.ToLocalChecked();
+
+#if NODE_MAJOR_VERSION >= 12
+        Isolate *isolate = Isolate::GetCurrent();
+        int length = str->Utf8Length(isolate);
+#else
+        int length = str->Utf8Length();
+#endif
+
+        if (length == 0) {
+            *val = NULL;
+            if (nval) {
+                *nval = 0;
+            }
+            return true;
+        }
+
+        char *buffer = _arena->alloc(length);
+        int flags = String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8;
+#if NODE_MAJOR_VERSION >= 12
+        str->WriteUtf8(isolate, buffer, length, nullptr, flags);
+#else
+        str->WriteUtf8(buffer, length, nullptr, flags);
+#endif
+
+        if (val) {
+            *val = reinterpret_cast<const T *>(buffer);
+        }
+        if (nval) {
+            *nval = length;
+        }
+
+        return true;
+    }
+
     std::vector<Nan::Utf8String *> _strings;
+    StringArena *_arena;
+    StringArena::Mark _arenaMark;
 };
 
 } // namespace couchnode
@@ -77,6 +77,33 @@ describe('#Cluster', function () {
     cluster.close()
   })
 
+  it('should deliver batched timeouts without waiting for other i/o', async function () {
+    var cluster = await H.lib.Cluster.connect(
+      H.connStr,
+      Object.assign({}, H.connOpts, { batchCompletions: true })
+    )
+    var coll = cluster.bucket(H.bucketName).defaultCollection()
+    var testKey = H.genTestKey()
+
+    await coll.insert(testKey, 'bar')
+    await coll.getAndLock(testKey, 5)
+
+    // The write is retried while the document is locked until it times
+    // out.  The timeout is failed from a timer rather than in response to
+    // any i/o, and must still be delivered promptly.
+    var timeoutMs = 500
+    var start = Date.now()
+    await H.throwsHelper(async () => {
+      await coll.upsert(testKey, 'baz', { timeout: timeoutMs })
+    }, Error)
+    var elapsed = Date.now() - start
+
+    assert(elapsed >= timeoutMs - 50, `timed out early after ${elapsed}ms`)
+    assert(elapsed < timeoutMs + 400, `timeout delivered after ${elapsed}ms`)
+
+    cluster.close()
+  })
+
   it('lcbVersion property should work', function () {
     assert(typeof H.lib.lcbVersion === 'string')
   })
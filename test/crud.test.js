@@ -1,6 +1,10 @@
 'use strict'
 
 const assert = require('chai').assert
+const {
+  transcoderToCppTranscoder,
+  translateCppError,
+} = require('../lib/bindingutilities')
 const H = require('./harness')
 
 const errorTranscoder = {
@@ -472,6 +476,178 @@ function genericTests(collFn) {
     })
   })
 
+  describe('#multi', function () {
+    let testKeys
+
+    function multiOp(fn, ...args) {
+      const coll = collFn()
+      return new Promise((resolve, reject) => {
+        coll.conn[fn](...coll._lcbScopeColl, ...args, (err, results) => {
+          if (err) {
+            return reject(err)
+          }
+          resolve(results)
+        })
+      })
+    }
+
+    function getMulti(keys) {
+      return multiOp(
+        'getMulti',
+        keys,
+        transcoderToCppTranscoder(collFn().transcoder),
+        undefined,
+        undefined
+      )
+    }
+
+    function upsertMulti(keys, values, timeout) {
+      return multiOp(
+        'upsertMulti',
+        keys,
+        values,
+        transcoderToCppTranscoder(collFn().transcoder),
+        undefined,
+        undefined,
+        undefined,
+        timeout
+      )
+    }
+
+    before(function () {
+      testKeys = []
+      for (var i = 0; i < 8; ++i) {
+        testKeys.push(H.genTestKey())
+      }
+    })
+
+    after(async function () {
+      for (const key of testKeys) {
+        try {
+          await collFn().remove(key)
+        } catch (e) {
+          // ignore
+        }
+      }
+    })
+
+    it('should upsert and get in key order', async function () {
+      var values = testKeys.map((key, idx) => ({ key: key, idx: idx }))
+      var ures = await upsertMulti(testKeys, values)
+      assert.lengthOf(ures, testKeys.length)
+      ures.forEach((res) => {
+        assert.isNull(res[0])
+        assert.isNotEmpty(res[1])
+      })
+
+      // request the keys in a different order than they were stored in
+      var keys = testKeys.slice().reverse()
+      var gres = await getMulti(keys)
+      assert.lengthOf(gres, keys.length)
+      gres.forEach((res, idx) => {
+        assert.isNull(res[0])
+        assert.isNotEmpty(res[1])
+        assert.deepStrictEqual(res[2], {
+          key: keys[idx],
+          idx: testKeys.indexOf(keys[idx]),
+        })
+      })
+    })
+
+    it('should report missing keys per item', async function () {
+      var missingKey = H.genTestKey()
+      var keys = [testKeys[0], missingKey, testKeys[1]]
+      var gres = await getMulti(keys)
+      assert.lengthOf(gres, 3)
+      assert.isNull(gres[0][0])
+      assert.strictEqual(gres[0][2].key, testKeys[0])
+      assert.instanceOf(
+        translateCppError(gres[1][0]),
+        H.lib.DocumentNotFoundError
+      )
+      assert.isNull(gres[2][0])
+      assert.strictEqual(gres[2][2].key, testKeys[1])
+    })
+
+    it('should report mixed per-key errors', async function () {
+      var lres = await collFn().getAndLock(testKeys[2], 2)
+
+      var keys = [testKeys[1], testKeys[2], testKeys[3]]
+      var ures = await upsertMulti(keys, [1, 2, 3], 1000000)
+      assert.lengthOf(ures, 3)
+      assert.isNull(ures[0][0])
+      assert.instanceOf(translateCppError(ures[1][0]), Error)
+      assert.isNull(ures[2][0])
+
+      var gres = await getMulti([testKeys[1], H.genTestKey(), testKeys[3]])
+      assert.strictEqual(gres[0][2], 1)
+      assert.instanceOf(
+        translateCppError(gres[1][0]),
+        H.lib.DocumentNotFoundError
+      )
+      assert.strictEqual(gres[2][2], 3)
+
+      await collFn().unlock(testKeys[2], lres.cas)
+    })
+
+    it('should fail the batch on bad arguments', async function () {
+      await H.throwsHelper(async () => {
+        await getMulti([])
+      }, Error)
+
+      await H.throwsHelper(async () => {
+        await upsertMulti(testKeys.slice(0, 2), [1])
+      }, Error)
+    })
+
+    it('should not dispatch any item of a bad batch before connecting', async function () {
+      const cluster = await H.newCluster()
+      const bucket = cluster.bucket(H.bucketName)
+      const scopeColl = collFn()._lcbScopeColl
+
+      // The bucket is still connecting, so the first item would be held
+      // until it is bootstrapped if it were scheduled.
+      const numCallbacks = { count: 0 }
+      assert.throws(() => {
+        bucket.conn.getMulti(
+          ...scopeColl,
+          [testKeys[0], Symbol('bad')],
+          undefined,
+          undefined,
+          undefined,
+          () => {
+            numCallbacks.count++
+          }
+        )
+      }, Error)
+
+      const gres = await new Promise((resolve, reject) => {
+        bucket.conn.getMulti(
+          ...scopeColl,
+          [testKeys[0], H.genTestKey()],
+          undefined,
+          undefined,
+          undefined,
+          (err, results) => {
+            if (err) {
+              return reject(err)
+            }
+            resolve(results)
+          }
+        )
+      })
+      assert.lengthOf(gres, 2)
+      assert.isNull(gres[0][0])
+      assert.instanceOf(
+        translateCppError(gres[1][0]),
+        H.lib.DocumentNotFoundError
+      )
+      assert.strictEqual(numCallbacks.count, 0)
+
+      await cluster.close()
+    })
+  })
+
   describe('#locks', function () {
     let testKeyLck
 
@@ -555,6 +731,44 @@ function genericTests(collFn) {
       assert.strictEqual(res.results, res.content)
     })
 
+    it('should create binding results of a single shape', async function () {
+      const coll = collFn()
+      const specs = [
+        H.lib.LookupInSpec.get('baz'),
+        H.lib.LookupInSpec.get('not-exists'),
+      ]
+      const cmdData = []
+      specs.forEach((spec) => cmdData.push(spec._op, spec._flags, spec._path))
+
+      const res = await new Promise((resolve, reject) => {
+        coll.conn.lookupIn(
+          ...coll._lcbScopeColl,
+          testKeySd,
+          0,
+          cmdData,
+          undefined,
+          undefined,
+          (err, res) => {
+            if (err) {
+              return reject(err)
+            }
+            resolve(res)
+          }
+        )
+      })
+
+      // The results are created from templates, which fixes the order of
+      // their properties whether or not an entry failed.
+      assert.deepStrictEqual(Object.keys(res), ['cas', 'content'])
+      assert.lengthOf(res.content, 2)
+      res.content.forEach((entry) => {
+        assert.deepStrictEqual(Object.keys(entry), ['error', 'value'])
+      })
+      assert.isNull(res.content[0].error)
+      assert.isOk(res.content[1].error)
+      assert.isNull(res.content[1].value)
+    })
+
     it('should doc-not-found for missing lookupIn', async function () {
       await H.throwsHelper(async () => {
         await collFn().lookupIn('some-document-which-does-not-exist', [
@@ -0,0 +1,119 @@
+'use strict'
+
+const assert = require('chai').assert
+const H = require('./harness')
+
+describe('#iothread', function () {
+  let cluster, coll
+
+  before(async function () {
+    cluster = await H.newCluster({ ioThread: true })
+    coll = cluster.bucket(H.bucketName).defaultCollection()
+  })
+
+  after(async function () {
+    if (cluster) {
+      await cluster.close()
+    }
+  })
+
+  it('should perform basic crud operations', async function () {
+    var testKey = H.genTestKey()
+
+    var ires = await coll.insert(testKey, { foo: 'bar' })
+    assert.isNotEmpty(ires.cas)
+
+    var gres = await coll.get(testKey)
+    assert.deepStrictEqual(gres.value, { foo: 'bar' })
+
+    await coll.replace(testKey, { foo: 'baz' }, { cas: gres.cas })
+    gres = await coll.get(testKey)
+    assert.deepStrictEqual(gres.value, { foo: 'baz' })
+
+    var lres = await coll.lookupIn(testKey, [H.lib.LookupInSpec.get('foo')])
+    assert.strictEqual(lres.content[0].value, 'baz')
+
+    var eres = await coll.exists(testKey)
+    assert.isTrue(eres.exists)
+
+    await coll.remove(testKey)
+    await H.throwsHelper(async () => {
+      await coll.get(testKey)
+    }, H.lib.DocumentNotFoundError)
+  })
+
+  it('should complete many concurrent operations', async function () {
+    var testKeys = []
+    for (var i = 0; i < 200; ++i) {
+      testKeys.push(H.genTestKey())
+    }
+
+    await Promise.all(testKeys.map((key, idx) => coll.upsert(key, idx)))
+    var gres = await Promise.all(testKeys.map((key) => coll.get(key)))
+    gres.forEach((res, idx) => assert.strictEqual(res.value, idx))
+
+    await Promise.all(testKeys.map((key) => coll.remove(key)))
+  })
+
+  it('should deliver synchronous completions', async function () {
+    // Ping and diagnostics responses cannot be cloned, so the I/O thread
+    // waits for these to be delivered on the V8 thread.  Running them
+    // alongside regular operations checks that this does not deadlock
+    // with the V8 thread taking the instance lock.
+    var testKey = H.genTestKey()
+    var ops = []
+    for (var i = 0; i < 20; ++i) {
+      ops.push(coll.upsert(testKey, i))
+      ops.push(
+        cluster.bucket(H.bucketName).ping({
+          serviceTypes: [H.lib.ServiceType.KeyValue],
+        })
+      )
+      ops.push(cluster.diagnostics())
+    }
+
+    var res = await Promise.all(ops)
+    for (var j = 0; j < res.length; j += 3) {
+      assert.isObject(res[j + 1])
+      assert.isObject(res[j + 1].services)
+      assert.isObject(res[j + 2])
+      assert.isArray(res[j + 2].services)
+    }
+
+    await coll.remove(testKey)
+  })
+
+  it('should fail operations in flight when closing', async function () {
+    var closeCluster = await H.newCluster({ ioThread: true })
+    var closeColl = closeCluster.bucket(H.bucketName).defaultCollection()
+    await closeColl.upsert(H.genTestKey(), 'warmup')
+
+    var ops = []
+    for (var i = 0; i < 100; ++i) {
+      ops.push(closeColl.upsert(H.genTestKey(), i))
+    }
+    await closeCluster.close()
+
+    // Every operation must settle, either having completed before the
+    // close or having been failed by it.
+    var res = await Promise.all(
+      ops.map((op) => op.then(() => null, (e) => e))
+    )
+    assert.lengthOf(res, ops.length)
+    res.forEach((err) => {
+      if (err) {
+        assert.instanceOf(err, Error)
+      }
+    })
+
+    await H.throwsHelper(async () => {
+      await closeColl.upsert(H.genTestKey(), 'after close')
+    }, Error)
+  })
+
+  it('should close a connection which has not been used', async function () {
+    var closeCluster = await H.newCluster({ ioThread: true })
+    closeCluster.bucket(H.bucketName)
+    await closeCluster.close()
+  })
+})
@@ -0,0 +1,160 @@
+'use strict'
+
+const assert = require('chai').assert
+const { ConnSpec } = require('../lib/connspec')
+const { batchLogFunc } = require('../lib/logging')
+const H = require('./harness')
+
+const LogSeverity = H.lib.LogSeverity
+
+// Records the log messages, along with the batch each was delivered in.
+class LogCollector {
+  constructor() {
+    this.records = []
+    this.numBatches = 0
+    this._inBatch = false
+    this.logFunc = (data) => this._log(data)
+  }
+
+  _log(data) {
+    // Every message of a batch is delivered before control returns to the
+    // event loop.
+    if (!this._inBatch) {
+      this._inBatch = true
+      this.numBatches++
+      setImmediate(() => {
+        this._inBatch = false
+      })
+    }
+    this.records.push(Object.assign({ batch: this.numBatches }, data))
+  }
+
+  matching(re) {
+    return this.records.filter((r) => re.test(r.message))
+  }
+}
+
+describe('#logging', function () {
+  // Each repeated option is logged as it is applied when the connection is
+  // created, all of them within a single tick of the event loop.
+  function connStrWithOptions(numOptions) {
+    var spec = ConnSpec.parse(H.connStr)
+    spec.options.operation_timeout = []
+    for (var i = 0; i < numOptions; ++i) {
+      spec.options.operation_timeout.push('10')
+    }
+    return spec.toString()
+  }
+
+  it('should only pass messages of the wanted severities and subsystems', async function () {
+    var collector = new LogCollector()
+    var cluster = await H.newCluster({
+      logFunc: collector.logFunc,
+      logLevel: LogSeverity.Info,
+      logSubsystems: ['instance'],
+    })
+    await cluster.close()
+    await H.sleep(100)
+
+    assert.isNotEmpty(collector.records)
+    collector.records.forEach((r) => {
+      assert.isAtLeast(r.severity, LogSeverity.Info)
+      assert.strictEqual(r.subsys, 'instance')
+    })
+    assert.isNotEmpty(collector.matching(/^Version=/))
+    assert.isEmpty(collector.matching(/^Applying initial cntl/))
+  })
+
+  it('should deliver the messages of a tick in a single batch', async function () {
+    var collector = new LogCollector()
+    var cluster = await H.newCluster({
+      connstr: connStrWithOptions(100),
+      logFunc: collector.logFunc,
+      logLevel: LogSeverity.Debug,
+      logSubsystems: ['instance'],
+    })
+    await cluster.close()
+    await H.sleep(100)
+
+    var applied = collector.matching(/^Applying initial cntl operation_timeout/)
+    assert.lengthOf(applied, 100)
+    applied.forEach((r) => assert.strictEqual(r.batch, applied[0].batch))
+  })
+
+  it('should report the number of dropped messages', async function () {
+    var numOptions = 2000
+    var collector = new LogCollector()
+    var cluster = await H.newCluster({
+      connstr: connStrWithOptions(numOptions),
+      logFunc: collector.logFunc,
+      logLevel: LogSeverity.Debug,
+      logSubsystems: ['instance'],
+    })
+    await cluster.close()
+    await H.sleep(100)
+
+    var applied = collector.matching(/^Applying initial cntl operation_timeout/)
+    assert.isBelow(applied.length, numOptions)
+
+    var dropped = collector.matching(/^\d+ log messages were dropped/)
+    assert.isNotEmpty(dropped)
+    var numDropped = 0
+    dropped.forEach((r) => {
+      assert.strictEqual(r.severity, LogSeverity.Warn)
+      assert.strictEqual(r.subsys, 'logger')
+      numDropped += parseInt(r.message)
+    })
+    assert.isAtLeast(applied.length + numDropped, numOptions)
+  })
+
+  it('should deliver messages logged while closing', async function () {
+    var collector = new LogCollector()
+    var cluster = await H.newCluster({
+      logFunc: collector.logFunc,
+      logLevel: LogSeverity.Debug,
+    })
+    var coll = cluster.bucket(H.bucketName).defaultCollection()
+    await coll.upsert(H.genTestKey(), 'logging')
+    await H.sleep(100)
+
+    var destroyedBefore = collector.matching(/Destroying context/).length
+    await cluster.close()
+
+    // The connections are destroyed on the next tick of the event loop,
+    // which closes their sockets.  The messages logged in doing so are
+    // passed on before the logger is disconnected.
+    await H.sleep(100)
+    var destroyedAfter = collector.matching(/Destroying context/).length
+    assert.isAbove(destroyedAfter, destroyedBefore)
+  })
+
+  it('should split a native batch into one call per message', function () {
+    var records = []
+    var logFunc = batchLogFunc((data) => records.push(data))
+
+    logFunc(
+      [LogSeverity.Debug, LogSeverity.Warn],
+      ['a.cc', 'b.cc'],
+      [1, 2],
+      ['instance', 'logger'],
+      ['first', 'second']
+    )
+
+    assert.deepStrictEqual(records, [
+      {
+        severity: LogSeverity.Debug,
+        srcFile: 'a.cc',
+        srcLine: 1,
+        subsys: 'instance',
+        message: 'first',
+      },
+      {
+        severity: LogSeverity.Warn,
+        srcFile: 'b.cc',
+        srcLine: 2,
+        subsys: 'logger',
+        message: 'second',
+      },
+    ])
+  })
+})
@@ -0,0 +1,158 @@
+'use strict'
+
+const assert = require('chai').assert
+const H = require('./harness')
+
+class TestValueRecorder {
+  constructor(name, tags) {
+    this.name = name
+    this.tags = tags
+    this.values = []
+    this.snapshots = []
+  }
+
+  recordValue(value) {
+    this.values.push(value)
+  }
+}
+
+class TestSnapshotRecorder extends TestValueRecorder {
+  recordSnapshot(snapshot) {
+    this.snapshots.push(snapshot)
+  }
+}
+
+class TestMeter {
+  constructor(recorderClass) {
+    this.recorderClass = recorderClass
+    this.recorders = []
+  }
+
+  valueRecorder(name, tags) {
+    var recorder = new this.recorderClass(name, tags)
+    this.recorders.push(recorder)
+    return recorder
+  }
+
+  snapshots() {
+    return [].concat(...this.recorders.map((r) => r.snapshots))
+  }
+
+  values() {
+    return [].concat(...this.recorders.map((r) => r.values))
+  }
+}
+
+describe('#metrics', function () {
+  async function runOps(coll, numOps) {
+    var testKey = H.genTestKey()
+    for (var i = 0; i < numOps; ++i) {
+      await coll.upsert(testKey, i)
+    }
+    await coll.remove(testKey)
+  }
+
+  it('should pass every value to recorders without recordSnapshot', async function () {
+    var meter = new TestMeter(TestValueRecorder)
+    var cluster = await H.newCluster({ meter: meter })
+    var coll = cluster.bucket(H.bucketName).defaultCollection()
+
+    await runOps(coll, 10)
+    await cluster.close()
+
+    assert.isAtLeast(meter.values().length, 11)
+    assert.isEmpty(meter.snapshots())
+  })
+
+  it('should emit snapshots at the emit interval', async function () {
+    var meter = new TestMeter(TestSnapshotRecorder)
+    var cluster = await H.newCluster({
+      meter: meter,
+      meterEmitInterval: 200,
+    })
+    var coll = cluster.bucket(H.bucketName).defaultCollection()
+
+    await runOps(coll, 10)
+    await H.sleep(500)
+
+    var snapshots = meter.snapshots()
+    assert.isNotEmpty(snapshots)
+    assert.isEmpty(meter.values())
+
+    var count = 0
+    snapshots.forEach((snapshot) => {
+      count += snapshot.count
+      assert.isAbove(snapshot.count, 0)
+      assert.isAtMost(snapshot.min, snapshot.mean)
+      assert.isAtLeast(snapshot.max, snapshot.mean)
+      assert.hasAllKeys(snapshot.percentiles, ['50', '90', '99', '99.9', '100'])
+      assert.isAtMost(snapshot.percentiles['50'], snapshot.percentiles['100'])
+    })
+    assert.isAtLeast(count, 11)
+
+    // Nothing is emitted for intervals without any values.
+    var numSnapshots = snapshots.length
+    await H.sleep(500)
+    assert.lengthOf(meter.snapshots(), numSnapshots)
+
+    await cluster.close()
+  }).timeout(5000)
+
+  it('should emit the remaining values when closing', async function () {
+    var meter = new TestMeter(TestSnapshotRecorder)
+    var cluster = await H.newCluster({
+      meter: meter,
+      meterEmitInterval: 600000,
+    })
+    var coll = cluster.bucket(H.bucketName).defaultCollection()
+
+    await runOps(coll, 10)
+    assert.isEmpty(meter.snapshots())
+
+    await cluster.close()
+
+    // The connection is destroyed on the next tick of the event loop.
+    await H.sleep(100)
+
+    var count = 0
+    meter.snapshots().forEach((snapshot) => (count += snapshot.count))
+    assert.isAtLeast(count, 11)
+  })
+
+  it('should keep emitting when recorders are created while emitting', async function () {
+    var meter = new TestMeter(TestSnapshotRecorder)
+    var cluster = await H.newCluster({
+      meter: meter,
+      meterEmitInterval: 200,
+    })
+    var bucket = cluster.bucket(H.bucketName)
+    var coll = bucket.defaultCollection()
+
+    // Starting a different kind of operation from within recordSnapshot
+    // creates a new recorder while the meter is emitting.
+    var started = false
+    var existsPromise = null
+    meter.recorderClass = class extends TestSnapshotRecorder {
+      recordSnapshot(snapshot) {
+        super.recordSnapshot(snapshot)
+        if (!started) {
+          started = true
+          existsPromise = coll.exists(H.genTestKey())
+        }
+      }
+    }
+
+    await runOps(coll, 5)
+    await H.sleep(500)
+    assert.isTrue(started)
+    await existsPromise
+    await H.sleep(500)
+
+    var names = meter.recorders
+      .filter((r) => r.snapshots.length > 0)
+      .map((r) => r.tags['db.operation'])
+    assert.include(names, 'exists')
+
+    await cluster.close()
+  }).timeout(5000)
+})
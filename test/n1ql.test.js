@@ -137,6 +137,111 @@ describe('#query', function () {
     }
   }).timeout(10000)
 
+  describe('#streaming', function () {
+    const numRows = 1000
+    const rangeQuery = `SELECT RAW x FROM ARRAY_RANGE(0, ${numRows}) AS x`
+
+    function expectedRows() {
+      return Array.from({ length: numRows }, (_, i) => i)
+    }
+
+    it('should deliver batched rows across pause and resume', async function () {
+      var events = []
+      var rowsWhilePaused = 0
+      var stream = H.c.query(rangeQuery, { rowBatchSize: 16 })
+
+      await new Promise((resolve, reject) => {
+        stream
+          .on('row', (row) => {
+            if (stream.isPaused()) {
+              rowsWhilePaused++
+            }
+            events.push(row)
+            if (events.length === 100) {
+              stream.pause()
+              setTimeout(() => stream.resume(), 200)
+            }
+          })
+          .on('meta', (meta) => events.push(meta))
+          .on('end', resolve)
+          .on('error', reject)
+      })
+
+      assert.strictEqual(rowsWhilePaused, 0)
+      assert.deepStrictEqual(events.slice(0, numRows), expectedRows())
+      assert.lengthOf(events, numRows + 1)
+      assert.isObject(events[numRows])
+    }).timeout(10000)
+
+    it('should apply backpressure to every row', async function () {
+      var rows = []
+      var rowsWhilePaused = 0
+      var meta = null
+      var stream = H.c.query(rangeQuery, { rowBatchSize: 64 })
+
+      await new Promise((resolve, reject) => {
+        stream
+          .on('row', (row) => {
+            if (stream.isPaused()) {
+              rowsWhilePaused++
+            }
+            rows.push(row)
+
+            // Only accept the next row once this one has been 'processed'.
+            stream.pause()
+            setImmediate(() => stream.resume())
+          })
+          .on('meta', (m) => {
+            assert.lengthOf(rows, numRows)
+            meta = m
+          })
+          .on('end', resolve)
+          .on('error', reject)
+      })
+
+      assert.strictEqual(rowsWhilePaused, 0)
+      assert.deepStrictEqual(rows, expectedRows())
+      assert.isObject(meta)
+    }).timeout(20000)
+
+    it('should resolve batched results when paused before any rows', async function () {
+      var stream = H.c.query(rangeQuery, {
+        rowBatchSize: 128,
+        rowBatchBytes: 256,
+      })
+      stream.pause()
+      setTimeout(() => stream.resume(), 200)
+
+      var res = await stream
+      assert.deepStrictEqual(res.rows, expectedRows())
+      assert.isObject(res.meta)
+    }).timeout(10000)
+
+    it('should deliver errors after the last batch', async function () {
+      var events = []
+      var badQuery = 'SELECT RAW x FROM ARRAY_RANGE(0, 10) AS x WHERE'
+      var stream = H.c.query(badQuery, { rowBatchSize: 16 })
+      stream.pause()
+
+      var ended = new Promise((resolve) => {
+        stream
+          .on('row', () => events.push('row'))
+          .on('meta', () => events.push('meta'))
+          .on('error', (err) => events.push(err))
+          .on('end', resolve)
+      })
+
+      await H.sleep(200)
+      assert.lengthOf(events, 0)
+
+      stream.resume()
+      await ended
+
+      assert.lengthOf(events, 1)
+      assert.instanceOf(events[0], H.lib.ParsingFailureError)
+    }).timeout(10000)
+  })
+
   it('should see test data correctly at scope level', async function () {
     H.skipIfMissingFeature(this, H.Features.Collections)
 
@@ -0,0 +1,104 @@
+'use strict'
+
+const assert = require('chai').assert
+const { transcoderToCppTranscoder } = require('../lib/bindingutilities')
+const H = require('./harness')
+
+describe('#pools', function () {
+  let cluster, coll, conn
+  let testKeys
+
+  before(async function () {
+    cluster = await H.newCluster()
+    var bucket = cluster.bucket(H.bucketName)
+    coll = bucket.defaultCollection()
+    await coll.upsert(H.genTestKey(), 'warmup')
+    conn = bucket.conn
+    testKeys = []
+  })
+
+  after(async function () {
+    for (const key of testKeys) {
+      await coll.remove(key).catch(() => {})
+    }
+    if (cluster) {
+      await cluster.close()
+    }
+  })
+
+  // Multi-operations copy their values through the string arena, whatever
+  // their size.
+  function upsertMulti(keys, values) {
+    return new Promise((resolve, reject) => {
+      conn.upsertMulti(
+        ...coll._lcbScopeColl,
+        keys,
+        values,
+        transcoderToCppTranscoder(coll.transcoder),
+        undefined,
+        undefined,
+        undefined,
+        undefined,
+        (err, results) => {
+          if (err) {
+            return reject(err)
+          }
+          resolve(results)
+        }
+      )
+    })
+  }
+
+  it('should report the pool counters', function () {
+    var stats = conn.poolStats()
+    assert.isNumber(stats.cookieHits)
+    assert.isNumber(stats.cookieMisses)
+    assert.isNumber(stats.stringArenaHits)
+    assert.isNumber(stats.stringArenaMisses)
+    assert.isNumber(stats.zeroCopyBuffers)
+
+    // The warmup operation needed a cookie and some string space.
+    assert.isAbove(stats.cookieHits + stats.cookieMisses, 0)
+    assert.isAbove(stats.stringArenaHits + stats.stringArenaMisses, 0)
+  })
+
+  it('should not allocate in steady state', async function () {
+    var testKey = H.genTestKey()
+    testKeys.push(testKey)
+    await coll.upsert(testKey, 'steady')
+
+    var before = conn.poolStats()
+    for (var i = 0; i < 10; ++i) {
+      await coll.upsert(testKey, 'steady')
+    }
+    var after = conn.poolStats()
+
+    assert.isAtLeast(after.cookieHits, before.cookieHits + 10)
+    assert.strictEqual(after.cookieMisses, before.cookieMisses)
+    assert.isAtLeast(after.stringArenaHits, before.stringArenaHits + 10)
+    assert.strictEqual(after.stringArenaMisses, before.stringArenaMisses)
+  })
+
+  it('should not retain space for oversized strings', async function () {
+    var testKey = H.genTestKey()
+    testKeys.push(testKey)
+    var largeValue = 'x'.repeat(64 * 1024)
+
+    // Each oversized value needs space of its own, which is released once
+    // the operation is scheduled rather than kept for the next one.
+    var before = conn.poolStats()
+    await upsertMulti([testKey], [largeValue])
+    await upsertMulti([testKey], [largeValue])
+    var after = conn.poolStats()
+    assert.strictEqual(after.stringArenaMisses, before.stringArenaMisses + 2)
+
+    var gres = await coll.get(testKey)
+    assert.strictEqual(gres.value, largeValue)
+
+    // Regular operations still reuse the space which was retained.
+    before = conn.poolStats()
+    await coll.upsert(testKey, 'small')
+    after = conn.poolStats()
+    assert.strictEqual(after.stringArenaMisses, before.stringArenaMisses)
+  })
+})
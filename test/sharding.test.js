@@ -0,0 +1,275 @@
+'use strict'
+
+const assert = require('chai').assert
+const { transcoderToCppTranscoder } = require('../lib/bindingutilities')
+const H = require('./harness')
+
+const numShards = 4
+
+describe('#sharding', function () {
+  let cluster, bucket, coll, conn
+
+  before(async function () {
+    cluster = await H.newCluster({ kvConnections: numShards })
+    bucket = cluster.bucket(H.bucketName)
+    coll = bucket.defaultCollection()
+
+    // Operations are only routed once every shard is connected.
+    await coll.upsert(H.genTestKey(), 'warmup')
+    conn = bucket.conn
+  })
+
+  after(async function () {
+    if (cluster) {
+      await cluster.close()
+    }
+  })
+
+  // Generates keys until every shard owns at least one of them.
+  function genShardedKeys(perShard) {
+    var byShard = []
+    for (var i = 0; i < numShards; ++i) {
+      byShard.push([])
+    }
+    while (byShard.some((keys) => keys.length < perShard)) {
+      var key = H.genTestKey()
+      var shard = conn._inst.keyShard(key, numShards)
+      if (byShard[shard].length < perShard) {
+        byShard[shard].push(key)
+      }
+    }
+    return byShard
+  }
+
+  function upsertMulti(keys, values, transcoder) {
+    return new Promise((resolve, reject) => {
+      conn.upsertMulti(
+        '',
+        '',
+        keys,
+        values,
+        transcoderToCppTranscoder(transcoder || coll.transcoder),
+        undefined,
+        undefined,
+        undefined,
+        undefined,
+        (err, results) => {
+          if (err) {
+            return reject(err)
+          }
+          resolve(results)
+        }
+      )
+    })
+  }
+
+  function getMulti(keys) {
+    return new Promise((resolve, reject) => {
+      conn.getMulti(
+        '',
+        '',
+        keys,
+        transcoderToCppTranscoder(coll.transcoder),
+        undefined,
+        undefined,
+        (err, results) => {
+          if (err) {
+            return reject(err)
+          }
+          resolve(results)
+        }
+      )
+    })
+  }
+
+  it('should create one binding connection per shard', function () {
+    assert.lengthOf(conn._shards, numShards)
+  })
+
+  it('should map keys to shards consistently', function () {
+    var keys = []
+    for (var i = 0; i < 200; ++i) {
+      keys.push(H.genTestKey())
+    }
+
+    var shards = conn._inst.keyShards(keys, numShards)
+    assert.lengthOf(shards, keys.length)
+    keys.forEach((key, idx) => {
+      assert.isAtLeast(shards[idx], 0)
+      assert.isBelow(shards[idx], numShards)
+      assert.strictEqual(shards[idx], conn._inst.keyShard(key, numShards))
+
+      // Every shard must agree on where a key belongs.
+      conn._shards.forEach((inst) => {
+        assert.strictEqual(inst.keyShard(key, numShards), shards[idx])
+      })
+    })
+
+    // The keys are spread over every shard.
+    assert.sameMembers(
+      Array.from(new Set(shards)),
+      Array.from({ length: numShards }, (_, i) => i)
+    )
+  })
+
+  it('should route single key operations to their shard', async function () {
+    var byShard = genShardedKeys(2)
+    var keys = [].concat(...byShard)
+
+    await Promise.all(keys.map((key) => coll.upsert(key, { key: key })))
+    var res = await Promise.all(keys.map((key) => coll.get(key)))
+    res.forEach((gres, idx) => {
+      assert.deepStrictEqual(gres.value, { key: keys[idx] })
+    })
+
+    await Promise.all(keys.map((key) => coll.remove(key)))
+  })
+
+  it('should reassemble multi operations spanning shards in order', async function () {
+    var byShard = genShardedKeys(3)
+
+    // Interleave the shards so that no shard owns a contiguous range.
+    var keys = []
+    for (var i = 0; i < 3; ++i) {
+      byShard.forEach((shardKeys) => keys.push(shardKeys[i]))
+    }
+    var values = keys.map((key, idx) => ({ idx: idx }))
+
+    var ures = await upsertMulti(keys, values)
+    assert.lengthOf(ures, keys.length)
+    ures.forEach((res) => assert.isNull(res[0]))
+
+    var missingKey = byShard[1][0] + '_missing'
+    var gkeys = keys.concat([missingKey]).reverse()
+    var gres = await getMulti(gkeys)
+    assert.lengthOf(gres, gkeys.length)
+    assert.isNotNull(gres[0][0])
+    gres.slice(1).forEach((res, idx) => {
+      assert.isNull(res[0])
+      assert.deepStrictEqual(res[2], { idx: keys.length - 1 - idx })
+    })
+
+    await Promise.all(keys.map((key) => coll.remove(key)))
+  })
+
+  it('should throw bad arguments before dispatching any shard', async function () {
+    var byShard = genShardedKeys(1)
+    var keys = [].concat(...byShard)
+
+    await H.throwsHelper(async () => {
+      await upsertMulti(keys, [1])
+    }, Error)
+  })
+
+  it('should fail the whole operation when a later shard fails', async function () {
+    var byShard = genShardedKeys(1)
+    var keys = [].concat(...byShard)
+    var values = keys.map((key, idx) => idx)
+
+    // The key of the last shard fails to encode, after the other shards
+    // have already been dispatched.
+    var failIdx = keys.length - 1
+    var failingTranscoder = {
+      encode: (value) => {
+        if (value === failIdx) {
+          throw new Error('encode error')
+        }
+        return [Buffer.from(JSON.stringify(value)), 0]
+      },
+      decode: (bytes) => JSON.parse(bytes.toString()),
+    }
+
+    var numCallbacks = 0
+    var err = await new Promise((resolve) => {
+      conn.upsertMulti(
+        '',
+        '',
+        keys,
+        values,
+        transcoderToCppTranscoder(failingTranscoder),
+        undefined,
+        undefined,
+        undefined,
+        undefined,
+        (err) => {
+          numCallbacks++
+          resolve(err)
+        }
+      )
+    })
+
+    assert.instanceOf(err, Error)
+    assert.match(err.message, /encode error/)
+
+    // Give any stray callback a chance to be invoked.
+    await H.sleep(100)
+    assert.strictEqual(numCallbacks, 1)
+
+    await Promise.all(
+      keys.slice(0, failIdx).map((key) => coll.remove(key).catch(() => {}))
+    )
+  })
+
+  it('should settle operations queued before connecting when they fail', async function () {
+    const newCluster = await H.newCluster({ kvConnections: numShards })
+    const newBucket = newCluster.bucket(H.bucketName)
+    const newColl = newBucket.defaultCollection()
+    const newConn = newBucket.conn
+    assert.isFalse(newConn._connected)
+
+    var byShard = genShardedKeys(1)
+    var keys = [].concat(...byShard)
+
+    // Bad arguments are still thrown to the caller.
+    var badKey = Symbol('bad')
+    var noop = () => {}
+    assert.throws(() => {
+      newConn.getMulti('', '', [badKey], undefined, undefined, undefined, noop)
+    }, Error)
+    assert.throws(() => {
+      newConn.get(
+        '',
+        '',
+        badKey,
+        undefined,
+        undefined,
+        undefined,
+        undefined,
+        undefined,
+        noop
+      )
+    }, Error)
+
+    // A failure only known once the operation is dispatched reaches its
+    // callback, and does not hold up the operations queued after it.
+    var failingTranscoder = {
+      encode: () => {
+        throw new Error('encode error')
+      },
+      decode: (bytes) => JSON.parse(bytes.toString()),
+    }
+    var failedUpsert = new Promise((resolve) => {
+      newConn.upsertMulti(
+        '',
+        '',
+        keys,
+        keys.map((key, idx) => idx),
+        failingTranscoder,
+        undefined,
+        undefined,
+        undefined,
+        undefined,
+        (err) => resolve(err)
+      )
+    })
+    var laterGet = newColl.get(keys[0]).catch((e) => e)
+
+    var err = await failedUpsert
+    assert.instanceOf(err, Error)
+    assert.match(err.message, /encode error/)
+    assert.instanceOf(await laterGet, H.lib.DocumentNotFoundError)
+    assert.isEmpty(newConn._connectWaiters)
+
+    await newCluster.close()
+  })
+})
@@ -0,0 +1,167 @@
+'use strict'
+
+const assert = require('assert')
+const { StreamableRowPromise } = require('../lib/streamablepromises')
+
+class FakeStreamControl {
+  constructor() {
+    this.paused = false
+    this.numPauses = 0
+    this.numResumes = 0
+  }
+
+  pause() {
+    this.paused = true
+    this.numPauses++
+    return true
+  }
+
+  resume() {
+    this.paused = false
+    this.numResumes++
+    return true
+  }
+}
+
+function createStream() {
+  var stream = new StreamableRowPromise((rows, meta) => ({ rows, meta }))
+  var control = new FakeStreamControl()
+  stream._setStreamControl(control)
+  return { stream, control }
+}
+
+// Emits rows the way the executors do when a batch is delivered.
+function emitBatch(stream, rows) {
+  rows.forEach((row) => stream.emit('row', row))
+}
+
+describe('#streamablepromises', function () {
+  it('should hold rows while paused and release them on resume', function () {
+    var { stream, control } = createStream()
+    var events = []
+    stream.on('row', (row) => events.push(['row', row]))
+    stream.on('meta', (meta) => events.push(['meta', meta]))
+    stream.on('end', () => events.push(['end']))
+
+    emitBatch(stream, [1, 2])
+    stream.pause()
+    assert.strictEqual(stream.isPaused(), true)
+    assert.strictEqual(control.paused, true)
+
+    emitBatch(stream, [3, 4])
+    stream.emit('meta', { status: 'success' })
+    stream.emit('end')
+    assert.deepStrictEqual(events, [
+      ['row', 1],
+      ['row', 2],
+    ])
+
+    stream.resume()
+    assert.strictEqual(stream.isPaused(), false)
+    assert.strictEqual(control.paused, false)
+    assert.deepStrictEqual(events, [
+      ['row', 1],
+      ['row', 2],
+      ['row', 3],
+      ['row', 4],
+      ['meta', { status: 'success' }],
+      ['end'],
+    ])
+  })
+
+  it('should not pause or resume the request more than once', function () {
+    var { stream, control } = createStream()
+
+    stream.resume()
+    assert.strictEqual(control.numResumes, 0)
+
+    stream.pause()
+    stream.pause()
+    assert.strictEqual(control.numPauses, 1)
+
+    stream.resume()
+    stream.resume()
+    assert.strictEqual(control.numResumes, 1)
+  })
+
+  it('should pause a request whose control arrives after pausing', function () {
+    var stream = new StreamableRowPromise((rows, meta) => ({ rows, meta }))
+    var control = new FakeStreamControl()
+
+    stream.pause()
+    stream._setStreamControl(control)
+    assert.strictEqual(control.paused, true)
+
+    stream.resume()
+    assert.strictEqual(control.paused, false)
+  })
+
+  it('should apply backpressure from within the row handler', function () {
+    var { stream, control } = createStream()
+    var rows = []
+    var pausedRows = []
+    var ended = false
+
+    // Pauses after every row, only accepting the next one once resumed.
+    stream.on('row', (row) => {
+      rows.push(row)
+      stream.pause()
+    })
+    stream.on('end', () => {
+      ended = true
+    })
+
+    emitBatch(stream, [1, 2, 3])
+    stream.emit('end')
+    assert.deepStrictEqual(rows, [1])
+    assert.strictEqual(control.paused, true)
+
+    while (!ended) {
+      pausedRows.push(rows.length)
+      stream.resume()
+    }
+
+    assert.deepStrictEqual(rows, [1, 2, 3])
+    assert.deepStrictEqual(pausedRows, [1, 2, 3])
+
+    // Nothing paused the stream once the end was delivered.
+    assert.strictEqual(stream.isPaused(), false)
+    assert.strictEqual(control.paused, false)
+  })
+
+  it('should deliver meta after the last batch', async function () {
+    var { stream } = createStream()
+    var resPromise = stream.then((res) => res)
+
+    stream.pause()
+    emitBatch(stream, [1, 2, 3])
+    emitBatch(stream, [4])
+    stream.emit('meta', { status: 'success' })
+    stream.emit('end')
+    stream.resume()
+
+    var res = await resPromise
+    assert.deepStrictEqual(res.rows, [1, 2, 3, 4])
+    assert.deepStrictEqual(res.meta, { status: 'success' })
+  })
+
+  it('should deliver errors after the last batch', async function () {
+    var { stream } = createStream()
+    var resPromise = stream.then((res) => res)
+    var events = []
+    stream.on('row', (row) => events.push(row))
+    stream.on('error', (err) => events.push(err.message))
+
+    emitBatch(stream, [1])
+    stream.pause()
+    emitBatch(stream, [2])
+    stream.emit('error', new Error('stream failed'))
+    stream.emit('end')
+    assert.deepStrictEqual(events, [1])
+
+    stream.resume()
+    assert.deepStrictEqual(events, [1, 2, 'stream failed'])
+
+    await assert.rejects(resPromise, /stream failed/)
+  })
+})
@@ -0,0 +1,128 @@
+'use strict'
+
+const assert = require('chai').assert
+const H = require('./harness')
+
+const DefaultTranscoder = H.lib.DefaultTranscoder
+
+const CF_PRIVATE = 0x01 << 24
+const CF_JSON = 0x02 << 24
+const CF_RAW = 0x03 << 24
+const CF_UTF8 = 0x04 << 24
+const NF_JSON = 0x00
+const NF_UTF8 = 0x04
+
+// The default transcoder is implemented natively, and is only used when the
+// DefaultTranscoder class itself is passed.  A subclass always goes through
+// the JS implementation.
+class JsDefaultTranscoder extends DefaultTranscoder {}
+
+// Stores and returns the bytes and flags it is given unchanged.
+const rawTranscoder = {
+  encode: (value) => [value.bytes, value.flags],
+  decode: (bytes, flags) => ({ bytes: bytes, flags: flags }),
+}
+
+describe('#transcoder', function () {
+  let coll, testKey
+
+  before(async function () {
+    coll = H.dco
+    testKey = H.genTestKey()
+  })
+
+  after(async function () {
+    await coll.remove(testKey).catch(() => {})
+  })
+
+  async function storedAs(value, transcoder) {
+    await coll.upsert(testKey, value, { transcoder: transcoder })
+    var res = await coll.get(testKey, { transcoder: rawTranscoder })
+    return res.value
+  }
+
+  async function decodedAs(bytes, flags, transcoder) {
+    await coll.upsert(
+      testKey,
+      { bytes: bytes, flags: flags },
+      { transcoder: rawTranscoder }
+    )
+    var res = await coll.get(testKey, { transcoder: transcoder })
+    return res.value
+  }
+
+  async function encodeError(value, transcoder) {
+    try {
+      await coll.upsert(testKey, value, { transcoder: transcoder })
+    } catch (e) {
+      return e
+    }
+    return null
+  }
+
+  const encodeCases = {
+    string: 'hello world',
+    Buffer: Buffer.from([0x00, 0x01, 0xfe, 0xff]),
+    object: { foo: 'bar', baz: [1, 2.5, null, true] },
+    number: 42,
+    null: null,
+    toJSON: { toJSON: () => ({ replaced: true }) },
+  }
+
+  Object.keys(encodeCases).forEach((name) => {
+    it(`should encode a ${name} like the JS transcoder`, async function () {
+      var value = encodeCases[name]
+      var native = await storedAs(value, new DefaultTranscoder())
+      var js = await storedAs(value, new JsDefaultTranscoder())
+      assert.isTrue(native.bytes.equals(js.bytes))
+      assert.strictEqual(native.flags, js.flags)
+    })
+  })
+
+  const unencodableCases = {
+    undefined: undefined,
+    function: function () {},
+    'toJSON returning undefined': { toJSON: () => undefined },
+  }
+
+  Object.keys(unencodableCases).forEach((name) => {
+    it(`should fail to encode ${name} like the JS transcoder`, async function () {
+      var value = unencodableCases[name]
+      var native = await encodeError(value, new DefaultTranscoder())
+      var js = await encodeError(value, new JsDefaultTranscoder())
+      assert.instanceOf(js, TypeError)
+      assert.instanceOf(native, TypeError)
+      assert.strictEqual(native.message, js.message)
+    })
+  })
+
+  const decodeCases = {
+    'a string': [Buffer.from('hello'), CF_UTF8 | NF_UTF8],
+    JSON: [Buffer.from('{"foo":[1,2]}'), CF_JSON | NF_JSON],
+    'raw bytes': [Buffer.from([0x00, 0xff]), CF_RAW],
+    'an unknown common flag': [Buffer.from('"text"'), (0x05 << 24) | NF_JSON],
+    'a private common flag': [Buffer.from('private'), CF_PRIVATE | NF_UTF8],
+    'invalid JSON': [Buffer.from('{not json'), CF_JSON | NF_JSON],
+    'legacy flags': [Buffer.from('legacy'), NF_UTF8],
+  }
+
+  Object.keys(decodeCases).forEach((name) => {
+    it(`should decode ${name} like the JS transcoder`, async function () {
+      var [bytes, flags] = decodeCases[name]
+      var native = await decodedAs(bytes, flags, new DefaultTranscoder())
+      var js = await decodedAs(bytes, flags, new JsDefaultTranscoder())
+      assert.deepStrictEqual(native, js)
+    })
+  })
+
+  it('should fall back to a Buffer for invalid JSON', async function () {
+    var bytes = Buffer.from('{not json')
+    var value = await decodedAs(
+      bytes,
+      CF_JSON | NF_JSON,
+      new DefaultTranscoder()
+    )
+    assert.instanceOf(value, Buffer)
+    assert.isTrue(value.equals(bytes))
+  })
+})
@@ -0,0 +1,100 @@
+'use strict'
+
+const assert = require('chai').assert
+const gc = require('expose-gc/function')
+const H = require('./harness')
+
+describe('#zerocopy', function () {
+  let cluster, coll, conn
+
+  before(async function () {
+    cluster = await H.newCluster({ zeroCopyValues: true })
+    var bucket = cluster.bucket(H.bucketName)
+    coll = bucket.defaultCollection()
+    await coll.upsert(H.genTestKey(), 'warmup')
+    conn = bucket.conn
+  })
+
+  after(async function () {
+    if (cluster) {
+      await cluster.close()
+    }
+  })
+
+  // Values are only referenced in place when they are large enough, and were
+  // read into a single network buffer.
+  function makeValue(fill) {
+    return Buffer.alloc(6000, fill)
+  }
+
+  it('should keep values valid after the next reads and a gc', async function () {
+    var testKey = H.genTestKey()
+    var otherKey = H.genTestKey()
+    await coll.upsert(testKey, makeValue('a'))
+    await coll.upsert(otherKey, makeValue('b'))
+
+    var liveBefore = conn.poolStats().zeroCopyBuffers
+
+    // Hold on to every value, some of them are read in place.
+    var held = []
+    for (var i = 0; i < 10; ++i) {
+      held.push((await coll.get(testKey)).value)
+    }
+    assert.isAbove(conn.poolStats().zeroCopyBuffers, liveBefore)
+
+    // Read over the network buffers which the held values were read into.
+    for (var j = 0; j < 20; ++j) {
+      var ores = await coll.get(otherKey)
+      assert.isTrue(ores.value.equals(makeValue('b')))
+    }
+    gc()
+    await H.sleep(10)
+
+    held.forEach((value) => {
+      assert.instanceOf(value, Buffer)
+      assert.isTrue(value.equals(makeValue('a')))
+    })
+
+    await coll.remove(testKey)
+    await coll.remove(otherKey)
+  })
+
+  it('should release the network buffers once the values are collected', async function () {
+    var testKey = H.genTestKey()
+    await coll.upsert(testKey, makeValue('c'))
+
+    gc()
+    await H.sleep(10)
+    var liveBefore = conn.poolStats().zeroCopyBuffers
+
+    var held = []
+    for (var i = 0; i < 10; ++i) {
+      held.push((await coll.get(testKey)).value)
+    }
+    assert.isAbove(conn.poolStats().zeroCopyBuffers, liveBefore)
+
+    held = null
+    for (var j = 0; j < 10; ++j) {
+      gc()
+      await H.sleep(10)
+      if (conn.poolStats().zeroCopyBuffers <= liveBefore) {
+        break
+      }
+    }
+    assert.strictEqual(conn.poolStats().zeroCopyBuffers, liveBefore)
+
+    await coll.remove(testKey)
+  })
+
+  it('should copy small values', async function () {
+    var testKey = H.genTestKey()
+    await coll.upsert(testKey, Buffer.from('small'))
+
+    var liveBefore = conn.poolStats().zeroCopyBuffers
+    var res = await coll.get(testKey)
+    assert.isTrue(res.value.equals(Buffer.from('small')))
+    assert.strictEqual(conn.poolStats().zeroCopyBuffers, liveBefore)
+
+    await coll.remove(testKey)
+  })
+})